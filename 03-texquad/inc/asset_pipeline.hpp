@@ -0,0 +1,140 @@
+#ifndef AZ_ASSET_PIPELINE_
+#define AZ_ASSET_PIPELINE_
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <file_reader.hpp>
+#include <task.hpp>
+#include <texture.hpp>
+#include <texture_import.hpp>
+#include <thread_pool.hpp>
+#include <upload_scheduler.hpp>
+
+/**
+ * Loads assets without blocking the render loop.
+ *
+ * Image files are read in batches (see file_reader.hpp) and decoded on a
+ * worker pool, where the pixels are also converted to the smallest adequate
+ * format (see texture_import.hpp) and written straight into a mapped pixel
+ * unpack buffer (PBO), from which the texture is then filled. GL work
+ * happens either on the render thread, at the frame boundary where pump() is
+ * called, or on a dedicated upload thread owning a context shared with the
+ * render context. Either way, finished textures only become visible to
+ * awaiting coroutines from pump().
+ *
+ *     Task<void> load_level(AssetPipeline& assets) {
+ *         GLuint texture = co_await assets.load_texture("../tex/1.png");
+ *         ...
+ *     }
+ */
+struct AssetPipeline final {
+    /* `make_upload_context_current`, when given, is called once on a new
+     * upload thread and must make a context sharing objects with the render
+     * context current there (e.g. a hidden GLFW window) */
+    explicit AssetPipeline(std::size_t n_decode_threads = 0,
+                           std::function<void()> make_upload_context_current = {});
+    ~AssetPipeline();
+
+    /* `priority` orders uploads in the scheduler, see below; `size_hint` lets
+     * oversized images load at a reduced resolution, see decode_image().
+     * Textures not expected to be drawn `minified` get lazy mipmaps, see
+     * ensure_mipmaps().
+     *
+     * Cooked textures (.aztx, see cooked_texture.hpp) are mapped and read in
+     * on the decode pool and uploaded as they are, from the level the size
+     * hint allows down; they bypass the scheduler */
+    Task<unsigned int> load_texture(std::string path, float priority = 0.0f,
+                                    TextureSizeHint size_hint = {}, bool minified = true);
+
+    /* Runs queued GL work and publishes finished assets; call once per frame
+     * from the render thread */
+    void pump();
+
+    /* Stops all loading: loads in flight are abandoned where they are, and
+     * neither finish nor fail. Call before destroying anything a load would
+     * resume into (e.g. a TextureManager), such as when the window closes
+     * mid-load; the destructor calls it too */
+    void shutdown();
+
+    /* Changes the upload priority of the image at `path`, whether it is
+     * already queued in the scheduler or still being decoded, e.g. as what
+     * it is drawn on comes into view. Render thread only; without the
+     * scheduler, it does nothing */
+    void set_priority(const std::string& path, float priority);
+
+    ThreadPool decode_pool;
+    FrameQueue frame_queue;
+
+    /* Hands finished reads to the decode pool */
+    FileReader file_reader;
+
+    /* When set, texture data is handed to this scheduler instead of being
+     * uploaded in one go, so big images are spread over several frames.
+     * pump() drives it. Only the fallback for pipelines without an upload
+     * thread, whose uploads never hold up a frame; with one, the scheduler
+     * is not used */
+    UploadScheduler* scheduler = nullptr;
+
+    /* With MipGeneration::cpu, mip chains are built on the decode pool and
+     * kept in the on-disk mip cache, see mipmap.hpp */
+    ImportOptions import_options;
+
+    /* Totals over every texture loaded so far */
+    struct ImportStats {
+        std::size_t textures = 0;
+        std::size_t bytes = 0;
+        std::size_t rgba8_bytes = 0;
+    };
+    ImportStats import_stats;
+
+    /* Print a line per texture with its format and the bytes it saved */
+    bool report_imports = true;
+
+private:
+    Task<unsigned int> load_texture_via_pbo(std::string path, TextureSizeHint size_hint,
+                                            ImportOptions options);
+    Task<unsigned int> load_texture_scheduled(std::string path, float priority,
+                                              TextureSizeHint size_hint, ImportOptions options);
+
+    Task<unsigned int> load_cooked_texture(std::string path, TextureSizeHint size_hint);
+
+    /* Reads and decodes an image, continuing on the decode pool */
+    Task<DecodedImage> decode(std::string path, TextureSizeHint size_hint);
+
+    /* The CPU mip chain `options` ask for, if any; runs on the decode pool */
+    MipChain mip_chain(const std::string& path, const DecodedImage& image, const ImportOptions& options);
+    void report_import(const std::string& path, const ImportedTexture& imported);
+
+    /* Drops `tickets` (uploads done or cancelled) from queued_uploads, and
+     * the entry of `path` once it has none left */
+    void forget_uploads(const std::string& path, const std::vector<UploadScheduler::Ticket>& tickets);
+
+    /* Continues on whichever thread issues GL calls for the pipeline */
+    Task<void> switch_to_gl_thread();
+
+    /* Continues on the render thread once `fence` has signalled */
+    Task<void> wait_fence(void* fence);
+
+    /* Called on the GL thread after uploading; with an upload thread,
+     * continues on the render thread once the render context may use what
+     * was uploaded */
+    Task<void> finish_upload();
+
+    /* Scheduler uploads by image path, for set_priority() */
+    struct QueuedUploads {
+        /* Overrides the priority the load was started with */
+        std::optional<float> priority;
+        std::vector<UploadScheduler::Ticket> tickets;
+    };
+    std::unordered_map<std::string, QueuedUploads> queued_uploads;
+
+    /* Single worker owning the shared upload context, if any */
+    std::unique_ptr<ThreadPool> upload_thread;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef AZ_ASYNC_SHADER_
+#define AZ_ASYNC_SHADER_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ProgramCache;
+
+/**
+ * Handle to a program being built by an AsyncProgramBuilder. Handles are
+ * cheap to copy; all copies observe the same build.
+ */
+struct ProgramFuture final {
+    enum class Status { pending, ready, failed };
+
+    struct State {
+        Status status = Status::pending;
+        unsigned int program = 0;
+        unsigned int vert_shader = 0;
+        unsigned int frag_shader = 0;
+        std::uint64_t cache_key = 0;
+        std::string error;
+    };
+
+    bool ready() const;
+    bool failed() const;
+
+    /* Linked program; throws if the build failed or is still pending */
+    unsigned int get() const;
+
+    /* Linked program if the build is done, `fallback` otherwise, so rendering
+     * can start before every program is available */
+    unsigned int get_or(unsigned int fallback) const;
+
+    /* Compile or link log of a failed build */
+    const std::string& error() const;
+
+    std::shared_ptr<State> state;
+};
+
+/**
+ * Builds programs without waiting on the driver between steps.
+ *
+ * submit() issues both compiles and the link right away and never queries a
+ * status, so drivers that compile on background threads can overlap all
+ * pending work. When GL_KHR_parallel_shader_compile is available, poll()
+ * checks GL_COMPLETION_STATUS_KHR and never blocks; without it, each poll()
+ * finishes at most one program so the cost is spread across frames.
+ *
+ * All calls must be made from the thread that owns the GL context.
+ */
+struct AsyncProgramBuilder final {
+    using LoadProc = void* (*)(const char* name);
+
+    /* `load_proc` resolves extension entry points (e.g. glfwGetProcAddress);
+     * `cache`, when given, is consulted before compiling and filled after
+     * successful links */
+    explicit AsyncProgramBuilder(LoadProc load_proc, ProgramCache* cache = nullptr);
+
+    ProgramFuture submit(const std::string& vert_shader_src,
+                         const std::string& frag_shader_src);
+
+    /* Same, for one stage linked as a GL_PROGRAM_SEPARABLE program, to be
+     * mixed with others by a program pipeline (see program_pipeline.hpp).
+     * Stages do not go through the cache */
+    ProgramFuture submit_stage(const std::string& shader_src, unsigned int gl_shader_type);
+
+    /* Finishes whatever builds are complete; returns how many are pending */
+    std::size_t poll();
+
+    /* Blocks until every submitted build is finished */
+    void wait_all();
+
+    std::size_t pending_count() const;
+
+    bool parallel_compile = false;
+
+private:
+    void finish(ProgramFuture::State& state);
+
+    ProgramCache* cache;
+    std::vector<std::shared_ptr<ProgramFuture::State>> pending;
+};
+
+#endif
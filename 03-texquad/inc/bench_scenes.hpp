@@ -0,0 +1,35 @@
+#ifndef AZ_BENCH_SCENES_
+#define AZ_BENCH_SCENES_
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+/**
+ * Scenes more than one benchmark draws, so that they all time the same
+ * frames. Each scene places sprites (the study's unit quad under a model
+ * matrix) and leaves drawing them to the caller.
+ */
+
+/* Draw call bound: a 64x48 grid of tiny sprites, each turned by `frame` and
+ * its place in the grid, alternating between two textures. Calls
+ * `draw_sprite(texture_index, model)` for every sprite; returns how many */
+template <typename DrawSprite>
+std::size_t draw_many_squares(int frame, DrawSprite&& draw_sprite) {
+    const int columns = 64;
+    const int rows = 48;
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            glm::vec3 position{-1.0f + (column + 0.5f) * 2.0f / columns,
+                               -1.0f + (row + 0.5f) * 2.0f / rows, 0.0f};
+            glm::mat4 model = glm::translate(glm::mat4{1.0f}, position);
+            model = glm::rotate(model, glm::radians(float(frame + row + column)), glm::vec3(0.0f, 0.0f, 1.0f));
+            model = glm::scale(model, glm::vec3(0.07f));
+            draw_sprite((row + column) % 2, model);
+        }
+    }
+    return std::size_t(columns) * rows;
+}
+
+#endif
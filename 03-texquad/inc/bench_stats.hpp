@@ -0,0 +1,27 @@
+#ifndef AZ_BENCH_STATS_
+#define AZ_BENCH_STATS_
+
+#include <vector>
+
+#include <json.hpp>
+
+/**
+ * Summaries of timing samples, as the benchmarks and the replay tool print
+ * and write them.
+ */
+
+struct SampleSummary {
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+};
+
+/* All zero for no samples */
+SampleSummary summarize(std::vector<double> samples);
+
+/* An object of `key` with mean, p50, p90, p99 and max */
+void write_summary(JsonWriter& json, const char* key, const SampleSummary& summary);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef AZ_BLOCK_COMPRESSION_
+#define AZ_BLOCK_COMPRESSION_
+
+#include <cstddef>
+
+/**
+ * S3TC block compression of RGBA8 images: 4x4 pixel blocks, each stored as
+ * two RGB565 endpoints plus 2-bit indices into a palette interpolated
+ * between them (BC1, 8 bytes, opaque), optionally preceded by a block of 8-bit
+ * alpha endpoints and 3-bit indices (BC3, 16 bytes).
+ *
+ * The encoder fits endpoints along the principal axis of each block's
+ * colors and refines them by least squares; it is meant for offline
+ * cooking, not for run time. The decoder is for GL implementations without
+ * S3TC support.
+ */
+enum class BlockFormat {
+    bc1,
+    bc3,
+};
+
+/* GL internal format (EXT_texture_compression_s3tc) */
+unsigned int block_gl_format(BlockFormat format);
+
+int block_bytes(BlockFormat format);
+
+/* Bytes of a compressed `width` x `height` image; partial blocks at the
+ * right and bottom edges take a whole block */
+std::size_t compressed_size(BlockFormat format, int width, int height);
+
+/* Compresses a tightly packed RGBA8 image into `dst`, which holds
+ * compressed_size() bytes. BC1 ignores alpha */
+void compress_image(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* dst);
+
+/* Decompresses into a tightly packed RGBA8 image */
+void decompress_image(BlockFormat format, const unsigned char* src, int width, int height,
+                      unsigned char* rgba);
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef AZ_COOKED_TEXTURE_
+#define AZ_COOKED_TEXTURE_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <texture.hpp>
+
+/**
+ * Textures cooked offline (tools/texture_cooker) into an .aztx container,
+ * ready to be handed to GL as they are: already flipped, with the whole mip
+ * chain, and either block compressed (see block_compression.hpp) or in the
+ * format the importer would have picked (see texture_import.hpp).
+ *
+ * Layout, little endian:
+ *
+ *     AztxHeader
+ *     AztxLevel[header.levels]
+ *     level data, each level starting at a multiple of 16 bytes
+ */
+struct AztxHeader {
+    char magic[8];
+    std::uint32_t version;
+    /* GL internal format, compressed or not */
+    std::uint32_t internal_format;
+    /* Pixel format and type of uncompressed data; what compressed data
+     * decompresses to */
+    std::uint32_t format;
+    std::uint32_t type;
+    std::int32_t swizzle[4];
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t levels;
+    std::uint32_t flags;
+};
+
+struct AztxLevel {
+    std::uint64_t offset;
+    std::uint64_t bytes;
+};
+
+/* AztxHeader::flags */
+constexpr std::uint32_t AZTX_FLIPPED = 1;
+constexpr std::uint32_t AZTX_PREMULTIPLIED = 2;
+
+struct CookOptions {
+    enum class Format {
+        /* BC1 for opaque images, BC3 otherwise */
+        automatic,
+        /* Uncompressed, in the importer's smallest adequate format */
+        raw,
+        bc1,
+        bc3,
+    };
+    Format format = Format::automatic;
+    bool mipmaps = true;
+    /* Store rows bottom first, as GL expects them */
+    bool flip_y = true;
+    bool premultiply_alpha = false;
+};
+
+/* The .aztx file for `image` */
+std::vector<unsigned char> cook_texture(const DecodedImage& image, const CookOptions& options = {});
+
+/* Whether `path` names a cooked texture (by its extension) */
+bool is_cooked_texture(std::string_view path);
+
+/**
+ * A cooked texture mapped into memory, or served from the mounted resource
+ * pack (see resource_pack.hpp). The header and level table are
+ * checked on opening, so level data can be used without further checks.
+ */
+struct CookedTexture final {
+    /* Throws std::runtime_error if the file cannot be mapped or is not a
+     * valid container */
+    explicit CookedTexture(const std::string& path);
+    ~CookedTexture();
+    CookedTexture(CookedTexture&& other) noexcept;
+    CookedTexture& operator=(CookedTexture&& other) noexcept;
+    CookedTexture(const CookedTexture&) = delete;
+    CookedTexture& operator=(const CookedTexture&) = delete;
+
+    const AztxHeader& header() const;
+    bool compressed() const;
+    int level_width(int level) const;
+    int level_height(int level) const;
+    const unsigned char* level_data(int level) const;
+    std::size_t level_bytes(int level) const;
+
+    /* Of all levels, i.e. the GL memory the texture takes when uploaded as
+     * it is */
+    std::size_t bytes() const;
+
+    /* Reads the whole file in, so that later accesses (e.g. the upload on
+     * the GL thread) do not wait for the disk */
+    void prefetch() const;
+
+private:
+    void map(const std::string& path);
+
+    const unsigned char* data = nullptr;
+    std::size_t size = 0;
+    /* Owns a mapping of its own, rather than viewing a resource pack */
+    bool mapped = false;
+};
+
+/* Whether the GL context can take the cooked data as it is; if not,
+ * upload_cooked() decompresses it to RGBA8 */
+bool cooked_format_supported(const CookedTexture& cooked);
+
+/* Creates a texture holding `cooked` from level `first_level` down (e.g.
+ * skipped_levels() of a size hint), accounted for as `owner`'s, and leaves it
+ * bound */
+unsigned int upload_cooked(const CookedTexture& cooked, int first_level, std::string owner);
+
+std::string cooked_report(const std::string& name, const CookedTexture& cooked, int first_level = 0);
+
+#endif
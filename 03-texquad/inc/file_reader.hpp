@@ -0,0 +1,110 @@
+#ifndef AZ_FILE_READER_
+#define AZ_FILE_READER_
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+
+#include <thread_pool.hpp>
+
+/* The whole contents of a file; shares ownership of its buffer */
+struct FileContents {
+    std::shared_ptr<const unsigned char[]> data;
+    std::size_t size = 0;
+
+    std::span<const unsigned char> bytes() const {
+        return {this->data.get(), this->size};
+    }
+};
+
+/* Reads a whole file with as few read() calls as its size allows; throws
+ * std::runtime_error if it cannot be opened or read */
+FileContents read_file(const std::string& path);
+
+/**
+ * Reads whole files asynchronously, so that many pending reads keep the
+ * disk busy at once instead of being issued one after another.
+ *
+ * On Linux with io_uring, a reader thread gathers every read requested
+ * since its last submission and submits them together, into buffers carved
+ * out of one registered arena where they fit (larger files get buffers of
+ * their own). Elsewhere, or when AZ_NO_IO_URING is set, reads are spread
+ * over a pool of threads doing pread().
+ *
+ *     FileContents file = co_await reader.read("../tex/1.png");
+ *
+ * Either way the awaiting coroutine resumes on `completion_pool`, e.g. the
+ * decode pool, ready to work on the bytes. Arena buffers go back to the
+ * arena once the last FileContents sharing them is gone. The reader must
+ * outlive the reads it has been given.
+ */
+struct FileReader final {
+    explicit FileReader(ThreadPool& completion_pool, unsigned queue_depth = 64,
+                        std::size_t arena_slots = 32, std::size_t slot_bytes = 1 << 20);
+    ~FileReader();
+    FileReader(const FileReader&) = delete;
+    FileReader& operator=(const FileReader&) = delete;
+
+    struct Request {
+        std::string path;
+        std::coroutine_handle<> handle;
+        FileContents contents;
+        std::exception_ptr error;
+    };
+
+    auto read(std::string path) {
+        struct Awaiter {
+            FileReader& reader;
+            Request request;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                this->request.handle = handle;
+                reader.submit(&this->request);
+            }
+            FileContents await_resume() {
+                if (this->request.error) {
+                    std::rethrow_exception(this->request.error);
+                }
+                return std::move(this->request.contents);
+            }
+        };
+        return Awaiter{*this, {std::move(path), {}, {}, {}}};
+    }
+
+    bool uses_io_uring() const;
+
+    /* Submissions made to the kernel and reads they carried; more reads
+     * than batches means requests were batched. io_uring only */
+    std::atomic<std::size_t> batches{0};
+    std::atomic<std::size_t> batched_reads{0};
+
+    struct Arena;
+    struct Ring;
+
+private:
+    void submit(Request* request);
+    void complete(Request* request);
+    void run();
+
+    ThreadPool& completion_pool;
+    std::shared_ptr<Arena> arena;
+    std::unique_ptr<Ring> ring;
+
+    /* Requests not yet picked up by the reader thread */
+    std::mutex mutex;
+    std::deque<Request*> pending;
+    bool stopping = false;
+    std::thread reader_thread;
+
+    /* Fallback */
+    std::unique_ptr<ThreadPool> read_pool;
+};
+
+#endif
@@ -1,13 +1,19 @@
 #include <shader_prog.hpp>
 
 struct Geometry {
+    /* A non-empty `name` labels the geometry (see label()) and owns its
+     * memory in memory_accounting.hpp from the start */
     Geometry(
             std::initializer_list<float> vertices,
-            std::initializer_list<int> indices);
+            std::initializer_list<int> indices,
+            std::string_view name = {});
 
     void draw();
     void del();
 
+    /* Names the vertex array and buffers in GL debug output, see gl_debug.hpp */
+    void label(std::string_view name) const;
+
     std::size_t n_indices;
 
     unsigned int vbo;
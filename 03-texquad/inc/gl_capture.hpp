@@ -0,0 +1,127 @@
+#ifndef AZ_GL_CAPTURE_
+#define AZ_GL_CAPTURE_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * GL capture and replay: a frame that is slow on some machine is captured
+ * there, as every GL call with the data it references (buffer and texture
+ * contents, shader sources, uniform values), into one compact binary file;
+ * the replay tool (tools/gl_replay.cpp) re-issues the calls on a headless
+ * context, as often as wanted, timing each one. Repro files can go with bug
+ * reports, and application and driver costs can be told apart offline.
+ *
+ *     gladLoadGL();
+ *     start_gl_capture({"slow.azgl", 100, 3});
+ *     while (running) {
+ *         ...
+ *         gl_capture_end_frame();
+ *     }
+ *
+ * Replaying a frame needs the objects it uses, so the capture starts right
+ * after GL is loaded and keeps everything before the captured frames that
+ * creates or changes objects or state; only draws, clears, reads and
+ * queries of earlier frames are left out. Of their bindings (programs,
+ * vertex arrays, textures, buffers other than element arrays),
+ * fixed-function state (clear color, viewport, blending, glEnable, ...)
+ * and uniform values, only the last per binding point, state or uniform is
+ * kept, so frames that redo the same state add nothing for it; uploads and
+ * other object changes still add up with first_frame. Calls of all threads
+ * are kept, in the order they were made, with the thread that made them:
+ * each thread is replayed on a context of its own, sharing objects with the
+ * others.
+ *
+ * Referenced data is found by function: what each pointer argument points
+ * to and how large it is. Pointers into buffer objects (vertex attributes,
+ * indices, pixel unpack buffers) are kept as offsets; data written to
+ * mapped buffers is kept when they are unmapped or flushed. Pointers the
+ * capture knows nothing about replay as scratch memory, and callbacks as
+ * null. Only the functions of gl_functions.inc (GL 3.3 core, and the
+ * extensions the study uses) are captured; calls of others are missing.
+ */
+
+struct GlCaptureOptions {
+    std::string path;
+    /* The frames to capture, counted by gl_capture_end_frame() calls */
+    std::uint64_t first_frame = 0;
+    std::uint64_t frames = 1;
+};
+
+/* Must be called with glad loaded and before any GL objects are created,
+ * as their creation would be missing otherwise. Throws std::runtime_error if
+ * the file cannot be created */
+void start_gl_capture(const GlCaptureOptions& options);
+
+/* Ends a frame; after the last one to capture, writes out the file and puts
+ * the original GL functions back. Throws std::runtime_error if the file
+ * cannot be written */
+void gl_capture_end_frame();
+
+/* Ends the capture early, keeping the frames captured so far */
+void stop_gl_capture();
+
+bool gl_capture_active();
+
+struct GlReplayFunctionStats {
+    const char* name;
+    std::uint64_t calls;
+    std::uint64_t time_ns;
+};
+
+struct GlReplayStats {
+    /* Time spent in GL calls, per frame played */
+    std::vector<double> frame_ms;
+    /* All frames played, most expensive function first */
+    std::vector<GlReplayFunctionStats> functions;
+    std::uint64_t calls = 0;
+    /* Only counted with GlReplay::check_errors */
+    std::uint64_t errors = 0;
+};
+
+struct GlReplayState;
+
+/* A capture file, loaded for replay on the current context */
+struct GlReplay final {
+    /* Throws std::runtime_error if the file cannot be read or is not a
+     * capture */
+    explicit GlReplay(const std::string& path);
+    ~GlReplay();
+
+    /* Replays the calls before the captured frames, which create the
+     * objects and state they use; once, before play_frames() */
+    void set_up();
+
+    /* Replays the captured frames, timing every call */
+    GlReplayStats play_frames();
+
+    /* Makes the context for the given captured thread current; thread 0
+     * (the first to call GL) is expected to be current to begin with */
+    std::function<void(std::size_t thread)> make_current;
+    /* Stands in for the default framebuffer of thread 0, e.g. a headless
+     * context's offscreen one */
+    unsigned int default_framebuffer = 0;
+    /* Call glGetError after every call, and report errors on std::cerr */
+    bool check_errors = false;
+
+    /* Viewport size when the capture started */
+    int width = 0;
+    int height = 0;
+    std::size_t frames = 0;
+    std::size_t threads = 1;
+
+private:
+    std::vector<std::uint8_t> data;
+    /* Where the calls start (past the header), where the set-up calls end
+     * and where each captured frame ends, in `data` */
+    std::size_t calls_start = 0;
+    std::vector<std::size_t> frame_ends;
+    /* Name mappings and statistics, see gl_capture.cpp */
+    std::unique_ptr<GlReplayState> state;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef AZ_GL_DEBUG_
+#define AZ_GL_DEBUG_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * GL debug output (KHR_debug, core since OpenGL 4.3): what the driver has
+ * to say about the calls it gets, errors and also performance warnings
+ * that never show up as errors (implicit synchronisation, shaders
+ * recompiled for some state, texel formats converted on upload). Meant for
+ * a dev mode, on a context created with the debug flag (many drivers say
+ * little otherwise):
+ *
+ *     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+ *     ...
+ *     gladLoadGL();
+ *     install_gl_debug(glfw_get_proc_address);
+ *
+ * Messages are classified (see GlDebugCategory) and deduplicated by what
+ * they are about: the first of each kind is logged to std::cerr, repeats
+ * only at 10, 100, 1000, ... occurrences, and print_gl_debug_summary() has
+ * all of them with counts. Each message is logged with the debug groups
+ * (GlDebugGroup) and the profiler zone (profiler.hpp) open on the thread
+ * that caused it, and in builds with AZ_PROFILE it is also put in the trace
+ * as an instant event, inside that zone. Output is made synchronous for
+ * this, so the callback runs in the offending GL call.
+ *
+ * Debug groups and object labels show in these messages and in GL
+ * debuggers (RenderDoc, apitrace). They cost a branch while debug output is
+ * not installed.
+ */
+
+enum class GlDebugCategory {
+    error,
+    undefined_behavior,
+    /* Performance warnings, by what the driver had to do */
+    implicit_sync,
+    shader_recompile,
+    format_conversion,
+    performance,
+    deprecated,
+    portability,
+    /* Compiler and linker output */
+    shader_compiler,
+    /* Notifications and anything else */
+    info,
+};
+
+const char* gl_debug_category_name(GlDebugCategory category);
+
+struct GlDebugOptions {
+    /* Log notification-severity messages too; they are counted anyway */
+    bool log_notifications = false;
+    /* Messages come from within the calls that caused them, on their
+     * thread; without, the driver may report them later and from anywhere,
+     * and groups and zones are unknown */
+    bool synchronous = true;
+};
+
+/* Loads the KHR_debug entry points glad did not (on contexts older than
+ * 4.3), enables debug output and registers the callback. Returns false,
+ * leaving everything as it was, if the context has no debug output. Call on
+ * each context to be debugged, the first one first: the entry points and
+ * options are set by the first call, later calls only enable output on
+ * their context */
+bool install_gl_debug(void* (*get_proc_address)(const char* name), const GlDebugOptions& options = {});
+bool gl_debug_installed();
+
+struct GlDebugMessageStats {
+    GlDebugCategory category;
+    unsigned int source;
+    unsigned int type;
+    unsigned int id;
+    unsigned int severity;
+    /* As first reported */
+    std::string text;
+    /* Debug groups and profiler zone open at the first report */
+    std::string context;
+    std::uint64_t count;
+};
+
+/* Messages so far, most frequent first */
+std::vector<GlDebugMessageStats> gl_debug_messages();
+
+/* Counts per category, then the `top` most frequent messages */
+void print_gl_debug_summary(std::ostream& out, std::size_t top = 20);
+
+/* Names a GL object (GL_BUFFER, GL_TEXTURE, GL_PROGRAM, ... and name), for
+ * messages and debuggers; truncated to what the driver takes */
+void gl_object_label(unsigned int identifier, unsigned int name, std::string_view label);
+
+/* Marks the GL calls made while it lives, on the current context. The name
+ * must be a string literal or otherwise outlive the group */
+struct GlDebugGroup final {
+    explicit GlDebugGroup(const char* name);
+    ~GlDebugGroup();
+    GlDebugGroup(const GlDebugGroup&) = delete;
+    GlDebugGroup& operator=(const GlDebugGroup&) = delete;
+
+    bool pushed;
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef AZ_GL_EXT_
+#define AZ_GL_EXT_
+
+#include <string_view>
+
+/* Whether the current context advertises the given extension. The extension
+ * list is read once per context and then cached */
+bool has_gl_extension(std::string_view name);
+
+/* Drops the cached extension list, e.g. after switching contexts */
+void reset_gl_extensions();
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef AZ_GL_TRACE_
+#define AZ_GL_TRACE_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * GL call tracing: once installed, the function pointers glad loaded (those
+ * of gl_functions.inc: GL 3.3 core, and the extensions the study uses) are
+ * replaced by wrappers that count (and optionally time) the call, inspect
+ * the arguments of draws, uploads and state changes, and run the given
+ * callbacks around it. Until then, and after uninstalling, GL calls go
+ * straight to the driver, so builds that never install it pay nothing.
+ *
+ *     gladLoadGL();
+ *     if (std::getenv("AZ_GL_TRACE")) {
+ *         install_gl_trace();
+ *     }
+ *     ...
+ *     print_gl_frame_stats(std::cerr, gl_trace_end_frame());
+ *
+ * Counters are shared by all threads, so GL calls of an upload thread count
+ * towards the frame they happen in.
+ */
+
+struct GlTraceOptions {
+    /* Time each call; CPU time in the driver, which for most calls is not
+     * where the GPU spends it */
+    bool timing = true;
+    /* Call glGetError after every call and report errors on std::cerr,
+     * naming the call. The application's own glGetError calls then see no
+     * errors */
+    bool check_errors = false;
+    /* Called before and after every GL call with its index, see
+     * gl_function_name() */
+    void (*before)(std::size_t function) = nullptr;
+    void (*after)(std::size_t function) = nullptr;
+};
+
+/* Must be called with glad loaded and no GL calls in flight on other
+ * threads; installing again just changes the options */
+void install_gl_trace(const GlTraceOptions& options = {});
+void uninstall_gl_trace();
+bool gl_trace_installed();
+
+/* Name of the function with the given index, e.g. "glDrawElements" */
+const char* gl_function_name(std::size_t function);
+
+/* Bytes per pixel of client pixel data of the given format and type, as
+ * glTexImage2D and glReadPixels take them */
+std::uint64_t gl_pixel_bytes(unsigned int format, unsigned int type);
+
+struct GlFunctionStats {
+    const char* name;
+    std::uint64_t calls;
+    std::uint64_t time_ns;
+};
+
+struct GlFrameStats {
+    std::uint64_t calls = 0;
+    std::uint64_t time_ns = 0;
+    std::uint64_t draw_calls = 0;
+    /* Triangles, lines or points drawn, instances included; unknown for
+     * indirect draws */
+    std::uint64_t primitives = 0;
+    /* Binds, enables, blend/depth/stencil/raster state, viewport and the
+     * like; uniforms are not counted */
+    std::uint64_t state_changes = 0;
+    /* Data handed to buffer objects (glBufferData, glBufferSubData, mapped
+     * for writing) and to textures (texel data, from client memory or a
+     * pixel unpack buffer) */
+    std::uint64_t buffer_bytes = 0;
+    std::uint64_t texture_bytes = 0;
+    std::uint64_t errors = 0;
+
+    /* Functions called in the frame, most expensive (or most called, without
+     * timing) first */
+    std::vector<GlFunctionStats> functions;
+};
+
+/* Statistics since the previous call; resets them */
+GlFrameStats gl_trace_end_frame();
+
+/* A few lines: totals, then the `top` first functions */
+void print_gl_frame_stats(std::ostream& out, const GlFrameStats& stats, std::size_t top = 8);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef AZ_HASH_
+#define AZ_HASH_
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+/* 64-bit FNV-1a; pass the previous result as `hash` to chain several inputs */
+inline std::uint64_t fnv1a_64(const void* data, std::size_t size,
+                              std::uint64_t hash = 0xcbf29ce484222325ull) {
+    auto bytes = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+inline std::uint64_t fnv1a_64(std::string_view text,
+                              std::uint64_t hash = 0xcbf29ce484222325ull) {
+    return fnv1a_64(text.data(), text.size(), hash);
+}
+
+#endif
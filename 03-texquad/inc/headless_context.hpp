@@ -0,0 +1,66 @@
+#ifndef AZ_HEADLESS_CONTEXT_
+#define AZ_HEADLESS_CONTEXT_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * An OpenGL 3.3 core context without a window or display, for benchmarks
+ * and tests on CI machines: EGL on the surfaceless platform where available
+ * (Mesa, including the llvmpipe software rasterizer), on the default
+ * display with a tiny pbuffer otherwise.
+ *
+ * Rendering goes to an offscreen framebuffer of the requested size (RGBA8
+ * color, 24-bit depth and 8-bit stencil) in place of a window's back
+ * buffer.
+ */
+struct HeadlessContext final {
+    /* Makes the context current, loads GL entry points (glad) and binds the
+     * framebuffer. Throws std::runtime_error if no such context can be had */
+    HeadlessContext(int width, int height);
+    ~HeadlessContext();
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    void make_current() const;
+
+    /* Binds the offscreen framebuffer and sets the viewport to it */
+    void bind_framebuffer() const;
+
+    /* RGBA8 contents of the framebuffer, bottom row first */
+    std::vector<unsigned char> read_pixels() const;
+
+    /* Creates a context sharing objects with this one; the returned function
+     * makes it current on whichever thread calls it, e.g. as the upload
+     * context of an AssetPipeline. It lives as long as this context */
+    std::function<void()> shared_context();
+
+    /* For glad and AsyncProgramBuilder */
+    static void* get_proc_address(const char* name);
+
+    /* GL_RENDERER, e.g. "llvmpipe (LLVM 15.0.6, 256 bits)" */
+    std::string renderer() const;
+
+    int width;
+    int height;
+
+private:
+    /* Deletes whatever of the below has been made; for the destructor, and
+     * for the constructor when it fails halfway */
+    void release();
+
+    /* EGL handles, kept opaque so users need not include EGL */
+    void* display = nullptr;
+    void* config = nullptr;
+    void* context = nullptr;
+    void* surface = nullptr;
+    std::vector<void*> shared_contexts;
+    std::vector<void*> shared_surfaces;
+
+    unsigned int framebuffer = 0;
+    unsigned int color_buffer = 0;
+    unsigned int depth_buffer = 0;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef AZ_JSON_
+#define AZ_JSON_
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Just enough JSON for benchmark results and the like: a streaming writer,
+ * and a reader flattening a document into dotted paths.
+ *
+ *     JsonWriter json{out};
+ *     json.begin_object();
+ *     json.field("scene", "squares");
+ *     json.begin_object("cpu_ms").field("p50", 0.42).end_object();
+ *     json.end_object();
+ */
+struct JsonWriter final {
+    explicit JsonWriter(std::ostream& out);
+
+    /* `key` is required inside objects and ignored inside arrays */
+    JsonWriter& begin_object(std::string_view key = {});
+    JsonWriter& end_object();
+    JsonWriter& begin_array(std::string_view key = {});
+    JsonWriter& end_array();
+
+    JsonWriter& field(std::string_view key, double value);
+    JsonWriter& field(std::string_view key, std::int64_t value);
+    JsonWriter& field(std::string_view key, std::uint64_t value);
+    JsonWriter& field(std::string_view key, int value);
+    JsonWriter& field(std::string_view key, bool value);
+    JsonWriter& field(std::string_view key, std::string_view value);
+    JsonWriter& field(std::string_view key, const char* value);
+
+    /* Array elements */
+    JsonWriter& value(double value);
+    JsonWriter& value(std::string_view value);
+
+private:
+    void key(std::string_view key);
+    void string(std::string_view text);
+
+    std::ostream& out;
+    /* Per open container: whether it is an object, and whether it has had
+     * an element yet */
+    std::vector<std::pair<bool, bool>> stack;
+};
+
+/* The scalars of a JSON document by dotted path, e.g. "cpu_ms.p50" or
+ * "frames.3" for array elements: numbers as written, strings unescaped,
+ * true/false/null as such. Throws std::runtime_error on malformed input */
+std::map<std::string, std::string> flatten_json(std::string_view json);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef AZ_LZ4_
+#define AZ_LZ4_
+
+#include <cstddef>
+
+/**
+ * LZ4 block format (no frame): sequences of literals and back references
+ * of at least 4 bytes up to 64 KiB back. Decoding is a few copies per
+ * sequence, which is what resource packs want; the greedy encoder is meant
+ * for packing offline.
+ */
+
+/* Worst case compressed size of `size` bytes */
+std::size_t lz4_compress_bound(std::size_t size);
+
+/* Compresses into `dst`, which holds lz4_compress_bound(size) bytes;
+ * returns the compressed size */
+std::size_t lz4_compress(const unsigned char* src, std::size_t size, unsigned char* dst);
+
+/* Decompresses exactly `dst_size` bytes; throws std::runtime_error on
+ * malformed input rather than reading or writing out of bounds */
+void lz4_decompress(const unsigned char* src, std::size_t size, unsigned char* dst, std::size_t dst_size);
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef AZ_MEMORY_ACCOUNTING_
+#define AZ_MEMORY_ACCOUNTING_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Memory accounting: what the GL objects of the process (buffers, textures,
+ * renderbuffers) and some of its own memory (pixels waiting for upload)
+ * take, who they belong to, and how that compares to a budget, for sizing
+ * scenes to memory-constrained machines.
+ *
+ * Allocations are recorded where they are made (Geometry, the texture
+ * importer, AssetPipeline, UploadScheduler, ...) with their size, format,
+ * mip levels, a category (what kind of data) and an owner (which asset),
+ * and released where the objects are deleted. GL does not say how much
+ * memory an object really takes; sizes are what the formats ask for, before
+ * any padding or alignment the driver adds.
+ *
+ * With a budget, an allocation that would go past it is logged to
+ * std::cerr, or refused with MemoryBudgetExceeded before anything is
+ * allocated. Everything here may be called from any thread.
+ */
+
+enum class MemoryKind {
+    buffer,
+    texture,
+    renderbuffer,
+    /* CPU memory */
+    host,
+};
+
+const char* memory_kind_name(MemoryKind kind);
+
+struct MemoryAllocation {
+    MemoryKind kind;
+    /* The GL name, or a host_allocation_id() */
+    std::uint64_t id;
+    std::size_t bytes;
+    /* Internal format of textures and renderbuffers, usage of buffers */
+    unsigned int format = 0;
+    int width = 0;
+    int height = 0;
+    int mip_levels = 1;
+    /* What the memory holds, e.g. "textures", "geometry" */
+    std::string category;
+    /* Whose it is, e.g. an image path; may be given later, see
+     * set_memory_owner() */
+    std::string owner;
+};
+
+struct MemoryUsage {
+    std::size_t bytes = 0;
+    std::size_t peak_bytes = 0;
+    std::size_t allocations = 0;
+};
+
+struct MemoryTotals {
+    /* Buffers, textures and renderbuffers */
+    MemoryUsage gpu;
+    MemoryUsage host;
+    std::map<MemoryKind, MemoryUsage> kinds;
+    std::map<std::string, MemoryUsage> categories;
+};
+
+enum class MemoryBudgetPolicy {
+    warn,
+    refuse,
+};
+
+/* Limits of 0 are no limit */
+struct MemoryBudget {
+    std::size_t gpu_bytes = 0;
+    std::size_t host_bytes = 0;
+    MemoryBudgetPolicy policy = MemoryBudgetPolicy::warn;
+};
+
+struct MemoryBudgetExceeded : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+void set_memory_budget(const MemoryBudget& budget);
+MemoryBudget memory_budget();
+
+/* Records an allocation, in place of any earlier one of the same kind and
+ * id (e.g. glBufferData on a buffer that had storage). Call before
+ * allocating: past the budget, it warns or throws MemoryBudgetExceeded,
+ * recording nothing */
+void record_allocation(MemoryAllocation allocation);
+/* Does nothing for allocations never recorded */
+void record_release(MemoryKind kind, std::uint64_t id);
+void set_memory_owner(MemoryKind kind, std::uint64_t id, std::string owner);
+
+/* A fresh id for host allocations */
+std::uint64_t host_allocation_id();
+
+MemoryTotals memory_totals();
+/* Live allocations, largest first */
+std::vector<MemoryAllocation> memory_allocations();
+
+/* Totals, then the `top` largest allocations */
+void print_memory_totals(std::ostream& out, std::size_t top = 10);
+
+/* Totals, breakdowns, budget and every live allocation as JSON; throws
+ * std::runtime_error if the file cannot be written */
+void write_memory_report(const std::string& path);
+
+/* Rewrites the report at `path` every `interval`, from memory_frame() */
+void set_memory_report(std::string path, std::chrono::milliseconds interval = std::chrono::seconds{1});
+/* Call once per frame; writes the report when due, logging errors */
+void memory_frame();
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef AZ_MIPMAP_
+#define AZ_MIPMAP_
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <texture.hpp>
+
+struct ThreadPool;
+
+/* How a texture gets the levels past 0 */
+enum class MipGeneration {
+    /* glGenerateMipmap() after uploading level 0 */
+    gpu,
+    /* Built on the CPU (or read from the mip cache) and uploaded with level 0 */
+    cpu,
+    /* Storage for every level, but only level 0 is filled and sampled until
+     * ensure_mipmaps() is called (see TextureHandle::drawn_at()); for
+     * textures not expected to be drawn minified */
+    lazy,
+};
+
+/**
+ * Levels 1 and up of an 8-bit image, tightly packed, back to back, with the
+ * channels of the image they were built from. Level 0 is the image itself
+ * and is not stored.
+ *
+ * Each level is a 2x2 box filter of the one above (sizes halve, rounding
+ * down, as in GL). Color channels are averaged in linear light, alpha as is.
+ */
+struct MipChain {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    /* Including level 0 */
+    int levels = 1;
+    std::unique_ptr<unsigned char[]> pixels;
+
+    int level_width(int level) const;
+    int level_height(int level) const;
+    std::size_t level_offset(int level) const;
+    const unsigned char* level(int level) const;
+
+    /* Of levels 1 and up */
+    std::size_t bytes() const;
+};
+
+/* Builds `levels` levels (counting level 0) below `level0`, tightly packed
+ * `channels`-channel pixels; with `srgb`, color channels are taken as sRGB
+ * encoded. Work is split into bands of rows run on `pool`, or on a shared
+ * pool of one thread per core when none is given */
+MipChain build_mip_chain(const unsigned char* level0, int width, int height, int channels, int levels,
+                         bool srgb = true, ThreadPool* pool = nullptr);
+
+/**
+ * On-disk cache of the mip chains of source images, kept in `mip_cache_dir`
+ * as `<image name>.<path hash>.<width>x<height>.mips`: keyed by the absolute
+ * source path, and by the decoded size, so reduced-resolution loads (see
+ * decode_image()) get their own entry next to the full one. An entry is
+ * valid for the size and modification time the source had when it was
+ * written, and for the exact decoded size and channels. Failing to write one
+ * (e.g. a read-only cache directory) is not an error.
+ */
+std::string mip_cache_path(std::string_view source_path, int width, int height);
+
+/* Relative to the working directory, next to the program cache; set before
+ * loading any texture */
+extern std::filesystem::path mip_cache_dir;
+
+std::optional<MipChain> load_cached_mip_chain(std::string_view source_path, const DecodedImage& image,
+                                              int levels, bool srgb = true);
+
+void store_cached_mip_chain(std::string_view source_path, const MipChain& chain, bool srgb = true);
+
+/* The cached chain of `image`, decoded from `source_path`, or a freshly
+ * built (and cached) one */
+MipChain cached_mip_chain(std::string_view source_path, const DecodedImage& image, int levels,
+                          bool srgb = true, ThreadPool* pool = nullptr);
+
+/* Fills the levels of the bound GL_TEXTURE_2D a MipGeneration::lazy import
+ * left empty and makes them visible to sampling; does nothing if they are
+ * already in use. The levels are built on the CPU from a read back level 0
+ * in 8-bit formats, by glGenerateMipmap() in packed ones */
+void ensure_mipmaps(bool srgb = true);
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef AZ_NULL_GL_
+#define AZ_NULL_GL_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * Null GL driver: fills glad's function pointers, in place of gladLoadGL(),
+ * with functions that keep objects, state and queries in memory and record
+ * the command stream, but never rasterize. No display, GPU or EGL is needed,
+ * and nothing else runs inside the "driver", so benchmarks on it measure the
+ * CPU cost of issuing the commands alone, and the same way on any machine:
+ *
+ *     load_null_gl();
+ *     Geometry quad{...};
+ *     null_gl_recording().clear();
+ *     quad.draw();
+ *     for (const NullGlCommand& command : null_gl_recording().commands) {
+ *         std::cout << gl_function_name(command.function) << '\n';
+ *     }
+ *
+ * It reports an OpenGL 3.3 core context with the extensions whose
+ * functions gl_functions.inc has (texture storage, program binaries,
+ * separate shader objects, debug output), and no program binary formats.
+ * Implemented in memory are object names (buffers, textures, vertex
+ * arrays, framebuffers, renderbuffers, samplers, queries, program
+ * pipelines, shaders, programs and syncs),
+ * buffer contents (so mapping works), texture level sizes and parameters,
+ * shader compile and program link status (always successful), uniform
+ * locations, bindings, enables, viewport and the like, through glGet*.
+ * Texel data is not kept; glReadPixels, glGetTexImage and queries the
+ * driver knows nothing about leave their outputs untouched. Queries' results
+ * are available immediately: timestamps are taken from the CPU clock and
+ * elapsed times are 0. Fences are signalled right away.
+ *
+ * There is a single context and no locking: GL calls must come from one
+ * thread at a time.
+ */
+
+/* One recorded call; `function` is an index as taken by gl_function_name()
+ * (gl_trace.hpp) */
+struct NullGlCommand {
+    std::uint32_t function;
+    std::uint32_t first_arg;
+    std::uint32_t n_args;
+};
+
+/* The calls made while recording, in order. Arguments are widened to 64 bits:
+ * integers and enums by value, floating point numbers by their bits, pointers
+ * by address (what they point to is not copied) */
+struct NullGlRecording {
+    std::vector<NullGlCommand> commands;
+    std::vector<std::uint64_t> args;
+
+    std::span<const std::uint64_t> arguments(const NullGlCommand& command) const {
+        return {this->args.data() + command.first_arg, command.n_args};
+    }
+
+    void clear() {
+        this->commands.clear();
+        this->args.clear();
+    }
+};
+
+/* Points glad at the null driver and resets its state, dropping all objects.
+ * Recording starts out as given */
+void load_null_gl(bool record = true);
+
+/* Recording costs a few nanoseconds per call; off, the driver's own cost is
+ * close to that of an empty function */
+void set_null_gl_recording(bool record);
+
+NullGlRecording& null_gl_recording();
+
+/* Contents of a buffer object, or nullptr if there is no such buffer */
+const std::vector<std::byte>* null_gl_buffer_data(unsigned int buffer);
+
+#endif
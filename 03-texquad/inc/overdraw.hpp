@@ -0,0 +1,104 @@
+#ifndef AZ_OVERDRAW_
+#define AZ_OVERDRAW_
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include <shader_prog.hpp>
+
+/**
+ * Overdraw analysis: how many fragments a frame shades per pixel, and how
+ * many of them are not fully transparent, to put numbers on culling and
+ * trimming (e.g. sprites cut to the shape of their opaque texels).
+ *
+ * Between begin_frame() and end_frame(), drawing goes to an RG32F target
+ * with additive blending, and the sprite program is built with the
+ * OVERDRAW feature of shaders/fragment.shader, which outputs 1 in red for
+ * every fragment and 1 in green for fragments whose texel is not fully
+ * transparent. end_frame() shows the red count as a heat map in the
+ * framebuffer that was bound before (pixels shaded with nothing visible
+ * darker) and reads both counts back into OverdrawStats.
+ *
+ * The counts are float rather than R32UI: integer targets do not blend.
+ * They stay exact up to 2^24 fragments per pixel. Scenes must leave the
+ * blend state alone meanwhile. The target has no depth buffer, so depth
+ * testing passes every fragment: the counts are those of the scene drawn
+ * without it, and a "visible" fragment is one with an opaque enough texel,
+ * whether or not something drawn later covers it.
+ *
+ * Readbacks go through pixel buffers and are collected a few frames later,
+ * like the profiler's GPU queries, so the mode costs little beyond the
+ * extra bandwidth and never waits for the GPU.
+ */
+
+struct OverdrawStats {
+    /* Counted from 0 at the first end_frame() */
+    std::uint64_t frame = 0;
+    int width = 0;
+    int height = 0;
+    /* Fragments, all of them and those not fully transparent ("visible",
+     * even where later fragments cover them) */
+    std::uint64_t shaded_fragments = 0;
+    std::uint64_t visible_fragments = 0;
+    /* Pixels with at least one of each */
+    std::uint64_t covered_pixels = 0;
+    std::uint64_t visible_pixels = 0;
+    /* Most fragments shaded for one pixel */
+    std::uint64_t max_overdraw = 0;
+
+    /* Fragments per covered pixel */
+    double average_overdraw() const;
+    /* Share of the shaded fragments that were fully transparent */
+    double wasted_share() const;
+};
+
+/* One line: overdraw average and max, fragments shaded vs. visible */
+void print_overdraw_stats(std::ostream& out, const OverdrawStats& stats);
+
+struct OverdrawView final {
+    /* Frames between a readback and its collection */
+    static const int LATENCY = 3;
+
+    /* Counts at `width`x`height`, which should match the viewport. Needs
+     * the heat-map shaders, shaders/overdraw/ */
+    OverdrawView(int width, int height);
+
+    /* Binds and clears the counting target and sets additive blending */
+    void begin_frame();
+    /* Restores the framebuffer and blend state, draws the heat map into the
+     * framebuffer and starts reading back the counts. Returns the stats of
+     * an earlier frame whose counts have arrived, if any */
+    std::optional<OverdrawStats> end_frame();
+    /* Waits for the counts still on their way */
+    std::vector<OverdrawStats> finish();
+    void del();
+
+    /* Overdraw at which the heat map saturates */
+    float max_shown = 8.0f;
+
+    int width;
+    int height;
+    ShaderProgram heat_map;
+    unsigned int framebuffer = 0;
+    unsigned int counts = 0;
+    unsigned int empty_vertex_array = 0;
+    /* Readbacks in flight, by frame; fences are GLsync */
+    unsigned int pixel_buffers[LATENCY + 1] = {};
+    void* fences[LATENCY + 1] = {};
+    std::uint64_t frames = 0;
+    std::uint64_t collected = 0;
+
+    /* State begin_frame() changed */
+    int previous_framebuffer = 0;
+    bool previous_blend = false;
+    int previous_blend_src = 0;
+    int previous_blend_dst = 0;
+    int previous_blend_equation = 0;
+
+private:
+    OverdrawStats collect(std::uint64_t frame);
+};
+
+#endif
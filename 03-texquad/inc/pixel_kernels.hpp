@@ -0,0 +1,70 @@
+#ifndef AZ_PIXEL_KERNELS_
+#define AZ_PIXEL_KERNELS_
+
+#include <array>
+#include <cstddef>
+
+/**
+ * Everything done to decoded 8-bit pixels on their way to the upload
+ * staging buffer, fused into a single pass:
+ *
+ * - vertical flip (GL wants the bottom row first),
+ * - channel expansion, selection and reordering (`swizzle`),
+ * - sRGB to linear conversion of the color channels,
+ * - alpha premultiplication.
+ *
+ * Kernels exist for SSE2 and AVX2 and are picked at run time according to
+ * what the CPU supports. The scalar kernel is the reference the others must
+ * match bit for bit.
+ */
+struct PixelConversion {
+    /* Swizzle entry producing a constant 255 */
+    static constexpr int ONE = 4;
+
+    int src_channels = 4;
+    int dst_channels = 4;
+
+    /* Source channel (or ONE) feeding each destination channel */
+    std::array<int, 4> swizzle{0, 1, 2, 3};
+
+    bool flip_y = false;
+
+    /* Color channels only; with two or four destination channels the last
+     * one is alpha and is left as is */
+    bool srgb_to_linear = false;
+    bool premultiply_alpha = false;
+
+    /* Swizzle taking `src_channels` to `dst_channels` the way GL expands
+     * formats: gray is replicated, missing alpha is opaque, and keeping fewer
+     * channels than there are keeps gray (+ alpha) or RGB */
+    static PixelConversion expand(int src_channels, int dst_channels);
+};
+
+enum class PixelIsa {
+    scalar,
+    sse2,
+    avx2,
+};
+
+/* Best instruction set supported by this CPU */
+PixelIsa detected_pixel_isa();
+
+/* The instruction set convert_image() uses; defaults to the detected one.
+ * Asking for more than the CPU has falls back to what it has */
+PixelIsa pixel_isa();
+void set_pixel_isa(PixelIsa isa);
+
+const char* pixel_isa_name(PixelIsa isa);
+
+/* Converts a tightly packed `width` x `height` image into `dst`, which holds
+ * width * height * dst_channels bytes and may be write-combined (mapped GL
+ * memory): it is written sequentially and never read */
+void convert_image(const PixelConversion& conversion, const unsigned char* src,
+                   int width, int height, unsigned char* dst);
+
+/* Same, with an explicit kernel; for checking the SIMD kernels against
+ * PixelIsa::scalar */
+void convert_image(PixelIsa isa, const PixelConversion& conversion, const unsigned char* src,
+                   int width, int height, unsigned char* dst);
+
+#endif
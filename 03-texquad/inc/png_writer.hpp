@@ -0,0 +1,25 @@
+#ifndef AZ_PNG_WRITER_
+#define AZ_PNG_WRITER_
+
+#include <string>
+#include <vector>
+
+/**
+ * PNG encoding for screenshots and golden images, without zlib: each row
+ * gets the filter with the smallest sum of absolute residuals (the usual
+ * heuristic), and the filtered rows go through LZ77 with fixed Huffman
+ * codes. Files come out a bit larger than zlib's, and read back with any
+ * decoder, stb_image included.
+ */
+
+/* `pixels` are 8-bit with 1 (gray), 2 (gray, alpha), 3 (RGB) or 4 (RGBA)
+ * channels, rows tightly packed, top row first unless `flip_y` (as read back
+ * with glReadPixels) */
+std::vector<unsigned char> encode_png(const unsigned char* pixels, int width, int height, int channels,
+                                      bool flip_y = false);
+
+/* Same, written to `path`; throws std::runtime_error on failure */
+void write_png(const std::string& path, const unsigned char* pixels, int width, int height, int channels,
+               bool flip_y = false);
+
+#endif
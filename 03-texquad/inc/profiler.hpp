@@ -0,0 +1,122 @@
+#ifndef AZ_PROFILER_
+#define AZ_PROFILER_
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Frame profiler: where the time of a frame goes, on the CPU threads and on
+ * the GPU, written out as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+ *
+ * Instrumentation goes through the macros below, which expand to nothing
+ * unless AZ_PROFILE is defined (CMake option AZ_PROFILE), so uninstrumented
+ * builds pay nothing for it:
+ *
+ *     while (running) {
+ *         {
+ *             AZ_PROFILE_ZONE("Scene::draw");
+ *             AZ_PROFILE_GPU_ZONE("Scene::draw");
+ *             scene.draw();
+ *         }
+ *         AZ_PROFILE_FRAME();
+ *     }
+ *     AZ_PROFILE_WRITE_TRACE("ortho.trace.json");
+ *
+ * Zone names must be string literals, or otherwise live until the trace is
+ * written; only the pointer is recorded.
+ *
+ * CPU zones record nanosecond timestamps into a buffer of the calling
+ * thread, which only that thread writes to: no locks, no atomic
+ * read-modify-write, no allocation except a new chunk every few thousand
+ * zones. GPU zones place GL_TIMESTAMP queries around their commands; the
+ * queries are read back a few frames later, once they are available, so
+ * the CPU never waits for the GPU. GPU zones and AZ_PROFILE_FRAME() belong
+ * on the render thread.
+ */
+
+#ifdef AZ_PROFILE
+
+#define AZ_PROFILE_CONCAT_(a, b) a##b
+#define AZ_PROFILE_CONCAT(a, b) AZ_PROFILE_CONCAT_(a, b)
+
+#define AZ_PROFILE_ZONE(name) ProfileZone AZ_PROFILE_CONCAT(az_profile_zone_, __LINE__){name}
+#define AZ_PROFILE_GPU_ZONE(name) GpuProfileZone AZ_PROFILE_CONCAT(az_profile_gpu_zone_, __LINE__){name}
+#define AZ_PROFILE_FRAME() profile_frame()
+#define AZ_PROFILE_THREAD_NAME(name) profile_thread_name(name)
+#define AZ_PROFILE_INSTANT(name) profile_instant(name)
+#define AZ_PROFILE_COUNTER(name, value) profile_counter(name, value)
+#define AZ_PROFILE_WRITE_TRACE(path) write_profile_trace(path)
+
+#else
+
+#define AZ_PROFILE_ZONE(name) ((void)0)
+#define AZ_PROFILE_GPU_ZONE(name) ((void)0)
+#define AZ_PROFILE_FRAME() ((void)0)
+#define AZ_PROFILE_THREAD_NAME(name) ((void)0)
+#define AZ_PROFILE_INSTANT(name) ((void)0)
+#define AZ_PROFILE_COUNTER(name, value) ((void)0)
+#define AZ_PROFILE_WRITE_TRACE(path) ((void)0)
+
+#endif
+
+/* Nanoseconds since the profiler's epoch (its first use), on a monotonic
+ * clock */
+std::uint64_t profile_now_ns();
+
+/* Appends a finished zone to the calling thread's buffer */
+void profile_record(const char* name, std::uint64_t start_ns, std::uint64_t end_ns);
+
+/* Appends an instant event (a marker, shown inside whatever zone is open)
+ * to the calling thread's buffer; same rule for the name as for zones */
+void profile_instant(const char* name);
+
+/* Appends a sample of a counter (e.g. bytes uploaded this frame), shown as
+ * a graph over time; same rule for the name as for zones */
+void profile_counter(const char* name, std::uint64_t value);
+
+/* Names the calling thread in traces */
+void profile_thread_name(std::string name);
+
+struct ProfileZone;
+
+/* Innermost CPU zone open on the calling thread, or nullptr */
+inline thread_local const ProfileZone* profile_open_zone = nullptr;
+
+struct ProfileZone final {
+    explicit ProfileZone(const char* name)
+        : name{name}, start_ns{profile_now_ns()}, parent{profile_open_zone} {
+        profile_open_zone = this;
+    }
+    ~ProfileZone() {
+        profile_record(this->name, this->start_ns, profile_now_ns());
+        profile_open_zone = this->parent;
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+    const char* name;
+    std::uint64_t start_ns;
+    const ProfileZone* parent;
+};
+
+/* Needs a current GL context with glad loaded */
+struct GpuProfileZone final {
+    explicit GpuProfileZone(const char* name);
+    ~GpuProfileZone();
+    GpuProfileZone(const GpuProfileZone&) = delete;
+    GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+
+    /* Index of the zone in the current frame, see profiler.cpp */
+    std::size_t zone;
+};
+
+/* Ends a frame: marks it in the trace and collects GPU zones of earlier
+ * frames whose queries are available */
+void profile_frame();
+
+/* Writes everything recorded so far as Chrome trace event JSON; throws
+ * std::runtime_error if the file cannot be written. Recording may go on
+ * meanwhile, on any thread */
+void write_profile_trace(const std::string& path);
+
+#endif
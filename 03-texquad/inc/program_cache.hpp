@@ -0,0 +1,50 @@
+#ifndef AZ_PROGRAM_CACHE_
+#define AZ_PROGRAM_CACHE_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/**
+ * On-disk cache of linked program binaries (glGetProgramBinary /
+ * glProgramBinary).
+ *
+ * Entries are keyed by a hash of the shader sources plus GL_RENDERER and
+ * GL_VERSION, so a driver update simply results in cache misses. Each file
+ * carries a checksum of its payload; corrupt, truncated or driver-rejected
+ * binaries are discarded and the program is compiled from source again.
+ */
+struct ProgramCache final {
+    explicit ProgramCache(std::filesystem::path cache_dir);
+
+    /* Returns a linked program for the given sources, restored from the cache
+     * if possible or else compiled, linked and stored for the next run */
+    unsigned int get_program(const std::string& vert_shader_src,
+                             const std::string& frag_shader_src);
+
+    /* Whether the current context can save and restore program binaries at all */
+    bool supported() const;
+
+    std::uint64_t key_for(const std::string& vert_shader_src,
+                          const std::string& frag_shader_src) const;
+
+    /* Lower-level access for callers that link programs themselves; the
+     * program passed to store() must have been linked with the
+     * retrievable binary hint set */
+    bool restore(std::uint64_t key, unsigned int& program_id);
+    void store(std::uint64_t key, unsigned int program_id);
+
+    std::filesystem::path cache_dir;
+    std::string driver_id;
+
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t rejected = 0;
+
+private:
+    std::filesystem::path path_for(std::uint64_t key) const;
+
+    bool binary_support = false;
+};
+
+#endif
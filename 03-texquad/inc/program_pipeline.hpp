@@ -0,0 +1,104 @@
+#ifndef AZ_PROGRAM_PIPELINE_
+#define AZ_PROGRAM_PIPELINE_
+
+#include <cstdint>
+#include <initializer_list>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+/* Where a uniform of a PipelineBinding lives: its location in each stage
+ * program, -1 in a stage not declaring it, which GL ignores. A uniform both
+ * stages declare is set on both, as separable stages do not share values */
+struct PipelineUniform {
+    unsigned int vertex_program;
+    int vertex_location;
+    unsigned int fragment_program;
+    int fragment_location;
+};
+
+/**
+ * A vertex/fragment combination ready to be bound. With separable programs
+ * `vertex_program` and `fragment_program` are the individually linked stages
+ * and `pipeline` is the program pipeline object mixing them; on the
+ * monolithic fallback both stage fields name the same linked program and
+ * `pipeline` is 0.
+ */
+struct PipelineBinding {
+    unsigned int pipeline = 0;
+    unsigned int vertex_program = 0;
+    unsigned int fragment_program = 0;
+
+    void bind() const;
+
+    /* Throws std::invalid_argument for uniforms not asked for when the
+     * binding was made, see PipelineCache::get() */
+    PipelineUniform get_uniform_location(std::string_view name) const;
+
+    /* Set the uniform on every stage declaring it; safe to call whether or
+     * not the binding is currently bound, which stays as it was */
+    void set_uniform_4f(PipelineUniform uniform, float x, float y, float z, float w) const;
+    void set_uniform_matrix4fv(PipelineUniform uniform, const glm::mat4& transform) const;
+
+    /* Puts other stages in place, e.g. rebuilt ones (see ShaderWatcher), and
+     * looks the uniforms up in them again. On the monolithic fallback both
+     * must name the same program. The replaced stages are not deleted */
+    void replace_stages(unsigned int vertex_program, unsigned int fragment_program);
+
+    /* Filled by PipelineCache::get() */
+    std::unordered_map<std::string, PipelineUniform> uniforms = {};
+
+private:
+    friend struct PipelineCache;
+    void store_uniform_locations(std::initializer_list<std::string> uniform_names);
+    PipelineUniform find_uniform(const std::string& name) const;
+};
+
+/**
+ * Builds vertex and fragment stages as GL_PROGRAM_SEPARABLE programs and
+ * mixes them with program pipeline objects, so N vertex and M fragment
+ * variants cost N + M links instead of N x M. Stages and pipelines are
+ * cached by source, so asking for a known combination costs nothing.
+ *
+ * When the context lacks separate shader objects (GL < 4.1 without
+ * GL_ARB_separate_shader_objects), or `allow_separable` is false, every
+ * combination is linked as an ordinary program instead, and cached just the
+ * same. bench/pipeline_bench.cpp compares the two.
+ */
+struct PipelineCache final {
+    explicit PipelineCache(bool allow_separable = true);
+
+    /* The binding stays valid, at the same address, until del() */
+    const PipelineBinding& get(const std::string& vert_shader_src, const std::string& frag_shader_src,
+                               std::initializer_list<std::string> uniform_names = {});
+
+    /* Same for stages built by the caller, e.g. asynchronously (see
+     * AsyncProgramBuilder::submit_stage()), who keeps owning them: two
+     * GL_PROGRAM_SEPARABLE programs are mixed by a pipeline, one program
+     * passed as both stages makes a monolithic binding. The binding may
+     * have its stages replaced; del() then only deletes the pipeline */
+    PipelineBinding& get(unsigned int vertex_program, unsigned int fragment_program,
+                         std::initializer_list<std::string> uniform_names = {});
+
+    void del();
+
+    bool separable = false;
+
+    /* Number of glLinkProgram (or glCreateShaderProgramv) calls made so far */
+    std::size_t link_count = 0;
+
+private:
+    unsigned int get_stage(const std::string& shader_src, unsigned int gl_shader_type);
+
+    std::unordered_map<std::uint64_t, unsigned int> stages;
+    std::unordered_map<std::uint64_t, PipelineBinding> bindings;
+    /* Bindings of caller-owned stages. Found by the stages they hold now,
+     * not the ones they were made with: those may have been replaced and
+     * deleted, and GL reuses the names */
+    std::list<PipelineBinding> external_bindings;
+};
+
+#endif
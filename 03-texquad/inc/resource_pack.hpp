@@ -0,0 +1,116 @@
+#ifndef AZ_RESOURCE_PACK_
+#define AZ_RESOURCE_PACK_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <thread_pool.hpp>
+
+/**
+ * All of the study's assets in one file (tools/resource_packer), mapped
+ * once instead of opened, stat'ed and read one by one.
+ *
+ * Resources are named by the relative paths the code already uses (e.g.
+ * "shaders/vertex.shader", "../tex/1.png"), lexically normalized, so a
+ * mounted pack serves them whatever the working directory. Paths missing
+ * from the pack, or every path when none is mounted, are read as loose
+ * files; that is the development setup, where edits (and shader hot
+ * reloading) must take effect without repacking.
+ *
+ * Layout, little endian:
+ *
+ *     PackHeader
+ *     PackEntry[header.entries], sorted by hash, then name
+ *     names, back to back
+ *     blobs, each starting at a multiple of 16 bytes
+ */
+struct PackHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t entries;
+    std::uint64_t names_offset;
+    std::uint64_t names_bytes;
+};
+
+struct PackEntry {
+    /* fnv1a_64() of the name */
+    std::uint64_t hash;
+    std::uint64_t offset;
+    std::uint64_t stored_bytes;
+    std::uint64_t bytes;
+    std::uint32_t name_offset;
+    std::uint32_t name_length;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+};
+
+/* PackEntry::flags */
+constexpr std::uint32_t PACK_LZ4 = 1;
+
+/* The name a path is packed under */
+std::string resource_name(std::string_view path);
+
+struct PackInput {
+    std::string name;
+    std::vector<unsigned char> bytes;
+};
+
+/* The pack file holding `inputs`. With `compress`, blobs are stored LZ4
+ * compressed when that saves at least an eighth (already compressed images
+ * seldom do, and stay uncompressed and zero-copy) */
+std::vector<unsigned char> build_resource_pack(const std::vector<PackInput>& inputs, bool compress = true);
+
+struct ResourcePack final {
+    /* Maps the pack; throws std::runtime_error if it cannot be mapped or
+     * its index is invalid */
+    explicit ResourcePack(const std::string& path);
+    ~ResourcePack();
+    ResourcePack(const ResourcePack&) = delete;
+    ResourcePack& operator=(const ResourcePack&) = delete;
+
+    bool contains(std::string_view path) const;
+
+    /* The contents of `path`, if packed: a view of the mapping, or of the
+     * decompressed copy kept for compressed blobs. Valid for the pack's
+     * lifetime; safe to call from any thread */
+    std::optional<std::span<const unsigned char>> find(std::string_view path) const;
+
+    /* Decompresses every compressed blob up front, spread over `pool` */
+    void decompress_all(ThreadPool& pool) const;
+
+    std::size_t size() const;
+
+private:
+    const PackEntry* entry(std::string_view path) const;
+    std::span<const unsigned char> contents(std::size_t index) const;
+
+    const unsigned char* data = nullptr;
+    std::size_t bytes = 0;
+    const PackEntry* entries = nullptr;
+    std::size_t n_entries = 0;
+
+    /* Decompressed blobs, filled in on first use */
+    struct Unpacked {
+        std::once_flag once;
+        std::unique_ptr<unsigned char[]> data;
+    };
+    std::unique_ptr<Unpacked[]> unpacked;
+};
+
+/* Makes `pack` the one find_resource() looks in; call once at startup,
+ * before any loading starts */
+void mount_resource_pack(std::unique_ptr<ResourcePack> pack);
+const ResourcePack* mounted_resource_pack();
+
+/* The mounted pack's contents of `path`, if any; nullopt means reading the
+ * loose file */
+std::optional<std::span<const unsigned char>> find_resource(std::string_view path);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef AZ_SHADER_PREPROC_
+#define AZ_SHADER_PREPROC_
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Name -> value; an empty value is injected as 1. Being ordered, a define set
+ * always produces the same source text and the same cache key */
+using ShaderDefines = std::map<std::string, std::string>;
+
+struct PreprocessedShader {
+    std::string source;
+    /* The shader itself followed by every file it included, in the order
+     * they were first seen; the index of a file is its GLSL source string
+     * number in #line directives (and thus in compiler logs) */
+    std::vector<std::filesystem::path> files;
+};
+
+/**
+ * Expands a GLSL file before it is handed to the compiler:
+ *
+ * - `#include "file"` is replaced by the contents of `file`, looked up
+ *   relative to the including file; files containing `#pragma once` are
+ *   only expanded once, and include cycles are reported as errors.
+ * - `defines` are injected right after the `#version` line.
+ * - `#pragma feature NAME` declares a compile-time toggle: NAME is defined
+ *   as 0 unless the define set enables it, so shaders can use `#if NAME`.
+ */
+PreprocessedShader preprocess_shader(const std::filesystem::path& path,
+                                     const ShaderDefines& defines = {});
+
+/**
+ * Compiles each (shader file, define set) variant once and hands out the
+ * same shader object, or linked program, every time it is asked for again.
+ */
+struct ShaderVariantCache final {
+    unsigned int get_shader(const std::filesystem::path& path, unsigned int gl_shader_type,
+                            const ShaderDefines& defines = {});
+    unsigned int get_program(const std::filesystem::path& vert_shader_path,
+                             const std::filesystem::path& frag_shader_path,
+                             const ShaderDefines& defines = {});
+
+    /* Forgets (and deletes) every variant built from `path` or from a file
+     * it includes */
+    void invalidate(const std::filesystem::path& path);
+    void del();
+
+    struct Variant {
+        unsigned int id;
+        std::vector<std::filesystem::path> files;
+    };
+
+    std::unordered_map<std::string, Variant> shaders;
+    std::unordered_map<std::string, Variant> programs;
+};
+
+#endif
@@ -7,11 +7,29 @@
 
 #include <glm/glm.hpp>
 
+struct ProgramCache;
+
+std::string load_shader_src(std::string_view src_path);
+unsigned int compile_shader(const std::string& shader_src, unsigned int gl_shader_type);
+unsigned int link_program(unsigned int vert_shader_id, unsigned int frag_shader_id,
+        bool retrievable_binary = false);
+
 struct ShaderProgram final {
     ShaderProgram(
             std::string_view vertex_shader_path,
             std::string_view fragment_shader_path,
             std::initializer_list<std::string> uniform_names);
+    /* Same as above, but restores the linked program from (and stores it
+     * into) the given on-disk binary cache when possible */
+    ShaderProgram(
+            std::string_view vertex_shader_path,
+            std::string_view fragment_shader_path,
+            std::initializer_list<std::string> uniform_names,
+            ProgramCache& cache);
+    /* Takes ownership of an already linked program */
+    ShaderProgram(
+            unsigned int program_id,
+            std::initializer_list<std::string> uniform_names);
     void use() const;
     void del() const;
     void set_uniform_4f(int location, float x, float y, float z, float w) const;
@@ -20,7 +38,9 @@ struct ShaderProgram final {
 
     unsigned int id;
     std::unordered_map<std::string, int> uniforms;
+
+private:
+    void store_uniform_locations(std::initializer_list<std::string> uniform_names);
 };
 
 #endif
-
@@ -0,0 +1,83 @@
+#ifndef AZ_SHADER_WATCHER_
+#define AZ_SHADER_WATCHER_
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <shader_prog.hpp>
+#include <shader_preproc.hpp>
+#include <async_shader.hpp>
+#include <program_pipeline.hpp>
+
+/**
+ * Rebuilds shader programs when their source files change on disk (Linux
+ * inotify).
+ *
+ * Rebuilds go through an AsyncProgramBuilder, so the frame loop never waits
+ * for the compiler. A rebuilt program only replaces the old one once it has
+ * linked successfully; on errors the log is printed and the old program
+ * stays in use.
+ */
+struct ShaderWatcher final {
+    using ReloadCallback = std::function<void(ShaderProgram&)>;
+
+    ShaderWatcher();
+    ~ShaderWatcher();
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    /* `program` must outlive the watcher. `on_reload` runs right after a new
+     * program has been swapped in, e.g. to refresh cached uniform locations */
+    void watch(ShaderProgram& program,
+               std::filesystem::path vert_shader_path,
+               std::filesystem::path frag_shader_path,
+               ShaderDefines defines = {},
+               ReloadCallback on_reload = {});
+
+    /* Same for a binding made of caller-owned stages (see
+     * PipelineCache::get()): with a pipeline, both stages are rebuilt as
+     * separable programs and replaced together. The replaced stages are
+     * deleted; `binding` must outlive the watcher */
+    void watch(PipelineBinding& binding,
+               std::filesystem::path vert_shader_path,
+               std::filesystem::path frag_shader_path,
+               ShaderDefines defines = {});
+
+    /* Picks up file changes, submits rebuilds and swaps in finished programs.
+     * Call it once per frame, at a point where no draw is in progress */
+    void update(AsyncProgramBuilder& builder);
+
+    struct Entry {
+        ShaderProgram* program;
+        std::filesystem::path vert_shader_path;
+        std::filesystem::path frag_shader_path;
+        ShaderDefines defines;
+        ReloadCallback on_reload;
+        std::vector<std::filesystem::path> files;
+        std::optional<ProgramFuture> rebuild;
+        bool dirty = false;
+        /* Set instead of `program` for bindings, whose fragment stage is
+         * rebuilt separately when they have a pipeline */
+        PipelineBinding* binding = nullptr;
+        std::optional<ProgramFuture> fragment_rebuild;
+    };
+
+    std::vector<Entry> entries;
+
+private:
+    void add(Entry entry);
+    void watch_files(const std::vector<std::filesystem::path>& files);
+    void read_events();
+    void swap(Entry& entry, unsigned int program_id);
+    void swap_stages(Entry& entry);
+
+    int inotify_fd;
+    /* Watch descriptor -> watched directory */
+    std::map<int, std::filesystem::path> directories;
+};
+
+#endif
@@ -491,6 +491,22 @@ STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 // calling it will fail to link if your compiler doesn't
 STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_flip);
 
+// decode JPEGs at 1/(1<<shift) of their size (shift 0..3, i.e. down to 1/8)
+// directly in the IDCT, which skips most of the work for images that are
+// displayed much smaller than they are stored; output dimensions are rounded
+// up. stbi_info() keeps reporting the stored size. Other formats ignore it.
+// (Local addition, not part of upstream stb_image.)
+STBIDEF void stbi_set_jpeg_scale_shift(int shift);
+
+// as above, but only applies to images loaded on the thread that calls the function
+STBIDEF void stbi_set_jpeg_scale_shift_thread(int shift);
+
+// enable (default) or disable the SIMD paths: JPEG IDCT, color conversion
+// and upsampling, and PNG row unfiltering. output is identical either way;
+// this exists to check exactly that, and to measure the difference.
+// (Local addition, not part of upstream stb_image.)
+STBIDEF void stbi_set_simd_enabled(int flag_true_if_simd);
+
 // ZLIB client - used by PNG, available for other purposes
 
 STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -1080,6 +1096,36 @@ STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_fli
                                          : stbi__vertically_flip_on_load_global)
 #endif // STBI_THREAD_LOCAL
 
+static int stbi__simd_enabled = 1;
+
+STBIDEF void stbi_set_simd_enabled(int flag_true_if_simd)
+{
+   stbi__simd_enabled = flag_true_if_simd;
+}
+
+static int stbi__jpeg_scale_shift_global = 0;
+
+STBIDEF void stbi_set_jpeg_scale_shift(int shift)
+{
+   stbi__jpeg_scale_shift_global = shift < 0 ? 0 : shift > 3 ? 3 : shift;
+}
+
+#ifndef STBI_THREAD_LOCAL
+#define stbi__jpeg_scale_shift  stbi__jpeg_scale_shift_global
+#else
+static STBI_THREAD_LOCAL int stbi__jpeg_scale_shift_local, stbi__jpeg_scale_shift_set;
+
+STBIDEF void stbi_set_jpeg_scale_shift_thread(int shift)
+{
+   stbi__jpeg_scale_shift_local = shift < 0 ? 0 : shift > 3 ? 3 : shift;
+   stbi__jpeg_scale_shift_set = 1;
+}
+
+#define stbi__jpeg_scale_shift  (stbi__jpeg_scale_shift_set       \
+                                  ? stbi__jpeg_scale_shift_local  \
+                                  : stbi__jpeg_scale_shift_global)
+#endif // STBI_THREAD_LOCAL
+
 static void *stbi__load_main(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri, int bpc)
 {
    memset(ri, 0, sizeof(*ri)); // make sure it's initialized if we add new fields
@@ -1933,6 +1979,9 @@ typedef struct
    int scan_n, order[4];
    int restart_interval, todo;
 
+   // blocks are decoded to (8 >> scale_shift)^2 pixels
+   int scale_shift;
+
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
    void (*YCbCr_to_RGB_kernel)(stbi_uc *out, const stbi_uc *y, const stbi_uc *pcb, const stbi_uc *pcr, int count, int step);
@@ -2449,6 +2498,64 @@ static void stbi__idct_block(stbi_uc *out, int out_stride, short data[64])
    }
 }
 
+// reduced-size IDCTs for decoding at 1/2 and 1/4 scale: only the n x n lowest
+// frequencies are kept and run through an n-point IDCT, so every output pixel
+// is a low-passed average of the pixels it replaces. entries are
+// c(k) * cos((2m+1)k*pi/2n) scaled by 1<<12, with c(0) = 1/sqrt(2), c(k) = 1
+static const int stbi__idct_reduced4[16] = {
+   2896,  3784,  2896,  1567,
+   2896,  1567, -2896, -3784,
+   2896, -1567, -2896,  3784,
+   2896, -3784,  2896, -1567,
+};
+static const int stbi__idct_reduced2[4] = {
+   2896,  2896,
+   2896, -2896,
+};
+
+static void stbi__idct_reduced(stbi_uc *out, int out_stride, short data[64], const int *t, int n)
+{
+   int i,j,k,val[16];
+
+   // columns; keep 2 extra bits of precision, as in stbi__idct_block
+   for (i=0; i < n; ++i) {
+      for (j=0; j < n; ++j) {
+         int sum = 512;
+         for (k=0; k < n; ++k)
+            sum += t[j*n+k] * data[k*8+i];
+         val[j*n+i] = sum >> 10;
+      }
+   }
+
+   // rows; 1<<12 from the constants, 1<<2 from above and a 1/4 normalization
+   // leave 1<<16 to remove, rounded, with the +128 level shift folded in
+   for (j=0; j < n; ++j, out += out_stride) {
+      for (i=0; i < n; ++i) {
+         int sum = 32768 + (128<<16);
+         for (k=0; k < n; ++k)
+            sum += t[i*n+k] * val[j*n+k];
+         out[i] = stbi__clamp(sum >> 16);
+      }
+   }
+}
+
+static void stbi__idct_block_4x4(stbi_uc *out, int out_stride, short data[64])
+{
+   stbi__idct_reduced(out, out_stride, data, stbi__idct_reduced4, 4);
+}
+
+static void stbi__idct_block_2x2(stbi_uc *out, int out_stride, short data[64])
+{
+   stbi__idct_reduced(out, out_stride, data, stbi__idct_reduced2, 2);
+}
+
+static void stbi__idct_block_1x1(stbi_uc *out, int out_stride, short data[64])
+{
+   // the IDCT of the DC coefficient alone is DC/8 everywhere
+   STBI_NOTUSED(out_stride);
+   out[0] = stbi__clamp((data[0] + 4 + (128<<3)) >> 3);
+}
+
 #ifdef STBI_SSE2
 // sse2 integer IDCT. not the fastest possible implementation but it
 // produces bit-identical results to the generic C version so it's
@@ -2890,7 +2997,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                int ha = z->img_comp[n].ha;
                if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               z->idct_block_kernel(z->img_comp[n].data+((z->img_comp[n].w2*j+i)*8 >> z->scale_shift), z->img_comp[n].w2, data);
                // every data block is an MCU, so countdown the restart interval
                if (--z->todo <= 0) {
                   if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
@@ -2914,8 +3021,8 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
                   // by the basic H and V specified for the component
                   for (y=0; y < z->img_comp[n].v; ++y) {
                      for (x=0; x < z->img_comp[n].h; ++x) {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
+                        int x2 = (i*z->img_comp[n].h + x)*8 >> z->scale_shift;
+                        int y2 = (j*z->img_comp[n].v + y)*8 >> z->scale_shift;
                         int ha = z->img_comp[n].ha;
                         if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
                         z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
@@ -3015,7 +3122,7 @@ static void stbi__jpeg_finish(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
                stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               z->idct_block_kernel(z->img_comp[n].data+((z->img_comp[n].w2*j+i)*8 >> z->scale_shift), z->img_comp[n].w2, data);
             }
          }
       }
@@ -3247,8 +3354,8 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       //
       // img_mcu_x, img_mcu_y: <=17 bits; comp[i].h and .v are <=4 (checked earlier)
       // so these muls can't overflow with 32-bit ints (which we require)
-      z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * 8;
-      z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * 8;
+      z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * 8 >> z->scale_shift;
+      z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * 8 >> z->scale_shift;
       z->img_comp[i].coeff = 0;
       z->img_comp[i].raw_coeff = 0;
       z->img_comp[i].linebuf = NULL;
@@ -3258,10 +3365,10 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       // align blocks for idct using mmx/sse
       z->img_comp[i].data = (stbi_uc*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
       if (z->progressive) {
-         // w2, h2 are multiples of 8 (see above)
-         z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
-         z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
-         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
+         // coefficients are kept for every block, whatever the output scale
+         z->img_comp[i].coeff_w = z->img_mcu_x * z->img_comp[i].h;
+         z->img_comp[i].coeff_h = z->img_mcu_y * z->img_comp[i].v;
+         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].coeff_w * 8, z->img_comp[i].coeff_h * 8, sizeof(short), 15);
          if (z->img_comp[i].raw_coeff == NULL)
             return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
          z->img_comp[i].coeff = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
@@ -3719,12 +3826,13 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
+   j->scale_shift = 0;
    j->idct_block_kernel = stbi__idct_block;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
 
 #ifdef STBI_SSE2
-   if (stbi__sse2_available()) {
+   if (stbi__sse2_available() && stbi__simd_enabled) {
       j->idct_block_kernel = stbi__idct_simd;
       j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
       j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
@@ -3732,12 +3840,37 @@ static void stbi__setup_jpeg(stbi__jpeg *j)
 #endif
 
 #ifdef STBI_NEON
-   j->idct_block_kernel = stbi__idct_simd;
-   j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
-   j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   if (stbi__simd_enabled) {
+      j->idct_block_kernel = stbi__idct_simd;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_simd;
+   }
 #endif
 }
 
+static void stbi__setup_jpeg_scale(stbi__jpeg *j, int shift)
+{
+   static void (* const kernels[4])(stbi_uc *out, int out_stride, short data[64]) = {
+      NULL, stbi__idct_block_4x4, stbi__idct_block_2x2, stbi__idct_block_1x1
+   };
+   j->scale_shift = shift;
+   if (shift > 0)
+      j->idct_block_kernel = kernels[shift];
+}
+
+// once all blocks are decoded, the image and its components are only as big
+// as the scaled-down blocks made them
+static void stbi__jpeg_apply_scale(stbi__jpeg *z)
+{
+   int i, round = (1 << z->scale_shift) - 1;
+   z->s->img_x = (z->s->img_x + round) >> z->scale_shift;
+   z->s->img_y = (z->s->img_y + round) >> z->scale_shift;
+   for (i=0; i < z->s->img_n; ++i) {
+      z->img_comp[i].x = (z->s->img_x * z->img_comp[i].h + z->img_h_max-1) / z->img_h_max;
+      z->img_comp[i].y = (z->s->img_y * z->img_comp[i].v + z->img_v_max-1) / z->img_v_max;
+   }
+}
+
 // clean up the temporary component buffers
 static void stbi__cleanup_jpeg(stbi__jpeg *j)
 {
@@ -3771,6 +3904,7 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
 
    // load a jpeg image from whichever source, but leave in YCbCr format
    if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
+   if (z->scale_shift) stbi__jpeg_apply_scale(z);
 
    // determine actual number of components to generate
    n = req_comp ? req_comp : z->s->img_n >= 3 ? 3 : 1;
@@ -3927,6 +4061,7 @@ static void *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int re
    STBI_NOTUSED(ri);
    j->s = s;
    stbi__setup_jpeg(j);
+   stbi__setup_jpeg_scale(j, stbi__jpeg_scale_shift);
    result = load_jpeg_image(j, x,y,comp,req_comp);
    STBI_FREE(j);
    return result;
@@ -4535,6 +4670,119 @@ static int stbi__paeth(int a, int b, int c)
 
 static const stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
+#ifdef STBI_SSE2
+// SSE2 unfiltering of 8-bit rows with 3 or 4 bytes per pixel, matching the
+// scalar loops in stbi__create_png_image_raw exactly. as there, cur, prior
+// and raw point past the first pixel, and n is the number of bytes left.
+// Sub and Up work on 16 bytes at a time; Average and Paeth depend on the
+// pixel to the left, so they work on one pixel (all its channels) at a time.
+
+static stbi_inline __m128i stbi__png_load_px(const stbi_uc *p, int bpp)
+{
+   int v;
+   if (bpp == 4)
+      memcpy(&v, p, 4);
+   else
+      v = p[0] | (p[1] << 8) | (p[2] << 16);
+   return _mm_cvtsi32_si128(v);
+}
+
+static stbi_inline void stbi__png_store_px(stbi_uc *p, __m128i v, int bpp)
+{
+   int x = _mm_cvtsi128_si32(v);
+   if (bpp == 4) {
+      memcpy(p, &x, 4);
+   } else {
+      p[0] = STBI__BYTECAST(x);
+      p[1] = STBI__BYTECAST(x >> 8);
+      p[2] = STBI__BYTECAST(x >> 16);
+   }
+}
+
+static int stbi__png_unfilter_row_sse2(int filter, stbi_uc *cur, const stbi_uc *prior, const stbi_uc *raw, int n, int bpp)
+{
+   int k = 0;
+   __m128i zero = _mm_setzero_si128();
+
+   switch (filter) {
+      case STBI__F_sub: {
+         // prefix sum over the pixels of a register, seeded by the pixel to
+         // the left; 4 pixels per step (12 of the 16 bytes for bpp 3)
+         int step = bpp * 4;
+         __m128i mask = _mm_cvtsi32_si128(bpp == 4 ? -1 : 0xffffff);
+         __m128i left = stbi__png_load_px(cur - bpp, bpp);
+         for (; k + 16 <= n; k += step) {
+            __m128i x = _mm_add_epi8(_mm_loadu_si128((const __m128i *) (raw + k)), left);
+            if (bpp == 4) {
+               x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+               x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+               _mm_storeu_si128((__m128i *) (cur + k), x);
+               left = _mm_srli_si128(x, 12);
+            } else {
+               x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+               x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+               _mm_storel_epi64((__m128i *) (cur + k), x);
+               stbi__png_store_px(cur + k + 8, _mm_srli_si128(x, 8), 4);
+               left = _mm_and_si128(_mm_srli_si128(x, 9), mask);
+            }
+         }
+         for (; k < n; ++k) cur[k] = STBI__BYTECAST(raw[k] + cur[k-bpp]);
+         break;
+      }
+      case STBI__F_up:
+         for (; k + 16 <= n; k += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i *) (raw + k));
+            __m128i b = _mm_loadu_si128((const __m128i *) (prior + k));
+            _mm_storeu_si128((__m128i *) (cur + k), _mm_add_epi8(x, b));
+         }
+         for (; k < n; ++k) cur[k] = STBI__BYTECAST(raw[k] + prior[k]);
+         break;
+      case STBI__F_avg: {
+         // (a+b)>>1 is the rounded-up average minus the carry-out bit
+         __m128i one = _mm_set1_epi8(1);
+         __m128i a = stbi__png_load_px(cur - bpp, bpp);
+         for (; k < n; k += bpp) {
+            __m128i b = stbi__png_load_px(prior + k, bpp);
+            __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            a = _mm_add_epi8(stbi__png_load_px(raw + k, bpp), avg);
+            stbi__png_store_px(cur + k, a, bpp);
+         }
+         break;
+      }
+      case STBI__F_paeth: {
+         // predictor distances, as in stbi__paeth: with p = a+b-c,
+         // |p-a| = |b-c|, |p-b| = |a-c| and |p-c| = |(b-c) + (a-c)|
+         __m128i a = _mm_unpacklo_epi8(stbi__png_load_px(cur - bpp, bpp), zero);
+         __m128i c = _mm_unpacklo_epi8(stbi__png_load_px(prior - bpp, bpp), zero);
+         for (; k < n; k += bpp) {
+            __m128i b = _mm_unpacklo_epi8(stbi__png_load_px(prior + k, bpp), zero);
+            __m128i pa = _mm_sub_epi16(b, c);
+            __m128i pb = _mm_sub_epi16(a, c);
+            __m128i pc = _mm_add_epi16(pa, pb);
+            __m128i smallest, use_a, use_b, nearest;
+            pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+            pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+            pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+            smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            // ties go to a, then b, as in the scalar version
+            use_a = _mm_cmpeq_epi16(smallest, pa);
+            use_b = _mm_andnot_si128(use_a, _mm_cmpeq_epi16(smallest, pb));
+            nearest = _mm_or_si128(_mm_and_si128(use_a, a), _mm_and_si128(use_b, b));
+            nearest = _mm_or_si128(nearest, _mm_andnot_si128(_mm_or_si128(use_a, use_b), c));
+            a = _mm_add_epi8(stbi__png_load_px(raw + k, bpp), _mm_packus_epi16(nearest, zero));
+            stbi__png_store_px(cur + k, a, bpp);
+            a = _mm_unpacklo_epi8(a, zero);
+            c = b;
+         }
+         break;
+      }
+      default:
+         return 0;
+   }
+   return 1;
+}
+#endif
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4620,6 +4868,11 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
          #define STBI__CASE(f) \
              case f:     \
                 for (k=0; k < nk; ++k)
+#ifdef STBI_SSE2
+         if (stbi__simd_enabled && depth == 8 && (filter_bytes == 3 || filter_bytes == 4)
+               && stbi__png_unfilter_row_sse2(filter, cur, prior, raw, nk, filter_bytes))
+            filter = -1; // done
+#endif
          switch (filter) {
             // "none" filter turns into a memcpy here; make that explicit.
             case STBI__F_none:         memcpy(cur, raw, nk); break;
@@ -0,0 +1,288 @@
+#ifndef AZ_TASK_
+#define AZ_TASK_
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Minimal C++20 coroutine toolkit for the asset pipeline:
+ *
+ * - Task<T>: lazily started coroutine returning T, awaitable from other
+ *   coroutines.
+ * - AssetFuture<T> / spawn(): starts a task right away and exposes its result
+ *   both to coroutines (co_await) and to plain code (ready() / get()).
+ * - FrameQueue: executor drained by the render loop, so `co_await
+ *   queue.schedule()` continues on the GL thread at the next frame boundary.
+ */
+
+template <typename T = void>
+struct Task;
+
+namespace detail {
+    struct PromiseBase {
+        std::coroutine_handle<> continuation = std::noop_coroutine();
+        std::exception_ptr exception;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                return handle.promise().continuation;
+            }
+            void await_resume() const noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() { this->exception = std::current_exception(); }
+    };
+
+    template <typename T>
+    struct Promise : PromiseBase {
+        std::optional<T> value;
+
+        Task<T> get_return_object();
+        void return_value(T value) { this->value = std::move(value); }
+        T result() {
+            if (this->exception) {
+                std::rethrow_exception(this->exception);
+            }
+            return std::move(*this->value);
+        }
+    };
+
+    template <>
+    struct Promise<void> : PromiseBase {
+        Task<void> get_return_object();
+        void return_void() {}
+        void result() {
+            if (this->exception) {
+                std::rethrow_exception(this->exception);
+            }
+        }
+    };
+
+    /* Fire-and-forget coroutine; frees itself when it finishes */
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+}
+
+template <typename T>
+struct [[nodiscard]] Task {
+    using promise_type = detail::Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle{handle} {}
+    Task(Task&& other) noexcept : handle{std::exchange(other.handle, {})} {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (this->handle) {
+            this->handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        this->handle.promise().continuation = caller;
+        return this->handle;
+    }
+    T await_resume() { return this->handle.promise().result(); }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail {
+    template <typename T>
+    Task<T> Promise<T>::get_return_object() {
+        return Task<T>{std::coroutine_handle<Promise<T>>::from_promise(*this)};
+    }
+
+    inline Task<void> Promise<void>::get_return_object() {
+        return Task<void>{std::coroutine_handle<Promise<void>>::from_promise(*this)};
+    }
+}
+
+template <typename T>
+struct AssetFuture final {
+    struct State {
+        std::mutex mutex;
+        bool done = false;
+        std::optional<T> value;
+        std::exception_ptr exception;
+        std::vector<std::coroutine_handle<>> waiters;
+
+        void finish() {
+            std::vector<std::coroutine_handle<>> resumable;
+            {
+                std::lock_guard lock{this->mutex};
+                this->done = true;
+                resumable.swap(this->waiters);
+            }
+            for (auto waiter : resumable) {
+                waiter.resume();
+            }
+        }
+    };
+
+    bool ready() const {
+        std::lock_guard lock{this->state->mutex};
+        return this->state->done;
+    }
+
+    /* Result of a finished task; rethrows its exception if it failed */
+    T& get() const {
+        if (this->state->exception) {
+            std::rethrow_exception(this->state->exception);
+        }
+        return *this->state->value;
+    }
+
+    bool await_ready() const { return ready(); }
+    bool await_suspend(std::coroutine_handle<> waiter) const {
+        std::lock_guard lock{this->state->mutex};
+        if (this->state->done) {
+            return false;
+        }
+        this->state->waiters.push_back(waiter);
+        return true;
+    }
+    T& await_resume() const { return get(); }
+
+    std::shared_ptr<State> state;
+};
+
+template <>
+struct AssetFuture<void> final {
+    struct State {
+        std::mutex mutex;
+        bool done = false;
+        std::exception_ptr exception;
+        std::vector<std::coroutine_handle<>> waiters;
+
+        void finish() {
+            std::vector<std::coroutine_handle<>> resumable;
+            {
+                std::lock_guard lock{this->mutex};
+                this->done = true;
+                resumable.swap(this->waiters);
+            }
+            for (auto waiter : resumable) {
+                waiter.resume();
+            }
+        }
+    };
+
+    bool ready() const {
+        std::lock_guard lock{this->state->mutex};
+        return this->state->done;
+    }
+
+    void get() const {
+        if (this->state->exception) {
+            std::rethrow_exception(this->state->exception);
+        }
+    }
+
+    bool await_ready() const { return ready(); }
+    bool await_suspend(std::coroutine_handle<> waiter) const {
+        std::lock_guard lock{this->state->mutex};
+        if (this->state->done) {
+            return false;
+        }
+        this->state->waiters.push_back(waiter);
+        return true;
+    }
+    void await_resume() const { get(); }
+
+    std::shared_ptr<State> state;
+};
+
+namespace detail {
+    template <typename T>
+    Detached drive(Task<T> task, std::shared_ptr<typename AssetFuture<T>::State> state) {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await task;
+            } else {
+                state->value.emplace(co_await task);
+            }
+        } catch (...) {
+            state->exception = std::current_exception();
+        }
+        state->finish();
+    }
+}
+
+/* Starts `task` right away; it runs until its first suspension point on the
+ * calling thread */
+template <typename T>
+AssetFuture<T> spawn(Task<T> task) {
+    auto state = std::make_shared<typename AssetFuture<T>::State>();
+    detail::drive(std::move(task), state);
+    return {state};
+}
+
+/**
+ * Coroutines queued here are resumed by run_pending(), which the render loop
+ * calls once per frame on the thread owning the GL context.
+ */
+struct FrameQueue final {
+    auto schedule() {
+        struct Awaiter {
+            FrameQueue& queue;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { queue.push(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    void push(std::coroutine_handle<> handle) {
+        std::lock_guard lock{this->mutex};
+        if (!this->closed) {
+            this->pending.push_back(handle);
+        }
+    }
+
+    /* Abandons the coroutines queued now and later: they are never resumed
+     * (nor destroyed, their frames are leaked), so nothing runs into the
+     * render thread's objects while they are torn down */
+    void close() {
+        std::lock_guard lock{this->mutex};
+        this->closed = true;
+        this->pending.clear();
+    }
+
+    /* Resumes everything queued before the call; coroutines that queue
+     * themselves again will run on the next call */
+    void run_pending() {
+        std::vector<std::coroutine_handle<>> runnable;
+        {
+            std::lock_guard lock{this->mutex};
+            runnable.swap(this->pending);
+        }
+        for (auto handle : runnable) {
+            handle.resume();
+        }
+    }
+
+    std::mutex mutex;
+    std::vector<std::coroutine_handle<>> pending;
+    bool closed = false;
+};
+
+#endif
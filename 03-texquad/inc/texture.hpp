@@ -0,0 +1,80 @@
+#ifndef AZ_TEXTURE_
+#define AZ_TEXTURE_
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+struct DecodedImage {
+    unsigned char* data;
+    int width;
+    int height;
+    int channels;
+
+    /* Rows are stored top first and still need flipping for GL; done while
+     * converting (see pixel_kernels.hpp) rather than in a pass of its own */
+    bool flip_y = false;
+
+    /* Releases `data`; the image must not be used afterwards */
+    void free();
+};
+
+/* Whether decode_image() marks images for flipping, so their first row ends
+ * up at the bottom of the texture. Use this rather than
+ * stbi_set_flip_vertically_on_load(), which makes stb_image flip in an extra
+ * pass */
+void set_flip_on_load(bool flip);
+
+/* Largest size, in pixels, an image will be displayed at; 0 means unknown */
+struct TextureSizeHint {
+    int width = 0;
+    int height = 0;
+};
+
+/* Global quality tiers: every texture loses this many top mip levels (each
+ * halving both dimensions) on top of what its size hint allows */
+enum class TextureQuality {
+    full = 0,
+    half = 1,
+    quarter = 2,
+    eighth = 3,
+};
+
+void set_texture_quality(TextureQuality quality);
+TextureQuality texture_quality();
+
+/* Number of top mip levels to skip for an image of the given size, given
+ * the hint and the current quality tier. Never skips below the hinted size
+ * on account of the hint, and never below 1x1 */
+int skipped_levels(int width, int height, TextureSizeHint hint);
+
+/**
+ * Decodes an image, skipping the top mip levels selected by skipped_levels().
+ * JPEGs are decoded straight at 1/2, 1/4 or 1/8 size in the IDCT; other
+ * formats (and JPEG reductions beyond 1/8) are decoded in full and halved
+ * with a box filter.
+ *
+ * Safe to call from any thread.
+ */
+DecodedImage decode_image(std::string_view img_path, TextureSizeHint hint = {});
+
+/* Same, for an encoded image already in memory; `name` is for errors */
+DecodedImage decode_image(std::span<const unsigned char> file, std::string_view name,
+                          TextureSizeHint hint = {});
+
+/* Replaces `image` by a half-size (rounded up) box-filtered copy */
+void downsample_half(DecodedImage& image);
+
+/* Allocates a texture object with the study's usual sampling parameters
+ * (repeat wrapping, linear filtering); leaves it bound to GL_TEXTURE_2D */
+unsigned int create_texture();
+
+/* Deletes a texture and drops it from the memory accounts */
+void delete_texture(unsigned int texture);
+
+/* Uploads `image` in the smallest adequate format, see texture_import.hpp;
+ * .aztx paths are uploaded as cooked, see cooked_texture.hpp */
+unsigned int set_up_texture(const DecodedImage& image);
+unsigned int set_up_texture(std::string_view img_path);
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef AZ_TEXTURE_IMPORT_
+#define AZ_TEXTURE_IMPORT_
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <mipmap.hpp>
+#include <texture.hpp>
+
+/* GL storage chosen for an imported image */
+struct ImportFormat {
+    unsigned int internal_format;
+    unsigned int format;
+    unsigned int type;
+    int bytes_per_pixel;
+    /* Maps the stored channels back to RGBA when sampling, so shaders never
+     * see the difference (e.g. R8 gray is read as RRR1) */
+    std::array<int, 4> swizzle;
+    const char* name;
+};
+
+struct ImportOptions {
+    /* Allow 16-bit packed RGB565 / RGBA4 for images that tolerate the loss */
+    bool allow_packed_16bit = false;
+    bool mipmaps = true;
+    MipGeneration mip_generation = MipGeneration::cpu;
+
+    /* Applied while converting; see pixel_kernels.hpp */
+    bool premultiply_alpha = false;
+    bool srgb_to_linear = false;
+};
+
+/**
+ * An image converted to the smallest internal format that still represents
+ * it exactly (or, with packed formats allowed, acceptably): R8 for gray
+ * images, RG8 for gray with alpha, RGB8 when the alpha channel is fully
+ * opaque and RGBA8 otherwise.
+ */
+struct ImportedTexture {
+    std::unique_ptr<unsigned char[]> pixels;
+    int width;
+    int height;
+    ImportFormat format;
+    int mip_levels;
+
+    /* Levels held in `pixels`, back to back (all of them for CPU generated
+     * mipmaps, else just level 0); the others are generated or left empty
+     * as `mip_generation` says */
+    int stored_levels = 1;
+    MipGeneration mip_generation = MipGeneration::gpu;
+
+    /* Whole mip chain, as stored vs. as plain RGBA8 */
+    std::size_t bytes;
+    std::size_t rgba8_bytes;
+
+    int level_width(int level) const;
+    int level_height(int level) const;
+    std::size_t level_offset(int level) const;
+    std::size_t level0_bytes() const;
+    std::size_t stored_bytes() const;
+};
+
+ImportFormat choose_import_format(const DecodedImage& image, const ImportOptions& options = {});
+
+/* Converts (and flips, if the image asks for it) `image` into `dst` laid out
+ * as `format` expects, in one pass; `dst` must hold
+ * width * height * format.bytes_per_pixel bytes and may be mapped GL memory */
+void convert_pixels(const DecodedImage& image, const ImportFormat& format, unsigned char* dst,
+                    const ImportOptions& options = {});
+
+/* convert_pixels() for every stored level of `texture`: level 0 from
+ * `image`, the others from `mips`; `dst` holds texture.stored_bytes() */
+void convert_levels(const DecodedImage& image, const MipChain* mips, const ImportedTexture& texture,
+                    unsigned char* dst, const ImportOptions& options = {});
+
+/* Picks the format and sizes the texture, leaving `pixels` empty; for
+ * callers converting straight into their own staging memory. CPU mipmaps
+ * are stored only if `mips` is given; without, the GPU generates them */
+ImportedTexture plan_import(const DecodedImage& image, const ImportOptions& options = {},
+                            const MipChain* mips = nullptr);
+
+/* plan_import() plus the converted pixels; builds the mip chain itself if
+ * the options ask for CPU mipmaps and none is given */
+ImportedTexture import_image(const DecodedImage& image, const ImportOptions& options = {},
+                             const MipChain* mips = nullptr);
+
+/* Number of levels of a full mip chain */
+int mip_count(int width, int height);
+
+/* Bytes of a full mip chain of the given base size */
+std::size_t mip_chain_bytes(int width, int height, int bytes_per_pixel, int mip_levels);
+
+/* Bytes per pixel of the internal formats chosen by the importer (4 for
+ * anything else) */
+int bytes_per_pixel(unsigned int internal_format);
+
+/* Allocates storage for `format` on the bound GL_TEXTURE_2D, immutable where
+ * glTexStorage2D is available, and applies its swizzle. The storage is
+ * accounted for (memory_accounting.hpp) as `owner`'s, e.g. the image path; a
+ * refusal by the memory budget deletes the texture and throws
+ * MemoryBudgetExceeded */
+void allocate_texture_storage(const ImportFormat& format, int width, int height, int mip_levels,
+                              std::string owner);
+
+/* Largest GL_UNPACK_ALIGNMENT that tightly packed rows of `row_bytes` satisfy */
+int unpack_alignment(std::size_t row_bytes);
+
+/* Creates a texture holding `texture`, accounted for as `owner`'s, and
+ * leaves it bound. Without pixels the data is read from the bound pixel
+ * unpack buffer */
+unsigned int upload_imported(const ImportedTexture& texture, std::string owner);
+
+/* Once the stored levels of `texture` are in the bound texture, generates
+ * the remaining ones or, for lazy mipmaps, keeps them from being sampled */
+void finish_mip_levels(const ImportedTexture& texture);
+
+std::string import_report(const std::string& name, const ImportedTexture& texture);
+
+#endif
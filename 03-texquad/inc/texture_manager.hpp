@@ -0,0 +1,115 @@
+#ifndef AZ_TEXTURE_MANAGER_
+#define AZ_TEXTURE_MANAGER_
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <asset_pipeline.hpp>
+#include <texture.hpp>
+
+/* Sampling parameters and display size a texture is loaded with; part of
+ * the cache key */
+struct TextureParams {
+    unsigned int wrap = 0x2901;         /* GL_REPEAT */
+    unsigned int min_filter = 0x2601;   /* GL_LINEAR */
+    unsigned int mag_filter = 0x2601;   /* GL_LINEAR */
+    TextureSizeHint size;
+
+    std::string key() const;
+};
+
+struct TextureManager;
+
+/**
+ * Reference-counted use of a managed texture. While any handle to a texture
+ * exists it stays resident; once the last one goes away the texture becomes
+ * a candidate for eviction.
+ */
+struct TextureHandle final {
+    TextureHandle() = default;
+    TextureHandle(const TextureHandle& other);
+    TextureHandle(TextureHandle&& other) noexcept;
+    TextureHandle& operator=(TextureHandle other) noexcept;
+    ~TextureHandle();
+
+    /* GL name of the texture, or 0 while it is still loading */
+    unsigned int id() const;
+    bool ready() const;
+    /* Loading failed: the handle never becomes ready, loaded() rethrows the
+     * error, and acquiring the texture again tries again */
+    bool failed() const;
+
+    /* `co_await handle.loaded()` yields the GL name once the texture is in */
+    AssetFuture<unsigned int> loaded() const;
+
+    /* Tells a ready texture the size it is drawn at. Textures loaded without
+     * a mipmap min filter skip their mip levels (see MipGeneration::lazy);
+     * the first time one is drawn smaller than it is, the levels are filled
+     * by ensure_mipmaps() and sampled with GL_LINEAR_MIPMAP_LINEAR from then
+     * on, for every handle to it. Render thread only */
+    void drawn_at(int width, int height) const;
+
+    /* Upload priority while still loading, e.g. raised once what the
+     * texture is drawn on comes into view; see AssetPipeline::set_priority() */
+    void set_priority(float priority) const;
+
+    struct Entry;
+
+private:
+    friend struct TextureManager;
+    TextureHandle(TextureManager* manager, std::shared_ptr<Entry> entry);
+
+    TextureManager* manager = nullptr;
+    std::shared_ptr<Entry> entry;
+};
+
+/**
+ * Loads each (canonical path, parameters) combination once, no matter how
+ * often or how concurrently it is asked for.
+ *
+ * Resident textures are accounted against a memory budget; when it is
+ * exceeded, textures no longer referenced by any handle are deleted in
+ * least-recently-released order. Asking for an evicted texture again simply
+ * loads it again.
+ */
+struct TextureManager final {
+    TextureManager(AssetPipeline& pipeline, std::size_t budget_bytes = 256 << 20);
+    ~TextureManager();
+    TextureManager(const TextureManager&) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    /* `priority` orders the upload, see AssetPipeline; asking again for a
+     * texture still loading can only raise it */
+    TextureHandle acquire(std::string_view path, const TextureParams& params = {}, float priority = 0.0f);
+
+    /* Evicts unreferenced textures until the budget is met again */
+    void collect();
+
+    struct Stats {
+        std::size_t resident_bytes = 0;
+        std::size_t resident_textures = 0;
+        std::size_t requests = 0;
+        std::size_t loads = 0;
+        std::size_t evictions = 0;
+    };
+
+    std::size_t budget_bytes;
+    Stats stats;
+
+private:
+    friend struct TextureHandle;
+
+    void release(const std::shared_ptr<TextureHandle::Entry>& entry);
+    Task<unsigned int> load(std::shared_ptr<TextureHandle::Entry> entry);
+
+    AssetPipeline& pipeline;
+    std::unordered_map<std::string, std::shared_ptr<TextureHandle::Entry>> entries;
+    /* Unreferenced entries, least recently released first */
+    std::list<std::shared_ptr<TextureHandle::Entry>> lru;
+};
+
+#endif
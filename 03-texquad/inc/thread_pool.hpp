@@ -0,0 +1,62 @@
+#ifndef AZ_THREAD_POOL_
+#define AZ_THREAD_POOL_
+
+#include <coroutine>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads running posted jobs in FIFO order. Coroutines
+ * can hop onto a worker with `co_await pool.schedule()`.
+ */
+struct ThreadPool final {
+    /* 0 means one worker per hardware thread */
+    explicit ThreadPool(std::size_t n_threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /* Dropped once the pool is closed */
+    void post(std::function<void()> job);
+
+    /* Drops the queued jobs and any posted later, and waits for the running
+     * ones. Unlike the destructor, which runs everything queued (including
+     * what those jobs post), this stops work that would otherwise go on
+     * into objects about to be destroyed */
+    void close();
+
+    /* Runs job(0) ... job(n - 1) across the workers and the calling thread,
+     * returning once all of them are done */
+    void parallel_for(std::size_t n, const std::function<void(std::size_t)>& job);
+
+    auto schedule() {
+        struct Awaiter {
+            ThreadPool& pool;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                pool.post([handle] { handle.resume(); });
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    std::size_t size() const;
+
+private:
+    void run();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    bool closed = false;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef AZ_UPLOAD_SCHEDULER_
+#define AZ_UPLOAD_SCHEDULER_
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * Spreads texture and buffer uploads over several frames.
+ *
+ * Queued uploads are carried out by pump(), once per frame, until either the
+ * byte or the time budget for that frame is used up. Large images are sent as
+ * bands of rows with glTexSubImage2D and large buffers as ranges with
+ * glBufferSubData, so a burst of new content never costs more than one
+ * budget per frame. Higher priorities (e.g. currently visible objects) go
+ * first; equal priorities keep their submission order. pump() leaves the
+ * GL_TEXTURE_2D binding, the buffer bindings it uploads through and the
+ * unpack alignment as it found them.
+ */
+struct UploadScheduler final {
+    /* Each frame sends whole rows (any bytes, for buffers) within the byte
+     * budget, except that its first band is always sent: a frame goes past
+     * `max_bytes` only when a single row is larger than that */
+    struct Budget {
+        std::size_t max_bytes = 4 << 20;
+        double max_ms = 2.0;
+    };
+
+    struct Stats {
+        std::size_t queue_depth = 0;
+        std::size_t frame_bytes = 0;
+        std::size_t frame_uploads_completed = 0;
+        std::size_t total_bytes = 0;
+    };
+
+    using Ticket = std::uint64_t;
+    using Pixels = std::shared_ptr<const unsigned char[]>;
+
+    UploadScheduler();
+    explicit UploadScheduler(Budget budget);
+    ~UploadScheduler();
+
+    /* Queues the pixels of level `level` of `texture`, whose storage must
+     * already be allocated with a matching size. Rows are tightly packed.
+     * Until sent, they count as host memory in the "upload queue" category
+     * (memory_accounting.hpp), which a budget may refuse.
+     * `on_done` runs from pump() after the last band has been sent */
+    Ticket enqueue_texture(unsigned int texture, int level, int width, int height,
+                           unsigned int format, unsigned int type, int bytes_per_pixel,
+                           Pixels pixels, float priority = 0.0f,
+                           std::function<void()> on_done = {});
+
+    /* Queues `size` bytes into `buffer` (already allocated) at `offset`,
+     * through `target`: GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER,
+     * GL_UNIFORM_BUFFER or GL_COPY_WRITE_BUFFER */
+    Ticket enqueue_buffer(unsigned int target, unsigned int buffer, std::size_t offset,
+                          Pixels data, std::size_t size, float priority = 0.0f,
+                          std::function<void()> on_done = {});
+
+    /* Reprioritises a pending upload, e.g. when its object becomes visible */
+    void set_priority(Ticket ticket, float priority);
+
+    /* Drops a pending upload, sent or not, without running its callbacks;
+     * for objects deleted before their uploads are done */
+    void cancel(Ticket ticket);
+
+    /* Spends this frame's budget; call once per frame from the GL thread */
+    void pump();
+
+    /* Awaitable form of on_done: `co_await scheduler.uploaded(ticket)` resumes
+     * inside pump() once the upload is complete */
+    auto uploaded(Ticket ticket) {
+        struct Awaiter {
+            UploadScheduler& scheduler;
+            Ticket ticket;
+            bool await_ready() const { return !scheduler.pending(ticket); }
+            void await_suspend(std::coroutine_handle<> handle) {
+                scheduler.on_done(ticket, [handle] { handle.resume(); });
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this, ticket};
+    }
+
+    bool pending(Ticket ticket) const;
+
+    Budget budget;
+    Stats stats;
+
+private:
+    struct Job {
+        Ticket ticket;
+        float priority;
+        bool is_texture;
+        unsigned int target;
+        unsigned int object;
+        int level;
+        int width;
+        int height;
+        unsigned int format;
+        unsigned int type;
+        std::size_t row_bytes;
+        std::size_t offset;
+        std::size_t size;
+        std::size_t done;
+        Pixels data;
+        std::vector<std::function<void()>> on_done;
+        /* Its pixels, in the memory accounts */
+        std::uint64_t memory_id = 0;
+    };
+
+    void on_done(Ticket ticket, std::function<void()> callback);
+    void hold(Job& job);
+    std::size_t upload_some(Job& job, std::size_t max_bytes, bool first_band);
+
+    std::vector<Job> jobs;
+    Ticket next_ticket = 1;
+};
+
+#endif
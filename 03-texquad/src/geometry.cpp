@@ -6,7 +6,8 @@
 
 Geometry::Geometry(
         std::initializer_list<float> vertices,
-        std::initializer_list<int> indices)
+        std::initializer_list<int> indices,
+        std::string_view /* name: this program labels nothing */)
     : n_indices{indices.size()} {
 
     /* Vertex buffer object (VBO) to store vertex data in GPU memory */
@@ -24,13 +24,26 @@ namespace {
     const std::size_t HEIGHT = 768;
 }
 
-unsigned int set_up_texture(std::string_view img_path) {
-    /* Load image to be used as texture */
+/* `display_width` x `display_height` is the largest size the texture is
+ * shown at; JPEGs much bigger than that are decoded at 1/2, 1/4 or 1/8 size */
+unsigned int set_up_texture(std::string_view img_path, int display_width, int display_height) {
     int img_width;
     int img_height;
     int img_channels;
+    if (!stbi_info(img_path.data(), &img_width, &img_height, &img_channels)) {
+        throw std::runtime_error{"Error loading image file"};
+    }
+    int scale_shift = 0;
+    while (scale_shift < 3 && (img_width >> (scale_shift + 1)) >= display_width
+            && (img_height >> (scale_shift + 1)) >= display_height) {
+        ++scale_shift;
+    }
+    stbi_set_jpeg_scale_shift(scale_shift);
+
+    /* Load image to be used as texture */
     unsigned char* img_data = stbi_load(
             img_path.data(), &img_width, &img_height, &img_channels, 0);
+    stbi_set_jpeg_scale_shift(0);
     if (!img_data) {
         throw std::runtime_error{"Error loading image file"};
     }
@@ -46,10 +59,23 @@ unsigned int set_up_texture(std::string_view img_path) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    /* Use loaded image data to make up the new texture */
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, img_width, img_height, 0, GL_RGB,
-            GL_UNSIGNED_BYTE, img_data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    /* Store only the channels the image has; gray images are read back as
+     * gray by replicating the red channel */
+    const GLenum formats[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    const GLenum internal_formats[] = {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+    GLenum format = formats[img_channels - 1];
+    if (img_channels <= 2) {
+        const GLint swizzle[] = {GL_RED, GL_RED, GL_RED, img_channels == 2 ? GL_GREEN : GL_ONE};
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    /* Use loaded image data to make up the new texture; stb_image rows are
+     * tightly packed, unlike GL's default 4-byte row alignment */
+    glPixelStorei(GL_UNPACK_ALIGNMENT, (img_width * img_channels) % 4 == 0 ? 4 : 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_formats[img_channels - 1], img_width, img_height, 0,
+            format, GL_UNSIGNED_BYTE, img_data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    /* No mipmaps: with GL_LINEAR minification they would never be sampled */
 
     /* Free previously allocated memory for image data */
     stbi_image_free(img_data);
@@ -107,12 +133,6 @@ int main(void)
         }
     };
 
-    /* I'd like my textures unflipped, please! */
-    stbi_set_flip_vertically_on_load(true);
-
-    unsigned int texture = set_up_texture("../tex/texquad.jpeg");
-    glBindTexture(GL_TEXTURE_2D, texture);
-
     /* Activate linked program */
     shader_program.use();
 
@@ -127,6 +147,25 @@ int main(void)
     /* Projection */
     glm::mat4 projection = glm::perspective(glm::radians(45.0f), float{WIDTH}/float{HEIGHT}, 0.1f, 100.0f);
 
+    /* Screen-space extent of the quad, so the texture is decoded no bigger
+     * than it is shown */
+    glm::vec2 screen_min{float{WIDTH}, float{HEIGHT}};
+    glm::vec2 screen_max{0.0f};
+    for (glm::vec3 corner : {glm::vec3{0.8f, 0.45f, 0.0f}, glm::vec3{0.8f, -0.45f, 0.0f},
+                             glm::vec3{-0.8f, -0.45f, 0.0f}, glm::vec3{-0.8f, 0.45f, 0.0f}}) {
+        glm::vec4 clip = projection * view * model * glm::vec4{corner, 1.0f};
+        glm::vec2 screen = (glm::vec2{clip} / clip.w * 0.5f + 0.5f) * glm::vec2{float{WIDTH}, float{HEIGHT}};
+        screen_min = glm::min(screen_min, screen);
+        screen_max = glm::max(screen_max, screen);
+    }
+    glm::vec2 screen_size = glm::ceil(screen_max - screen_min);
+
+    /* I'd like my textures unflipped, please! */
+    stbi_set_flip_vertically_on_load(true);
+
+    unsigned int texture = set_up_texture("../tex/texquad.jpeg", int(screen_size.x), int(screen_size.y));
+    glBindTexture(GL_TEXTURE_2D, texture);
+
     int model_location = shader_program.get_uniform_location("model");
     int view_location = shader_program.get_uniform_location("view");
     int projection_location = shader_program.get_uniform_location("projection");
@@ -0,0 +1,105 @@
+/**
+ * Decode throughput of the bundled stb_image, with and without its SIMD
+ * paths (PNG unfiltering, JPEG IDCT, color conversion and upsampling).
+ *
+ * Files are read into memory first so only decoding is timed. Throughput is
+ * reported in MB/s of decoded pixels, and the SIMD output is checked against
+ * the scalar output byte for byte.
+ *
+ * Usage: decode_bench [image...] (defaults to the study's textures, run from
+ * the src directory)
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+namespace {
+    const int REPEATS = 10;
+
+    struct Decoded {
+        std::vector<unsigned char> pixels;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        double ms = 0.0;
+    };
+
+    Decoded decode(const std::vector<unsigned char>& file, bool simd) {
+        stbi_set_simd_enabled(simd);
+        Decoded decoded;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < REPEATS; ++i) {
+            stbi_uc* data = stbi_load_from_memory(file.data(), int(file.size()), &decoded.width,
+                    &decoded.height, &decoded.channels, 0);
+            if (!data) {
+                throw std::runtime_error(stbi_failure_reason());
+            }
+            if (i == 0) {
+                decoded.pixels.assign(data,
+                        data + std::size_t(decoded.width) * decoded.height * decoded.channels);
+            }
+            stbi_image_free(data);
+        }
+        decoded.ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count() / REPEATS;
+        return decoded;
+    }
+
+    double mb_per_s(const Decoded& decoded) {
+        return decoded.pixels.size() / (decoded.ms * 1000.0);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths{argv + 1, argv + argc};
+    if (paths.empty()) {
+        paths = {"../tex/1.png", "../tex/2.png", "../tex/3.png", "../tex/4.png",
+                 "../../03-texquad/tex/texquad.jpeg"};
+    }
+
+    int mismatches = 0;
+    double scalar_ms = 0.0;
+    double simd_ms = 0.0;
+    std::size_t decoded_bytes = 0;
+    for (auto& path : paths) {
+        std::ifstream in{path, std::ios::binary};
+        if (!in) {
+            std::cerr << path << ": cannot open\n";
+            continue;
+        }
+        std::vector<unsigned char> file{std::istreambuf_iterator<char>(in), {}};
+
+        try {
+            Decoded scalar = decode(file, false);
+            Decoded simd = decode(file, true);
+            std::cout << path << " (" << simd.width << 'x' << simd.height << 'x' << simd.channels
+                      << "): scalar " << mb_per_s(scalar) << " MB/s, simd " << mb_per_s(simd)
+                      << " MB/s";
+            if (simd.pixels != scalar.pixels) {
+                std::cout << " (MISMATCH)";
+                ++mismatches;
+            }
+            std::cout << '\n';
+            scalar_ms += scalar.ms;
+            simd_ms += simd.ms;
+            decoded_bytes += simd.pixels.size();
+        } catch (const std::runtime_error& e) {
+            std::cerr << path << ": " << e.what() << '\n';
+        }
+    }
+
+    if (decoded_bytes > 0) {
+        std::cout << "total: scalar " << decoded_bytes / (scalar_ms * 1000.0) << " MB/s, simd "
+                  << decoded_bytes / (simd_ms * 1000.0) << " MB/s\n";
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/**
+ * Link cost of N vertex x M fragment shader variants: separable stages mixed
+ * by program pipelines (N + M links) vs. one program per combination
+ * (N x M links), both built through PipelineCache (see program_pipeline.hpp).
+ *
+ * Vertex variants are copies of shaders/vertex.shader told apart by a
+ * comment; fragment variants go through the TEXTURED and OVERDRAW features
+ * of shaders/fragment.shader, then comments. Every combination is drawn once
+ * after being built, so the time includes whatever validation the driver
+ * defers to the first draw. Renders headless (see headless_context.hpp).
+ *
+ * Usage: pipeline_bench [n_vertex] [n_fragment] (run from the src directory)
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <geometry.hpp>
+#include <headless_context.hpp>
+#include <program_pipeline.hpp>
+#include <shader_preproc.hpp>
+
+namespace {
+    struct Result {
+        std::size_t links;
+        double build_ms;
+        double draw_ms;
+    };
+
+    Result build_and_draw(PipelineCache& cache, Geometry& quad,
+                          const std::vector<std::string>& vert_srcs,
+                          const std::vector<std::string>& frag_srcs) {
+        std::vector<const PipelineBinding*> bindings;
+        auto start = std::chrono::steady_clock::now();
+        for (auto& vert_src : vert_srcs) {
+            for (auto& frag_src : frag_srcs) {
+                bindings.push_back(&cache.get(vert_src, frag_src, {"model", "in_color"}));
+            }
+        }
+        glFinish();
+        auto built = std::chrono::steady_clock::now();
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        glm::mat4 model = glm::scale(glm::mat4{1.0f}, glm::vec3{0.5f});
+        for (const PipelineBinding* binding : bindings) {
+            binding->bind();
+            binding->set_uniform_matrix4fv(binding->get_uniform_location("model"), model);
+            binding->set_uniform_4f(binding->get_uniform_location("in_color"), 1.0f, 0.5f, 0.0f, 1.0f);
+            quad.draw();
+        }
+        glFinish();
+        auto drawn = std::chrono::steady_clock::now();
+
+        glUseProgram(0);
+        return {
+            cache.link_count,
+            std::chrono::duration<double, std::milli>(built - start).count(),
+            std::chrono::duration<double, std::milli>(drawn - built).count(),
+        };
+    }
+
+    void print_result(const char* name, const Result& result) {
+        std::printf("%-11s %4zu links, build %8.2f ms, first draws %8.2f ms\n",
+                    name, result.links, result.build_ms, result.draw_ms);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int n_vertex = argc > 1 ? std::stoi(argv[1]) : 8;
+    int n_fragment = argc > 2 ? std::stoi(argv[2]) : 8;
+
+    try {
+        HeadlessContext context{64, 64};
+
+        std::string vert_src = preprocess_shader("shaders/vertex.shader").source;
+        std::vector<std::string> vert_srcs;
+        for (int i = 0; i < n_vertex; ++i) {
+            vert_srcs.push_back(vert_src + "\n// variant " + std::to_string(i) + "\n");
+        }
+
+        const ShaderDefines feature_sets[] = {
+            {},
+            {{"TEXTURED", ""}},
+            {{"OVERDRAW", ""}},
+            {{"TEXTURED", ""}, {"OVERDRAW", ""}},
+        };
+        std::vector<std::string> frag_srcs;
+        for (int i = 0; i < n_fragment; ++i) {
+            const ShaderDefines& defines = feature_sets[i % std::size(feature_sets)];
+            frag_srcs.push_back(preprocess_shader("shaders/fragment.shader", defines).source
+                                + "\n// variant " + std::to_string(i) + "\n");
+        }
+
+        Geometry quad{
+            {
+                 0.5f,  0.5f, 0.0f,  1.0f, 1.0f,
+                 0.5f, -0.5f, 0.0f,  1.0f, 0.0f,
+                -0.5f, -0.5f, 0.0f,  0.0f, 0.0f,
+                -0.5f,  0.5f, 0.0f,  0.0f, 1.0f,
+            },
+            {
+                0, 1, 3,
+                1, 2, 3,
+            }
+        };
+
+        std::cout << "renderer:   " << context.renderer() << '\n'
+                  << "variants:   " << n_vertex << " vertex x " << n_fragment << " fragment\n";
+
+        PipelineCache monolithic_cache{false};
+        print_result("monolithic:", build_and_draw(monolithic_cache, quad, vert_srcs, frag_srcs));
+        monolithic_cache.del();
+
+        PipelineCache separable_cache;
+        if (separable_cache.separable) {
+            print_result("separable:", build_and_draw(separable_cache, quad, vert_srcs, frag_srcs));
+        } else {
+            std::cout << "separable:  not supported by this context\n";
+        }
+        separable_cache.del();
+
+        quad.del();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
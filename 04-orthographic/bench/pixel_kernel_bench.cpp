@@ -0,0 +1,161 @@
+/**
+ * Decode vs. post-processing cost of texture import.
+ *
+ * First, every SIMD kernel the CPU supports is checked against the scalar
+ * reference, byte for byte, over all combinations of source and destination
+ * channel counts (1 to 4), a few swizzles each, sRGB conversion,
+ * premultiplication and flipping, at widths around the kernels' block
+ * sizes. Then each image is decoded once and converted into an RGBA8
+ * staging buffer (flipped and premultiplied, the most expensive
+ * combination) with every kernel, which is timed and checked the same way.
+ * The exit status is 1 on any mismatch.
+ *
+ * Usage: pixel_kernel_bench [image...] (defaults to the study's textures,
+ * run from the src directory)
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <texture.hpp>
+#include <pixel_kernels.hpp>
+
+namespace {
+    const int REPEATS = 10;
+
+    /* Odd ones for the scalar tails, the rest around the SSE2 (4 pixels)
+     * and AVX2 (8 pixels, and 16 bytes of lookahead) blocks */
+    const int CHECK_WIDTHS[] = {1, 2, 3, 4, 5, 7, 8, 9, 11, 12, 13, 15, 16, 17, 31, 32, 33, 67};
+    const int CHECK_HEIGHT = 3;
+
+    double elapsed_ms(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::string describe(const PixelConversion& conversion, int width) {
+        std::string text = std::to_string(conversion.src_channels) + "->"
+            + std::to_string(conversion.dst_channels) + " swizzle ";
+        for (int i = 0; i < conversion.dst_channels; ++i) {
+            int channel = conversion.swizzle[i];
+            text += channel == PixelConversion::ONE ? '1' : char('0' + channel);
+        }
+        text += conversion.srgb_to_linear ? " srgb" : "";
+        text += conversion.premultiply_alpha ? " premultiply" : "";
+        text += conversion.flip_y ? " flip" : "";
+        return text + " width " + std::to_string(width);
+    }
+
+    /* Swizzles to try for a channel count pair: GL's expansion, the
+     * channels reversed (as for BGRA) and the last one replicated */
+    std::vector<PixelConversion> swizzles(int src_channels, int dst_channels) {
+        PixelConversion expand = PixelConversion::expand(src_channels, dst_channels);
+        PixelConversion reversed = expand;
+        PixelConversion replicated = expand;
+        for (int i = 0; i < dst_channels; ++i) {
+            reversed.swizzle[i] = i < src_channels ? src_channels - 1 - i : PixelConversion::ONE;
+            replicated.swizzle[i] = src_channels - 1;
+        }
+        return {expand, reversed, replicated};
+    }
+
+    /* Every SIMD kernel against the scalar one; returns the mismatches */
+    int check_kernels() {
+        std::mt19937 engine{1234};
+        std::vector<unsigned char> src(std::size_t(CHECK_WIDTHS[std::size(CHECK_WIDTHS) - 1]) * CHECK_HEIGHT * 4);
+        for (auto& byte : src) {
+            byte = (unsigned char)(engine() >> 24);
+        }
+        /* The premultiply extremes, besides random alpha */
+        src[3] = 0;
+        src[7] = 255;
+
+        int checked = 0;
+        int mismatches = 0;
+        for (int src_channels = 1; src_channels <= 4; ++src_channels) {
+            for (int dst_channels = 1; dst_channels <= 4; ++dst_channels) {
+                for (PixelConversion conversion : swizzles(src_channels, dst_channels)) {
+                    for (int flags = 0; flags < 8; ++flags) {
+                        conversion.srgb_to_linear = flags & 1;
+                        conversion.premultiply_alpha = flags & 2;
+                        conversion.flip_y = flags & 4;
+                        for (int width : CHECK_WIDTHS) {
+                            std::size_t size = std::size_t(width) * CHECK_HEIGHT * dst_channels;
+                            std::vector<unsigned char> reference(size);
+                            std::vector<unsigned char> converted(size);
+                            convert_image(PixelIsa::scalar, conversion, src.data(), width, CHECK_HEIGHT,
+                                    reference.data());
+                            for (PixelIsa isa : {PixelIsa::sse2, PixelIsa::avx2}) {
+                                if (isa > detected_pixel_isa()) {
+                                    break;
+                                }
+                                ++checked;
+                                convert_image(isa, conversion, src.data(), width, CHECK_HEIGHT, converted.data());
+                                if (converted != reference) {
+                                    std::cout << "MISMATCH " << pixel_isa_name(isa) << ' '
+                                              << describe(conversion, width) << '\n';
+                                    ++mismatches;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        std::cout << "Checked " << checked << " conversions against scalar, " << mismatches
+                  << " mismatches\n";
+        return mismatches;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths{argv + 1, argv + argc};
+    if (paths.empty()) {
+        paths = {"../tex/1.png", "../tex/2.png", "../tex/3.png", "../tex/4.png"};
+    }
+
+    set_flip_on_load(true);
+    std::cout << "Detected " << pixel_isa_name(detected_pixel_isa()) << '\n';
+
+    int mismatches = check_kernels();
+    for (auto& path : paths) {
+        auto start = std::chrono::steady_clock::now();
+        DecodedImage image = decode_image(path);
+        double decode_ms = elapsed_ms(start);
+
+        PixelConversion conversion = PixelConversion::expand(image.channels, 4);
+        conversion.flip_y = image.flip_y;
+        conversion.premultiply_alpha = true;
+
+        std::size_t size = std::size_t(image.width) * image.height * 4;
+        std::vector<unsigned char> reference(size);
+        std::vector<unsigned char> staging(size);
+        convert_image(PixelIsa::scalar, conversion, image.data, image.width, image.height,
+                reference.data());
+
+        std::cout << path << " (" << image.width << 'x' << image.height << 'x' << image.channels
+                  << "): decode " << decode_ms << " ms";
+        for (PixelIsa isa : {PixelIsa::scalar, PixelIsa::sse2, PixelIsa::avx2}) {
+            if (isa > detected_pixel_isa()) {
+                break;
+            }
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < REPEATS; ++i) {
+                convert_image(isa, conversion, image.data, image.width, image.height, staging.data());
+            }
+            std::cout << ", " << pixel_isa_name(isa) << ' ' << elapsed_ms(start) / REPEATS << " ms";
+            if (std::memcmp(staging.data(), reference.data(), size) != 0) {
+                std::cout << " (MISMATCH)";
+                ++mismatches;
+            }
+        }
+        std::cout << '\n';
+        image.free();
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
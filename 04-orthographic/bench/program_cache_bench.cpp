@@ -0,0 +1,103 @@
+/**
+ * Cold vs. warm startup cost of building shader programs through the
+ * on-disk program binary cache.
+ *
+ * The cold pass starts from an empty cache directory, so every program is
+ * compiled, linked and stored; the warm pass restores the same programs from
+ * their cached binaries. Each program gets a distinct (otherwise identical)
+ * source so it has its own cache entry.
+ *
+ * Usage: program_cache_bench [n_programs] (run from the src directory)
+ */
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <shader_prog.hpp>
+#include <program_cache.hpp>
+#include <shader_preproc.hpp>
+
+namespace {
+    const char* const CACHE_DIR = "../cache/bench_programs";
+
+    double build_all(ProgramCache& cache,
+                     const std::vector<std::string>& vert_srcs,
+                     const std::string& frag_src) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<GLuint> programs;
+        for (auto& vert_src : vert_srcs) {
+            programs.push_back(cache.get_program(vert_src, frag_src));
+        }
+        /* Make sure nothing is left pending in the driver */
+        glFinish();
+        auto end = std::chrono::steady_clock::now();
+
+        for (auto program : programs) {
+            glDeleteProgram(program);
+        }
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int n_programs = argc > 1 ? std::stoi(argv[1]) : 64;
+
+    if (!glfwInit())
+        return -1;
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Program cache benchmark", NULL, NULL);
+    if (!window)
+    {
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGL()) {
+        std::cerr << "Problem initializing glad\n";
+        glfwTerminate();
+        return -1;
+    }
+
+    ShaderDefines defines{{"TEXTURED", ""}};
+    std::string vert_src = preprocess_shader("shaders/vertex.shader", defines).source;
+    std::string frag_src = preprocess_shader("shaders/fragment.shader", defines).source;
+
+    std::vector<std::string> vert_srcs;
+    for (int i = 0; i < n_programs; ++i) {
+        vert_srcs.push_back(vert_src + "\n// variant " + std::to_string(i) + "\n");
+    }
+
+    std::filesystem::remove_all(CACHE_DIR);
+
+    ProgramCache cold_cache{CACHE_DIR};
+    if (!cold_cache.supported()) {
+        std::cerr << "Program binaries are not supported by this driver\n";
+    }
+    double cold_ms = build_all(cold_cache, vert_srcs, frag_src);
+
+    ProgramCache warm_cache{CACHE_DIR};
+    double warm_ms = build_all(warm_cache, vert_srcs, frag_src);
+
+    std::cout << "programs:  " << n_programs << '\n'
+              << "cold:      " << cold_ms << " ms (" << cold_cache.misses << " compiled)\n"
+              << "warm:      " << warm_ms << " ms (" << warm_cache.hits << " restored, "
+              << warm_cache.rejected << " rejected)\n"
+              << "speedup:   " << cold_ms / warm_ms << "x\n";
+
+    glfwTerminate();
+
+    return 0;
+}
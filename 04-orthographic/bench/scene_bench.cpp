@@ -0,0 +1,485 @@
+/**
+ * Frame times of a named scene, rendered headless (see headless_context.hpp)
+ * so it runs on machines without a display or GPU, e.g. CI with llvmpipe.
+ *
+ * After some warm-up frames, every frame's CPU time (issuing its GL calls)
+ * and GPU time (GL_TIME_ELAPSED) are recorded; percentiles of both, the draw
+ * calls per frame and the process' memory use (resident, and what its GL
+ * objects take, see memory_accounting.hpp) are printed and optionally
+ * written as JSON. Like a swap chain, the CPU may run at most two frames
+ * ahead of the GPU.
+ *
+ * Given a baseline (a JSON file written by an earlier run), the p50 and p90
+ * times are compared against it, and the exit status is 1 if any got worse
+ * by more than the tolerance and by more than --min-ms. The latter keeps
+ * times of a few microseconds (e.g. GPU times on llvmpipe, which are mostly
+ * noise) from failing the run on relative changes alone.
+ *
+ * bench/baselines holds one per scene at the default settings, measured with
+ * llvmpipe on a single core of one particular machine. They are only
+ * comparable with runs on that machine: on any other, regenerate them first
+ * (--json bench/baselines/<scene>.json) and compare against those.
+ *
+ * With --overdraw, frames are drawn in the overdraw analysis mode (see
+ * overdraw.hpp), and the fragments shaded per pixel and how many of them
+ * are visible are reported as well; times then include the mode's costs.
+ *
+ * Usage: scene_bench [--scene squares|many_squares|overdraw] [--frames N]
+ *                    [--warmup N] [--size WxH] [--overdraw]
+ *                    [--json out.json] [--baseline in.json]
+ *                    [--tolerance 0.1] [--min-ms 0.05]
+ *                    (run from the src directory)
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <bench_scenes.hpp>
+#include <bench_stats.hpp>
+#include <geometry.hpp>
+#include <headless_context.hpp>
+#include <json.hpp>
+#include <memory_accounting.hpp>
+#include <overdraw.hpp>
+#include <profiler.hpp>
+#include <shader_preproc.hpp>
+#include <shader_prog.hpp>
+#include <texture.hpp>
+
+namespace {
+    /* GPU timer queries are read back this many frames later, when they are
+     * done, so reading them never stalls */
+    const int QUERY_LATENCY = 3;
+    /* Frames the CPU may queue ahead of the GPU */
+    const int FRAMES_IN_FLIGHT = 2;
+
+    struct Options {
+        std::string scene = "squares";
+        int frames = 500;
+        int warmup = 30;
+        int width = 1024;
+        int height = 768;
+        std::string json_path;
+        std::string baseline_path;
+        double tolerance = 0.1;
+        /* Changes smaller than this never count as regressions */
+        double min_ms = 0.05;
+        bool overdraw = false;
+    };
+
+    /* What scenes are built from: the study's sprite program and quad */
+    struct Resources {
+        ShaderProgram program;
+        GLint model_location;
+        Geometry quad;
+        std::vector<GLuint> textures;
+        /* Blending is the overdraw analysis' own then */
+        bool overdraw = false;
+    };
+
+    /* Draws one frame and returns the number of draw calls it made */
+    using Scene = std::function<std::size_t(Resources& resources, int frame)>;
+
+    std::size_t draw_sprite(Resources& resources, GLuint texture, const glm::mat4& model) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        resources.program.set_uniform_matrix4fv(resources.model_location, model);
+        resources.quad.draw();
+        return 1;
+    }
+
+    const std::map<std::string, Scene> SCENES = {
+        /* The study's own scene: two squares, one of them turning */
+        {"squares", [](Resources& resources, int frame) {
+            glm::mat4 identity{1.0f};
+            glm::mat4 square1 = glm::translate(identity, glm::vec3(-0.4f, 0.0f, 0.0f));
+            glm::mat4 square2 = glm::translate(identity, glm::vec3(0.4f, -0.3f, 0.0f));
+            square2 = glm::rotate(square2, glm::radians(-42.0f - frame), glm::vec3(0.0f, 0.0f, 1.0f));
+            return draw_sprite(resources, resources.textures[0], square1)
+                + draw_sprite(resources, resources.textures[1], square2);
+        }},
+        /* Draw call bound: thousands of tiny sprites, one call each */
+        {"many_squares", [](Resources& resources, int frame) {
+            return draw_many_squares(frame, [&](int texture, const glm::mat4& model) {
+                draw_sprite(resources, resources.textures[texture], model);
+            });
+        }},
+        /* Fill bound: blended full-screen layers */
+        {"overdraw", [](Resources& resources, int frame) {
+            const int layers = 16;
+            if (!resources.overdraw) {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            }
+            std::size_t draws = 0;
+            for (int layer = 0; layer < layers; ++layer) {
+                glm::mat4 model = glm::rotate(glm::mat4{1.0f}, glm::radians(float(frame + layer * 7)),
+                        glm::vec3(0.0f, 0.0f, 1.0f));
+                model = glm::scale(model, glm::vec3(8.0f));
+                draws += draw_sprite(resources, resources.textures[layer % 2], model);
+            }
+            if (!resources.overdraw) {
+                glDisable(GL_BLEND);
+            }
+            return draws;
+        }},
+    };
+
+    /* Per-frame means of the overdraw statistics, and their worst frame */
+    struct OverdrawTotals {
+        SampleSummary average;
+        std::uint64_t max = 0;
+        double shaded_fragments = 0.0;
+        double visible_fragments = 0.0;
+        double covered_pixels = 0.0;
+        double visible_pixels = 0.0;
+    };
+
+    OverdrawTotals total_overdraw(const std::vector<OverdrawStats>& frames) {
+        OverdrawTotals totals;
+        std::vector<double> averages;
+        for (const OverdrawStats& stats : frames) {
+            averages.push_back(stats.average_overdraw());
+            totals.max = std::max(totals.max, stats.max_overdraw);
+            totals.shaded_fragments += double(stats.shaded_fragments);
+            totals.visible_fragments += double(stats.visible_fragments);
+            totals.covered_pixels += double(stats.covered_pixels);
+            totals.visible_pixels += double(stats.visible_pixels);
+        }
+        if (!frames.empty()) {
+            totals.shaded_fragments /= frames.size();
+            totals.visible_fragments /= frames.size();
+            totals.covered_pixels /= frames.size();
+            totals.visible_pixels /= frames.size();
+        }
+        totals.average = summarize(averages);
+        return totals;
+    }
+
+    void write_overdraw(JsonWriter& json, const std::vector<OverdrawStats>& frames) {
+        OverdrawTotals totals = total_overdraw(frames);
+        json.begin_object("overdraw");
+        write_summary(json, "average", totals.average);
+        json.field("max", totals.max)
+            .field("shaded_fragments", totals.shaded_fragments)
+            .field("visible_fragments", totals.visible_fragments)
+            .field("covered_pixels", totals.covered_pixels)
+            .field("visible_pixels", totals.visible_pixels)
+            .end_object();
+    }
+
+    void print_overdraw(const std::vector<OverdrawStats>& frames) {
+        OverdrawTotals totals = total_overdraw(frames);
+        double wasted = totals.shaded_fragments > 0.0
+            ? 1.0 - totals.visible_fragments / totals.shaded_fragments : 0.0;
+        std::printf("overdraw: mean %.3f p50 %.3f p90 %.3f max %.3f per covered pixel, %llu at most\n",
+                totals.average.mean, totals.average.p50, totals.average.p90, totals.average.max,
+                static_cast<unsigned long long>(totals.max));
+        std::printf("fragments: %.0f shaded, %.0f visible (%.1f%% wasted); pixels: %.0f covered, %.0f visible\n",
+                totals.shaded_fragments, totals.visible_fragments, wasted * 100.0, totals.covered_pixels,
+                totals.visible_pixels);
+    }
+
+    std::size_t resident_bytes() {
+        std::ifstream statm{"/proc/self/statm"};
+        std::size_t pages = 0;
+        std::size_t resident = 0;
+        statm >> pages >> resident;
+        return resident * ::sysconf(_SC_PAGESIZE);
+    }
+
+    std::size_t peak_resident_bytes() {
+        rusage usage{};
+        ::getrusage(RUSAGE_SELF, &usage);
+        return std::size_t(usage.ru_maxrss) * 1024;
+    }
+
+    Options parse_options(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--overdraw") {
+                options.overdraw = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if (arg == "--scene") {
+                options.scene = value;
+            } else if (arg == "--frames") {
+                options.frames = std::max(1, std::stoi(value));
+            } else if (arg == "--warmup") {
+                options.warmup = std::max(0, std::stoi(value));
+            } else if (arg == "--size") {
+                if (std::sscanf(value.c_str(), "%dx%d", &options.width, &options.height) != 2) {
+                    throw std::runtime_error("Bad size " + value);
+                }
+            } else if (arg == "--json") {
+                options.json_path = value;
+            } else if (arg == "--baseline") {
+                options.baseline_path = value;
+            } else if (arg == "--tolerance") {
+                options.tolerance = std::stod(value);
+            } else if (arg == "--min-ms") {
+                options.min_ms = std::stod(value);
+            } else {
+                throw std::runtime_error("Unknown option " + arg);
+            }
+        }
+        if (!SCENES.contains(options.scene)) {
+            throw std::runtime_error("Unknown scene " + options.scene);
+        }
+        return options;
+    }
+
+    /* Compares against the baseline; returns whether nothing regressed */
+    bool compare(const std::map<std::string, std::string>& results, const std::string& baseline_path,
+                 double tolerance, double min_ms) {
+        std::ifstream in{baseline_path};
+        if (!in) {
+            throw std::runtime_error("Cannot read baseline " + baseline_path);
+        }
+        auto baseline = flatten_json(std::string{std::istreambuf_iterator<char>(in), {}});
+
+        if (baseline["scene"] != results.at("scene") || baseline["width"] != results.at("width")
+                || baseline["height"] != results.at("height")) {
+            throw std::runtime_error("Baseline " + baseline_path + " is for another scene or size");
+        }
+        if (baseline["renderer"] != results.at("renderer")) {
+            std::cout << "warning: baseline renderer was " << baseline["renderer"] << '\n';
+        }
+        if (baseline["draws_per_frame"] != results.at("draws_per_frame")) {
+            std::cout << "warning: baseline drew " << baseline["draws_per_frame"] << " times per frame\n";
+        }
+
+        bool passed = true;
+        for (const char* metric : {"cpu_ms.p50", "cpu_ms.p90", "gpu_ms.p50", "gpu_ms.p90"}) {
+            if (!baseline.contains(metric) || baseline[metric] == "null") {
+                continue;
+            }
+            double before = std::stod(baseline[metric]);
+            double now = std::stod(results.at(metric));
+            double change = before > 0.0 ? now / before - 1.0 : 0.0;
+            bool significant = std::abs(now - before) > min_ms;
+            bool regressed = change > tolerance && significant;
+            const char* verdict = regressed ? "REGRESSED"
+                : change < -tolerance && significant ? "improved"
+                : std::abs(change) > tolerance ? "ok (below --min-ms)" : "ok";
+            std::printf("%-12s %10.4f -> %10.4f ms (%+6.1f%%) %s\n", metric, before, now, change * 100.0, verdict);
+            passed &= !regressed;
+        }
+        return passed;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\nusage: scene_bench [--scene squares|many_squares|overdraw] [--frames N]"
+                     " [--warmup N] [--size WxH] [--overdraw] [--json out.json] [--baseline in.json]"
+                     " [--tolerance 0.1] [--min-ms 0.05]\n";
+        return 2;
+    }
+
+    try {
+        HeadlessContext context{options.width, options.height};
+        set_flip_on_load(true);
+
+        /* The sprite program, with or without the OVERDRAW feature; the
+         * cache owns it */
+        ShaderVariantCache shader_variants;
+        ShaderDefines sprite_defines{{"TEXTURED", ""}};
+        if (options.overdraw) {
+            sprite_defines["OVERDRAW"] = "";
+        }
+        Resources resources{
+            ShaderProgram{
+                shader_variants.get_program("shaders/vertex.shader", "shaders/fragment.shader", sprite_defines),
+                {"model"}
+            },
+            0,
+            Geometry{
+                {
+                     0.2f,  0.2f, 0.0f,  1.0f, 1.0f,
+                     0.2f, -0.2f, 0.0f,  1.0f, 0.0f,
+                    -0.2f, -0.2f, 0.0f,  0.0f, 0.0f,
+                    -0.2f,  0.2f, 0.0f,  0.0f, 1.0f,
+                },
+                {0, 1, 3, 1, 2, 3}
+            },
+            {set_up_texture("../tex/1.png"), set_up_texture("../tex/2.png")},
+            options.overdraw,
+        };
+        resources.model_location = resources.program.get_uniform_location("model");
+        resources.program.use();
+        const Scene& scene = SCENES.at(options.scene);
+        std::optional<OverdrawView> overdraw_view;
+        if (options.overdraw) {
+            overdraw_view.emplace(options.width, options.height);
+        }
+        std::vector<OverdrawStats> overdraw_stats;
+        auto keep_overdraw_stats = [&](const OverdrawStats& stats) {
+            if (stats.frame >= std::uint64_t(options.warmup)) {
+                overdraw_stats.push_back(stats);
+            }
+        };
+
+        GLuint queries[QUERY_LATENCY + 1];
+        glGenQueries(QUERY_LATENCY + 1, queries);
+        GLsync fences[FRAMES_IN_FLIGHT] = {};
+
+        std::vector<double> cpu_ms;
+        std::vector<double> gpu_ms;
+        std::size_t draws = 0;
+        int total_frames = options.warmup + options.frames;
+        for (int frame = 0; frame < total_frames + QUERY_LATENCY; ++frame) {
+            /* Past the last frame, only the outstanding queries are read */
+            if (frame >= QUERY_LATENCY) {
+                GLuint64 elapsed_ns = 0;
+                glGetQueryObjectui64v(queries[(frame - QUERY_LATENCY) % (QUERY_LATENCY + 1)], GL_QUERY_RESULT,
+                        &elapsed_ns);
+                if (frame - QUERY_LATENCY >= options.warmup) {
+                    gpu_ms.push_back(elapsed_ns / 1e6);
+                }
+            }
+            if (frame >= total_frames) {
+                continue;
+            }
+
+            GLsync& fence = fences[frame % FRAMES_IN_FLIGHT];
+            if (fence) {
+                AZ_PROFILE_ZONE("wait for GPU");
+                glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(10'000'000'000));
+                glDeleteSync(fence);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, queries[frame % (QUERY_LATENCY + 1)]);
+            if (overdraw_view) {
+                overdraw_view->begin_frame();
+            }
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            std::size_t frame_draws;
+            {
+                AZ_PROFILE_ZONE("scene");
+                AZ_PROFILE_GPU_ZONE("scene");
+                frame_draws = scene(resources, frame);
+            }
+            if (overdraw_view) {
+                if (auto stats = overdraw_view->end_frame()) {
+                    keep_overdraw_stats(*stats);
+                }
+            }
+            glEndQuery(GL_TIME_ELAPSED);
+            fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            if (frame >= options.warmup) {
+                cpu_ms.push_back(elapsed);
+                draws = frame_draws;
+            }
+            AZ_PROFILE_FRAME();
+        }
+        glFinish();
+        if (overdraw_view) {
+            for (const OverdrawStats& stats : overdraw_view->finish()) {
+                keep_overdraw_stats(stats);
+            }
+            overdraw_view->del();
+        }
+        for (GLsync fence : fences) {
+            if (fence) {
+                glDeleteSync(fence);
+            }
+        }
+        glDeleteQueries(QUERY_LATENCY + 1, queries);
+        if (GLenum error = glGetError()) {
+            throw std::runtime_error("GL error " + std::to_string(error));
+        }
+
+        SampleSummary cpu = summarize(cpu_ms);
+        SampleSummary gpu = summarize(gpu_ms);
+        std::ostringstream json_text;
+        JsonWriter json{json_text};
+        json.begin_object()
+            .field("scene", options.scene)
+            .field("renderer", context.renderer())
+            .field("width", options.width)
+            .field("height", options.height)
+            .field("frames", options.frames)
+            .field("warmup", options.warmup)
+            .field("draws_per_frame", std::uint64_t(draws));
+        write_summary(json, "cpu_ms", cpu);
+        write_summary(json, "gpu_ms", gpu);
+        if (options.overdraw) {
+            write_overdraw(json, overdraw_stats);
+        }
+        MemoryTotals memory = memory_totals();
+        json.field("gpu_bytes", std::uint64_t(memory.gpu.bytes))
+            .field("peak_gpu_bytes", std::uint64_t(memory.gpu.peak_bytes))
+            .field("rss_bytes", std::uint64_t(resident_bytes()))
+            .field("peak_rss_bytes", std::uint64_t(peak_resident_bytes()))
+            .end_object();
+
+        std::printf("%s on %s, %dx%d, %d frames, %zu draws per frame\n", options.scene.c_str(),
+                context.renderer().c_str(), options.width, options.height, options.frames, draws);
+        std::printf("cpu ms: mean %.4f p50 %.4f p90 %.4f p99 %.4f max %.4f\n", cpu.mean, cpu.p50, cpu.p90, cpu.p99, cpu.max);
+        std::printf("gpu ms: mean %.4f p50 %.4f p90 %.4f p99 %.4f max %.4f\n", gpu.mean, gpu.p50, gpu.p90, gpu.p99, gpu.max);
+        if (options.overdraw) {
+            print_overdraw(overdraw_stats);
+        }
+        std::printf("memory: %.1f MiB resident, %.1f MiB peak; GL objects %.1f MiB, %.1f MiB peak\n",
+                resident_bytes() / 1048576.0, peak_resident_bytes() / 1048576.0, memory.gpu.bytes / 1048576.0,
+                memory.gpu.peak_bytes / 1048576.0);
+
+        if (!options.json_path.empty()) {
+            std::ofstream out{options.json_path};
+            out << json_text.str();
+            if (!out.flush()) {
+                throw std::runtime_error("Cannot write " + options.json_path);
+            }
+        }
+
+        bool passed = true;
+        if (!options.baseline_path.empty()) {
+            passed = compare(flatten_json(json_text.str()), options.baseline_path, options.tolerance,
+                             options.min_ms);
+        }
+
+        for (GLuint texture : resources.textures) {
+            delete_texture(texture);
+        }
+        resources.quad.del();
+        shader_variants.del();
+        AZ_PROFILE_WRITE_TRACE("scene_bench.trace.json");
+        return passed ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+}
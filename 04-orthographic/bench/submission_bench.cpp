@@ -0,0 +1,259 @@
+/**
+ * CPU cost of submitting work: the study's Geometry, ShaderProgram and
+ * scene drawing, run against the null GL driver (see null_gl.hpp), so what
+ * is measured is the application's side of each GL call and nothing of a
+ * real driver's. No display or GPU is needed, and the GL calls per
+ * operation, taken from the recorded command stream, are the same on every
+ * machine.
+ *
+ * Each case is timed in batches long enough for the clock (at least a
+ * millisecond); the median and fastest batch are reported per operation.
+ * The driver does not record while timing unless --record is given, which
+ * adds what keeping the command stream costs.
+ *
+ * Usage: submission_bench [--case name] [--repeats N] [--record]
+ *                         [--json out.json] (run from the src directory)
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <bench_scenes.hpp>
+#include <geometry.hpp>
+#include <gl_trace.hpp>
+#include <json.hpp>
+#include <null_gl.hpp>
+#include <shader_preproc.hpp>
+#include <shader_prog.hpp>
+
+namespace {
+    /* Batches run until they take at least this long */
+    const double MIN_BATCH_MS = 1.0;
+
+    struct Options {
+        std::string only_case;
+        int repeats = 30;
+        bool record = false;
+        std::string json_path;
+    };
+
+    struct Case {
+        const char* name;
+        std::function<void()> run;
+    };
+
+    struct Result {
+        const char* name;
+        double median_ns;
+        double min_ns;
+        std::size_t gl_calls;
+        /* Most called function and how often, per operation */
+        std::string top_function;
+        std::size_t top_calls;
+    };
+
+    Geometry make_quad() {
+        return Geometry{
+            {
+                 0.2f,  0.2f, 0.0f,  1.0f, 1.0f,
+                 0.2f, -0.2f, 0.0f,  1.0f, 0.0f,
+                -0.2f, -0.2f, 0.0f,  0.0f, 0.0f,
+                -0.2f,  0.2f, 0.0f,  0.0f, 1.0f,
+            },
+            {0, 1, 3, 1, 2, 3}
+        };
+    }
+
+    Options parse_options(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--record") {
+                options.record = true;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if (arg == "--case") {
+                options.only_case = value;
+            } else if (arg == "--repeats") {
+                options.repeats = std::max(1, std::stoi(value));
+            } else if (arg == "--json") {
+                options.json_path = value;
+            } else {
+                throw std::runtime_error("Unknown option " + arg);
+            }
+        }
+        return options;
+    }
+
+    Result measure(const Case& test, const Options& options) {
+        /* One operation recorded, for its calls */
+        NullGlRecording& recording = null_gl_recording();
+        recording.clear();
+        set_null_gl_recording(true);
+        test.run();
+        set_null_gl_recording(options.record);
+
+        std::map<std::uint32_t, std::size_t> calls;
+        for (const NullGlCommand& command : recording.commands) {
+            ++calls[command.function];
+        }
+        auto top = std::max_element(calls.begin(), calls.end(), [](const auto& a, const auto& b) {
+            return a.second < b.second;
+        });
+        Result result{test.name, 0.0, 0.0, recording.commands.size(),
+                      top == calls.end() ? "" : gl_function_name(top->first),
+                      top == calls.end() ? 0 : top->second};
+
+        auto time_batch = [&](std::size_t n) {
+            recording.clear();
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < n; ++i) {
+                test.run();
+            }
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        std::size_t batch = 1;
+        while (time_batch(batch) < MIN_BATCH_MS) {
+            batch *= 2;
+        }
+
+        std::vector<double> ns_per_op;
+        for (int i = 0; i < options.repeats; ++i) {
+            ns_per_op.push_back(time_batch(batch) * 1e6 / batch);
+        }
+        std::sort(ns_per_op.begin(), ns_per_op.end());
+        result.median_ns = ns_per_op[ns_per_op.size() / 2];
+        result.min_ns = ns_per_op.front();
+        recording.clear();
+        return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\nusage: submission_bench [--case name] [--repeats N] [--record]"
+                     " [--json out.json]\n";
+        return 2;
+    }
+
+    try {
+        load_null_gl(false);
+
+        ShaderDefines sprite_defines{{"TEXTURED", ""}};
+        std::string vertex_source = preprocess_shader("shaders/vertex.shader", sprite_defines).source;
+        std::string fragment_source = preprocess_shader("shaders/fragment.shader", sprite_defines).source;
+
+        ShaderProgram program{link_program(compile_shader(vertex_source, GL_VERTEX_SHADER),
+                                           compile_shader(fragment_source, GL_FRAGMENT_SHADER)), {"model"}};
+        GLint model_location = program.get_uniform_location("model");
+        program.use();
+        Geometry quad = make_quad();
+        GLuint textures[2];
+        glGenTextures(2, textures);
+        for (GLuint texture : textures) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexStorage2D(GL_TEXTURE_2D, 10, GL_RGBA8, 512, 512);
+        }
+        glm::mat4 model = glm::translate(glm::mat4{1.0f}, glm::vec3(0.4f, -0.3f, 0.0f));
+
+        const std::vector<Case> cases = {
+            {"Geometry create+del", [] {
+                Geometry geometry = make_quad();
+                geometry.del();
+            }},
+            {"Geometry::draw", [&] {
+                quad.draw();
+            }},
+            {"set_uniform_matrix4fv", [&] {
+                program.set_uniform_matrix4fv(model_location, model);
+            }},
+            /* Without the source preprocessing, which is file I/O */
+            {"ShaderProgram link", [&] {
+                ShaderProgram linked{link_program(compile_shader(vertex_source, GL_VERTEX_SHADER),
+                                                  compile_shader(fragment_source, GL_FRAGMENT_SHADER)), {"model"}};
+                linked.del();
+            }},
+            /* scene_bench's many_squares frame */
+            {"many_squares frame", [&] {
+                glClear(GL_COLOR_BUFFER_BIT);
+                draw_many_squares(0, [&](int texture, const glm::mat4& sprite) {
+                    glBindTexture(GL_TEXTURE_2D, textures[texture]);
+                    program.set_uniform_matrix4fv(model_location, sprite);
+                    quad.draw();
+                });
+            }},
+        };
+
+        std::vector<Result> results;
+        for (const Case& test : cases) {
+            if (options.only_case.empty() || options.only_case == test.name) {
+                results.push_back(measure(test, options));
+            }
+        }
+        if (results.empty()) {
+            throw std::runtime_error("Unknown case " + options.only_case);
+        }
+        if (GLenum error = glGetError()) {
+            throw std::runtime_error("GL error " + std::to_string(error));
+        }
+
+        std::printf("%-24s %12s %12s %9s  %s\n", "case", "median ns", "min ns", "GL calls", "most called");
+        for (const Result& result : results) {
+            std::printf("%-24s %12.1f %12.1f %9zu  %s x%zu\n", result.name, result.median_ns, result.min_ns,
+                        result.gl_calls, result.top_function.c_str(), result.top_calls);
+        }
+
+        if (!options.json_path.empty()) {
+            std::ostringstream json_text;
+            JsonWriter json{json_text};
+            json.begin_object()
+                .field("renderer", "null")
+                .field("record", options.record)
+                .field("repeats", options.repeats)
+                .begin_array("cases");
+            for (const Result& result : results) {
+                json.begin_object()
+                    .field("name", result.name)
+                    .field("median_ns", result.median_ns)
+                    .field("min_ns", result.min_ns)
+                    .field("gl_calls", std::uint64_t(result.gl_calls))
+                    .end_object();
+            }
+            json.end_array().end_object();
+
+            std::ofstream out{options.json_path};
+            out << json_text.str();
+            if (!out.flush()) {
+                throw std::runtime_error("Cannot write " + options.json_path);
+            }
+        }
+
+        glDeleteTextures(2, textures);
+        quad.del();
+        program.del();
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <asset_pipeline.hpp>
+#include <cooked_texture.hpp>
+#include <gl_debug.hpp>
+#include <memory_accounting.hpp>
+#include <resource_pack.hpp>
+#include <mipmap.hpp>
+#include <profiler.hpp>
+#include <texture.hpp>
+#include <texture_import.hpp>
+
+using namespace std::string_literals;
+
+AssetPipeline::AssetPipeline(std::size_t n_decode_threads,
+                             std::function<void()> make_upload_context_current)
+    : decode_pool{n_decode_threads}, file_reader{decode_pool} {
+
+    if (make_upload_context_current) {
+        this->upload_thread = std::make_unique<ThreadPool>(1);
+        this->upload_thread->post([] { AZ_PROFILE_THREAD_NAME("uploads"); });
+        this->upload_thread->post(std::move(make_upload_context_current));
+    }
+}
+
+AssetPipeline::~AssetPipeline() {
+    shutdown();
+}
+
+void AssetPipeline::shutdown() {
+    /* The render thread first, as that is where loads touch their callers'
+     * state; then the workers, which may be passing coroutines back and
+     * forth, so each one drops what the other posts once it is closed */
+    this->frame_queue.close();
+    this->decode_pool.close();
+    if (this->upload_thread) {
+        this->upload_thread->close();
+    }
+}
+
+Task<void> AssetPipeline::switch_to_gl_thread() {
+    if (this->upload_thread) {
+        co_await this->upload_thread->schedule();
+    } else {
+        co_await this->frame_queue.schedule();
+    }
+}
+
+Task<void> AssetPipeline::wait_fence(void* fence) {
+    auto sync = static_cast<GLsync>(fence);
+    for (;;) {
+        co_await this->frame_queue.schedule();
+        GLenum status = glClientWaitSync(sync, 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED
+                || status == GL_WAIT_FAILED) {
+            break;
+        }
+    }
+    glDeleteSync(sync);
+}
+
+Task<void> AssetPipeline::finish_upload() {
+    if (this->upload_thread) {
+        /* The render context may only use the texture once the upload
+         * context's commands have executed */
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        co_await wait_fence(fence);
+    }
+}
+
+Task<GLuint> AssetPipeline::load_texture(std::string path, float priority, TextureSizeHint size_hint,
+                                         bool minified) {
+    GLuint texture;
+    if (is_cooked_texture(path)) {
+        texture = co_await load_cooked_texture(path, size_hint);
+    } else {
+        ImportOptions options = this->import_options;
+        if (!minified) {
+            options.mip_generation = MipGeneration::lazy;
+        }
+        if (this->scheduler && !this->upload_thread) {
+            texture = co_await load_texture_scheduled(path, priority, size_hint, options);
+        } else {
+            texture = co_await load_texture_via_pbo(path, size_hint, options);
+        }
+    }
+    /* Every way in ends on a thread with a GL context; the render thread's,
+     * with the scheduler */
+    if (this->scheduler && !this->upload_thread) {
+        /* A priority set for an image that never went through the queue */
+        forget_uploads(path, {});
+    }
+    gl_object_label(GL_TEXTURE, texture, path);
+    co_return texture;
+}
+
+Task<DecodedImage> AssetPipeline::decode(std::string path, TextureSizeHint size_hint) {
+    /* Packed images need no reading */
+    if (auto packed = find_resource(path)) {
+        co_await this->decode_pool.schedule();
+        co_return decode_image(*packed, path, size_hint);
+    }
+    FileContents file = co_await this->file_reader.read(path);
+    co_return decode_image(file.bytes(), path, size_hint);
+}
+
+MipChain AssetPipeline::mip_chain(const std::string& path, const DecodedImage& image,
+                                  const ImportOptions& options) {
+    if (!options.mipmaps || options.mip_generation != MipGeneration::cpu) {
+        return {};
+    }
+    return cached_mip_chain(path, image, mip_count(image.width, image.height), true, &this->decode_pool);
+}
+
+Task<GLuint> AssetPipeline::load_texture_scheduled(std::string path, float priority,
+                                                   TextureSizeHint size_hint, ImportOptions options) {
+    DecodedImage image = co_await decode(path, size_hint);
+    ImportedTexture imported;
+    try {
+        MipChain mips = mip_chain(path, image, options);
+        imported = import_image(image, options, &mips);
+    } catch (...) {
+        image.free();
+        throw;
+    }
+    image.free();
+    std::shared_ptr<const unsigned char[]> pixels{std::move(imported.pixels)};
+
+    co_await this->frame_queue.schedule();
+    GLuint texture = create_texture();
+    allocate_texture_storage(imported.format, imported.width, imported.height, imported.mip_levels, path);
+
+    /* Raised (or lowered) while the image was decoding */
+    auto& queued = this->queued_uploads[path];
+    priority = queued.priority.value_or(priority);
+
+    std::vector<UploadScheduler::Ticket> tickets;
+    try {
+        for (int level = 0; level < imported.stored_levels; ++level) {
+            /* Each level shares ownership of the whole chain */
+            std::shared_ptr<const unsigned char[]> level_pixels{pixels, pixels.get() + imported.level_offset(level)};
+            tickets.push_back(this->scheduler->enqueue_texture(texture, level, imported.level_width(level),
+                    imported.level_height(level), imported.format.format, imported.format.type,
+                    imported.format.bytes_per_pixel, std::move(level_pixels), priority));
+            queued.tickets.push_back(tickets.back());
+        }
+    } catch (...) {
+        /* Refused by the memory budget partway: the levels already queued
+         * must not reach a deleted (or reused) name */
+        for (auto ticket : tickets) {
+            this->scheduler->cancel(ticket);
+        }
+        forget_uploads(path, tickets);
+        delete_texture(texture);
+        throw;
+    }
+    for (auto ticket : tickets) {
+        co_await this->scheduler->uploaded(ticket);
+    }
+    forget_uploads(path, tickets);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    finish_mip_levels(imported);
+    report_import(path, imported);
+
+    co_return texture;
+}
+
+Task<GLuint> AssetPipeline::load_texture_via_pbo(std::string path, TextureSizeHint size_hint,
+                                                ImportOptions options) {
+    /* The format depends on the pixels, so they are decoded before the
+     * staging buffer can be sized */
+    DecodedImage image = co_await decode(path, size_hint);
+    MipChain mips;
+    ImportedTexture imported;
+    try {
+        mips = mip_chain(path, image, options);
+        imported = plan_import(image, options, &mips);
+    } catch (...) {
+        image.free();
+        throw;
+    }
+    std::size_t size = imported.stored_bytes();
+
+    co_await switch_to_gl_thread();
+    GLuint pbo;
+    glGenBuffers(1, &pbo);
+    try {
+        record_allocation({MemoryKind::buffer, pbo, size, GL_STREAM_DRAW, 0, 0, 1, "staging", path});
+    } catch (...) {
+        image.free();
+        glDeleteBuffers(1, &pbo);
+        throw;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    auto pixels = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    /* Convert the pixels into the mapped buffer off the GL thread */
+    co_await this->decode_pool.schedule();
+    std::exception_ptr error;
+    try {
+        if (!pixels) {
+            throw std::runtime_error{"Could not map pixel unpack buffer"};
+        }
+        convert_levels(image, &mips, imported, pixels, options);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    image.free();
+    mips = {};
+
+    co_await switch_to_gl_thread();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+    if (pixels) {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    GLuint texture = 0;
+    if (!error) {
+        /* Without pixels of its own, the upload reads the bound unpack buffer.
+         * Past the memory budget it throws, having deleted the texture; the
+         * buffer still has to go */
+        try {
+            texture = upload_imported(imported, path);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+
+    /* The buffer is only released once the copy above has completed */
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    record_release(MemoryKind::buffer, pbo);
+    glDeleteBuffers(1, &pbo);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    co_await finish_upload();
+    report_import(path, imported);
+
+    co_return texture;
+}
+
+Task<GLuint> AssetPipeline::load_cooked_texture(std::string path, TextureSizeHint size_hint) {
+    /* Page faults on the mapping would otherwise stall the GL thread */
+    co_await this->decode_pool.schedule();
+    CookedTexture cooked{path};
+    cooked.prefetch();
+    int first_level = skipped_levels(cooked.level_width(0), cooked.level_height(0), size_hint);
+
+    co_await switch_to_gl_thread();
+    GLuint texture = upload_cooked(cooked, first_level, path);
+    co_await finish_upload();
+
+    int levels = cooked.header().levels;
+    first_level = std::min(first_level, levels - 1);
+    ++this->import_stats.textures;
+    for (int level = first_level; level < levels; ++level) {
+        this->import_stats.bytes += cooked.level_bytes(level);
+    }
+    this->import_stats.rgba8_bytes += mip_chain_bytes(cooked.level_width(first_level),
+            cooked.level_height(first_level), 4, levels - first_level);
+    if (this->report_imports) {
+        std::cerr << cooked_report(path, cooked, first_level) << '\n';
+    }
+
+    co_return texture;
+}
+
+void AssetPipeline::report_import(const std::string& path, const ImportedTexture& imported) {
+    ++this->import_stats.textures;
+    this->import_stats.bytes += imported.bytes;
+    this->import_stats.rgba8_bytes += imported.rgba8_bytes;
+    if (this->report_imports) {
+        std::cerr << import_report(path, imported) << '\n';
+    }
+}
+
+void AssetPipeline::set_priority(const std::string& path, float priority) {
+    if (!this->scheduler || this->upload_thread) {
+        return;
+    }
+    auto& queued = this->queued_uploads[path];
+    queued.priority = priority;
+    for (auto ticket : queued.tickets) {
+        this->scheduler->set_priority(ticket, priority);
+    }
+}
+
+void AssetPipeline::forget_uploads(const std::string& path, const std::vector<UploadScheduler::Ticket>& tickets) {
+    auto found = this->queued_uploads.find(path);
+    if (found == this->queued_uploads.end()) {
+        return;
+    }
+    auto& queued = found->second.tickets;
+    std::erase_if(queued, [&](auto ticket) {
+        return std::find(tickets.begin(), tickets.end(), ticket) != tickets.end();
+    });
+    if (queued.empty()) {
+        this->queued_uploads.erase(found);
+    }
+}
+
+void AssetPipeline::pump() {
+    this->frame_queue.run_pending();
+    if (this->scheduler) {
+        this->scheduler->pump();
+    }
+}
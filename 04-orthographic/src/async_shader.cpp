@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <glad/glad.h>
+
+#include <async_shader.hpp>
+#include <program_cache.hpp>
+#include <gl_ext.hpp>
+
+using namespace std::string_literals;
+
+/* GL_KHR_parallel_shader_compile is not part of the generated glad loader */
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+    typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+    std::string shader_log(GLuint shader_id) {
+        /* Stage builds have one of the two shaders only */
+        if (!shader_id) {
+            return "";
+        }
+        int success;
+        glGetShaderiv(shader_id, GL_COMPILE_STATUS, &success);
+        if (success) {
+            return "";
+        }
+        char info_buffer[512];
+        glGetShaderInfoLog(shader_id, 512, nullptr, info_buffer);
+        return info_buffer;
+    }
+}
+
+bool ProgramFuture::ready() const {
+    return this->state->status == Status::ready;
+}
+
+bool ProgramFuture::failed() const {
+    return this->state->status == Status::failed;
+}
+
+GLuint ProgramFuture::get() const {
+    switch (this->state->status) {
+        case Status::ready:
+            return this->state->program;
+        case Status::failed:
+            throw std::runtime_error("Shader program build failed: "s + this->state->error);
+        default:
+            throw std::logic_error{"Shader program is still being built"};
+    }
+}
+
+GLuint ProgramFuture::get_or(GLuint fallback) const {
+    return ready() ? this->state->program : fallback;
+}
+
+const std::string& ProgramFuture::error() const {
+    return this->state->error;
+}
+
+AsyncProgramBuilder::AsyncProgramBuilder(LoadProc load_proc, ProgramCache* cache)
+    : cache{cache} {
+
+    if (has_gl_extension("GL_KHR_parallel_shader_compile")
+            || has_gl_extension("GL_ARB_parallel_shader_compile")) {
+        auto max_threads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+                load_proc("glMaxShaderCompilerThreadsKHR"));
+        if (!max_threads) {
+            max_threads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+                    load_proc("glMaxShaderCompilerThreadsARB"));
+        }
+        if (max_threads) {
+            /* 0xFFFFFFFF lets the driver pick its own maximum */
+            max_threads(0xFFFFFFFF);
+            this->parallel_compile = true;
+        }
+    }
+}
+
+ProgramFuture AsyncProgramBuilder::submit(const std::string& vert_shader_src,
+                                          const std::string& frag_shader_src) {
+    auto state = std::make_shared<ProgramFuture::State>();
+
+    bool use_cache = this->cache && this->cache->supported();
+    if (use_cache) {
+        state->cache_key = this->cache->key_for(vert_shader_src, frag_shader_src);
+        if (this->cache->restore(state->cache_key, state->program)) {
+            ++this->cache->hits;
+            state->status = ProgramFuture::Status::ready;
+            return {state};
+        }
+        ++this->cache->misses;
+    }
+
+    const char* const vert_code = vert_shader_src.c_str();
+    state->vert_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(state->vert_shader, 1, &vert_code, nullptr);
+    glCompileShader(state->vert_shader);
+
+    const char* const frag_code = frag_shader_src.c_str();
+    state->frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(state->frag_shader, 1, &frag_code, nullptr);
+    glCompileShader(state->frag_shader);
+
+    /* Linking does not need the compile status; a failed compile simply
+     * shows up as a failed link */
+    state->program = glCreateProgram();
+    glAttachShader(state->program, state->vert_shader);
+    glAttachShader(state->program, state->frag_shader);
+    if (use_cache) {
+        glProgramParameteri(state->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(state->program);
+
+    this->pending.push_back(state);
+    return {state};
+}
+
+ProgramFuture AsyncProgramBuilder::submit_stage(const std::string& shader_src, GLenum gl_shader_type) {
+    auto state = std::make_shared<ProgramFuture::State>();
+
+    /* What glCreateShaderProgramv() does, minus its status queries */
+    const char* const shader_code = shader_src.c_str();
+    GLuint shader = glCreateShader(gl_shader_type);
+    glShaderSource(shader, 1, &shader_code, nullptr);
+    glCompileShader(shader);
+    (gl_shader_type == GL_VERTEX_SHADER ? state->vert_shader : state->frag_shader) = shader;
+
+    state->program = glCreateProgram();
+    glProgramParameteri(state->program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    glAttachShader(state->program, shader);
+    glLinkProgram(state->program);
+
+    this->pending.push_back(state);
+    return {state};
+}
+
+void AsyncProgramBuilder::finish(ProgramFuture::State& state) {
+    int success;
+    glGetProgramiv(state.program, GL_LINK_STATUS, &success);
+
+    if (success) {
+        state.status = ProgramFuture::Status::ready;
+        if (this->cache && state.cache_key) {
+            this->cache->store(state.cache_key, state.program);
+        }
+    } else {
+        state.error = shader_log(state.vert_shader) + shader_log(state.frag_shader);
+        if (state.error.empty()) {
+            char info_buffer[512];
+            glGetProgramInfoLog(state.program, 512, nullptr, info_buffer);
+            state.error = info_buffer;
+        }
+        glDeleteProgram(state.program);
+        state.program = 0;
+        state.status = ProgramFuture::Status::failed;
+    }
+
+    glDeleteShader(state.frag_shader);
+    glDeleteShader(state.vert_shader);
+    state.frag_shader = 0;
+    state.vert_shader = 0;
+}
+
+std::size_t AsyncProgramBuilder::poll() {
+    bool finished_one = false;
+    std::erase_if(this->pending, [&](auto& state) {
+        if (this->parallel_compile) {
+            int completed;
+            glGetProgramiv(state->program, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed) {
+                return false;
+            }
+        } else if (finished_one) {
+            /* Without the extension every status query may block */
+            return false;
+        }
+        finish(*state);
+        finished_one = true;
+        return true;
+    });
+    return this->pending.size();
+}
+
+void AsyncProgramBuilder::wait_all() {
+    for (auto& state : this->pending) {
+        finish(*state);
+    }
+    this->pending.clear();
+}
+
+std::size_t AsyncProgramBuilder::pending_count() const {
+    return this->pending.size();
+}
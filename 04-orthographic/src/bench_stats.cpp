@@ -0,0 +1,26 @@
+#include <algorithm>
+#include <numeric>
+
+#include <bench_stats.hpp>
+
+SampleSummary summarize(std::vector<double> samples) {
+    if (samples.empty()) {
+        return {};
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) {
+        return samples[std::min(samples.size() - 1, std::size_t(p * samples.size()))];
+    };
+    return {std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size(),
+            percentile(0.5), percentile(0.9), percentile(0.99), samples.back()};
+}
+
+void write_summary(JsonWriter& json, const char* key, const SampleSummary& summary) {
+    json.begin_object(key)
+        .field("mean", summary.mean)
+        .field("p50", summary.p50)
+        .field("p90", summary.p90)
+        .field("p99", summary.p99)
+        .field("max", summary.max)
+        .end_object();
+}
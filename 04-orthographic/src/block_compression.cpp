@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <block_compression.hpp>
+
+namespace {
+    /* EXT_texture_compression_s3tc, which glad was not generated with */
+    const unsigned int COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+    const unsigned int COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+
+    using Rgb = int[3];
+
+    unsigned int pack565(const float color[3]) {
+        auto quantize = [](float value, int max) {
+            return (unsigned int)std::clamp(int(std::lround(value * max / 255.0f)), 0, max);
+        };
+        return (quantize(color[0], 31) << 11) | (quantize(color[1], 63) << 5) | quantize(color[2], 31);
+    }
+
+    /* Widens by bit replication, as GL does */
+    void unpack565(unsigned int packed, Rgb rgb) {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    /* Four-color palette of the endpoints (BC3 always decodes this way, BC1
+     * when c0 > c1, which the encoder ensures) */
+    void color_palette(unsigned int c0, unsigned int c1, Rgb palette[4]) {
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        for (int i = 0; i < 3; ++i) {
+            palette[2][i] = (2 * palette[0][i] + palette[1][i] + 1) / 3;
+            palette[3][i] = (palette[0][i] + 2 * palette[1][i] + 1) / 3;
+        }
+    }
+
+    int color_distance(const Rgb color, const unsigned char* pixel) {
+        int dr = color[0] - pixel[0];
+        int dg = color[1] - pixel[1];
+        int db = color[2] - pixel[2];
+        return dr * dr + dg * dg + db * db;
+    }
+
+    /* Best index of every pixel for the endpoints, returning the total error */
+    long color_indices(const unsigned char* block, unsigned int c0, unsigned int c1, std::uint32_t& indices) {
+        Rgb palette[4];
+        color_palette(c0, c1, palette);
+        long error = 0;
+        indices = 0;
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            int best_distance = color_distance(palette[0], block + 4 * i);
+            for (int j = 1; j < 4; ++j) {
+                int distance = color_distance(palette[j], block + 4 * i);
+                if (distance < best_distance) {
+                    best = j;
+                    best_distance = distance;
+                }
+            }
+            indices |= std::uint32_t(best) << (2 * i);
+            error += best_distance;
+        }
+        return error;
+    }
+
+    /* Endpoints at the extremes of the block's colors along their principal
+     * axis */
+    void principal_endpoints(const unsigned char* block, float end0[3], float end1[3]) {
+        float mean[3] = {};
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                mean[c] += block[4 * i + c] / 16.0f;
+            }
+        }
+        float covariance[3][3] = {};
+        for (int i = 0; i < 16; ++i) {
+            float d[3];
+            for (int c = 0; c < 3; ++c) {
+                d[c] = block[4 * i + c] - mean[c];
+            }
+            for (int a = 0; a < 3; ++a) {
+                for (int b = 0; b < 3; ++b) {
+                    covariance[a][b] += d[a] * d[b];
+                }
+            }
+        }
+
+        /* Power iteration, from the luminance direction */
+        float axis[3] = {0.299f, 0.587f, 0.114f};
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            float next[3];
+            for (int a = 0; a < 3; ++a) {
+                next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+            }
+            float length = std::max({std::fabs(next[0]), std::fabs(next[1]), std::fabs(next[2])});
+            if (length < 1e-6f) {
+                break;
+            }
+            for (int a = 0; a < 3; ++a) {
+                axis[a] = next[a] / length;
+            }
+        }
+
+        float low = 0.0f;
+        float high = 0.0f;
+        for (int i = 0; i < 16; ++i) {
+            float t = 0.0f;
+            for (int c = 0; c < 3; ++c) {
+                t += (block[4 * i + c] - mean[c]) * axis[c];
+            }
+            low = std::min(low, t);
+            high = std::max(high, t);
+        }
+        float norm = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+        for (int c = 0; c < 3; ++c) {
+            end0[c] = std::clamp(mean[c] + high * axis[c] / norm, 0.0f, 255.0f);
+            end1[c] = std::clamp(mean[c] + low * axis[c] / norm, 0.0f, 255.0f);
+        }
+    }
+
+    /* Least squares endpoints for the given indices; false if the indices
+     * do not constrain them (all pixels on one palette entry) */
+    bool refine_endpoints(const unsigned char* block, std::uint32_t indices, float end0[3], float end1[3]) {
+        const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0.0f;
+        float ab = 0.0f;
+        float bb = 0.0f;
+        float ax[3] = {};
+        float bx[3] = {};
+        for (int i = 0; i < 16; ++i) {
+            float a = weights[(indices >> (2 * i)) & 3];
+            float b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < 3; ++c) {
+                ax[c] += a * block[4 * i + c];
+                bx[c] += b * block[4 * i + c];
+            }
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) < 1e-6f) {
+            return false;
+        }
+        for (int c = 0; c < 3; ++c) {
+            end0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+            end1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    void write_color_block(unsigned int c0, unsigned int c1, std::uint32_t indices, unsigned char* out) {
+        /* c0 > c1 selects the four-color palette in BC1; swapping the
+         * endpoints swaps indices 0 <-> 1 and 2 <-> 3 */
+        if (c0 < c1) {
+            std::swap(c0, c1);
+            indices ^= 0x55555555u;
+        } else if (c0 == c1) {
+            indices = 0;
+        }
+        std::uint16_t endpoints[2] = {std::uint16_t(c0), std::uint16_t(c1)};
+        std::memcpy(out, endpoints, 4);
+        std::memcpy(out + 4, &indices, 4);
+    }
+
+    void encode_color_block(const unsigned char* block, unsigned char* out) {
+        float end0[3];
+        float end1[3];
+        principal_endpoints(block, end0, end1);
+        unsigned int c0 = pack565(end0);
+        unsigned int c1 = pack565(end1);
+        std::uint32_t indices;
+        long error = color_indices(block, c0, c1, indices);
+
+        for (int iteration = 0; iteration < 2 && error > 0; ++iteration) {
+            if (!refine_endpoints(block, indices, end0, end1)) {
+                break;
+            }
+            unsigned int r0 = pack565(end0);
+            unsigned int r1 = pack565(end1);
+            std::uint32_t refined_indices;
+            long refined_error = color_indices(block, r0, r1, refined_indices);
+            if (refined_error >= error) {
+                break;
+            }
+            c0 = r0;
+            c1 = r1;
+            indices = refined_indices;
+            error = refined_error;
+        }
+        write_color_block(c0, c1, indices, out);
+    }
+
+    /* Eight-value palette; a0 > a1 selects it, a0 == a1 makes it constant */
+    void alpha_palette(int a0, int a1, int palette[8]) {
+        palette[0] = a0;
+        palette[1] = a1;
+        for (int k = 1; k < 7; ++k) {
+            palette[k + 1] = ((7 - k) * a0 + k * a1 + 3) / 7;
+        }
+    }
+
+    void encode_alpha_block(const unsigned char* block, unsigned char* out) {
+        int low = 255;
+        int high = 0;
+        for (int i = 0; i < 16; ++i) {
+            low = std::min(low, int(block[4 * i + 3]));
+            high = std::max(high, int(block[4 * i + 3]));
+        }
+        int palette[8];
+        alpha_palette(high, low, palette);
+
+        std::uint64_t indices = 0;
+        for (int i = 0; i < 16 && high != low; ++i) {
+            int alpha = block[4 * i + 3];
+            int best = 0;
+            for (int j = 1; j < 8; ++j) {
+                if (std::abs(palette[j] - alpha) < std::abs(palette[best] - alpha)) {
+                    best = j;
+                }
+            }
+            indices |= std::uint64_t(best) << (3 * i);
+        }
+        out[0] = (unsigned char)high;
+        out[1] = (unsigned char)low;
+        for (int i = 0; i < 6; ++i) {
+            out[2 + i] = (unsigned char)(indices >> (8 * i));
+        }
+    }
+
+    void decode_color_block(const unsigned char* in, bool four_color, unsigned char* block) {
+        std::uint16_t endpoints[2];
+        std::uint32_t indices;
+        std::memcpy(endpoints, in, 4);
+        std::memcpy(&indices, in + 4, 4);
+
+        Rgb palette[4];
+        color_palette(endpoints[0], endpoints[1], palette);
+        int alpha[4] = {255, 255, 255, 255};
+        if (!four_color && endpoints[0] <= endpoints[1]) {
+            /* Three colors plus transparent black */
+            for (int i = 0; i < 3; ++i) {
+                palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+                palette[3][i] = 0;
+            }
+            alpha[3] = 0;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int index = (indices >> (2 * i)) & 3;
+            for (int c = 0; c < 3; ++c) {
+                block[4 * i + c] = (unsigned char)palette[index][c];
+            }
+            block[4 * i + 3] = (unsigned char)alpha[index];
+        }
+    }
+
+    void decode_alpha_block(const unsigned char* in, unsigned char* block) {
+        int palette[8];
+        if (in[0] > in[1]) {
+            alpha_palette(in[0], in[1], palette);
+        } else {
+            /* Six values plus 0 and 255 */
+            palette[0] = in[0];
+            palette[1] = in[1];
+            for (int k = 1; k < 5; ++k) {
+                palette[k + 1] = ((5 - k) * in[0] + k * in[1] + 2) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        std::uint64_t indices = 0;
+        for (int i = 0; i < 6; ++i) {
+            indices |= std::uint64_t(in[2 + i]) << (8 * i);
+        }
+        for (int i = 0; i < 16; ++i) {
+            block[4 * i + 3] = (unsigned char)palette[(indices >> (3 * i)) & 7];
+        }
+    }
+}
+
+unsigned int block_gl_format(BlockFormat format) {
+    return format == BlockFormat::bc1 ? COMPRESSED_RGB_S3TC_DXT1 : COMPRESSED_RGBA_S3TC_DXT5;
+}
+
+int block_bytes(BlockFormat format) {
+    return format == BlockFormat::bc1 ? 8 : 16;
+}
+
+std::size_t compressed_size(BlockFormat format, int width, int height) {
+    return std::size_t((width + 3) / 4) * ((height + 3) / 4) * block_bytes(format);
+}
+
+void compress_image(BlockFormat format, const unsigned char* rgba, int width, int height, unsigned char* dst) {
+    unsigned char block[16 * 4];
+    for (int by = 0; by < height; by += 4) {
+        for (int bx = 0; bx < width; bx += 4) {
+            /* Partial blocks repeat the last row and column */
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 4; ++x) {
+                    int sx = std::min(bx + x, width - 1);
+                    int sy = std::min(by + y, height - 1);
+                    std::memcpy(block + 4 * (4 * y + x), rgba + (std::size_t(sy) * width + sx) * 4, 4);
+                }
+            }
+            if (format == BlockFormat::bc3) {
+                encode_alpha_block(block, dst);
+                dst += 8;
+            }
+            encode_color_block(block, dst);
+            dst += 8;
+        }
+    }
+}
+
+void decompress_image(BlockFormat format, const unsigned char* src, int width, int height,
+                      unsigned char* rgba) {
+    unsigned char block[16 * 4];
+    for (int by = 0; by < height; by += 4) {
+        for (int bx = 0; bx < width; bx += 4) {
+            if (format == BlockFormat::bc3) {
+                decode_color_block(src + 8, true, block);
+                decode_alpha_block(src, block);
+            } else {
+                decode_color_block(src, false, block);
+            }
+            src += block_bytes(format);
+
+            for (int y = 0; y < 4 && by + y < height; ++y) {
+                for (int x = 0; x < 4 && bx + x < width; ++x) {
+                    std::memcpy(rgba + (std::size_t(by + y) * width + bx + x) * 4, block + 4 * (4 * y + x), 4);
+                }
+            }
+        }
+    }
+}
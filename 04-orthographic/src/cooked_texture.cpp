@@ -0,0 +1,338 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glad/glad.h>
+
+#include <cooked_texture.hpp>
+#include <block_compression.hpp>
+#include <gl_ext.hpp>
+#include <mipmap.hpp>
+#include <pixel_kernels.hpp>
+#include <resource_pack.hpp>
+#include <texture_import.hpp>
+
+using namespace std::string_literals;
+
+namespace {
+    const char AZTX_MAGIC[8] = {'A', 'Z', 'T', 'X', '\r', '\n', '\x1a', '\n'};
+    const std::uint32_t AZTX_VERSION = 1;
+    const std::size_t AZTX_ALIGNMENT = 16;
+    const std::uint32_t AZTX_MAX_LEVELS = 16;
+
+    std::size_t align(std::size_t offset) {
+        return (offset + AZTX_ALIGNMENT - 1) / AZTX_ALIGNMENT * AZTX_ALIGNMENT;
+    }
+
+    /* The block format of a compressed internal format, if it is one */
+    bool block_format(std::uint32_t internal_format, BlockFormat& format) {
+        for (BlockFormat candidate : {BlockFormat::bc1, BlockFormat::bc3}) {
+            if (internal_format == block_gl_format(candidate)) {
+                format = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::size_t level_size(std::uint32_t internal_format, int width, int height) {
+        BlockFormat format;
+        if (block_format(internal_format, format)) {
+            return compressed_size(format, width, height);
+        }
+        return std::size_t(width) * height * bytes_per_pixel(internal_format);
+    }
+
+    const char* format_name(std::uint32_t internal_format) {
+        switch (internal_format) {
+            case GL_R8: return "R8";
+            case GL_RG8: return "RG8";
+            case GL_RGB8: return "RGB8";
+            case GL_RGBA8: return "RGBA8";
+            case GL_RGB565: return "RGB565";
+            case GL_RGBA4: return "RGBA4";
+        }
+        BlockFormat format;
+        if (block_format(internal_format, format)) {
+            return format == BlockFormat::bc1 ? "BC1" : "BC3";
+        }
+        return "?";
+    }
+
+    AztxLevel read_level(const unsigned char* data, int level) {
+        AztxLevel entry;
+        std::memcpy(&entry, data + sizeof(AztxHeader) + level * sizeof(AztxLevel), sizeof entry);
+        return entry;
+    }
+}
+
+std::vector<unsigned char> cook_texture(const DecodedImage& image, const CookOptions& options) {
+    ImportOptions import_options;
+    import_options.premultiply_alpha = options.premultiply_alpha;
+    ImportFormat raw_format = choose_import_format(image, import_options);
+    bool opaque = raw_format.internal_format == GL_R8 || raw_format.internal_format == GL_RGB8;
+
+    CookOptions::Format format = options.format;
+    if (format == CookOptions::Format::automatic) {
+        format = opaque ? CookOptions::Format::bc1 : CookOptions::Format::bc3;
+    }
+    BlockFormat blocks = format == CookOptions::Format::bc1 ? BlockFormat::bc1 : BlockFormat::bc3;
+
+    AztxHeader header{};
+    std::memcpy(header.magic, AZTX_MAGIC, sizeof header.magic);
+    header.version = AZTX_VERSION;
+    if (format == CookOptions::Format::raw) {
+        header.internal_format = raw_format.internal_format;
+        header.format = raw_format.format;
+        header.type = raw_format.type;
+        std::copy(raw_format.swizzle.begin(), raw_format.swizzle.end(), header.swizzle);
+    } else {
+        header.internal_format = block_gl_format(blocks);
+        header.format = GL_RGBA;
+        header.type = GL_UNSIGNED_BYTE;
+        const GLint identity[] = {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA};
+        std::copy(std::begin(identity), std::end(identity), header.swizzle);
+    }
+    header.width = image.width;
+    header.height = image.height;
+    header.levels = options.mipmaps ? mip_count(image.width, image.height) : 1;
+    header.flags = (options.flip_y ? AZTX_FLIPPED : 0) | (options.premultiply_alpha ? AZTX_PREMULTIPLIED : 0);
+
+    MipChain mips = build_mip_chain(image.data, image.width, image.height, image.channels, header.levels);
+
+    std::vector<AztxLevel> table(header.levels);
+    std::size_t offset = align(sizeof header + table.size() * sizeof(AztxLevel));
+    for (std::uint32_t level = 0; level < header.levels; ++level) {
+        table[level].offset = offset;
+        table[level].bytes = level_size(header.internal_format, mips.level_width(level),
+                mips.level_height(level));
+        offset = align(offset + table[level].bytes);
+    }
+
+    std::vector<unsigned char> file(offset);
+    std::memcpy(file.data(), &header, sizeof header);
+    std::memcpy(file.data() + sizeof header, table.data(), table.size() * sizeof(AztxLevel));
+
+    std::unique_ptr<unsigned char[]> rgba;
+    if (format != CookOptions::Format::raw) {
+        rgba = std::make_unique_for_overwrite<unsigned char[]>(std::size_t(image.width) * image.height * 4);
+    }
+    for (std::uint32_t level = 0; level < header.levels; ++level) {
+        /* Level 0 is the image itself; only read, despite the cast */
+        DecodedImage level_image = image;
+        if (level > 0) {
+            level_image.data = const_cast<unsigned char*>(mips.level(level));
+            level_image.width = mips.level_width(level);
+            level_image.height = mips.level_height(level);
+        }
+        level_image.flip_y = options.flip_y;
+        unsigned char* dst = file.data() + table[level].offset;
+
+        if (format == CookOptions::Format::raw) {
+            convert_pixels(level_image, raw_format, dst, import_options);
+        } else {
+            PixelConversion conversion = PixelConversion::expand(image.channels, 4);
+            conversion.flip_y = options.flip_y;
+            conversion.premultiply_alpha = options.premultiply_alpha;
+            convert_image(conversion, level_image.data, level_image.width, level_image.height, rgba.get());
+            compress_image(blocks, rgba.get(), level_image.width, level_image.height, dst);
+        }
+    }
+    return file;
+}
+
+bool is_cooked_texture(std::string_view path) {
+    return path.ends_with(".aztx");
+}
+
+CookedTexture::CookedTexture(const std::string& path) {
+    /* Packed textures are used in place, inside the pack's mapping */
+    if (auto packed = find_resource(path)) {
+        this->data = packed->data();
+        this->size = packed->size();
+        this->mapped = false;
+    } else {
+        map(path);
+    }
+
+    /* Everything the accessors rely on */
+    const AztxHeader& header = this->header();
+    bool valid = this->size >= sizeof header
+        && std::memcmp(header.magic, AZTX_MAGIC, sizeof header.magic) == 0
+        && header.version == AZTX_VERSION
+        && header.width > 0 && header.height > 0 && header.width <= 1u << 15 && header.height <= 1u << 15
+        && header.levels > 0 && header.levels <= AZTX_MAX_LEVELS
+        && header.levels <= std::uint32_t(mip_count(header.width, header.height))
+        && sizeof header + header.levels * sizeof(AztxLevel) <= this->size;
+    for (std::uint32_t level = 0; valid && level < header.levels; ++level) {
+        AztxLevel entry = read_level(this->data, level);
+        valid = entry.bytes == level_size(header.internal_format, level_width(level), level_height(level))
+            && entry.offset <= this->size && entry.bytes <= this->size - entry.offset;
+    }
+    if (!valid) {
+        if (this->mapped) {
+            ::munmap(const_cast<unsigned char*>(this->data), this->size);
+        }
+        throw std::runtime_error("Invalid cooked texture '"s + path + "'");
+    }
+}
+
+void CookedTexture::map(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Error opening cooked texture '"s + path + "'");
+    }
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    if (::fstat(fd, &status) == 0 && std::size_t(status.st_size) >= sizeof(AztxHeader)) {
+        this->size = status.st_size;
+        mapping = ::mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Error mapping cooked texture '"s + path + "'");
+    }
+    this->data = static_cast<const unsigned char*>(mapping);
+    this->mapped = true;
+}
+
+CookedTexture::~CookedTexture() {
+    if (this->mapped) {
+        ::munmap(const_cast<unsigned char*>(this->data), this->size);
+    }
+}
+
+CookedTexture::CookedTexture(CookedTexture&& other) noexcept
+    : data{std::exchange(other.data, nullptr)}, size{std::exchange(other.size, 0)},
+      mapped{std::exchange(other.mapped, false)} {
+}
+
+CookedTexture& CookedTexture::operator=(CookedTexture&& other) noexcept {
+    std::swap(this->data, other.data);
+    std::swap(this->size, other.size);
+    std::swap(this->mapped, other.mapped);
+    return *this;
+}
+
+const AztxHeader& CookedTexture::header() const {
+    /* Mappings are page aligned, pack blobs 16-byte aligned */
+    return *reinterpret_cast<const AztxHeader*>(this->data);
+}
+
+bool CookedTexture::compressed() const {
+    BlockFormat format;
+    return block_format(header().internal_format, format);
+}
+
+int CookedTexture::level_width(int level) const {
+    return std::max(int(header().width) >> level, 1);
+}
+
+int CookedTexture::level_height(int level) const {
+    return std::max(int(header().height) >> level, 1);
+}
+
+const unsigned char* CookedTexture::level_data(int level) const {
+    return this->data + read_level(this->data, level).offset;
+}
+
+std::size_t CookedTexture::level_bytes(int level) const {
+    return read_level(this->data, level).bytes;
+}
+
+std::size_t CookedTexture::bytes() const {
+    std::size_t total = 0;
+    for (std::uint32_t level = 0; level < header().levels; ++level) {
+        total += level_bytes(level);
+    }
+    return total;
+}
+
+void CookedTexture::prefetch() const {
+    ::madvise(const_cast<unsigned char*>(this->data), this->size, MADV_WILLNEED);
+
+    /* Fault every page in, waiting for the read ahead started above */
+    long page = ::sysconf(_SC_PAGESIZE);
+    unsigned char sum = 0;
+    for (std::size_t offset = 0; offset < this->size; offset += page) {
+        sum += static_cast<const volatile unsigned char*>(this->data)[offset];
+    }
+    (void)sum;
+}
+
+bool cooked_format_supported(const CookedTexture& cooked) {
+    return !cooked.compressed() || has_gl_extension("GL_EXT_texture_compression_s3tc");
+}
+
+GLuint upload_cooked(const CookedTexture& cooked, int first_level, std::string owner) {
+    const AztxHeader& header = cooked.header();
+    first_level = std::clamp(first_level, 0, int(header.levels) - 1);
+    int levels = header.levels - first_level;
+    bool native = cooked_format_supported(cooked);
+
+    ImportFormat format{header.internal_format, header.format, header.type,
+        bytes_per_pixel(header.internal_format),
+        {header.swizzle[0], header.swizzle[1], header.swizzle[2], header.swizzle[3]}, ""};
+    if (!native) {
+        format.internal_format = GL_RGBA8;
+    }
+
+    GLuint id = create_texture();
+    allocate_texture_storage(format, cooked.level_width(first_level), cooked.level_height(first_level), levels,
+                             std::move(owner));
+
+    /* Decompression target when falling back, sized for the largest level */
+    std::unique_ptr<unsigned char[]> rgba;
+    BlockFormat blocks;
+    if (!native && block_format(header.internal_format, blocks)) {
+        rgba = std::make_unique_for_overwrite<unsigned char[]>(
+                std::size_t(cooked.level_width(first_level)) * cooked.level_height(first_level) * 4);
+    }
+
+    for (int level = 0; level < levels; ++level) {
+        int source = first_level + level;
+        int width = cooked.level_width(source);
+        int height = cooked.level_height(source);
+        if (native && cooked.compressed()) {
+            /* Straight from the mapping */
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, header.internal_format,
+                    GLsizei(cooked.level_bytes(source)), cooked.level_data(source));
+        } else if (rgba) {
+            decompress_image(blocks, cooked.level_data(source), width, height, rgba.get());
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.get());
+        } else {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment(std::size_t(width) * format.bytes_per_pixel));
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, header.format, header.type,
+                    cooked.level_data(source));
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    return id;
+}
+
+std::string cooked_report(const std::string& name, const CookedTexture& cooked, int first_level) {
+    const AztxHeader& header = cooked.header();
+    first_level = std::clamp(first_level, 0, int(header.levels) - 1);
+    std::size_t bytes = 0;
+    for (std::uint32_t level = first_level; level < header.levels; ++level) {
+        bytes += cooked.level_bytes(level);
+    }
+    int levels = header.levels - first_level;
+    std::size_t rgba8_bytes = mip_chain_bytes(cooked.level_width(first_level),
+            cooked.level_height(first_level), 4, levels);
+
+    char report[256];
+    std::snprintf(report, sizeof report, "%s: cooked %s %dx%d, %d levels, %.1f KiB (saved %.1f KiB vs RGBA8)",
+            name.c_str(), format_name(header.internal_format), cooked.level_width(first_level),
+            cooked.level_height(first_level), levels, bytes / 1024.0, (rgba8_bytes - bytes) / 1024.0);
+    return report;
+}
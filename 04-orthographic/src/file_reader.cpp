@@ -0,0 +1,461 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <file_reader.hpp>
+#include <profiler.hpp>
+
+using namespace std::string_literals;
+
+namespace {
+    /* Largest single read; Linux never transfers more at once anyway */
+    const std::size_t MAX_READ = 1 << 30;
+    const std::size_t FALLBACK_THREADS = 8;
+    /* user_data of the poll on the wake-up eventfd; reads use their address */
+    const std::uint64_t WAKE = 0;
+
+    /* Opens `path` and returns its size */
+    int open_file(const std::string& path, std::size_t& size) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Error opening '"s + path + "': " + std::strerror(errno));
+        }
+        struct stat status;
+        if (::fstat(fd, &status) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Error reading '"s + path + "': " + std::strerror(errno));
+        }
+        size = status.st_size;
+        return fd;
+    }
+
+    void pread_all(int fd, const std::string& path, unsigned char* dst, std::size_t size) {
+        std::size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::pread(fd, dst + done, std::min(size - done, MAX_READ), done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                throw std::runtime_error("Error reading '"s + path + "': "
+                        + (n < 0 ? std::strerror(errno) : "unexpected end of file"));
+            }
+            done += n;
+        }
+    }
+
+    template<typename T>
+    T load_acquire(T* value) {
+        return std::atomic_ref<T>{*value}.load(std::memory_order_acquire);
+    }
+
+    template<typename T>
+    void store_release(T* value, T new_value) {
+        std::atomic_ref<T>{*value}.store(new_value, std::memory_order_release);
+    }
+}
+
+FileContents read_file(const std::string& path) {
+    std::size_t size;
+    int fd = open_file(path, size);
+    std::shared_ptr<unsigned char[]> data{new unsigned char[std::max<std::size_t>(size, 1)]};
+    try {
+        pread_all(fd, path, data.get(), size);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    return {std::move(data), size};
+}
+
+/* Fixed-size buffers in one mapping, which io_uring can register once so
+ * reads into it skip pinning pages per read */
+struct FileReader::Arena {
+    Arena(std::size_t slots, std::size_t slot_bytes) : slot_bytes{slot_bytes}, bytes{slots * slot_bytes} {
+        void* mapping = ::mmap(nullptr, this->bytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Error allocating read buffers");
+        }
+        this->memory = static_cast<unsigned char*>(mapping);
+        for (std::size_t slot = slots; slot-- > 0; ) {
+            this->free_slots.push_back(slot);
+        }
+    }
+
+    ~Arena() {
+        ::munmap(this->memory, this->bytes);
+    }
+
+    /* A slot for `size` bytes, or null if none is free or it does not fit.
+     * The slot is returned when the last copy of the pointer goes */
+    static std::shared_ptr<unsigned char[]> buffer(const std::shared_ptr<Arena>& arena, std::size_t size) {
+        if (!arena || size > arena->slot_bytes) {
+            return nullptr;
+        }
+        std::size_t slot;
+        {
+            std::lock_guard lock{arena->mutex};
+            if (arena->free_slots.empty()) {
+                return nullptr;
+            }
+            slot = arena->free_slots.back();
+            arena->free_slots.pop_back();
+        }
+        return {arena->memory + slot * arena->slot_bytes, [arena, slot](unsigned char*) {
+            std::lock_guard lock{arena->mutex};
+            arena->free_slots.push_back(slot);
+        }};
+    }
+
+    std::size_t slot_bytes;
+    std::size_t bytes;
+    unsigned char* memory;
+    std::mutex mutex;
+    std::vector<std::size_t> free_slots;
+};
+
+/* A raw io_uring: submission and completion rings shared with the kernel */
+struct FileReader::Ring {
+    /* Null if io_uring is unavailable (old kernel, seccomp, AZ_NO_IO_URING) */
+    static std::unique_ptr<Ring> create(unsigned entries, Arena* arena) {
+        if (std::getenv("AZ_NO_IO_URING")) {
+            return nullptr;
+        }
+        io_uring_params params{};
+        int fd = int(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return nullptr;
+        }
+        auto ring = std::make_unique<Ring>();
+        ring->fd = fd;
+        ring->entries = params.sq_entries;
+
+        ring->sq_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cq_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ring->sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            ring->sq_bytes = ring->cq_bytes = std::max(ring->sq_bytes, ring->cq_bytes);
+        }
+        ring->sq_ring = ::mmap(nullptr, ring->sq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                fd, IORING_OFF_SQ_RING);
+        if (ring->sq_ring == MAP_FAILED) {
+            return nullptr;
+        }
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            ring->cq_ring = ring->sq_ring;
+        } else {
+            ring->cq_ring = ::mmap(nullptr, ring->cq_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    fd, IORING_OFF_CQ_RING);
+            if (ring->cq_ring == MAP_FAILED) {
+                return nullptr;
+            }
+        }
+        void* sqes = ::mmap(nullptr, ring->sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return nullptr;
+        }
+        ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto sq = static_cast<unsigned char*>(ring->sq_ring);
+        ring->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring->sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        auto cq = static_cast<unsigned char*>(ring->cq_ring);
+        ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring->cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        ring->wake_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (ring->wake_fd < 0) {
+            return nullptr;
+        }
+
+        /* Fails e.g. beyond RLIMIT_MEMLOCK on older kernels; plain reads
+         * into the arena still work then */
+        if (arena) {
+            iovec buffers{arena->memory, arena->bytes};
+            ring->fixed_buffers = ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, &buffers, 1) == 0;
+        }
+        return ring;
+    }
+
+    ~Ring() {
+        if (this->sqes) {
+            ::munmap(this->sqes, this->sqes_bytes);
+        }
+        if (this->cq_ring && this->cq_ring != MAP_FAILED && this->cq_ring != this->sq_ring) {
+            ::munmap(this->cq_ring, this->cq_bytes);
+        }
+        if (this->sq_ring && this->sq_ring != MAP_FAILED) {
+            ::munmap(this->sq_ring, this->sq_bytes);
+        }
+        if (this->wake_fd >= 0) {
+            ::close(this->wake_fd);
+        }
+        ::close(this->fd);
+    }
+
+    /* The next submission entry, cleared; the caller keeps the number in
+     * flight within `entries` */
+    io_uring_sqe* next_sqe() {
+        unsigned tail = *this->sq_tail;
+        unsigned index = tail & this->sq_mask;
+        io_uring_sqe* sqe = &this->sqes[index];
+        std::memset(sqe, 0, sizeof *sqe);
+        this->sq_array[index] = index;
+        store_release(this->sq_tail, tail + 1);
+        return sqe;
+    }
+
+    /* Submits whatever is queued and waits for at least one completion */
+    void submit_and_wait() {
+        for (;;) {
+            unsigned queued = *this->sq_tail - load_acquire(this->sq_head);
+            if (::syscall(__NR_io_uring_enter, this->fd, queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0) >= 0
+                    || (errno != EINTR && errno != EAGAIN && errno != EBUSY)) {
+                return;
+            }
+        }
+    }
+
+    /* Calls `handle(cqe)` for every completion so far */
+    template<typename Handler>
+    void reap(Handler handle) {
+        unsigned head = *this->cq_head;
+        unsigned tail = load_acquire(this->cq_tail);
+        for (; head != tail; ++head) {
+            io_uring_cqe cqe = this->cqes[head & this->cq_mask];
+            store_release(this->cq_head, head + 1);
+            handle(cqe);
+        }
+    }
+
+    int fd = -1;
+    int wake_fd = -1;
+    unsigned entries = 0;
+    bool fixed_buffers = false;
+
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    std::size_t sq_bytes = 0;
+    std::size_t cq_bytes = 0;
+    std::size_t sqes_bytes = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+};
+
+FileReader::FileReader(ThreadPool& completion_pool, unsigned queue_depth, std::size_t arena_slots,
+                       std::size_t slot_bytes)
+    : completion_pool{completion_pool} {
+
+    if (arena_slots > 0) {
+        this->arena = std::make_shared<Arena>(arena_slots, slot_bytes);
+    }
+    this->ring = Ring::create(std::max(queue_depth, 2u), this->arena.get());
+    if (this->ring) {
+        this->reader_thread = std::thread{[this] { run(); }};
+    } else {
+        this->read_pool = std::make_unique<ThreadPool>(FALLBACK_THREADS);
+    }
+}
+
+FileReader::~FileReader() {
+    if (this->ring) {
+        {
+            std::lock_guard lock{this->mutex};
+            this->stopping = true;
+        }
+        std::uint64_t one = 1;
+        (void)!::write(this->ring->wake_fd, &one, sizeof one);
+        this->reader_thread.join();
+    }
+}
+
+bool FileReader::uses_io_uring() const {
+    return this->ring != nullptr;
+}
+
+void FileReader::submit(Request* request) {
+    if (!this->ring) {
+        this->read_pool->post([this, request] {
+            try {
+                std::size_t size;
+                int fd = open_file(request->path, size);
+                auto data = Arena::buffer(this->arena, size);
+                if (!data) {
+                    data.reset(new unsigned char[std::max<std::size_t>(size, 1)]);
+                }
+                try {
+                    pread_all(fd, request->path, data.get(), size);
+                } catch (...) {
+                    ::close(fd);
+                    throw;
+                }
+                ::close(fd);
+                request->contents = {std::move(data), size};
+            } catch (...) {
+                request->error = std::current_exception();
+            }
+            complete(request);
+        });
+        return;
+    }
+
+    {
+        std::lock_guard lock{this->mutex};
+        this->pending.push_back(request);
+    }
+    std::uint64_t one = 1;
+    (void)!::write(this->ring->wake_fd, &one, sizeof one);
+}
+
+void FileReader::complete(Request* request) {
+    this->completion_pool.post([handle = request->handle] { handle.resume(); });
+}
+
+void FileReader::run() {
+    AZ_PROFILE_THREAD_NAME("FileReader");
+    /* A read in flight; its address is the completion's user_data */
+    struct Read {
+        Request* request;
+        int fd;
+        std::shared_ptr<unsigned char[]> data;
+        std::size_t size;
+        std::size_t done = 0;
+        bool fixed = false;
+    };
+    Ring& ring = *this->ring;
+
+    auto queue_read = [&ring](std::unique_ptr<Read> read) {
+        io_uring_sqe* sqe = ring.next_sqe();
+        sqe->opcode = read->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = read->fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(read->data.get() + read->done);
+        sqe->len = unsigned(std::min(read->size - read->done, MAX_READ));
+        sqe->off = read->done;
+        sqe->buf_index = 0;
+        sqe->user_data = reinterpret_cast<std::uint64_t>(read.release());
+    };
+    auto finish = [this](std::unique_ptr<Read> read, std::exception_ptr error) {
+        ::close(read->fd);
+        if (error) {
+            read->request->error = error;
+        } else {
+            read->request->contents = {std::move(read->data), read->size};
+        }
+        complete(read->request);
+    };
+
+    /* One entry stays reserved for the wake-up poll */
+    std::size_t capacity = ring.entries - 1;
+    std::size_t in_flight = 0;
+    bool wake_armed = false;
+    for (;;) {
+        if (!wake_armed) {
+            io_uring_sqe* sqe = ring.next_sqe();
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = ring.wake_fd;
+            sqe->poll32_events = POLLIN;
+            sqe->user_data = WAKE;
+            wake_armed = true;
+        }
+
+        /* Everything requested since the last round goes out together */
+        std::deque<Request*> batch;
+        {
+            std::lock_guard lock{this->mutex};
+            while (!this->pending.empty() && in_flight + batch.size() < capacity) {
+                batch.push_back(this->pending.front());
+                this->pending.pop_front();
+            }
+            if (this->stopping && this->pending.empty() && batch.empty() && in_flight == 0) {
+                break;
+            }
+        }
+        std::size_t started = 0;
+        for (Request* request : batch) {
+            auto read = std::make_unique<Read>();
+            read->request = request;
+            try {
+                read->fd = open_file(request->path, read->size);
+            } catch (...) {
+                request->error = std::current_exception();
+                complete(request);
+                continue;
+            }
+            if (read->size == 0) {
+                read->data.reset(new unsigned char[1]);
+                finish(std::move(read), nullptr);
+                continue;
+            }
+            read->data = Arena::buffer(this->arena, read->size);
+            read->fixed = read->data && ring.fixed_buffers;
+            if (!read->data) {
+                read->data.reset(new unsigned char[read->size]);
+            }
+            queue_read(std::move(read));
+            ++started;
+        }
+        in_flight += started;
+        if (started > 0) {
+            ++this->batches;
+            this->batched_reads += started;
+        }
+
+        ring.submit_and_wait();
+        ring.reap([&](const io_uring_cqe& cqe) {
+            if (cqe.user_data == WAKE) {
+                std::uint64_t count;
+                (void)!::read(ring.wake_fd, &count, sizeof count);
+                wake_armed = false;
+                return;
+            }
+            std::unique_ptr<Read> read{reinterpret_cast<Read*>(cqe.user_data)};
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                queue_read(std::move(read));
+                return;
+            }
+            if (cqe.res <= 0) {
+                std::string reason = cqe.res < 0 ? std::strerror(-cqe.res) : "unexpected end of file";
+                std::string path = read->request->path;
+                --in_flight;
+                finish(std::move(read), std::make_exception_ptr(
+                        std::runtime_error("Error reading '"s + path + "': " + reason)));
+                return;
+            }
+            read->done += cqe.res;
+            if (read->done < read->size) {
+                queue_read(std::move(read));
+            } else {
+                --in_flight;
+                finish(std::move(read), nullptr);
+            }
+        });
+    }
+}
@@ -1,14 +1,20 @@
 #include <iostream>
+#include <string>
 
 #include <glad/glad.h>
 
 #include <geometry.hpp>
+#include <gl_debug.hpp>
+#include <memory_accounting.hpp>
 
 Geometry::Geometry(
         std::initializer_list<float> vertices,
-        std::initializer_list<int> indices)
+        std::initializer_list<int> indices,
+        std::string_view name)
     : n_indices{indices.size()} {
 
+    GlDebugGroup debug_group{"Geometry upload"};
+
     /* Vertex buffer object (VBO) to store vertex data in GPU memory */
     glGenBuffers(1, &this->vbo);
 
@@ -18,17 +24,28 @@ Geometry::Geometry(
     /* Element buffer object (EBO) */
     glGenBuffers(1, &this->ebo);
 
+    /* Accounted for before they take any memory, so a budget can refuse */
+    std::size_t vertices_size = sizeof *std::begin(vertices) * vertices.size();
+    std::size_t indices_size = sizeof *std::begin(indices) * n_indices;
+    try {
+        record_allocation({.kind = MemoryKind::buffer, .id = this->vbo, .bytes = vertices_size,
+                           .format = GL_STATIC_DRAW, .category = "geometry", .owner = std::string{name}});
+        record_allocation({.kind = MemoryKind::buffer, .id = this->ebo, .bytes = indices_size,
+                           .format = GL_STATIC_DRAW, .category = "geometry", .owner = std::string{name}});
+    } catch (...) {
+        del();
+        throw;
+    }
+
     /* Bind vao */
     glBindVertexArray(this->vao);
 
     /* Bind vbo and copy vertex data */
     glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
-    std::size_t vertices_size = sizeof *std::begin(vertices) * vertices.size();
     glBufferData(GL_ARRAY_BUFFER, vertices_size, std::begin(vertices), GL_STATIC_DRAW);
 
     /* Bind ebo and copy indices; ebo will be recalled by previously-bound vao */
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo);
-    std::size_t indices_size = sizeof *std::begin(indices) * n_indices;
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_size, std::begin(indices), GL_STATIC_DRAW);
 
     /* Location 0 in the shader will receive position data */
@@ -41,14 +58,29 @@ Geometry::Geometry(
 
     /* Unbind vao */
     glBindVertexArray(0);
+
+    if (!name.empty()) {
+        label(name);
+    }
 }
 
 void Geometry::draw() {
+    GlDebugGroup debug_group{"Geometry::draw"};
     glBindVertexArray(this->vao);
     glDrawElements(GL_TRIANGLES, this->n_indices, GL_UNSIGNED_INT, 0);
 }
 
+void Geometry::label(std::string_view name) const {
+    gl_object_label(GL_VERTEX_ARRAY, this->vao, name);
+    gl_object_label(GL_BUFFER, this->vbo, std::string{name} + " vertices");
+    gl_object_label(GL_BUFFER, this->ebo, std::string{name} + " indices");
+    set_memory_owner(MemoryKind::buffer, this->vbo, std::string{name});
+    set_memory_owner(MemoryKind::buffer, this->ebo, std::string{name});
+}
+
 void Geometry::del() {
+    record_release(MemoryKind::buffer, this->ebo);
+    record_release(MemoryKind::buffer, this->vbo);
     glDeleteBuffers(1, &this->ebo);
     glDeleteVertexArrays(1, &this->vao);
     glDeleteBuffers(1, &this->vbo);
@@ -0,0 +1,1408 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <glad/glad.h>
+
+#include <gl_capture.hpp>
+#include <gl_trace.hpp>
+
+using namespace std::string_literals;
+
+/**
+ * File format: an 8-byte magic, then unsigned LEB128 varints for the
+ * version and the viewport size, then records, each a varint type:
+ *
+ *     FUNCTION  id, name            before the first call of a function
+ *     CALL      id, payload         the call's arguments and result
+ *     BEGIN                         the first captured frame starts
+ *     FRAME                         a captured frame ends
+ *     THREAD    index               the calls after are of that thread
+ *     MAPPED    address, offset, data  written to a mapped buffer
+ *
+ * Names, payloads and data are a varint size and that many bytes. A payload
+ * encodes the arguments by their C type: unsigned integers as varints,
+ * signed ones zigzag encoded, floating point numbers as their 4 or 8 bytes,
+ * GLsync by address, other pointers as a tag (see POINTER_*) with what it
+ * says follows. Non-void results come last, pointers among them as
+ * addresses.
+ */
+
+namespace {
+    enum : std::size_t {
+#define AZ_GL_FUNCTION(name) fn_##name,
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+        FUNCTION_COUNT
+    };
+
+    const char CAPTURE_MAGIC[8] = {'A', 'Z', 'G', 'L', '\r', '\n', '\x1a', '\n'};
+    const std::uint64_t CAPTURE_VERSION = 1;
+
+    enum : std::uint64_t {
+        RECORD_FUNCTION, RECORD_CALL, RECORD_BEGIN, RECORD_FRAME, RECORD_THREAD, RECORD_MAPPED,
+    };
+
+    /* What a pointer argument is kept as: nothing, an offset into a buffer
+     * object, the data it points to, an array of strings, or nothing known
+     * (replayed as scratch memory) */
+    enum : std::uint64_t {
+        POINTER_NULL, POINTER_OFFSET, POINTER_DATA, POINTER_STRINGS, POINTER_SCRATCH,
+    };
+
+    /* Linux maps nothing below this, so smaller pointers are offsets */
+    const std::uintptr_t MIN_CLIENT_ADDRESS = 65536;
+    /* Payloads are written out once this much has gathered */
+    const std::size_t FLUSH_BYTES = 1 << 20;
+    /* More than any function in gl_functions.inc takes */
+    const std::size_t MAX_ARGS = 16;
+
+    struct Writer {
+        std::vector<std::uint8_t> bytes;
+
+        void varint(std::uint64_t value) {
+            while (value >= 0x80) {
+                this->bytes.push_back(std::uint8_t(value | 0x80));
+                value >>= 7;
+            }
+            this->bytes.push_back(std::uint8_t(value));
+        }
+
+        void zigzag(std::int64_t value) {
+            this->varint((std::uint64_t(value) << 1) ^ std::uint64_t(value >> 63));
+        }
+
+        void raw(const void* data, std::size_t size) {
+            auto begin = static_cast<const std::uint8_t*>(data);
+            this->bytes.insert(this->bytes.end(), begin, begin + size);
+        }
+
+        void blob(const void* data, std::size_t size) {
+            this->varint(size);
+            this->raw(data, size);
+        }
+    };
+
+    struct Reader {
+        const std::uint8_t* at;
+        const std::uint8_t* end;
+
+        std::uint64_t varint() {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                std::uint8_t byte = *this->raw(1);
+                value |= std::uint64_t(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) {
+                    return value;
+                }
+            }
+            throw std::runtime_error("Malformed capture");
+        }
+
+        std::int64_t zigzag() {
+            std::uint64_t value = this->varint();
+            return std::int64_t(value >> 1) ^ -std::int64_t(value & 1);
+        }
+
+        const std::uint8_t* raw(std::size_t size) {
+            if (std::size_t(this->end - this->at) < size) {
+                throw std::runtime_error("Truncated capture");
+            }
+            const std::uint8_t* data = this->at;
+            this->at += size;
+            return data;
+        }
+
+        std::span<const std::uint8_t> blob() {
+            std::size_t size = this->varint();
+            return {this->raw(size), size};
+        }
+    };
+
+    template <typename T>
+    void write_value(Writer& out, T value) {
+        if constexpr (std::is_pointer_v<T>) {
+            out.varint(reinterpret_cast<std::uintptr_t>(value));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            out.raw(&value, sizeof value);
+        } else if constexpr (std::is_signed_v<T>) {
+            out.zigzag(value);
+        } else {
+            out.varint(value);
+        }
+    }
+
+    template <typename T>
+    T read_value(Reader& in) {
+        if constexpr (std::is_pointer_v<T>) {
+            return reinterpret_cast<T>(std::uintptr_t(in.varint()));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            T value;
+            std::memcpy(&value, in.raw(sizeof value), sizeof value);
+            return value;
+        } else if constexpr (std::is_signed_v<T>) {
+            return T(in.zigzag());
+        } else {
+            return T(in.varint());
+        }
+    }
+
+    template <std::size_t N, typename... Args>
+    auto arg(const Args&... args) {
+        return std::get<N>(std::tie(args...));
+    }
+
+    template <std::size_t N, typename... Args>
+    using ArgType = std::tuple_element_t<N, std::tuple<Args...>>;
+
+    /* Components per element of glUniform*v and glProgramUniform*v arrays,
+     * 0 for other functions */
+    const auto uniform_components = [] {
+        std::array<std::size_t, FUNCTION_COUNT> components{};
+        for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+            std::string_view name = gl_function_name(i);
+            if (!name.ends_with("v") || !(name.starts_with("glUniform") || name.starts_with("glProgramUniform"))) {
+                continue;
+            }
+            name.remove_prefix(name.find("Uniform") + 7);
+            bool matrix = name.starts_with("Matrix");
+            if (matrix) {
+                name.remove_prefix(6);
+            }
+            if (name.empty() || name[0] < '1' || name[0] > '4') {
+                continue;
+            }
+            std::size_t columns = std::size_t(name[0] - '0');
+            std::size_t rows = matrix ? columns : 1;
+            if (matrix && name.size() > 2 && name[1] == 'x') {
+                rows = std::size_t(name[2] - '0');
+            }
+            components[i] = columns * rows;
+        }
+        return components;
+    }();
+
+    /* Uniform value setters: 1 for glUniform* (the current program's), 2 for
+     * glProgramUniform* */
+    const auto uniform_setters = [] {
+        std::array<std::uint8_t, FUNCTION_COUNT> setters{};
+        for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+            std::string_view name = gl_function_name(i);
+            std::uint8_t kind = name.starts_with("glUniform") ? 1 : name.starts_with("glProgramUniform") ? 2 : 0;
+            if (!kind) {
+                continue;
+            }
+            name.remove_prefix(name.find("Uniform") + 7);
+            if (name.starts_with("Matrix")) {
+                name.remove_prefix(6);
+            }
+            if (!name.empty() && name[0] >= '1' && name[0] <= '4') {
+                setters[i] = kind;
+            }
+        }
+        return setters;
+    }();
+
+    /* Setters taking a vector of up to four values whose length depends on
+     * another argument (glTexParameteriv and the like); four are kept */
+    const auto vector_setters = [] {
+        std::array<bool, FUNCTION_COUNT> setters{};
+        for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+            std::string_view name = gl_function_name(i);
+            setters[i] = name.ends_with("v") && !name.starts_with("glGet");
+        }
+        return setters;
+    }();
+
+    /* What a frame does to the screen, rather than to objects or state:
+     * left out before the captured frames. glDrawBuffers is not among it */
+    const std::string_view FRAME_ONLY_PREFIXES[] = {
+        "glDraw", "glMultiDraw", "glClearBuffer", "glBlitFramebuffer", "glReadPixels", "glFlush", "glFinish",
+        "glClientWaitSync", "glWaitSync", "glGet", "glIs",
+    };
+
+    template <typename F>
+    struct Signature;
+
+    template <typename R, typename... Args>
+    struct Signature<R (APIENTRYP)(Args...)> {
+        using Result = R;
+    };
+
+    const auto frame_only = [] {
+        std::array<bool, FUNCTION_COUNT> returns{};
+#define AZ_GL_FUNCTION(name) \
+        returns[fn_##name] = !std::is_void_v<Signature<decltype(glad_##name)>::Result>;
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+        std::array<bool, FUNCTION_COUNT> frame_only{};
+        for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+            std::string_view name = gl_function_name(i);
+            /* Queries returning their result may be needed to replay later
+             * calls, e.g. glGetUniformLocation */
+            bool kept_query = returns[i] && name.starts_with("glGet");
+            bool state = name.starts_with("glDrawBuffer");
+            frame_only[i] = !kept_query && !state && (name == "glClear"
+                    || std::any_of(std::begin(FRAME_ONLY_PREFIXES), std::end(FRAME_ONLY_PREFIXES),
+                                   [&](std::string_view prefix) { return name.starts_with(prefix); }));
+        }
+        return frame_only;
+    }();
+
+    /* Capture */
+
+    struct Mapping {
+        std::uint8_t* pointer;
+        std::size_t length;
+        bool write;
+    };
+
+    /* Bindings, fixed-function state and uniform values set before the
+     * captured frames only matter for their last value. Each call is held
+     * back in place of the one before it for the same binding point, state
+     * or uniform, until another call of the thread is kept (bindings and
+     * state are written first, as it may depend on them) or the captured
+     * frames begin. Frames that redo the same state then add nothing for
+     * it, however late the capture starts */
+    struct HeldState {
+        /* Function and payload by what they set: a function standing for
+         * the kind of call (e.g. glEnable for glDisable too), a texture
+         * unit and a target or capability */
+        std::map<std::tuple<std::size_t, GLenum, GLenum>, std::pair<std::size_t, std::vector<std::uint8_t>>> state;
+        /* Function and payload by program and location */
+        std::map<std::pair<GLuint, GLint>, std::pair<std::size_t, std::vector<std::uint8_t>>> uniforms;
+        /* As the thread's context has them, and as written so far */
+        GLuint program = 0;
+        GLenum active_texture = GL_TEXTURE0;
+        GLenum written_active_texture = GL_TEXTURE0;
+    };
+
+    struct Capture {
+        std::mutex mutex;
+        GlCaptureOptions options;
+        std::ofstream file;
+        Writer out;
+        /* Read without the lock by the hooks, to skip encoding calls */
+        std::atomic<bool> capturing = false;
+        std::atomic<bool> in_range = false;
+        std::uint64_t frame = 0;
+        std::array<bool, FUNCTION_COUNT> declared{};
+        /* Counts captures started, for thread indices */
+        std::uint64_t id = 0;
+        std::size_t threads = 0;
+        std::size_t current_thread = SIZE_MAX;
+        /* Mapped ranges, by buffer */
+        std::map<GLuint, Mapping> mappings;
+        /* By thread index */
+        std::map<std::size_t, HeldState> held;
+    };
+
+    Capture capture;
+    PFNGLGETINTEGERVPROC get_integer = nullptr;
+    PFNGLGETBUFFERPARAMETERI64VPROC get_buffer_parameter = nullptr;
+
+    /* Pixel store state and pixel buffer bindings of the calling thread's
+     * context, for the size of texel data; the skip parameters are not
+     * supported */
+    thread_local GLint unpack_alignment = 4;
+    thread_local GLint unpack_row_length = 0;
+    thread_local GLint unpack_image_height = 0;
+    thread_local GLuint unpack_buffer = 0;
+    thread_local GLuint pack_buffer = 0;
+    /* Index of the calling thread in the capture it was given one by */
+    thread_local std::size_t thread_index = SIZE_MAX;
+    thread_local std::uint64_t thread_capture = 0;
+    /* Reused for every call's payload */
+    thread_local Writer payload;
+
+    GLenum binding_of(GLenum target) {
+        switch (target) {
+            case GL_ARRAY_BUFFER: return GL_ARRAY_BUFFER_BINDING;
+            case GL_ELEMENT_ARRAY_BUFFER: return GL_ELEMENT_ARRAY_BUFFER_BINDING;
+            case GL_PIXEL_PACK_BUFFER: return GL_PIXEL_PACK_BUFFER_BINDING;
+            case GL_PIXEL_UNPACK_BUFFER: return GL_PIXEL_UNPACK_BUFFER_BINDING;
+            case GL_UNIFORM_BUFFER: return GL_UNIFORM_BUFFER_BINDING;
+            case GL_COPY_READ_BUFFER: return GL_COPY_READ_BUFFER_BINDING;
+            case GL_COPY_WRITE_BUFFER: return GL_COPY_WRITE_BUFFER_BINDING;
+            case GL_SHADER_STORAGE_BUFFER: return GL_SHADER_STORAGE_BUFFER_BINDING;
+            case GL_DRAW_INDIRECT_BUFFER: return GL_DRAW_INDIRECT_BUFFER_BINDING;
+            case GL_DISPATCH_INDIRECT_BUFFER: return GL_DISPATCH_INDIRECT_BUFFER_BINDING;
+            case GL_TEXTURE_BUFFER: return GL_TEXTURE_BUFFER_BINDING;
+            case GL_TRANSFORM_FEEDBACK_BUFFER: return GL_TRANSFORM_FEEDBACK_BUFFER_BINDING;
+            case GL_ATOMIC_COUNTER_BUFFER: return GL_ATOMIC_COUNTER_BUFFER_BINDING;
+            case GL_QUERY_BUFFER: return GL_QUERY_BUFFER_BINDING;
+            default: return 0;
+        }
+    }
+
+    GLuint bound_buffer(GLenum target) {
+        GLint buffer = 0;
+        if (GLenum binding = binding_of(target)) {
+            get_integer(binding, &buffer);
+        }
+        return GLuint(buffer);
+    }
+
+    struct Data {
+        enum { unknown, offset, bytes } kind;
+        std::size_t size = 0;
+    };
+
+    Data bytes(std::int64_t size) {
+        return {Data::bytes, std::size_t(std::max<std::int64_t>(size, 0))};
+    }
+
+    Data texels(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type) {
+        if (unpack_buffer) {
+            return {Data::offset};
+        }
+        if (width <= 0 || height <= 0 || depth <= 0) {
+            return bytes(0);
+        }
+        std::size_t pixel = gl_pixel_bytes(format, type);
+        std::size_t row = std::size_t(unpack_row_length > 0 ? unpack_row_length : width) * pixel;
+        std::size_t alignment = std::size_t(std::max(unpack_alignment, 1));
+        std::size_t stride = (row + alignment - 1) / alignment * alignment;
+        std::size_t image_rows = std::size_t(unpack_image_height > 0 ? unpack_image_height : height);
+        /* The last row is not padded */
+        std::size_t rows = image_rows * std::size_t(depth - 1) + std::size_t(height);
+        return bytes(std::int64_t(stride * (rows - 1) + std::size_t(width) * pixel));
+    }
+
+    Data compressed_texels(GLsizei size) {
+        return unpack_buffer ? Data{Data::offset} : bytes(size);
+    }
+
+    /* Functions whose pointers are offsets into buffer objects (in core
+     * profiles, always) */
+    constexpr bool takes_offsets(std::size_t function) {
+        for (std::size_t offset_function : {
+                fn_glVertexAttribPointer, fn_glVertexAttribIPointer, fn_glDrawElements,
+                fn_glDrawElementsBaseVertex, fn_glDrawElementsInstanced, fn_glDrawElementsInstancedBaseVertex,
+                fn_glDrawRangeElements, fn_glDrawRangeElementsBaseVertex}) {
+            if (function == offset_function) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* What pointer argument N of a call points to */
+    template <std::size_t Function, std::size_t N, typename... Args>
+    Data referenced_data(const Args&... args) {
+        using Pointee = std::remove_pointer_t<ArgType<N, Args...>>;
+        using Value = std::remove_cv_t<Pointee>;
+        constexpr bool input = std::is_const_v<Pointee>;
+
+        if constexpr (takes_offsets(Function)) {
+            return {Data::offset};
+        } else if constexpr (Function == fn_glBufferData) {
+            return bytes(arg<1>(args...));
+        } else if constexpr (Function == fn_glBufferSubData) {
+            return bytes(arg<2>(args...));
+        } else if constexpr (Function == fn_glTexImage1D) {
+            return texels(arg<3>(args...), 1, 1, arg<5>(args...), arg<6>(args...));
+        } else if constexpr (Function == fn_glTexImage2D) {
+            return texels(arg<3>(args...), arg<4>(args...), 1, arg<6>(args...), arg<7>(args...));
+        } else if constexpr (Function == fn_glTexImage3D) {
+            return texels(arg<3>(args...), arg<4>(args...), arg<5>(args...), arg<7>(args...), arg<8>(args...));
+        } else if constexpr (Function == fn_glTexSubImage1D) {
+            return texels(arg<3>(args...), 1, 1, arg<4>(args...), arg<5>(args...));
+        } else if constexpr (Function == fn_glTexSubImage2D) {
+            return texels(arg<4>(args...), arg<5>(args...), 1, arg<6>(args...), arg<7>(args...));
+        } else if constexpr (Function == fn_glTexSubImage3D) {
+            return texels(arg<5>(args...), arg<6>(args...), arg<7>(args...), arg<8>(args...), arg<9>(args...));
+        } else if constexpr (Function == fn_glCompressedTexImage1D || Function == fn_glCompressedTexSubImage1D) {
+            return compressed_texels(arg<5>(args...));
+        } else if constexpr (Function == fn_glCompressedTexImage2D) {
+            return compressed_texels(arg<6>(args...));
+        } else if constexpr (Function == fn_glCompressedTexSubImage2D || Function == fn_glCompressedTexImage3D) {
+            return compressed_texels(arg<7>(args...));
+        } else if constexpr (Function == fn_glCompressedTexSubImage3D) {
+            return compressed_texels(arg<9>(args...));
+        } else if constexpr (Function == fn_glReadPixels || Function == fn_glGetTexImage) {
+            return pack_buffer ? Data{Data::offset} : Data{Data::unknown};
+        } else if constexpr (std::is_same_v<Value, GLchar> && input) {
+            /* Labels and messages may come with a length */
+            GLsizei length = -1;
+            if constexpr (Function == fn_glObjectLabel || Function == fn_glPushDebugGroup) {
+                length = arg<2>(args...);
+            } else if constexpr (Function == fn_glObjectPtrLabel) {
+                length = arg<1>(args...);
+            } else if constexpr (Function == fn_glDebugMessageInsert) {
+                length = arg<4>(args...);
+            }
+            return bytes(length >= 0 ? length : std::int64_t(std::strlen(arg<N>(args...)) + 1));
+        } else if constexpr (std::is_arithmetic_v<Value>) {
+            /* glUniform*v(location, count, ...) or
+             * glProgramUniform*v(program, location, count, ...) */
+            constexpr std::size_t count_arg = std::is_same_v<ArgType<0, Args...>, GLint> ? 1 : 2;
+            if constexpr (input && count_arg < N) {
+                if constexpr (std::is_same_v<ArgType<count_arg, Args...>, GLsizei>) {
+                    if (std::size_t components = uniform_components[Function]) {
+                        return bytes(std::int64_t(arg<count_arg>(args...)) * std::int64_t(components * sizeof(Value)));
+                    }
+                }
+            }
+            if constexpr (std::is_same_v<Value, GLuint> && N > 0) {
+                /* Arrays of names or enums follow their length */
+                if constexpr (std::is_same_v<ArgType<N - 1, Args...>, GLsizei>) {
+                    return bytes(std::int64_t(arg<N - 1>(args...)) * 4);
+                }
+            }
+            if constexpr (input) {
+                if (vector_setters[Function]) {
+                    return bytes(4 * sizeof(Value));
+                }
+            }
+            return {Data::unknown};
+        } else {
+            return {Data::unknown};
+        }
+    }
+
+    template <std::size_t Function, std::size_t N, typename... Args>
+    void write_pointer(Writer& out, const Args&... args) {
+        auto pointer = arg<N>(args...);
+        using Pointee = std::remove_pointer_t<decltype(pointer)>;
+        using Value = std::remove_cv_t<Pointee>;
+
+        /* Callbacks are not replayed; glShaderSource's lengths are taken
+         * care of with its strings */
+        if constexpr (std::is_function_v<Pointee> || (Function == fn_glShaderSource && N == 3)) {
+            out.varint(POINTER_NULL);
+            return;
+        } else {
+            if (!pointer) {
+                out.varint(POINTER_NULL);
+                return;
+            }
+            if constexpr (std::is_pointer_v<Value>) {
+                if constexpr (std::is_same_v<Value, const GLchar*> && N > 0) {
+                    if constexpr (std::is_same_v<ArgType<N - 1, Args...>, GLsizei>) {
+                        GLsizei count = std::max(arg<N - 1>(args...), 0);
+                        const GLint* lengths = nullptr;
+                        if constexpr (Function == fn_glShaderSource) {
+                            lengths = arg<3>(args...);
+                        }
+                        out.varint(POINTER_STRINGS);
+                        out.varint(std::uint64_t(count));
+                        for (GLsizei i = 0; i < count; ++i) {
+                            out.blob(pointer[i], lengths && lengths[i] >= 0 ? std::size_t(lengths[i])
+                                    : std::strlen(pointer[i]));
+                        }
+                        return;
+                    }
+                }
+                out.varint(POINTER_SCRATCH);
+            } else {
+                Data data = referenced_data<Function, N>(args...);
+                auto address = reinterpret_cast<std::uintptr_t>(pointer);
+                if (data.kind == Data::bytes) {
+                    out.varint(POINTER_DATA);
+                    out.blob(pointer, data.size);
+                } else if (data.kind == Data::offset || address < MIN_CLIENT_ADDRESS) {
+                    out.varint(POINTER_OFFSET);
+                    out.varint(address);
+                } else {
+                    out.varint(POINTER_SCRATCH);
+                }
+            }
+        }
+    }
+
+    template <std::size_t Function, std::size_t N, typename... Args>
+    void write_arg(Writer& out, const Args&... args) {
+        using T = ArgType<N, Args...>;
+        if constexpr (std::is_pointer_v<T> && !std::is_same_v<T, GLsync>) {
+            write_pointer<Function, N>(out, args...);
+        } else {
+            write_value(out, arg<N>(args...));
+        }
+    }
+
+    void flush_capture() {
+        capture.file.write(reinterpret_cast<const char*>(capture.out.bytes.data()),
+                           std::streamsize(capture.out.bytes.size()));
+        capture.out.bytes.clear();
+    }
+
+    /* With the capture's lock held: the calling thread's index in the
+     * capture */
+    std::size_t capture_thread() {
+        if (thread_capture != capture.id) {
+            thread_index = capture.threads++;
+            thread_capture = capture.id;
+        }
+        return thread_index;
+    }
+
+    /* With the capture's lock held: the records after are of `thread`, and
+     * `function` is on record */
+    void begin_record(std::size_t thread, std::size_t function) {
+        if (thread != capture.current_thread) {
+            capture.out.varint(RECORD_THREAD);
+            capture.out.varint(thread);
+            capture.current_thread = thread;
+        }
+        if (!capture.declared[function]) {
+            std::string_view name = gl_function_name(function);
+            capture.out.varint(RECORD_FUNCTION);
+            capture.out.varint(function);
+            capture.out.blob(name.data(), name.size());
+            capture.declared[function] = true;
+        }
+    }
+
+    void write_call(std::size_t thread, std::size_t function, std::span<const std::uint8_t> call_payload) {
+        begin_record(thread, function);
+        capture.out.varint(RECORD_CALL);
+        capture.out.varint(function);
+        capture.out.blob(call_payload.data(), call_payload.size());
+    }
+
+    /* A call the application did not make, with one argument */
+    void write_call(std::size_t thread, std::size_t function, GLuint value) {
+        Writer args;
+        write_value(args, value);
+        write_call(thread, function, args.bytes);
+    }
+
+    void write_held_state(std::size_t thread, HeldState& held) {
+        for (const auto& [key, call] : held.state) {
+            GLenum unit = std::get<1>(key);
+            const auto& [function, call_payload] = call;
+            if (function == fn_glBindTexture && unit != held.written_active_texture) {
+                write_call(thread, fn_glActiveTexture, unit);
+                held.written_active_texture = unit;
+            }
+            write_call(thread, function, call_payload);
+        }
+        held.state.clear();
+        if (held.active_texture != held.written_active_texture) {
+            write_call(thread, fn_glActiveTexture, held.active_texture);
+            held.written_active_texture = held.active_texture;
+        }
+    }
+
+    /* After the state: glUniform* calls go with their program made
+     * current, then the thread's own is restored */
+    void write_held_uniforms(std::size_t thread, HeldState& held) {
+        GLuint current = held.program;
+        for (const auto& [key, call] : held.uniforms) {
+            const auto& [function, call_payload] = call;
+            if (uniform_setters[function] == 1 && key.first != current) {
+                write_call(thread, fn_glUseProgram, key.first);
+                current = key.first;
+            }
+            write_call(thread, function, call_payload);
+        }
+        held.uniforms.clear();
+        if (current != held.program) {
+            write_call(thread, fn_glUseProgram, held.program);
+        }
+    }
+
+    /* Everything held back, before the captured frames begin */
+    void write_held() {
+        for (auto& [thread, held] : capture.held) {
+            write_held_state(thread, held);
+            write_held_uniforms(thread, held);
+        }
+        capture.held.clear();
+    }
+
+    /* Fixed-function state set whole by one call, with the function it is
+     * held under; the blend functions and equations have two ways of being
+     * set, which must not both be held */
+    constexpr std::size_t held_state_kind(std::size_t function) {
+        switch (function) {
+            case fn_glClearColor: case fn_glClearDepth: case fn_glViewport: case fn_glScissor:
+            case fn_glDepthFunc: case fn_glDepthMask: case fn_glColorMask: case fn_glCullFace:
+            case fn_glFrontFace:
+                return function;
+            case fn_glBlendFunc: case fn_glBlendFuncSeparate:
+                return fn_glBlendFuncSeparate;
+            case fn_glBlendEquation: case fn_glBlendEquationSeparate:
+                return fn_glBlendEquationSeparate;
+            default:
+                return FUNCTION_COUNT;
+        }
+    }
+
+    /* What a call made before the captured frames sets, for holding it
+     * back (see HeldState); the same for all calls of a kind, so that
+     * record() need not be one per function */
+    struct Holding {
+        enum : std::uint8_t {
+            none, active_texture, state, texture_binding, uniform, program_uniform,
+        } kind = none;
+        /* The function the state is held under, and its target or
+         * capability */
+        std::size_t held_as = 0;
+        GLenum target = 0;
+        /* The unit of glActiveTexture; the program of glUseProgram,
+         * glProgramUniform*, glLinkProgram and glDeleteProgram */
+        GLuint name = 0;
+        GLint location = 0;
+        /* glUseProgram: the thread's program changes */
+        bool uses_program = false;
+        /* glLinkProgram and glDeleteProgram: the program's uniforms start
+         * over, or go away */
+        bool resets_uniforms = false;
+    };
+
+    template <std::size_t Function, typename... Args>
+    Holding holding(const Args&... args) {
+        if constexpr (Function == fn_glActiveTexture) {
+            return {.kind = Holding::active_texture, .name = arg<0>(args...)};
+        } else if constexpr (held_state_kind(Function) != FUNCTION_COUNT) {
+            return {.kind = Holding::state, .held_as = held_state_kind(Function)};
+        } else if constexpr (Function == fn_glEnable || Function == fn_glDisable) {
+            return {.kind = Holding::state, .held_as = fn_glEnable, .target = arg<0>(args...)};
+        } else if constexpr (Function == fn_glUseProgram) {
+            return {.kind = Holding::state, .held_as = Function, .name = arg<0>(args...), .uses_program = true};
+        } else if constexpr (Function == fn_glBindVertexArray) {
+            return {.kind = Holding::state, .held_as = Function};
+        } else if constexpr (Function == fn_glBindTexture) {
+            return {.kind = Holding::texture_binding, .held_as = Function, .target = arg<0>(args...)};
+        } else if constexpr (Function == fn_glBindBuffer) {
+            /* The element array binding belongs to the vertex array */
+            if (arg<0>(args...) != GL_ELEMENT_ARRAY_BUFFER) {
+                return {.kind = Holding::state, .held_as = Function, .target = arg<0>(args...)};
+            }
+        } else if constexpr (Function == fn_glLinkProgram || Function == fn_glDeleteProgram) {
+            return {.name = arg<0>(args...), .resets_uniforms = true};
+        } else if constexpr (sizeof...(Args) >= 2) {
+            if constexpr (std::is_same_v<ArgType<0, Args...>, GLint>) {
+                if (uniform_setters[Function] == 1) {
+                    return {.kind = Holding::uniform, .location = arg<0>(args...)};
+                }
+            } else if constexpr (std::is_same_v<ArgType<0, Args...>, GLuint>
+                    && std::is_same_v<ArgType<1, Args...>, GLint>) {
+                if (uniform_setters[Function] == 2) {
+                    return {.kind = Holding::program_uniform, .name = arg<0>(args...), .location = arg<1>(args...)};
+                }
+            }
+        }
+        return {};
+    }
+
+    /* Whether to hold the call (in `payload`) back rather than keep it */
+    bool hold(HeldState& held, std::size_t function, const Holding& holding) {
+        switch (holding.kind) {
+            case Holding::active_texture:
+                held.active_texture = holding.name;
+                return true;
+            case Holding::state:
+                if (holding.uses_program) {
+                    held.program = holding.name;
+                }
+                held.state[{holding.held_as, 0, holding.target}] = {function, payload.bytes};
+                return true;
+            case Holding::texture_binding:
+                held.state[{holding.held_as, held.active_texture, holding.target}] = {function, payload.bytes};
+                return true;
+            case Holding::uniform:
+                held.uniforms[{held.program, holding.location}] = {function, payload.bytes};
+                return true;
+            case Holding::program_uniform:
+                held.uniforms[{holding.name, holding.location}] = {function, payload.bytes};
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /* Whether a call of the function may be kept, before its arguments are
+     * encoded; record() decides */
+    bool wanted(std::size_t function) {
+        return capture.capturing.load(std::memory_order_relaxed)
+            && (capture.in_range.load(std::memory_order_relaxed) || !frame_only[function]);
+    }
+
+    template <std::size_t Function, typename... Args>
+    void write_args(const Args&... args) {
+        payload.bytes.clear();
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (write_arg<Function, I>(payload, args...), ...);
+        }(std::index_sequence_for<Args...>{});
+    }
+
+    /* The call whose arguments (and result) are in `payload` */
+    void record(std::size_t function, const Holding& holding) {
+        std::lock_guard lock{capture.mutex};
+        if (!capture.capturing || (!capture.in_range && frame_only[function])) {
+            return;
+        }
+        std::size_t thread = capture_thread();
+        if (!capture.in_range) {
+            HeldState& held = capture.held[thread];
+            if (hold(held, function, holding)) {
+                return;
+            }
+            if (holding.resets_uniforms) {
+                for (auto& [other_thread, other] : capture.held) {
+                    std::erase_if(other.uniforms, [&](const auto& uniform) {
+                        return uniform.first.first == holding.name;
+                    });
+                }
+            }
+            write_held_state(thread, held);
+        }
+        write_call(thread, function, payload.bytes);
+        if (capture.out.bytes.size() >= FLUSH_BYTES) {
+            flush_capture();
+        }
+    }
+
+    /* Keeps what was written to a mapped range, before it is unmapped */
+    void record_mapped(GLuint buffer, std::size_t offset, std::size_t length, bool unmap) {
+        std::lock_guard lock{capture.mutex};
+        auto mapping = capture.mappings.find(buffer);
+        if (mapping == capture.mappings.end()) {
+            return;
+        }
+        if (capture.capturing && mapping->second.write) {
+            begin_record(capture_thread(), fn_glUnmapBuffer);
+            length = std::min(length, mapping->second.length - std::min(offset, mapping->second.length));
+            capture.out.varint(RECORD_MAPPED);
+            capture.out.varint(reinterpret_cast<std::uintptr_t>(mapping->second.pointer));
+            capture.out.varint(offset);
+            capture.out.blob(mapping->second.pointer + offset, length);
+        }
+        if (unmap) {
+            capture.mappings.erase(mapping);
+        }
+    }
+
+    void record_mapping(GLuint buffer, void* pointer, std::size_t length, bool write) {
+        if (pointer) {
+            std::lock_guard lock{capture.mutex};
+            capture.mappings[buffer] = {static_cast<std::uint8_t*>(pointer), length, write};
+        }
+    }
+
+    /* State the data sizes depend on, and mapped writes; before the call */
+    template <std::size_t Function, typename... Args>
+    void before(const Args&... args) {
+        if constexpr (Function == fn_glPixelStorei) {
+            GLenum pname = arg<0>(args...);
+            GLint value = arg<1>(args...);
+            if (pname == GL_UNPACK_ALIGNMENT) {
+                unpack_alignment = value;
+            } else if (pname == GL_UNPACK_ROW_LENGTH) {
+                unpack_row_length = value;
+            } else if (pname == GL_UNPACK_IMAGE_HEIGHT) {
+                unpack_image_height = value;
+            }
+        } else if constexpr (Function == fn_glBindBuffer) {
+            if (arg<0>(args...) == GL_PIXEL_UNPACK_BUFFER) {
+                unpack_buffer = arg<1>(args...);
+            } else if (arg<0>(args...) == GL_PIXEL_PACK_BUFFER) {
+                pack_buffer = arg<1>(args...);
+            }
+        } else if constexpr (Function == fn_glUnmapBuffer) {
+            record_mapped(bound_buffer(arg<0>(args...)), 0, SIZE_MAX, true);
+        } else if constexpr (Function == fn_glFlushMappedBufferRange) {
+            record_mapped(bound_buffer(arg<0>(args...)), std::size_t(arg<1>(args...)), std::size_t(arg<2>(args...)),
+                          false);
+        }
+    }
+
+    /* Mappings, after the call */
+    template <std::size_t Function, typename R, typename... Args>
+    void after(R result, const Args&... args) {
+        if constexpr (Function == fn_glMapBuffer) {
+            GLint64 size = 0;
+            get_buffer_parameter(arg<0>(args...), GL_BUFFER_SIZE, &size);
+            record_mapping(bound_buffer(arg<0>(args...)), result, std::size_t(size), arg<1>(args...) != GL_READ_ONLY);
+        } else if constexpr (Function == fn_glMapBufferRange) {
+            record_mapping(bound_buffer(arg<0>(args...)), result, std::size_t(arg<2>(args...)),
+                           arg<3>(args...) & GL_MAP_WRITE_BIT);
+        }
+    }
+
+    /* Stands in for the function glad stored in `Pointer` while capturing */
+    template <auto& Pointer, std::size_t Function, typename F = std::remove_reference_t<decltype(Pointer)>>
+    struct Hook;
+
+    template <auto& Pointer, std::size_t Function, typename R, typename... Args>
+    struct Hook<Pointer, Function, R (APIENTRYP)(Args...)> {
+        static inline R (APIENTRYP original)(Args...) = nullptr;
+
+        static R APIENTRY call(Args... args) {
+            before<Function>(args...);
+            if constexpr (std::is_void_v<R>) {
+                original(args...);
+                if (wanted(Function)) {
+                    write_args<Function>(args...);
+                    record(Function, holding<Function>(args...));
+                }
+            } else {
+                R result = original(args...);
+                after<Function>(result, args...);
+                if (wanted(Function)) {
+                    write_args<Function>(args...);
+                    write_value(payload, result);
+                    record(Function, holding<Function>(args...));
+                }
+                return result;
+            }
+        }
+
+        static void install() {
+            original = Pointer;
+            if (Pointer) {
+                Pointer = &call;
+            }
+        }
+
+        /* Unless something else has wrapped it since, e.g. the GL tracer;
+         * the hook then stays, recording nothing */
+        static void uninstall() {
+            if (Pointer == &call) {
+                Pointer = original;
+            }
+        }
+    };
+
+    void finish_capture() {
+        capture.capturing = false;
+        if (!capture.in_range) {
+            write_held();
+        }
+        flush_capture();
+        capture.file.close();
+#define AZ_GL_FUNCTION(name) Hook<glad_##name, fn_##name>::uninstall();
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+        if (!capture.file) {
+            throw std::runtime_error("Error writing GL capture '"s + capture.options.path + "'");
+        }
+    }
+
+    /* Replay */
+
+    enum class Kind : std::uint8_t {
+        none, buffer, texture, program, framebuffer, renderbuffer, vertex_array, sampler, pipeline,
+        transform_feedback, query, location,
+    };
+
+    /* Object arguments by function, from gl_object_args.inc */
+    constexpr auto OBJECT_ARGS = [] {
+        std::array<std::array<Kind, MAX_ARGS>, FUNCTION_COUNT> kinds{};
+#define AZ_GL_OBJECT_ARG(name, index, kind) kinds[fn_##name][index] = Kind::kind;
+#include <gl_object_args.inc>
+#undef AZ_GL_OBJECT_ARG
+        return kinds;
+    }();
+
+    /* Container objects are not shared between contexts */
+    constexpr bool per_context(Kind kind) {
+        return kind == Kind::vertex_array || kind == Kind::framebuffer || kind == Kind::pipeline
+            || kind == Kind::transform_feedback || kind == Kind::query;
+    }
+
+    Kind label_kind(GLenum identifier) {
+        switch (identifier) {
+            case GL_BUFFER: return Kind::buffer;
+            case GL_TEXTURE: return Kind::texture;
+            case GL_SHADER:
+            case GL_PROGRAM: return Kind::program;
+            case GL_FRAMEBUFFER: return Kind::framebuffer;
+            case GL_RENDERBUFFER: return Kind::renderbuffer;
+            case GL_VERTEX_ARRAY: return Kind::vertex_array;
+            case GL_SAMPLER: return Kind::sampler;
+            case GL_PROGRAM_PIPELINE: return Kind::pipeline;
+            case GL_TRANSFORM_FEEDBACK: return Kind::transform_feedback;
+            case GL_QUERY: return Kind::query;
+            default: return Kind::none;
+        }
+    }
+
+    std::uint64_t now_ns() {
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+struct GlReplayState {
+    /* Function indices by the capture's ids */
+    std::unordered_map<std::uint64_t, std::size_t> functions;
+    /* Replayed names by kind, context (for per-context kinds) and captured
+     * name; names not in here replay as themselves */
+    std::unordered_map<std::uint64_t, GLuint> names;
+    std::map<std::pair<GLuint, GLint>, GLint> locations;
+    std::unordered_map<std::uint64_t, GLsync> syncs;
+    std::unordered_map<std::uint64_t, std::uint8_t*> mappings;
+    /* Current program, per thread */
+    std::vector<GLuint> programs;
+    std::size_t thread = 0;
+
+    /* Storage for pointer arguments, per argument: copied data, strings */
+    std::array<std::vector<std::uint64_t>, MAX_ARGS> arg_data;
+    std::array<std::vector<std::string>, MAX_ARGS> arg_strings;
+    std::array<std::vector<const GLchar*>, MAX_ARGS> arg_string_pointers;
+    std::array<std::span<const std::uint8_t>, MAX_ARGS> captured;
+    std::vector<std::uint64_t> scratch;
+
+    const GlReplay* replay = nullptr;
+    std::array<std::uint64_t, FUNCTION_COUNT> calls{};
+    std::array<std::uint64_t, FUNCTION_COUNT> times_ns{};
+    std::array<bool, FUNCTION_COUNT> missing{};
+    std::uint64_t frame_ns = 0;
+    std::uint64_t errors = 0;
+
+    std::uint64_t key(Kind kind, GLuint name) const {
+        std::uint64_t context = per_context(kind) ? this->thread : 0;
+        return std::uint64_t(kind) << 48 | context << 32 | name;
+    }
+
+    GLuint name(Kind kind, GLuint captured) const {
+        if (captured == 0 && kind == Kind::framebuffer && this->thread == 0) {
+            return this->replay->default_framebuffer;
+        }
+        auto name = this->names.find(this->key(kind, captured));
+        return name == this->names.end() ? captured : name->second;
+    }
+
+    GLint location(GLuint program, GLint captured) const {
+        auto location = this->locations.find({program, captured});
+        return location == this->locations.end() ? captured : location->second;
+    }
+
+    GLuint& current_program() {
+        if (this->programs.size() <= this->thread) {
+            this->programs.resize(this->thread + 1);
+        }
+        return this->programs[this->thread];
+    }
+};
+
+namespace {
+    template <typename T>
+    constexpr std::size_t alignment_of() {
+        if constexpr (std::is_void_v<T> || std::is_function_v<T>) {
+            return 1;
+        } else {
+            return alignof(T);
+        }
+    }
+
+    /* Re-issues captured calls of the function glad stored in `Pointer` */
+    template <auto& Pointer, std::size_t Function, typename F = std::remove_reference_t<decltype(Pointer)>>
+    struct Player;
+
+    template <auto& Pointer, std::size_t Function, typename R, typename... Args>
+    struct Player<Pointer, Function, R (APIENTRYP)(Args...)> {
+        static_assert(sizeof...(Args) <= MAX_ARGS);
+
+        /* Index of the program argument, if any, which uniform locations
+         * belong to */
+        static constexpr std::size_t program_arg() {
+            for (std::size_t i = 0; i < sizeof...(Args); ++i) {
+                if (OBJECT_ARGS[Function][i] == Kind::program) {
+                    return i;
+                }
+            }
+            return MAX_ARGS;
+        }
+
+        template <std::size_t N>
+        static auto read_pointer(GlReplayState& state, Reader& in) {
+            using T = ArgType<N, Args...>;
+            using Pointee = std::remove_pointer_t<T>;
+            constexpr Kind kind = OBJECT_ARGS[Function][N];
+            auto as_pointer = [](const void* data) { return reinterpret_cast<T>(const_cast<void*>(data)); };
+
+            switch (in.varint()) {
+                case POINTER_NULL:
+                    return T(nullptr);
+                case POINTER_OFFSET:
+                    return reinterpret_cast<T>(std::uintptr_t(in.varint()));
+                case POINTER_DATA: {
+                    std::span<const std::uint8_t> data = in.blob();
+                    state.captured[N] = data;
+                    bool aligned = reinterpret_cast<std::uintptr_t>(data.data()) % alignment_of<Pointee>() == 0;
+                    if (std::is_const_v<Pointee> && kind == Kind::none && aligned) {
+                        return as_pointer(data.data());
+                    }
+                    /* Written to, remapped or misaligned: a copy */
+                    std::vector<std::uint64_t>& copy = state.arg_data[N];
+                    copy.resize((data.size() + 7) / 8 + 1);
+                    std::memcpy(copy.data(), data.data(), data.size());
+                    if constexpr (std::is_const_v<Pointee> && std::is_same_v<std::remove_cv_t<Pointee>, GLuint>
+                            && kind != Kind::none) {
+                        auto names = reinterpret_cast<GLuint*>(copy.data());
+                        for (std::size_t i = 0; i < data.size() / sizeof(GLuint); ++i) {
+                            names[i] = state.name(kind, names[i]);
+                        }
+                    }
+                    return as_pointer(copy.data());
+                }
+                case POINTER_STRINGS: {
+                    std::vector<std::string>& strings = state.arg_strings[N];
+                    std::vector<const GLchar*>& pointers = state.arg_string_pointers[N];
+                    strings.resize(in.varint());
+                    pointers.clear();
+                    for (std::string& string : strings) {
+                        std::span<const std::uint8_t> data = in.blob();
+                        string.assign(data.begin(), data.end());
+                        pointers.push_back(string.c_str());
+                    }
+                    return as_pointer(pointers.data());
+                }
+                case POINTER_SCRATCH:
+                    return as_pointer(state.scratch.data());
+                default:
+                    throw std::runtime_error("Malformed capture");
+            }
+        }
+
+        template <std::size_t N>
+        static void read_arg(GlReplayState& state, Reader& in, std::tuple<Args...>& args) {
+            using T = ArgType<N, Args...>;
+            constexpr Kind kind = OBJECT_ARGS[Function][N];
+            T& value = std::get<N>(args);
+            if constexpr (std::is_same_v<T, GLsync>) {
+                auto sync = state.syncs.find(in.varint());
+                value = sync == state.syncs.end() ? nullptr : sync->second;
+            } else if constexpr (std::is_pointer_v<T>) {
+                value = read_pointer<N>(state, in);
+            } else {
+                value = read_value<T>(in);
+                if constexpr (kind == Kind::location) {
+                    if constexpr (program_arg() < N) {
+                        value = state.location(std::get<program_arg()>(args), value);
+                    } else {
+                        value = state.location(state.current_program(), value);
+                    }
+                } else if constexpr (kind != Kind::none) {
+                    value = state.name(kind, value);
+                }
+            }
+        }
+
+        /* Names the call generated stand in for the captured ones */
+        template <std::size_t N>
+        static void map_generated(GlReplayState& state, const std::tuple<Args...>& args) {
+            using T = ArgType<N, Args...>;
+            constexpr Kind kind = OBJECT_ARGS[Function][N];
+            if constexpr (kind != Kind::none && kind != Kind::location && std::is_same_v<T, GLuint*>) {
+                std::span<const std::uint8_t> captured = state.captured[N];
+                const GLuint* generated = std::get<N>(args);
+                if (captured.empty() || !generated || generated == static_cast<const void*>(state.scratch.data())) {
+                    return;
+                }
+                for (std::size_t i = 0; i < captured.size() / sizeof(GLuint); ++i) {
+                    GLuint name;
+                    std::memcpy(&name, captured.data() + i * sizeof(GLuint), sizeof name);
+                    state.names[state.key(kind, name)] = generated[i];
+                }
+            }
+        }
+
+        static void play(GlReplayState& state, Reader& in) {
+            std::tuple<Args...> args;
+            state.captured = {};
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                (read_arg<I>(state, in, args), ...);
+            }(std::index_sequence_for<Args...>{});
+            if constexpr (Function == fn_glObjectLabel) {
+                Kind kind = label_kind(std::get<0>(args));
+                std::get<1>(args) = kind == Kind::none ? std::get<1>(args) : state.name(kind, std::get<1>(args));
+            }
+
+            if (!Pointer) {
+                if (!state.missing[Function]) {
+                    std::cerr << gl_function_name(Function) << " is not available, calls skipped\n";
+                    state.missing[Function] = true;
+                }
+                return;
+            }
+
+            std::uint64_t start_ns = now_ns();
+            if constexpr (std::is_void_v<R>) {
+                std::apply(Pointer, args);
+                state.times_ns[Function] += now_ns() - start_ns;
+            } else {
+                R result = std::apply(Pointer, args);
+                state.times_ns[Function] += now_ns() - start_ns;
+
+                R captured = read_value<R>(in);
+                if constexpr (Function == fn_glCreateShader || Function == fn_glCreateProgram
+                        || Function == fn_glCreateShaderProgramv) {
+                    state.names[state.key(Kind::program, captured)] = result;
+                } else if constexpr (Function == fn_glFenceSync) {
+                    state.syncs[reinterpret_cast<std::uintptr_t>(captured)] = result;
+                } else if constexpr (Function == fn_glMapBuffer || Function == fn_glMapBufferRange) {
+                    state.mappings[reinterpret_cast<std::uintptr_t>(captured)] = static_cast<std::uint8_t*>(result);
+                } else if constexpr (Function == fn_glGetUniformLocation) {
+                    state.locations[{std::get<0>(args), captured}] = result;
+                }
+            }
+            ++state.calls[Function];
+
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                (map_generated<I>(state, args), ...);
+            }(std::index_sequence_for<Args...>{});
+            if constexpr (Function == fn_glUseProgram) {
+                state.current_program() = std::get<0>(args);
+            }
+            if (state.replay->check_errors) {
+                for (GLenum error; (error = glad_glGetError()) != GL_NO_ERROR;) {
+                    ++state.errors;
+                    std::cerr << "GL error 0x" << std::hex << error << std::dec << " replaying "
+                              << gl_function_name(Function) << '\n';
+                }
+            }
+        }
+    };
+
+    using PlayFunction = void (*)(GlReplayState& state, Reader& in);
+
+    const PlayFunction PLAYERS[FUNCTION_COUNT] = {
+#define AZ_GL_FUNCTION(name) &Player<glad_##name, fn_##name>::play,
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+    };
+
+    /* Replays the records in [begin, end) of the capture */
+    void play(GlReplayState& state, const GlReplay& replay, const std::uint8_t* begin, const std::uint8_t* end) {
+        Reader in{begin, end};
+        while (in.at != in.end) {
+            switch (in.varint()) {
+                case RECORD_FUNCTION:
+                    in.varint();
+                    in.blob();
+                    break;
+                case RECORD_CALL: {
+                    auto function = state.functions.find(in.varint());
+                    std::span<const std::uint8_t> payload = in.blob();
+                    if (function != state.functions.end()) {
+                        Reader call{payload.data(), payload.data() + payload.size()};
+                        PLAYERS[function->second](state, call);
+                    }
+                    break;
+                }
+                case RECORD_THREAD: {
+                    std::size_t thread = in.varint();
+                    if (thread != state.thread) {
+                        if (!replay.make_current) {
+                            throw std::runtime_error("Capture of several threads, and no make_current");
+                        }
+                        replay.make_current(thread);
+                        state.thread = thread;
+                    }
+                    break;
+                }
+                case RECORD_MAPPED: {
+                    auto mapping = state.mappings.find(in.varint());
+                    std::size_t offset = in.varint();
+                    std::span<const std::uint8_t> data = in.blob();
+                    if (mapping != state.mappings.end() && mapping->second) {
+                        std::memcpy(mapping->second + offset, data.data(), data.size());
+                    }
+                    break;
+                }
+                case RECORD_BEGIN:
+                case RECORD_FRAME:
+                    break;
+                default:
+                    throw std::runtime_error("Malformed capture");
+            }
+        }
+    }
+}
+
+void start_gl_capture(const GlCaptureOptions& options) {
+    std::lock_guard lock{capture.mutex};
+    if (capture.capturing) {
+        throw std::runtime_error("A GL capture is running already");
+    }
+    capture.file = std::ofstream{options.path, std::ios::binary};
+    if (!capture.file) {
+        throw std::runtime_error("Error creating GL capture '"s + options.path + "'");
+    }
+    capture.options = options;
+    capture.frame = 0;
+    capture.declared = {};
+    capture.threads = 0;
+    capture.current_thread = SIZE_MAX;
+    capture.mappings.clear();
+    capture.held.clear();
+    ++capture.id;
+
+    get_integer = glad_glGetIntegerv;
+    get_buffer_parameter = glad_glGetBufferParameteri64v;
+    GLint viewport[4] = {};
+    get_integer(GL_VIEWPORT, viewport);
+
+    capture.out.raw(CAPTURE_MAGIC, sizeof CAPTURE_MAGIC);
+    capture.out.varint(CAPTURE_VERSION);
+    capture.out.varint(std::uint64_t(viewport[2]));
+    capture.out.varint(std::uint64_t(viewport[3]));
+    capture.in_range = options.first_frame == 0;
+    if (capture.in_range) {
+        capture.out.varint(RECORD_BEGIN);
+    }
+
+#define AZ_GL_FUNCTION(name) Hook<glad_##name, fn_##name>::install();
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+    capture.capturing = options.frames > 0;
+}
+
+void gl_capture_end_frame() {
+    std::lock_guard lock{capture.mutex};
+    if (!capture.capturing) {
+        return;
+    }
+    ++capture.frame;
+    if (capture.in_range) {
+        capture.out.varint(RECORD_FRAME);
+        if (capture.frame >= capture.options.first_frame + capture.options.frames) {
+            finish_capture();
+        }
+    } else if (capture.frame == capture.options.first_frame) {
+        write_held();
+        capture.out.varint(RECORD_BEGIN);
+        capture.in_range = true;
+    }
+}
+
+void stop_gl_capture() {
+    std::lock_guard lock{capture.mutex};
+    if (capture.capturing) {
+        finish_capture();
+    }
+}
+
+bool gl_capture_active() {
+    std::lock_guard lock{capture.mutex};
+    return capture.capturing;
+}
+
+GlReplay::GlReplay(const std::string& path) : state{std::make_unique<GlReplayState>()} {
+    std::ifstream file{path, std::ios::binary};
+    if (!file) {
+        throw std::runtime_error("Error opening GL capture '"s + path + "'");
+    }
+    this->data.assign(std::istreambuf_iterator<char>(file), {});
+    if (this->data.size() < sizeof CAPTURE_MAGIC
+            || std::memcmp(this->data.data(), CAPTURE_MAGIC, sizeof CAPTURE_MAGIC) != 0) {
+        throw std::runtime_error("Not a GL capture: '"s + path + "'");
+    }
+
+    std::unordered_map<std::string_view, std::size_t> indices;
+    for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+        indices[gl_function_name(i)] = i;
+    }
+
+    try {
+        Reader in{this->data.data() + sizeof CAPTURE_MAGIC, this->data.data() + this->data.size()};
+        if (in.varint() != CAPTURE_VERSION) {
+            throw std::runtime_error("Unsupported version");
+        }
+        this->width = int(in.varint());
+        this->height = int(in.varint());
+        this->calls_start = std::size_t(in.at - this->data.data());
+
+        /* Without a BEGIN record, everything is set-up */
+        bool begun = false;
+        while (in.at != in.end) {
+            std::uint64_t type = in.varint();
+            if (type == RECORD_FUNCTION) {
+                std::uint64_t id = in.varint();
+                std::span<const std::uint8_t> name = in.blob();
+                auto index = indices.find({reinterpret_cast<const char*>(name.data()), name.size()});
+                if (index != indices.end()) {
+                    this->state->functions[id] = index->second;
+                } else {
+                    std::cerr << "Unknown GL function " << std::string_view{reinterpret_cast<const char*>(name.data()),
+                                 name.size()} << " in capture, calls skipped\n";
+                }
+            } else if (type == RECORD_CALL) {
+                in.varint();
+                in.blob();
+            } else if (type == RECORD_THREAD) {
+                this->threads = std::max(this->threads, std::size_t(in.varint()) + 1);
+            } else if (type == RECORD_MAPPED) {
+                in.varint();
+                in.varint();
+                in.blob();
+            } else if (type == RECORD_BEGIN) {
+                begun = true;
+                this->frame_ends.push_back(std::size_t(in.at - this->data.data()));
+            } else if (type == RECORD_FRAME) {
+                this->frame_ends.push_back(std::size_t(in.at - this->data.data()));
+            } else {
+                throw std::runtime_error("Unknown record");
+            }
+        }
+        if (!begun) {
+            this->frame_ends.assign(1, this->data.size());
+        }
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error("Error reading GL capture '"s + path + "': " + e.what());
+    }
+    this->frames = this->frame_ends.size() - 1;
+
+    /* Room for what any call may write to memory it was given */
+    this->state->scratch.resize(std::max<std::size_t>(std::size_t(this->width) * this->height * 2, 1 << 21));
+    this->state->replay = this;
+}
+
+GlReplay::~GlReplay() = default;
+
+void GlReplay::set_up() {
+    play(*this->state, *this, this->data.data() + this->calls_start, this->data.data() + this->frame_ends[0]);
+}
+
+GlReplayStats GlReplay::play_frames() {
+    GlReplayState& state = *this->state;
+    state.calls = {};
+    state.times_ns = {};
+    state.errors = 0;
+
+    GlReplayStats stats;
+    for (std::size_t frame = 0; frame < this->frames; ++frame) {
+        std::uint64_t before_ns = 0;
+        for (std::uint64_t time_ns : state.times_ns) {
+            before_ns += time_ns;
+        }
+        play(state, *this, this->data.data() + this->frame_ends[frame], this->data.data() + this->frame_ends[frame + 1]);
+        std::uint64_t after_ns = 0;
+        for (std::uint64_t time_ns : state.times_ns) {
+            after_ns += time_ns;
+        }
+        stats.frame_ms.push_back(double(after_ns - before_ns) / 1e6);
+    }
+
+    for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+        if (state.calls[i] > 0) {
+            stats.functions.push_back({gl_function_name(i), state.calls[i], state.times_ns[i]});
+            stats.calls += state.calls[i];
+        }
+    }
+    std::sort(stats.functions.begin(), stats.functions.end(), [](const auto& a, const auto& b) {
+        return a.time_ns > b.time_ns;
+    });
+    stats.errors = state.errors;
+    return stats;
+}
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <gl_debug.hpp>
+#include <gl_ext.hpp>
+#include <profiler.hpp>
+
+using namespace std::string_literals;
+
+namespace {
+    struct Message {
+        GlDebugMessageStats stats;
+        /* Event name in traces; stays put, as map nodes do */
+        std::string trace_name;
+    };
+
+    /* Messages about the same thing share source, type, id and text but for
+     * the numbers in it (object names, sizes); ids alone do not tell, as
+     * some drivers (Mesa) give all API errors the same one */
+    using MessageKey = std::tuple<GLenum, GLenum, GLuint, std::string>;
+
+    std::atomic<bool> installed{false};
+    std::once_flag set_up;
+    /* Whether the first install_gl_debug() found debug output */
+    bool available = false;
+    GlDebugOptions options;
+    GLint max_label_length = 256;
+
+    std::mutex mutex;
+    std::map<MessageKey, Message> messages;
+
+    /* Debug groups open on the calling thread, outermost first */
+    thread_local std::vector<const char*> open_groups;
+
+    const char* severity_name(GLenum severity) {
+        switch (severity) {
+            case GL_DEBUG_SEVERITY_HIGH: return "high";
+            case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+            case GL_DEBUG_SEVERITY_LOW: return "low";
+            default: return "notification";
+        }
+    }
+
+    bool mentions(std::string_view text, std::initializer_list<std::string_view> words) {
+        return std::any_of(words.begin(), words.end(), [&](std::string_view word) {
+            return text.find(word) != std::string_view::npos;
+        });
+    }
+
+    GlDebugCategory classify(GLenum source, GLenum type, std::string_view text) {
+        if (source == GL_DEBUG_SOURCE_SHADER_COMPILER) {
+            return GlDebugCategory::shader_compiler;
+        }
+        switch (type) {
+            case GL_DEBUG_TYPE_ERROR: return GlDebugCategory::error;
+            case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return GlDebugCategory::undefined_behavior;
+            case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return GlDebugCategory::deprecated;
+            case GL_DEBUG_TYPE_PORTABILITY: return GlDebugCategory::portability;
+            case GL_DEBUG_TYPE_PERFORMANCE: break;
+            default: return GlDebugCategory::info;
+        }
+
+        /* Performance warnings have no finer types; their wording is what
+         * the drivers have in common */
+        std::string lower{text};
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (mentions(lower, {"recompil", "shader variant"})) {
+            return GlDebugCategory::shader_recompile;
+        }
+        if (mentions(lower, {"convert", "conversion", "swizzl", "slow path", "pixel transfer"})) {
+            return GlDebugCategory::format_conversion;
+        }
+        if (mentions(lower, {"stall", "sync", "wait", "busy", "in use", "flush"})) {
+            return GlDebugCategory::implicit_sync;
+        }
+        return GlDebugCategory::performance;
+    }
+
+    /* Where on the calling thread the message came from */
+    std::string message_context() {
+        std::string context;
+        for (const char* group : open_groups) {
+            context += context.empty() ? "" : " > ";
+            context += group;
+        }
+#ifdef AZ_PROFILE
+        if (profile_open_zone) {
+            context += context.empty() ? "zone " : ", zone ";
+            context += profile_open_zone->name;
+        }
+#endif
+        return context;
+    }
+
+    /* The text with each run of digits replaced by '#' */
+    std::string without_numbers(std::string_view text) {
+        std::string pattern;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            if (std::isdigit(static_cast<unsigned char>(text[i]))) {
+                if (pattern.empty() || pattern.back() != '#') {
+                    pattern += '#';
+                }
+            } else {
+                pattern += text[i];
+            }
+        }
+        return pattern;
+    }
+
+    /* Logged the first time and at every power of ten */
+    bool worth_logging(std::uint64_t count) {
+        while (count % 10 == 0) {
+            count /= 10;
+        }
+        return count == 1;
+    }
+
+    void APIENTRY on_message(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                             const GLchar* message, const void*) {
+        /* Our own groups, echoed back */
+        if (type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP) {
+            return;
+        }
+        std::string_view text = length >= 0 ? std::string_view{message, std::size_t(length)} : message;
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+            text.remove_suffix(1);
+        }
+        std::string context = message_context();
+
+        std::lock_guard lock{mutex};
+        auto [entry, inserted] = messages.try_emplace({source, type, id, without_numbers(text)});
+        Message& stored = entry->second;
+        if (inserted) {
+            GlDebugCategory category = classify(source, type, text);
+            stored.stats = {category, source, type, id, severity, std::string{text}, context, 0};
+            stored.trace_name = "GL "s + gl_debug_category_name(category) + ": " + std::string{text};
+        }
+        std::uint64_t count = ++stored.stats.count;
+        AZ_PROFILE_INSTANT(stored.trace_name.c_str());
+
+        if ((severity != GL_DEBUG_SEVERITY_NOTIFICATION || options.log_notifications) && worth_logging(count)) {
+            std::cerr << "GL " << gl_debug_category_name(stored.stats.category) << " (" << severity_name(severity)
+                      << ")";
+            if (!context.empty()) {
+                std::cerr << " in " << context;
+            }
+            std::cerr << ": " << text;
+            if (count > 1) {
+                std::cerr << " [" << count << " times]";
+            }
+            std::cerr << '\n';
+        }
+    }
+
+    template <typename F>
+    void load(F& pointer, void* (*get_proc_address)(const char*), const char* name) {
+        if (!pointer) {
+            pointer = reinterpret_cast<F>(get_proc_address(name));
+        }
+    }
+
+    bool load_debug_functions(void* (*get_proc_address)(const char* name)) {
+        /* Core in 4.3; the same entry points, unsuffixed, with KHR_debug */
+        if (!GLAD_GL_VERSION_4_3) {
+            if (!has_gl_extension("GL_KHR_debug")) {
+                return false;
+            }
+            load(glad_glDebugMessageControl, get_proc_address, "glDebugMessageControl");
+            load(glad_glDebugMessageInsert, get_proc_address, "glDebugMessageInsert");
+            load(glad_glDebugMessageCallback, get_proc_address, "glDebugMessageCallback");
+            load(glad_glGetDebugMessageLog, get_proc_address, "glGetDebugMessageLog");
+            load(glad_glPushDebugGroup, get_proc_address, "glPushDebugGroup");
+            load(glad_glPopDebugGroup, get_proc_address, "glPopDebugGroup");
+            load(glad_glObjectLabel, get_proc_address, "glObjectLabel");
+            load(glad_glGetObjectLabel, get_proc_address, "glGetObjectLabel");
+            load(glad_glObjectPtrLabel, get_proc_address, "glObjectPtrLabel");
+            load(glad_glGetObjectPtrLabel, get_proc_address, "glGetObjectPtrLabel");
+        }
+        return glDebugMessageCallback && glDebugMessageControl && glPushDebugGroup && glPopDebugGroup
+            && glObjectLabel;
+    }
+}
+
+const char* gl_debug_category_name(GlDebugCategory category) {
+    switch (category) {
+        case GlDebugCategory::error: return "error";
+        case GlDebugCategory::undefined_behavior: return "undefined behavior";
+        case GlDebugCategory::implicit_sync: return "implicit sync";
+        case GlDebugCategory::shader_recompile: return "shader recompile";
+        case GlDebugCategory::format_conversion: return "format conversion";
+        case GlDebugCategory::performance: return "performance";
+        case GlDebugCategory::deprecated: return "deprecated";
+        case GlDebugCategory::portability: return "portability";
+        case GlDebugCategory::shader_compiler: return "shader compiler";
+        case GlDebugCategory::info: return "info";
+    }
+    return "unknown";
+}
+
+bool install_gl_debug(void* (*get_proc_address)(const char* name), const GlDebugOptions& new_options) {
+    /* The entry points, options and label limit are the process's: set by
+     * the first call only, as later ones (the upload thread's context) would
+     * race with the callback reading them */
+    std::call_once(set_up, [&] {
+        available = load_debug_functions(get_proc_address);
+        if (available) {
+            options = new_options;
+            glGetIntegerv(GL_MAX_LABEL_LENGTH, &max_label_length);
+        }
+    });
+    if (!available) {
+        return false;
+    }
+
+    glDebugMessageCallback(on_message, nullptr);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+    glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+    glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+    glEnable(GL_DEBUG_OUTPUT);
+    if (options.synchronous) {
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    } else {
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+    installed = true;
+    return true;
+}
+
+bool gl_debug_installed() {
+    return installed;
+}
+
+std::vector<GlDebugMessageStats> gl_debug_messages() {
+    std::vector<GlDebugMessageStats> stats;
+    {
+        std::lock_guard lock{mutex};
+        for (const auto& [key, message] : messages) {
+            stats.push_back(message.stats);
+        }
+    }
+    std::stable_sort(stats.begin(), stats.end(), [](const auto& a, const auto& b) {
+        return a.count > b.count;
+    });
+    return stats;
+}
+
+void print_gl_debug_summary(std::ostream& out, std::size_t top) {
+    std::vector<GlDebugMessageStats> stats = gl_debug_messages();
+    std::map<GlDebugCategory, std::uint64_t> counts;
+    for (const GlDebugMessageStats& message : stats) {
+        counts[message.category] += message.count;
+    }
+    out << "GL debug messages:";
+    if (counts.empty()) {
+        out << " none";
+    }
+    const char* separator = " ";
+    for (const auto& [category, count] : counts) {
+        out << separator << count << ' ' << gl_debug_category_name(category);
+        separator = ", ";
+    }
+    out << '\n';
+    for (std::size_t i = 0; i < std::min(top, stats.size()); ++i) {
+        const GlDebugMessageStats& message = stats[i];
+        out << "  " << message.count << "x " << gl_debug_category_name(message.category) << " ("
+            << severity_name(message.severity) << "): " << message.text;
+        if (!message.context.empty()) {
+            out << " [in " << message.context << ']';
+        }
+        out << '\n';
+    }
+}
+
+void gl_object_label(unsigned int identifier, unsigned int name, std::string_view label) {
+    if (!installed || !name) {
+        return;
+    }
+    std::size_t length = std::min(label.size(), std::size_t(std::max(max_label_length - 1, 0)));
+    glObjectLabel(identifier, name, GLsizei(length), label.data());
+}
+
+GlDebugGroup::GlDebugGroup(const char* name) : pushed{installed} {
+    if (this->pushed) {
+        glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+        open_groups.push_back(name);
+    }
+}
+
+GlDebugGroup::~GlDebugGroup() {
+    if (this->pushed) {
+        open_groups.pop_back();
+        glPopDebugGroup();
+    }
+}
@@ -0,0 +1,36 @@
+#include <string>
+#include <unordered_set>
+
+#include <glad/glad.h>
+
+#include <gl_ext.hpp>
+
+namespace {
+    std::unordered_set<std::string> extensions;
+    bool extensions_loaded = false;
+
+    void load_extensions() {
+        /* Core profiles only support the indexed query */
+        GLint n_extensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &n_extensions);
+        for (GLint i = 0; i < n_extensions; ++i) {
+            auto name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (name) {
+                extensions.insert(name);
+            }
+        }
+        extensions_loaded = true;
+    }
+}
+
+bool has_gl_extension(std::string_view name) {
+    if (!extensions_loaded) {
+        load_extensions();
+    }
+    return extensions.contains(std::string{name});
+}
+
+void reset_gl_extensions() {
+    extensions.clear();
+    extensions_loaded = false;
+}
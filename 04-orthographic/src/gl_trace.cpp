@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include <glad/glad.h>
+
+#include <gl_trace.hpp>
+
+namespace {
+    enum : std::size_t {
+#define AZ_GL_FUNCTION(name) fn_##name,
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+        FUNCTION_COUNT
+    };
+
+    const char* const FUNCTION_NAMES[FUNCTION_COUNT] = {
+#define AZ_GL_FUNCTION(name) #name,
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+    };
+
+    /* Calls changing pipeline state, by name prefix */
+    const std::string_view STATE_PREFIXES[] = {
+        "glBind", "glEnable", "glDisable", "glUseProgram", "glActiveTexture", "glBlend", "glDepthFunc",
+        "glDepthMask", "glDepthRange", "glStencil", "glColorMask", "glCullFace", "glFrontFace",
+        "glPolygonMode", "glPolygonOffset", "glViewport", "glScissor", "glLineWidth", "glPointSize",
+        "glClearColor", "glClearDepth", "glClearStencil", "glPixelStore", "glSampleCoverage",
+        "glSampleMask", "glPrimitiveRestartIndex", "glProvokingVertex", "glLogicOp", "glDrawBuffer",
+        "glReadBuffer",
+    };
+
+    const auto is_state_change = [] {
+        std::array<bool, FUNCTION_COUNT> state{};
+        for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+            std::string_view name = FUNCTION_NAMES[i];
+            /* glBindAttribLocation and the like are about linking */
+            state[i] = !name.ends_with("Location") && std::any_of(std::begin(STATE_PREFIXES),
+                    std::end(STATE_PREFIXES), [&](std::string_view prefix) { return name.starts_with(prefix); });
+        }
+        return state;
+    }();
+
+    GlTraceOptions options;
+    bool installed = false;
+    PFNGLGETERRORPROC get_error = nullptr;
+
+    std::array<std::atomic<std::uint64_t>, FUNCTION_COUNT> calls{};
+    std::array<std::atomic<std::uint64_t>, FUNCTION_COUNT> times_ns{};
+    std::atomic<std::uint64_t> draw_calls{0};
+    std::atomic<std::uint64_t> primitives{0};
+    std::atomic<std::uint64_t> buffer_bytes{0};
+    std::atomic<std::uint64_t> texture_bytes{0};
+    std::atomic<std::uint64_t> errors{0};
+
+    /* Texel data comes from a buffer rather than client memory while one is
+     * bound here; `pixels` is an offset then, possibly 0 */
+    thread_local GLuint unpack_buffer = 0;
+
+    std::uint64_t now_ns() {
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    std::uint64_t primitive_count(GLenum mode, std::uint64_t vertices) {
+        switch (mode) {
+            case GL_POINTS: return vertices;
+            case GL_LINES: return vertices / 2;
+            case GL_LINE_STRIP: return vertices > 0 ? vertices - 1 : 0;
+            case GL_LINE_LOOP: return vertices > 1 ? vertices : 0;
+            case GL_TRIANGLES: return vertices / 3;
+            case GL_TRIANGLE_STRIP:
+            case GL_TRIANGLE_FAN: return vertices > 2 ? vertices - 2 : 0;
+            case GL_LINES_ADJACENCY: return vertices / 4;
+            case GL_TRIANGLES_ADJACENCY: return vertices / 6;
+            default: return 0;
+        }
+    }
+
+    void draw(GLenum mode, GLsizei count, GLsizei instances = 1) {
+        draw_calls.fetch_add(1, std::memory_order_relaxed);
+        primitives.fetch_add(primitive_count(mode, std::uint64_t(std::max(count, 0)))
+                * std::uint64_t(std::max(instances, 0)), std::memory_order_relaxed);
+    }
+
+    void multi_draw(GLenum mode, const GLsizei* counts, GLsizei draws) {
+        for (GLsizei i = 0; counts && i < draws; ++i) {
+            draw(mode, counts[i]);
+        }
+    }
+
+    void texels(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+        if (pixels || unpack_buffer) {
+            texture_bytes.fetch_add(std::uint64_t(std::max(width, 0)) * std::max(height, 0) * std::max(depth, 0)
+                    * gl_pixel_bytes(format, type), std::memory_order_relaxed);
+        }
+    }
+
+    void compressed_texels(GLsizei size, const void* data) {
+        if (data || unpack_buffer) {
+            texture_bytes.fetch_add(std::uint64_t(std::max(size, 0)), std::memory_order_relaxed);
+        }
+    }
+
+    void buffer_data(GLsizeiptr size, const void* data) {
+        if (data) {
+            buffer_bytes.fetch_add(std::uint64_t(std::max<GLsizeiptr>(size, 0)), std::memory_order_relaxed);
+        }
+    }
+
+    void mapped_range(GLsizeiptr length, GLbitfield access) {
+        if (access & GL_MAP_WRITE_BIT) {
+            buffer_bytes.fetch_add(std::uint64_t(std::max<GLsizeiptr>(length, 0)), std::memory_order_relaxed);
+        }
+    }
+
+    template <std::size_t N, typename... Args>
+    auto arg(const Args&... args) {
+        return std::get<N>(std::tie(args...));
+    }
+
+    /* What the arguments of a call say about its cost */
+    template <std::size_t Function, typename... Args>
+    void account(const Args&... args) {
+        if constexpr (Function == fn_glDrawArrays) {
+            draw(arg<0>(args...), arg<2>(args...));
+        } else if constexpr (Function == fn_glDrawArraysInstanced) {
+            draw(arg<0>(args...), arg<2>(args...), arg<3>(args...));
+        } else if constexpr (Function == fn_glDrawElements || Function == fn_glDrawElementsBaseVertex) {
+            draw(arg<0>(args...), arg<1>(args...));
+        } else if constexpr (Function == fn_glDrawElementsInstanced
+                || Function == fn_glDrawElementsInstancedBaseVertex) {
+            draw(arg<0>(args...), arg<1>(args...), arg<4>(args...));
+        } else if constexpr (Function == fn_glDrawRangeElements || Function == fn_glDrawRangeElementsBaseVertex) {
+            draw(arg<0>(args...), arg<3>(args...));
+        } else if constexpr (Function == fn_glMultiDrawArrays) {
+            multi_draw(arg<0>(args...), arg<2>(args...), arg<3>(args...));
+        } else if constexpr (Function == fn_glMultiDrawElements || Function == fn_glMultiDrawElementsBaseVertex) {
+            multi_draw(arg<0>(args...), arg<1>(args...), arg<4>(args...));
+        } else if constexpr (Function == fn_glBindBuffer) {
+            if (arg<0>(args...) == GL_PIXEL_UNPACK_BUFFER) {
+                unpack_buffer = arg<1>(args...);
+            }
+        } else if constexpr (Function == fn_glBufferData) {
+            buffer_data(arg<1>(args...), arg<2>(args...));
+        } else if constexpr (Function == fn_glBufferSubData) {
+            buffer_data(arg<2>(args...), arg<3>(args...));
+        } else if constexpr (Function == fn_glMapBufferRange) {
+            mapped_range(arg<2>(args...), arg<3>(args...));
+        } else if constexpr (Function == fn_glTexImage1D) {
+            texels(arg<3>(args...), 1, 1, arg<5>(args...), arg<6>(args...), arg<7>(args...));
+        } else if constexpr (Function == fn_glTexImage2D) {
+            texels(arg<3>(args...), arg<4>(args...), 1, arg<6>(args...), arg<7>(args...), arg<8>(args...));
+        } else if constexpr (Function == fn_glTexImage3D) {
+            texels(arg<3>(args...), arg<4>(args...), arg<5>(args...), arg<7>(args...), arg<8>(args...),
+                   arg<9>(args...));
+        } else if constexpr (Function == fn_glTexSubImage1D) {
+            texels(arg<3>(args...), 1, 1, arg<4>(args...), arg<5>(args...), arg<6>(args...));
+        } else if constexpr (Function == fn_glTexSubImage2D) {
+            texels(arg<4>(args...), arg<5>(args...), 1, arg<6>(args...), arg<7>(args...), arg<8>(args...));
+        } else if constexpr (Function == fn_glTexSubImage3D) {
+            texels(arg<5>(args...), arg<6>(args...), arg<7>(args...), arg<8>(args...), arg<9>(args...),
+                   arg<10>(args...));
+        } else if constexpr (Function == fn_glCompressedTexImage1D || Function == fn_glCompressedTexSubImage1D) {
+            compressed_texels(arg<5>(args...), arg<6>(args...));
+        } else if constexpr (Function == fn_glCompressedTexImage2D) {
+            compressed_texels(arg<6>(args...), arg<7>(args...));
+        } else if constexpr (Function == fn_glCompressedTexSubImage2D) {
+            compressed_texels(arg<7>(args...), arg<8>(args...));
+        } else if constexpr (Function == fn_glCompressedTexImage3D) {
+            compressed_texels(arg<7>(args...), arg<8>(args...));
+        } else if constexpr (Function == fn_glCompressedTexSubImage3D) {
+            compressed_texels(arg<9>(args...), arg<10>(args...));
+        }
+    }
+
+    void check_errors(std::size_t function) {
+        for (GLenum error; (error = get_error()) != GL_NO_ERROR;) {
+            errors.fetch_add(1, std::memory_order_relaxed);
+            char code[16];
+            std::snprintf(code, sizeof code, "0x%04x", error);
+            std::cerr << "GL error " << code << " in " << FUNCTION_NAMES[function] << '\n';
+        }
+    }
+
+    /* What every call does around the original, the same for all of them;
+     * kept out of the hooks, which there is one of per function */
+    std::uint64_t begin_call(std::size_t function) {
+        std::uint64_t start_ns = options.timing ? now_ns() : 0;
+        if (options.before) {
+            options.before(function);
+        }
+        return start_ns;
+    }
+
+    void end_call(std::size_t function, std::uint64_t start_ns) {
+        if (options.timing) {
+            times_ns[function].fetch_add(now_ns() - start_ns, std::memory_order_relaxed);
+        }
+        calls[function].fetch_add(1, std::memory_order_relaxed);
+        if (options.check_errors && function != fn_glGetError) {
+            check_errors(function);
+        }
+        if (options.after) {
+            options.after(function);
+        }
+    }
+
+    /* Stands in for the function glad stored in `Pointer` */
+    template <auto& Pointer, std::size_t Function, typename F = std::remove_reference_t<decltype(Pointer)>>
+    struct Hook;
+
+    template <auto& Pointer, std::size_t Function, typename R, typename... Args>
+    struct Hook<Pointer, Function, R (APIENTRYP)(Args...)> {
+        static inline R (APIENTRYP original)(Args...) = nullptr;
+
+        static R APIENTRY call(Args... args) {
+            std::uint64_t start_ns = begin_call(Function);
+            account<Function>(args...);
+            if constexpr (std::is_void_v<R>) {
+                original(args...);
+                end_call(Function, start_ns);
+            } else {
+                R result = original(args...);
+                end_call(Function, start_ns);
+                return result;
+            }
+        }
+
+        static void install() {
+            original = Pointer;
+            if (Pointer) {
+                Pointer = &call;
+            }
+        }
+
+        static void uninstall() {
+            Pointer = original;
+        }
+    };
+}
+
+void install_gl_trace(const GlTraceOptions& trace_options) {
+    options = trace_options;
+    if (installed) {
+        return;
+    }
+    get_error = glad_glGetError;
+#define AZ_GL_FUNCTION(name) Hook<glad_##name, fn_##name>::install();
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+    installed = true;
+}
+
+void uninstall_gl_trace() {
+    if (!installed) {
+        return;
+    }
+#define AZ_GL_FUNCTION(name) Hook<glad_##name, fn_##name>::uninstall();
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+    installed = false;
+}
+
+bool gl_trace_installed() {
+    return installed;
+}
+
+std::uint64_t gl_pixel_bytes(unsigned int format, unsigned int type) {
+    switch (type) {
+        case GL_UNSIGNED_BYTE_3_3_2:
+        case GL_UNSIGNED_BYTE_2_3_3_REV:
+            return 1;
+        case GL_UNSIGNED_SHORT_5_6_5:
+        case GL_UNSIGNED_SHORT_5_6_5_REV:
+        case GL_UNSIGNED_SHORT_4_4_4_4:
+        case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+        case GL_UNSIGNED_SHORT_5_5_5_1:
+        case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+            return 2;
+        case GL_UNSIGNED_INT_8_8_8_8:
+        case GL_UNSIGNED_INT_8_8_8_8_REV:
+        case GL_UNSIGNED_INT_10_10_10_2:
+        case GL_UNSIGNED_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_24_8:
+        case GL_UNSIGNED_INT_10F_11F_11F_REV:
+        case GL_UNSIGNED_INT_5_9_9_9_REV:
+            return 4;
+        case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+            return 8;
+    }
+    std::uint64_t components;
+    switch (format) {
+        case GL_RG:
+        case GL_RG_INTEGER:
+        case GL_DEPTH_STENCIL:
+        case GL_LUMINANCE_ALPHA:
+            components = 2;
+            break;
+        case GL_RGB:
+        case GL_BGR:
+        case GL_RGB_INTEGER:
+        case GL_BGR_INTEGER:
+            components = 3;
+            break;
+        case GL_RGBA:
+        case GL_BGRA:
+        case GL_RGBA_INTEGER:
+        case GL_BGRA_INTEGER:
+            components = 4;
+            break;
+        default:
+            components = 1;
+    }
+    switch (type) {
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return components * 2;
+        case GL_INT:
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT:
+            return components * 4;
+        default:
+            return components;
+    }
+}
+
+const char* gl_function_name(std::size_t function) {
+    return function < FUNCTION_COUNT ? FUNCTION_NAMES[function] : "unknown";
+}
+
+GlFrameStats gl_trace_end_frame() {
+    GlFrameStats stats;
+    for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+        std::uint64_t function_calls = calls[i].exchange(0, std::memory_order_relaxed);
+        if (function_calls == 0) {
+            continue;
+        }
+        std::uint64_t time_ns = times_ns[i].exchange(0, std::memory_order_relaxed);
+        stats.functions.push_back({FUNCTION_NAMES[i], function_calls, time_ns});
+        stats.calls += function_calls;
+        stats.time_ns += time_ns;
+        if (is_state_change[i]) {
+            stats.state_changes += function_calls;
+        }
+    }
+    std::sort(stats.functions.begin(), stats.functions.end(), [](const auto& a, const auto& b) {
+        return a.time_ns != b.time_ns ? a.time_ns > b.time_ns : a.calls > b.calls;
+    });
+    stats.draw_calls = draw_calls.exchange(0, std::memory_order_relaxed);
+    stats.primitives = primitives.exchange(0, std::memory_order_relaxed);
+    stats.buffer_bytes = buffer_bytes.exchange(0, std::memory_order_relaxed);
+    stats.texture_bytes = texture_bytes.exchange(0, std::memory_order_relaxed);
+    stats.errors = errors.exchange(0, std::memory_order_relaxed);
+    return stats;
+}
+
+void print_gl_frame_stats(std::ostream& out, const GlFrameStats& stats, std::size_t top) {
+    char line[256];
+    std::snprintf(line, sizeof line, "GL: %llu calls (%.3f ms), %llu draws, %llu primitives, %llu state changes, "
+            "%llu buffer bytes, %llu texture bytes, %llu errors\n",
+            (unsigned long long)stats.calls, stats.time_ns / 1e6, (unsigned long long)stats.draw_calls,
+            (unsigned long long)stats.primitives, (unsigned long long)stats.state_changes,
+            (unsigned long long)stats.buffer_bytes, (unsigned long long)stats.texture_bytes,
+            (unsigned long long)stats.errors);
+    out << line;
+    for (std::size_t i = 0; i < std::min(top, stats.functions.size()); ++i) {
+        const GlFunctionStats& function = stats.functions[i];
+        std::snprintf(line, sizeof line, "    %-32s %8llu calls %10.3f ms\n", function.name,
+                (unsigned long long)function.calls, function.time_ns / 1e6);
+        out << line;
+    }
+}
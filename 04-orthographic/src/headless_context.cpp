@@ -0,0 +1,209 @@
+#include <cstring>
+#include <stdexcept>
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <headless_context.hpp>
+#include <memory_accounting.hpp>
+
+namespace {
+    bool has_extension(const char* extensions, const char* name) {
+        if (!extensions) {
+            return false;
+        }
+        std::size_t length = std::strlen(name);
+        for (const char* found = extensions; (found = std::strstr(found, name)); found += length) {
+            if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0')) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    EGLContext create_context(EGLDisplay display, EGLConfig config, EGLContext share) {
+        const EGLint attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE,
+        };
+        return eglCreateContext(display, config, share, attributes);
+    }
+}
+
+HeadlessContext::HeadlessContext(int width, int height) : width{width}, height{height} {
+    /* No window system needed at all on the surfaceless platform */
+    EGLDisplay display = EGL_NO_DISPLAY;
+    if (has_extension(eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS), "EGL_MESA_platform_surfaceless")) {
+        auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (get_platform_display) {
+            display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+        throw std::runtime_error("No EGL display available");
+    }
+    this->display = display;
+
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE,
+    };
+    EGLConfig config;
+    EGLint n_configs = 0;
+    if (!eglBindAPI(EGL_OPENGL_API)
+            || !eglChooseConfig(display, config_attributes, &config, 1, &n_configs) || n_configs == 0) {
+        release();
+        throw std::runtime_error("No EGL config for desktop OpenGL");
+    }
+    this->config = config;
+
+    EGLContext context = create_context(display, config, EGL_NO_CONTEXT);
+    if (context == EGL_NO_CONTEXT) {
+        release();
+        throw std::runtime_error("Could not create an OpenGL 3.3 core context");
+    }
+    this->context = context;
+
+    /* Rendering goes to the framebuffer below; a surface is only needed
+     * where the context cannot be current without one */
+    if (!has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+        const EGLint pbuffer_attributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        this->surface = eglCreatePbufferSurface(display, config, pbuffer_attributes);
+    }
+    try {
+        make_current();
+    } catch (...) {
+        release();
+        throw;
+    }
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(get_proc_address))) {
+        release();
+        throw std::runtime_error("Could not load OpenGL functions");
+    }
+
+    glGenRenderbuffers(1, &this->color_buffer);
+    glGenRenderbuffers(1, &this->depth_buffer);
+    std::size_t pixels = std::size_t(width) * height;
+    try {
+        record_allocation({MemoryKind::renderbuffer, this->color_buffer, pixels * 4, GL_RGBA8, width, height, 1,
+                           "framebuffers", "offscreen color"});
+        record_allocation({MemoryKind::renderbuffer, this->depth_buffer, pixels * 4, GL_DEPTH24_STENCIL8, width,
+                           height, 1, "framebuffers", "offscreen depth"});
+    } catch (...) {
+        /* Deletes the renderbuffers, releasing whichever was recorded */
+        release();
+        throw;
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, this->color_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, this->depth_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &this->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->color_buffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depth_buffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        release();
+        throw std::runtime_error("Offscreen framebuffer incomplete");
+    }
+    bind_framebuffer();
+}
+
+HeadlessContext::~HeadlessContext() {
+    /* Not make_current(): destructors must not throw, and release() tears
+     * the context down either way */
+    EGLSurface surface = this->surface ? this->surface : EGL_NO_SURFACE;
+    eglMakeCurrent(this->display, surface, surface, this->context);
+    release();
+}
+
+void HeadlessContext::release() {
+    /* GL objects only exist once the context is current and glad loaded */
+    if (this->color_buffer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &this->framebuffer);
+        record_release(MemoryKind::renderbuffer, this->color_buffer);
+        record_release(MemoryKind::renderbuffer, this->depth_buffer);
+        glDeleteRenderbuffers(1, &this->color_buffer);
+        glDeleteRenderbuffers(1, &this->depth_buffer);
+    }
+
+    eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    for (void* shared : this->shared_contexts) {
+        eglDestroyContext(this->display, shared);
+    }
+    for (void* surface : this->shared_surfaces) {
+        eglDestroySurface(this->display, surface);
+    }
+    if (this->context) {
+        eglDestroyContext(this->display, this->context);
+    }
+    if (this->surface) {
+        eglDestroySurface(this->display, this->surface);
+    }
+    eglTerminate(this->display);
+}
+
+void HeadlessContext::make_current() const {
+    EGLSurface surface = this->surface ? this->surface : EGL_NO_SURFACE;
+    if (!eglMakeCurrent(this->display, surface, surface, this->context)) {
+        throw std::runtime_error("Could not make the headless context current");
+    }
+}
+
+void HeadlessContext::bind_framebuffer() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+    glViewport(0, 0, this->width, this->height);
+}
+
+std::vector<unsigned char> HeadlessContext::read_pixels() const {
+    std::vector<unsigned char> pixels(std::size_t(this->width) * this->height * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    return pixels;
+}
+
+std::function<void()> HeadlessContext::shared_context() {
+    EGLContext shared = create_context(this->display, this->config, this->context);
+    if (shared == EGL_NO_CONTEXT) {
+        throw std::runtime_error("Could not create a shared context");
+    }
+    this->shared_contexts.push_back(shared);
+
+    /* Shared contexts render nowhere, so they need no surface of their own
+     * where surfaceless contexts are supported */
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (this->surface) {
+        const EGLint pbuffer_attributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(this->display, this->config, pbuffer_attributes);
+        this->shared_surfaces.push_back(surface);
+    }
+    return [display = this->display, surface, shared] {
+        eglMakeCurrent(display, surface, surface, shared);
+    };
+}
+
+void* HeadlessContext::get_proc_address(const char* name) {
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+
+std::string HeadlessContext::renderer() const {
+    auto renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    return renderer ? renderer : "unknown";
+}
@@ -0,0 +1,262 @@
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#include <json.hpp>
+
+using namespace std::string_literals;
+
+JsonWriter::JsonWriter(std::ostream& out) : out{out} {
+}
+
+void JsonWriter::key(std::string_view key) {
+    if (this->stack.empty()) {
+        return;
+    }
+    auto& [is_object, has_elements] = this->stack.back();
+    if (has_elements) {
+        this->out << ',';
+    }
+    has_elements = true;
+    this->out << '\n' << std::string(this->stack.size() * 2, ' ');
+    if (is_object) {
+        string(key);
+        this->out << ": ";
+    }
+}
+
+void JsonWriter::string(std::string_view text) {
+    this->out << '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': this->out << "\\\""; break;
+            case '\\': this->out << "\\\\"; break;
+            case '\n': this->out << "\\n"; break;
+            case '\t': this->out << "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof escaped, "\\u%04x", c);
+                    this->out << escaped;
+                } else {
+                    this->out << c;
+                }
+        }
+    }
+    this->out << '"';
+}
+
+JsonWriter& JsonWriter::begin_object(std::string_view key) {
+    this->key(key);
+    this->out << '{';
+    this->stack.push_back({true, false});
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_object() {
+    bool has_elements = this->stack.back().second;
+    this->stack.pop_back();
+    if (has_elements) {
+        this->out << '\n' << std::string(this->stack.size() * 2, ' ');
+    }
+    this->out << '}';
+    if (this->stack.empty()) {
+        this->out << '\n';
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::begin_array(std::string_view key) {
+    this->key(key);
+    this->out << '[';
+    this->stack.push_back({false, false});
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_array() {
+    bool has_elements = this->stack.back().second;
+    this->stack.pop_back();
+    if (has_elements) {
+        this->out << '\n' << std::string(this->stack.size() * 2, ' ');
+    }
+    this->out << ']';
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(std::string_view key, double value) {
+    this->key(key);
+    if (std::isfinite(value)) {
+        /* Shortest text reading back as the same double */
+        char number[32];
+        char* end = std::to_chars(number, number + sizeof number, value).ptr;
+        this->out.write(number, end - number);
+    } else {
+        /* JSON has no infinities or NaN */
+        this->out << "null";
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(std::string_view key, std::int64_t value) {
+    this->key(key);
+    this->out << value;
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(std::string_view key, std::uint64_t value) {
+    this->key(key);
+    this->out << value;
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(std::string_view key, int value) {
+    return field(key, std::int64_t(value));
+}
+
+JsonWriter& JsonWriter::field(std::string_view key, bool value) {
+    this->key(key);
+    this->out << (value ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(std::string_view key, std::string_view value) {
+    this->key(key);
+    string(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(std::string_view key, const char* value) {
+    return field(key, std::string_view{value});
+}
+
+JsonWriter& JsonWriter::value(double value) {
+    return field({}, value);
+}
+
+JsonWriter& JsonWriter::value(std::string_view value) {
+    return field({}, value);
+}
+
+namespace {
+    struct Reader {
+        std::string_view text;
+        std::size_t pos = 0;
+        std::map<std::string, std::string> values;
+
+        [[noreturn]] void fail(const char* what) {
+            throw std::runtime_error("Malformed JSON at offset "s + std::to_string(this->pos) + ": " + what);
+        }
+
+        void skip_space() {
+            while (this->pos < this->text.size() && std::string_view{" \t\r\n"}.find(this->text[this->pos]) != std::string_view::npos) {
+                ++this->pos;
+            }
+        }
+
+        char peek() {
+            skip_space();
+            if (this->pos == this->text.size()) {
+                fail("unexpected end");
+            }
+            return this->text[this->pos];
+        }
+
+        void expect(char c) {
+            if (peek() != c) {
+                fail("unexpected character");
+            }
+            ++this->pos;
+        }
+
+        std::string string() {
+            expect('"');
+            std::string result;
+            while (this->pos < this->text.size() && this->text[this->pos] != '"') {
+                char c = this->text[this->pos++];
+                if (c != '\\') {
+                    result += c;
+                    continue;
+                }
+                if (this->pos == this->text.size()) {
+                    fail("unterminated escape");
+                }
+                char escaped = this->text[this->pos++];
+                switch (escaped) {
+                    case 'n': result += '\n'; break;
+                    case 't': result += '\t'; break;
+                    case 'r': result += '\r'; break;
+                    case 'b': result += '\b'; break;
+                    case 'f': result += '\f'; break;
+                    case 'u': {
+                        if (this->pos + 4 > this->text.size()) {
+                            fail("short \\u escape");
+                        }
+                        /* Only what the writer produces: ASCII */
+                        unsigned code = std::stoul(std::string(this->text.substr(this->pos, 4)), nullptr, 16);
+                        result += char(code & 0x7f);
+                        this->pos += 4;
+                        break;
+                    }
+                    default: result += escaped;
+                }
+            }
+            if (this->pos == this->text.size()) {
+                fail("unterminated string");
+            }
+            ++this->pos;
+            return result;
+        }
+
+        void value(const std::string& path) {
+            char c = peek();
+            if (c == '{') {
+                ++this->pos;
+                if (peek() == '}') {
+                    ++this->pos;
+                    return;
+                }
+                do {
+                    std::string key = string();
+                    expect(':');
+                    value(path.empty() ? key : path + '.' + key);
+                } while (peek() == ',' && ++this->pos);
+                expect('}');
+            } else if (c == '[') {
+                ++this->pos;
+                if (peek() == ']') {
+                    ++this->pos;
+                    return;
+                }
+                std::size_t index = 0;
+                do {
+                    value(path.empty() ? std::to_string(index) : path + '.' + std::to_string(index));
+                    ++index;
+                } while (peek() == ',' && ++this->pos);
+                expect(']');
+            } else if (c == '"') {
+                this->values[path] = string();
+            } else {
+                std::size_t start = this->pos;
+                while (this->pos < this->text.size()
+                        && std::string_view{",}] \t\r\n"}.find(this->text[this->pos]) == std::string_view::npos) {
+                    ++this->pos;
+                }
+                if (start == this->pos) {
+                    fail("missing value");
+                }
+                this->values[path] = std::string(this->text.substr(start, this->pos - start));
+            }
+        }
+    };
+}
+
+std::map<std::string, std::string> flatten_json(std::string_view json) {
+    Reader reader{json};
+    reader.value("");
+    reader.skip_space();
+    if (reader.pos != json.size()) {
+        reader.fail("trailing characters");
+    }
+    return std::move(reader.values);
+}
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include <lz4.hpp>
+
+namespace {
+    const std::size_t MIN_MATCH = 4;
+    /* The format requires the last 5 bytes to be literals and the last
+     * match to start at least 12 bytes before the end */
+    const std::size_t LAST_LITERALS = 5;
+    const std::size_t MATCH_FIND_LIMIT = 12;
+    const std::size_t MAX_OFFSET = 65535;
+    const int HASH_BITS = 16;
+
+    std::uint32_t read32(const unsigned char* src) {
+        std::uint32_t value;
+        std::memcpy(&value, src, sizeof value);
+        return value;
+    }
+
+    std::uint32_t hash(std::uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    /* Lengths past what fits in a token nibble continue in 255-valued bytes */
+    unsigned char* write_length(unsigned char* dst, std::size_t length) {
+        for (; length >= 255; length -= 255) {
+            *dst++ = 255;
+        }
+        *dst++ = (unsigned char)length;
+        return dst;
+    }
+
+    unsigned char* write_sequence(unsigned char* dst, const unsigned char* literals, std::size_t n_literals,
+                                  std::size_t offset, std::size_t match_length) {
+        unsigned char* token = dst++;
+        *token = (unsigned char)(std::min<std::size_t>(n_literals, 15) << 4);
+        if (n_literals >= 15) {
+            dst = write_length(dst, n_literals - 15);
+        }
+        std::memcpy(dst, literals, n_literals);
+        dst += n_literals;
+
+        /* The last sequence has literals only */
+        if (match_length == 0) {
+            return dst;
+        }
+        *dst++ = (unsigned char)offset;
+        *dst++ = (unsigned char)(offset >> 8);
+        match_length -= MIN_MATCH;
+        *token |= (unsigned char)std::min<std::size_t>(match_length, 15);
+        if (match_length >= 15) {
+            dst = write_length(dst, match_length - 15);
+        }
+        return dst;
+    }
+
+    std::size_t read_length(const unsigned char*& src, const unsigned char* end) {
+        std::size_t length = 0;
+        unsigned char byte;
+        do {
+            if (src == end) {
+                throw std::runtime_error("Truncated LZ4 block");
+            }
+            byte = *src++;
+            length += byte;
+        } while (byte == 255);
+        return length;
+    }
+}
+
+std::size_t lz4_compress_bound(std::size_t size) {
+    return size + size / 255 + 16;
+}
+
+std::size_t lz4_compress(const unsigned char* src, std::size_t size, unsigned char* dst) {
+    unsigned char* out = dst;
+    std::size_t anchor = 0;
+
+    if (size > MATCH_FIND_LIMIT) {
+        /* Last position each hashed 4-byte sequence was seen at; stale or
+         * colliding entries are caught by comparing the bytes */
+        auto table = std::make_unique<std::uint32_t[]>(std::size_t(1) << HASH_BITS);
+        std::size_t limit = size - MATCH_FIND_LIMIT;
+        std::size_t match_limit = size - LAST_LITERALS;
+
+        std::size_t pos = 0;
+        while (pos < limit) {
+            std::uint32_t sequence = read32(src + pos);
+            std::uint32_t& slot = table[hash(sequence)];
+            std::size_t candidate = slot;
+            slot = std::uint32_t(pos);
+            if (candidate >= pos || pos - candidate > MAX_OFFSET || read32(src + candidate) != sequence) {
+                ++pos;
+                continue;
+            }
+
+            /* Grow the match backwards over pending literals, then forwards */
+            while (pos > anchor && candidate > 0 && src[pos - 1] == src[candidate - 1]) {
+                --pos;
+                --candidate;
+            }
+            std::size_t length = MIN_MATCH;
+            while (pos + length < match_limit && src[candidate + length] == src[pos + length]) {
+                ++length;
+            }
+
+            out = write_sequence(out, src + anchor, pos - anchor, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+            if (pos < limit) {
+                table[hash(read32(src + pos - 2))] = std::uint32_t(pos - 2);
+            }
+        }
+    }
+
+    out = write_sequence(out, src + anchor, size - anchor, 0, 0);
+    return std::size_t(out - dst);
+}
+
+void lz4_decompress(const unsigned char* src, std::size_t size, unsigned char* dst, std::size_t dst_size) {
+    const unsigned char* end = src + size;
+    unsigned char* out = dst;
+    unsigned char* out_end = dst + dst_size;
+
+    for (;;) {
+        if (src == end) {
+            throw std::runtime_error("Truncated LZ4 block");
+        }
+        unsigned token = *src++;
+
+        std::size_t n_literals = token >> 4;
+        if (n_literals == 15) {
+            n_literals += read_length(src, end);
+        }
+        if (n_literals > std::size_t(end - src) || n_literals > std::size_t(out_end - out)) {
+            throw std::runtime_error("LZ4 literals out of bounds");
+        }
+        std::memcpy(out, src, n_literals);
+        src += n_literals;
+        out += n_literals;
+        if (src == end) {
+            break;
+        }
+
+        if (end - src < 2) {
+            throw std::runtime_error("Truncated LZ4 block");
+        }
+        std::size_t offset = src[0] | std::size_t(src[1]) << 8;
+        src += 2;
+        std::size_t length = token & 15;
+        if (length == 15) {
+            length += read_length(src, end);
+        }
+        length += MIN_MATCH;
+        if (offset == 0 || offset > std::size_t(out - dst) || length > std::size_t(out_end - out)) {
+            throw std::runtime_error("LZ4 match out of bounds");
+        }
+
+        const unsigned char* match = out - offset;
+        if (offset >= length) {
+            std::memcpy(out, match, length);
+            out += length;
+        } else {
+            /* Overlapping: repeats the last `offset` bytes */
+            for (std::size_t i = 0; i < length; ++i) {
+                *out++ = match[i];
+            }
+        }
+    }
+
+    if (out != out_end) {
+        throw std::runtime_error("LZ4 block size mismatch");
+    }
+}
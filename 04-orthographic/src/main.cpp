@@ -10,66 +10,67 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
 
 #include <glad/glad.h>
 #include <GL/gl.h>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_transform.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb_image.h>
 
 #include <shader_prog.hpp>
+#include <program_cache.hpp>
+#include <program_pipeline.hpp>
+#include <async_shader.hpp>
+#include <shader_preproc.hpp>
+#include <shader_watcher.hpp>
 #include <geometry.hpp>
+#include <texture.hpp>
+#include <asset_pipeline.hpp>
+#include <upload_scheduler.hpp>
+#include <texture_manager.hpp>
+#include <resource_pack.hpp>
+#include <profiler.hpp>
+#include <gl_trace.hpp>
+#include <gl_capture.hpp>
+#include <gl_debug.hpp>
+#include <memory_accounting.hpp>
+#include <overdraw.hpp>
 
 namespace {
     const std::size_t WIDTH = 1024;
     const std::size_t HEIGHT = 768;
-}
 
-GLuint set_up_texture(std::string_view img_path) {
-    /* Load image to be used as texture */
-    int img_width;
-    int img_height;
-    int img_channels;
-    unsigned char* img_data = stbi_load(
-            img_path.data(), &img_width, &img_height, &img_channels, 0);
-    if (!img_data) {
-        throw std::runtime_error{"Error loading image file"};
-    }
-
-    /* Allocate texture */
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-
-    /* Set texture parameters */
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    /* Use loaded image data to make up the new texture */
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img_width, img_height, 0, GL_RGBA,
-            GL_UNSIGNED_BYTE, img_data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    /* Free previously allocated memory for image data */
-    stbi_image_free(img_data);
-
-    return texture;
+    /* Uploads of textures for squares in view go first */
+    const float VISIBLE_PRIORITY = 1.0f;
 }
 
 struct Square {
     std::shared_ptr<Geometry> geometry;
-    GLuint texture;
+    TextureHandle texture;
     glm::mat4 transformation;
-    const ShaderProgram& shader;
-    GLint model_location;
 
-    void draw() {
-        glBindTexture(GL_TEXTURE_2D, this->texture);
-        shader.set_uniform_matrix4fv(model_location, transformation);
+    /* By where its center lands; squares are far smaller than the view */
+    bool on_screen() const {
+        glm::vec4 center = transformation * glm::vec4{0.0f, 0.0f, 0.0f, 1.0f};
+        return std::abs(center.x) <= center.w && std::abs(center.y) <= center.w;
+    }
+
+    void draw(const PipelineBinding& sprite, PipelineUniform model) {
+        /* Still loading: hurry it along if it would be seen */
+        if (!this->texture.ready()) {
+            if (on_screen()) {
+                this->texture.set_priority(VISIBLE_PRIORITY);
+            }
+            return;
+        }
+        glBindTexture(GL_TEXTURE_2D, this->texture.id());
+        sprite.set_uniform_matrix4fv(model, transformation);
         geometry->draw();
     }
 
@@ -85,22 +86,25 @@ struct Square {
 struct Scene {
     std::vector<std::shared_ptr<Square>> squares;
 
-    void add_square(std::shared_ptr<Geometry> square_geo, GLuint texture,
-                    glm::mat4 &&transformation, ShaderProgram &shader_program,
-                    GLint model_location) {
-      squares.push_back(std::make_shared<Square>(
-          square_geo, texture, transformation, shader_program, model_location));
+    void add_square(std::shared_ptr<Geometry> square_geo, TextureHandle texture,
+                    glm::mat4 &&transformation) {
+      squares.push_back(std::make_shared<Square>(square_geo, texture, transformation));
     }
 
     void del() {
         for (auto&& square : squares) {
             square->del();
         }
+        /* Drops the texture references, too */
+        squares.clear();
     }
 
-    void draw() {
+    /* Looked up every frame, as a shader reload may move the uniform */
+    void draw(const PipelineBinding& sprite) {
+        sprite.bind();
+        PipelineUniform model = sprite.get_uniform_location("model");
         for (auto&& square : squares) {
-            square->draw();
+            square->draw(sprite, model);
         }
     }
 };
@@ -111,6 +115,9 @@ Scene scene;
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
+    } else if (scene.squares.size() < 2) {
+        /* Not set up yet */
+        return;
     } else if (key == GLFW_KEY_RIGHT && action == GLFW_REPEAT) {
         auto& sq2 = scene.squares[1];
         sq2->rotate(-8.0f);
@@ -131,6 +138,14 @@ int main(void)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+    /* AZ_GL_DEBUG=1 is dev mode: a debug context, whose driver messages
+     * (errors, performance warnings) are logged; see gl_debug.hpp */
+    bool gl_debug = std::getenv("AZ_GL_DEBUG") != nullptr;
+    auto get_proc_address = reinterpret_cast<void* (*)(const char*)>(glfwGetProcAddress);
+    if (gl_debug) {
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+    }
+
     /* Create a windowed mode window and its OpenGL context */
     GLFWwindow* window;
 
@@ -150,86 +165,342 @@ int main(void)
         return -1;
     }
 
-    ShaderProgram shader_program{
-        "shaders/vertex.shader",
-        "shaders/fragment.shader",
-        {"model"}
-        /* {"in_color", "model", "view", "projection"} */
-    };
+    if (gl_debug && !install_gl_debug(get_proc_address)) {
+        std::cerr << "No GL debug output on this context\n";
+    }
 
-    auto square_geo = std::make_shared<Geometry>(
-        std::initializer_list<float>{
-            // positions         // texture coordinates
-             0.2f,  0.2f, 0.0f,  1.0f, 1.0f,  // top right
-             0.2f, -0.2f, 0.0f,  1.0f, 0.0f,  // bottom right
-            -0.2f, -0.2f, 0.0f,  0.0f, 0.0f,  // bottom left
-            -0.2f,  0.2f, 0.0f,  0.0f, 1.0f,  // top left
-        },
-        std::initializer_list<int>{
-            0, 1, 3,
-            1, 2, 3,
+    /* AZ_GL_CAPTURE=file.azgl captures GL calls for tools/gl_replay, of the
+     * frames given by AZ_GL_CAPTURE_FRAMES=first:count (the first frame by
+     * default); see gl_capture.hpp. Before the tracer, so its cost is not
+     * traced */
+    if (const char* gl_capture = std::getenv("AZ_GL_CAPTURE")) {
+        GlCaptureOptions gl_capture_options{gl_capture};
+        if (const char* frames = std::getenv("AZ_GL_CAPTURE_FRAMES")) {
+            char* end;
+            gl_capture_options.first_frame = std::strtoull(frames, &end, 10);
+            if (*end == ':') {
+                gl_capture_options.frames = std::strtoull(end + 1, nullptr, 10);
+            }
+        }
+        try {
+            start_gl_capture(gl_capture_options);
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << '\n';
         }
-    );
+    }
 
-    /* I'd like my textures unflipped, please! */
-    stbi_set_flip_vertically_on_load(true);
+    /* AZ_GL_TRACE=1 counts and times every GL call, AZ_GL_TRACE=errors also
+     * checks each one for errors; see gl_trace.hpp */
+    if (const char* gl_trace = std::getenv("AZ_GL_TRACE")) {
+        GlTraceOptions gl_trace_options;
+        gl_trace_options.check_errors = std::string{gl_trace} == "errors";
+        install_gl_trace(gl_trace_options);
+    }
 
-    GLuint sq1_texture = set_up_texture("../tex/1.png");
-    GLuint sq2_texture = set_up_texture("../tex/2.png");
-    GLuint sq3_texture = set_up_texture("../tex/3.png");
-    GLuint sq4_texture = set_up_texture("../tex/4.png");
+    /* AZ_MEMORY_REPORT=file.json rewrites a report of what GL objects and
+     * queued uploads take every second; AZ_MEMORY_BUDGET=MiB warns past that
+     * much GPU memory, AZ_MEMORY_BUDGET=MiB:refuse makes allocations past
+     * it fail. See memory_accounting.hpp */
+    const char* memory_report = std::getenv("AZ_MEMORY_REPORT");
+    if (memory_report) {
+        set_memory_report(memory_report);
+    }
+    const char* memory_budget = std::getenv("AZ_MEMORY_BUDGET");
+    if (memory_budget) {
+        char* end;
+        MemoryBudget budget;
+        budget.gpu_bytes = std::size_t(std::strtoull(memory_budget, &end, 10)) << 20;
+        if (std::string{end} == ":refuse") {
+            budget.policy = MemoryBudgetPolicy::refuse;
+        }
+        set_memory_budget(budget);
+    }
 
-    glm::mat4 identity = glm::mat4{1.0f};
+    /* I'd like my textures unflipped, please! */
+    set_flip_on_load(true);
 
-    glm::mat4 sq1_transform = glm::translate(identity, glm::vec3(-0.4f, 0.0f, 0.0f));
+    /* Everything holding GL objects or threads with contexts lives in this
+     * scope, so it is gone before glfwTerminate() destroys the contexts */
+    {
+        /* Uploads run on their own thread, through a hidden window whose context
+         * shares objects with the main one; without it (or with
+         * AZ_NO_UPLOAD_THREAD set) they happen between frames */
+        GLFWwindow* upload_window = nullptr;
+        if (!std::getenv("AZ_NO_UPLOAD_THREAD")) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            upload_window = glfwCreateWindow(1, 1, "Uploads", NULL, window);
+        }
+        std::function<void()> make_upload_context_current;
+        if (upload_window) {
+            make_upload_context_current = [upload_window, gl_debug, get_proc_address] {
+                glfwMakeContextCurrent(upload_window);
+                if (gl_debug) {
+                    install_gl_debug(get_proc_address);
+                }
+            };
+        }
 
-    glm::mat4 sq2_transform = glm::translate(identity, glm::vec3(0.4f, -0.3f, 0.0f));
-    sq2_transform = glm::rotate(sq2_transform, glm::radians(-42.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        /* Decode textures on worker threads while the driver compiles shaders */
+        AssetPipeline asset_pipeline{0, make_upload_context_current};
+
+        /* Assets come from the pack next to the executable, if it was built
+         * (resource_pack target) and AZ_LOOSE_FILES is unset; from the loose
+         * files otherwise */
+        std::error_code error;
+        auto pack_path = std::filesystem::read_symlink("/proc/self/exe", error).parent_path() / "orthographic.azpk";
+        if (!error && !std::getenv("AZ_LOOSE_FILES") && std::filesystem::exists(pack_path)) {
+            mount_resource_pack(std::make_unique<ResourcePack>(pack_path.string()));
+            mounted_resource_pack()->decompress_all(asset_pipeline.decode_pool);
+        }
 
-    GLint model_location = shader_program.get_uniform_location("model");
+        /* Without an upload thread, uploads are spread over frames instead;
+         * with one, the scheduler stays idle */
+        UploadScheduler upload_scheduler;
+        asset_pipeline.scheduler = &upload_scheduler;
 
-    scene.add_square(square_geo, sq1_texture, std::move(sq1_transform), shader_program, model_location);
-    scene.add_square(square_geo, sq2_texture, std::move(sq2_transform), shader_program, model_location);
+        /* Requests for an image already loaded (or loading) share its texture */
+        TextureManager texture_manager{asset_pipeline};
 
-    /* Activate linked program */
-    shader_program.use();
+        /* Squares are 0.4 wide in clip space, so they never cover more than a
+         * fifth of the window; bigger images load at a reduced size */
+        TextureParams square_params;
+        square_params.size = {int(WIDTH / 5), int(HEIGHT / 5)};
 
-    /* Model */
-    /* glm::mat4 model = glm::mat4{1.0f}; */
-    /* model = glm::rotate(model, glm::radians(-55.0f), glm::vec3{1.0f, 0.0f, 0.0f}); */
+        TextureHandle sq1_texture = texture_manager.acquire("../tex/1.png", square_params);
+        TextureHandle sq2_texture = texture_manager.acquire("../tex/2.png", square_params);
 
-    /* View */
-    /* glm::mat4 view = glm::mat4{1.0f}; */
-    /* view = glm::translate(view, glm::vec3{0.0f, 0.0f, 0.0f}); */
+        /* Linked programs are kept on disk so later runs skip compilation */
+        ProgramCache program_cache{"../cache/programs"};
 
-    /* Projection */
-    /* glm::mat4 projection = glm::ortho(-3.0f, 3.0f, -3.0f, 3.0f); */
+        AsyncProgramBuilder program_builder{
+            reinterpret_cast<AsyncProgramBuilder::LoadProc>(glfwGetProcAddress),
+            &program_cache
+        };
 
-    glfwSetKeyCallback(window, key_callback);
+        /* AZ_OVERDRAW=1 shows how many times each pixel gets shaded, as a heat
+         * map, and logs overdraw statistics; see overdraw.hpp */
+        bool overdraw = std::getenv("AZ_OVERDRAW") != nullptr;
+        ShaderDefines sprite_defines{{"TEXTURED", ""}};
+        if (overdraw) {
+            sprite_defines["OVERDRAW"] = "";
+        }
+        std::string vert_shader_src = preprocess_shader("shaders/vertex.shader", sprite_defines).source;
+        std::string frag_shader_src = preprocess_shader("shaders/fragment.shader", sprite_defines).source;
+
+        /* Separable stages where the context has them, so each stage builds
+         * (and rebuilds) on its own; one program through the cache otherwise.
+         * See program_pipeline.hpp */
+        PipelineCache pipeline_cache;
+        ProgramFuture vertex_build;
+        ProgramFuture fragment_build;
+        if (pipeline_cache.separable) {
+            vertex_build = program_builder.submit_stage(vert_shader_src, GL_VERTEX_SHADER);
+            fragment_build = program_builder.submit_stage(frag_shader_src, GL_FRAGMENT_SHADER);
+        } else {
+            vertex_build = fragment_build = program_builder.submit(vert_shader_src, frag_shader_src);
+        }
 
-    /* Loop until the user closes the window */
-    while (!glfwWindowShouldClose(window))
-    {
-        /* Poll for and process events */
-        glfwPollEvents();
+        auto square_geo = std::make_shared<Geometry>(
+            std::initializer_list<float>{
+                // positions         // texture coordinates
+                 0.2f,  0.2f, 0.0f,  1.0f, 1.0f,  // top right
+                 0.2f, -0.2f, 0.0f,  1.0f, 0.0f,  // bottom right
+                -0.2f, -0.2f, 0.0f,  0.0f, 0.0f,  // bottom left
+                -0.2f,  0.2f, 0.0f,  0.0f, 1.0f,  // top left
+            },
+            std::initializer_list<int>{
+                0, 1, 3,
+                1, 2, 3,
+            },
+            "square"
+        );
+
+        /* Set up by the render loop once the build is done; frames are only
+         * cleared until then */
+        PipelineBinding* sprite = nullptr;
+
+        /* Squares are in the scene from the start and show up as soon as
+         * their textures are in (see Square::draw); the loop keeps running
+         * meanwhile */
+        glm::mat4 identity = glm::mat4{1.0f};
+        glm::mat4 sq1_transform = glm::translate(identity, glm::vec3(-0.4f, 0.0f, 0.0f));
+        scene.add_square(square_geo, sq1_texture, std::move(sq1_transform));
+        glm::mat4 sq2_transform = glm::translate(identity, glm::vec3(0.4f, -0.3f, 0.0f));
+        sq2_transform = glm::rotate(sq2_transform, glm::radians(-42.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        scene.add_square(square_geo, sq2_texture, std::move(sq2_transform));
+
+        auto populate_scene = [&]() -> Task<void> {
+            /* A reduced decode may still be larger than the square */
+            co_await sq1_texture.loaded();
+            sq1_texture.drawn_at(int(WIDTH / 5), int(HEIGHT / 5));
+            co_await sq2_texture.loaded();
+            sq2_texture.drawn_at(int(WIDTH / 5), int(HEIGHT / 5));
+        };
+        auto scene_loaded = spawn(populate_scene());
+
+        /* Rebuilds the program whenever one of its source files is saved */
+        ShaderWatcher shader_watcher;
+
+        /* Model */
+        /* glm::mat4 model = glm::mat4{1.0f}; */
+        /* model = glm::rotate(model, glm::radians(-55.0f), glm::vec3{1.0f, 0.0f, 0.0f}); */
+
+        /* View */
+        /* glm::mat4 view = glm::mat4{1.0f}; */
+        /* view = glm::translate(view, glm::vec3{0.0f, 0.0f, 0.0f}); */
+
+        /* Projection */
+        /* glm::mat4 projection = glm::ortho(-3.0f, 3.0f, -3.0f, 3.0f); */
+
+        glfwSetKeyCallback(window, key_callback);
+
+        std::optional<OverdrawView> overdraw_view;
+        if (overdraw) {
+            int framebuffer_width, framebuffer_height;
+            glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+            try {
+                overdraw_view.emplace(framebuffer_width, framebuffer_height);
+            } catch (const std::runtime_error& e) {
+                std::cerr << e.what() << '\n';
+            }
+        }
+        OverdrawStats previous_overdraw_stats;
+
+        /* Loop until the user closes the window */
+        AZ_PROFILE_THREAD_NAME("render");
+        GlFrameStats previous_gl_stats;
+        while (!glfwWindowShouldClose(window))
+        {
+            /* Poll for and process events */
+            {
+                AZ_PROFILE_ZONE("glfwPollEvents");
+                glfwPollEvents();
+            }
+
+            /* Swap in reloaded shaders and finished assets between frames */
+            {
+                AZ_PROFILE_ZONE("ShaderWatcher::update");
+                shader_watcher.update(program_builder);
+            }
+            /* ShaderWatcher::update() also polls the builder, which is how the
+             * initial build completes */
+            if (!sprite) {
+                for (auto* build : {&vertex_build, &fragment_build}) {
+                    if (build->failed()) {
+                        /* Rethrows the build error */
+                        build->get();
+                    }
+                }
+                GLuint vertex_program = vertex_build.get_or(0);
+                GLuint fragment_program = fragment_build.get_or(0);
+                if (vertex_program && fragment_program) {
+                    sprite = &pipeline_cache.get(vertex_program, fragment_program, {"model"});
+                    shader_watcher.watch(*sprite,
+                        "shaders/vertex.shader", "shaders/fragment.shader", sprite_defines);
+                }
+            }
+            {
+                AZ_PROFILE_ZONE("AssetPipeline::pump");
+                AZ_PROFILE_GPU_ZONE("AssetPipeline::pump");
+                asset_pipeline.pump();
+            }
+            AZ_PROFILE_COUNTER("upload bytes", upload_scheduler.stats.frame_bytes);
+            AZ_PROFILE_COUNTER("uploads queued", upload_scheduler.stats.queue_depth);
+            if (scene_loaded.ready()) {
+                /* Rethrows loading errors, if any */
+                scene_loaded.get();
+            }
+
+            /* Render here */
+            {
+                AZ_PROFILE_ZONE("Scene::draw");
+                AZ_PROFILE_GPU_ZONE("Scene::draw");
+                if (overdraw_view) {
+                    overdraw_view->begin_frame();
+                }
+                glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT);
+
+                /* Drawing code */
+                /* square_1.draw(); */
+                /* square_2.draw(); */
+                if (sprite) {
+                    scene.draw(*sprite);
+                }
+            }
+
+            /* Overdraw statistics whenever they change, e.g. as squares come in */
+            if (overdraw_view) {
+                AZ_PROFILE_ZONE("OverdrawView::end_frame");
+                if (auto stats = overdraw_view->end_frame()) {
+                    if (stats->shaded_fragments != previous_overdraw_stats.shaded_fragments
+                            || stats->visible_fragments != previous_overdraw_stats.visible_fragments) {
+                        print_overdraw_stats(std::cerr, *stats);
+                    }
+                    previous_overdraw_stats = *stats;
+                }
+            }
+
+            /* Swap front and back buffers */
+            {
+                AZ_PROFILE_ZONE("glfwSwapBuffers");
+                glfwSwapBuffers(window);
+            }
+            AZ_PROFILE_FRAME();
+            memory_frame();
+
+            if (gl_capture_active()) {
+                try {
+                    gl_capture_end_frame();
+                } catch (const std::runtime_error& e) {
+                    std::cerr << e.what() << '\n';
+                }
+            }
+
+            /* GL statistics whenever a frame's calls differ from the last one's,
+             * e.g. while assets come in */
+            if (gl_trace_installed()) {
+                GlFrameStats gl_stats = gl_trace_end_frame();
+                if (gl_stats.calls != previous_gl_stats.calls || gl_stats.draw_calls != previous_gl_stats.draw_calls
+                        || gl_stats.buffer_bytes || gl_stats.texture_bytes || gl_stats.errors) {
+                    print_gl_frame_stats(std::cerr, gl_stats);
+                }
+                previous_gl_stats = std::move(gl_stats);
+            }
+        }
 
-        /* Render here */
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        /* Only in builds with AZ_PROFILE on */
+        AZ_PROFILE_WRITE_TRACE("ortho.trace.json");
 
-        /* Drawing code */
-        /* square_1.draw(); */
-        /* square_2.draw(); */
-        scene.draw();
+        if (gl_debug_installed()) {
+            print_gl_debug_summary(std::cerr);
+        }
+        if (memory_report || memory_budget) {
+            print_memory_totals(std::cerr);
+        }
 
-        /* Swap front and back buffers */
-        glfwSwapBuffers(window);
-    }
+        /* Loads still in flight (the window may close before the squares
+         * are in) must not resume into what is deallocated below */
+        asset_pipeline.shutdown();
 
-    /* Deallocate objects */
-    scene.del();
+        /* Deallocate objects */
+        scene.del();
 
-    shader_program.del();
+        if (overdraw_view) {
+            overdraw_view->del();
+        }
+
+        /* The sprite's programs are ours rather than the pipeline cache's;
+         * builds still in flight are finished so they can be deleted, too */
+        program_builder.wait_all();
+        GLuint vertex_program = sprite ? sprite->vertex_program : vertex_build.get_or(0);
+        GLuint fragment_program = sprite ? sprite->fragment_program : fragment_build.get_or(0);
+        if (fragment_program != vertex_program) {
+            glDeleteProgram(fragment_program);
+        }
+        glDeleteProgram(vertex_program);
+        pipeline_cache.del();
+    }
 
     glfwTerminate();
     
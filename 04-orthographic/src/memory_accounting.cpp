@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <utility>
+
+#include <json.hpp>
+#include <memory_accounting.hpp>
+
+using namespace std::string_literals;
+
+namespace {
+    using Key = std::pair<MemoryKind, std::uint64_t>;
+
+    struct Accounts {
+        std::mutex mutex;
+        std::map<Key, MemoryAllocation> allocations;
+        MemoryTotals totals;
+        MemoryBudget budget;
+        /* Past the budget since the last warning, per pool */
+        bool gpu_warned = false;
+        bool host_warned = false;
+
+        std::string report_path;
+        std::chrono::milliseconds report_interval{0};
+        std::chrono::steady_clock::time_point last_report;
+    };
+
+    Accounts& accounts() {
+        static Accounts accounts;
+        return accounts;
+    }
+
+    std::atomic<std::uint64_t> next_host_id{1};
+
+    void add(MemoryUsage& usage, std::size_t bytes) {
+        usage.bytes += bytes;
+        usage.peak_bytes = std::max(usage.peak_bytes, usage.bytes);
+        ++usage.allocations;
+    }
+
+    void remove(MemoryUsage& usage, std::size_t bytes) {
+        usage.bytes -= std::min(usage.bytes, bytes);
+        usage.allocations -= std::min<std::size_t>(usage.allocations, 1);
+    }
+
+    MemoryUsage& pool(MemoryTotals& totals, MemoryKind kind) {
+        return kind == MemoryKind::host ? totals.host : totals.gpu;
+    }
+
+    void add(MemoryTotals& totals, const MemoryAllocation& allocation) {
+        add(pool(totals, allocation.kind), allocation.bytes);
+        add(totals.kinds[allocation.kind], allocation.bytes);
+        add(totals.categories[allocation.category], allocation.bytes);
+    }
+
+    void remove(MemoryTotals& totals, const MemoryAllocation& allocation) {
+        remove(pool(totals, allocation.kind), allocation.bytes);
+        remove(totals.kinds[allocation.kind], allocation.bytes);
+        remove(totals.categories[allocation.category], allocation.bytes);
+    }
+
+    std::string mib(std::size_t bytes) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.1f MiB", bytes / 1048576.0);
+        return text;
+    }
+
+    /* Throws or warns if `bytes` more would not fit the pool of `kind`;
+     * `replaced` bytes of it are given back by the same allocation */
+    void check_budget(Accounts& accounts, const MemoryAllocation& allocation, std::size_t replaced) {
+        bool host = allocation.kind == MemoryKind::host;
+        std::size_t limit = host ? accounts.budget.host_bytes : accounts.budget.gpu_bytes;
+        bool& warned = host ? accounts.host_warned : accounts.gpu_warned;
+        std::size_t used = pool(accounts.totals, allocation.kind).bytes;
+        std::size_t after = used - std::min(used, replaced) + allocation.bytes;
+        if (limit == 0 || after <= limit) {
+            warned = false;
+            return;
+        }
+
+        std::string what = std::to_string(allocation.bytes) + " bytes of " + memory_kind_name(allocation.kind)
+            + " for " + allocation.category + (allocation.owner.empty() ? "" : " '" + allocation.owner + "'")
+            + ": " + mib(after) + " would be over the " + (host ? "host" : "GPU") + " memory budget of "
+            + mib(limit);
+        if (accounts.budget.policy == MemoryBudgetPolicy::refuse) {
+            throw MemoryBudgetExceeded("Error allocating "s + what);
+        }
+        /* Once each time the budget is crossed */
+        if (!warned) {
+            std::cerr << "warning: allocating " << what << '\n';
+            warned = true;
+        }
+    }
+
+    void write_usage(JsonWriter& json, std::string_view key, const MemoryUsage& usage) {
+        json.begin_object(key)
+            .field("bytes", std::uint64_t(usage.bytes))
+            .field("peak_bytes", std::uint64_t(usage.peak_bytes))
+            .field("allocations", std::uint64_t(usage.allocations))
+            .end_object();
+    }
+}
+
+const char* memory_kind_name(MemoryKind kind) {
+    switch (kind) {
+        case MemoryKind::buffer: return "buffer";
+        case MemoryKind::texture: return "texture";
+        case MemoryKind::renderbuffer: return "renderbuffer";
+        case MemoryKind::host: return "host";
+    }
+    return "unknown";
+}
+
+void set_memory_budget(const MemoryBudget& budget) {
+    std::lock_guard lock{accounts().mutex};
+    accounts().budget = budget;
+}
+
+MemoryBudget memory_budget() {
+    std::lock_guard lock{accounts().mutex};
+    return accounts().budget;
+}
+
+void record_allocation(MemoryAllocation allocation) {
+    Accounts& accounts = ::accounts();
+    std::lock_guard lock{accounts.mutex};
+    auto existing = accounts.allocations.find({allocation.kind, allocation.id});
+    std::size_t replaced = existing != accounts.allocations.end() ? existing->second.bytes : 0;
+    check_budget(accounts, allocation, replaced);
+
+    if (existing != accounts.allocations.end()) {
+        remove(accounts.totals, existing->second);
+        /* Reallocated storage still belongs to whoever had it */
+        if (allocation.owner.empty()) {
+            allocation.owner = std::move(existing->second.owner);
+        }
+        accounts.allocations.erase(existing);
+    }
+    add(accounts.totals, allocation);
+    accounts.allocations.emplace(Key{allocation.kind, allocation.id}, std::move(allocation));
+}
+
+void record_release(MemoryKind kind, std::uint64_t id) {
+    Accounts& accounts = ::accounts();
+    std::lock_guard lock{accounts.mutex};
+    auto existing = accounts.allocations.find({kind, id});
+    if (existing != accounts.allocations.end()) {
+        remove(accounts.totals, existing->second);
+        accounts.allocations.erase(existing);
+    }
+}
+
+void set_memory_owner(MemoryKind kind, std::uint64_t id, std::string owner) {
+    Accounts& accounts = ::accounts();
+    std::lock_guard lock{accounts.mutex};
+    auto existing = accounts.allocations.find({kind, id});
+    if (existing != accounts.allocations.end()) {
+        existing->second.owner = std::move(owner);
+    }
+}
+
+std::uint64_t host_allocation_id() {
+    return next_host_id++;
+}
+
+MemoryTotals memory_totals() {
+    std::lock_guard lock{accounts().mutex};
+    return accounts().totals;
+}
+
+std::vector<MemoryAllocation> memory_allocations() {
+    std::vector<MemoryAllocation> allocations;
+    {
+        std::lock_guard lock{accounts().mutex};
+        for (const auto& [key, allocation] : accounts().allocations) {
+            allocations.push_back(allocation);
+        }
+    }
+    std::stable_sort(allocations.begin(), allocations.end(), [](const auto& a, const auto& b) {
+        return a.bytes > b.bytes;
+    });
+    return allocations;
+}
+
+void print_memory_totals(std::ostream& out, std::size_t top) {
+    MemoryTotals totals = memory_totals();
+    MemoryBudget budget = memory_budget();
+    out << "Memory: GPU " << mib(totals.gpu.bytes) << " in " << totals.gpu.allocations << " objects (peak "
+        << mib(totals.gpu.peak_bytes) << (budget.gpu_bytes ? ", budget " + mib(budget.gpu_bytes) : "")
+        << "), host " << mib(totals.host.bytes) << " (peak " << mib(totals.host.peak_bytes)
+        << (budget.host_bytes ? ", budget " + mib(budget.host_bytes) : "") << ")\n";
+    for (const auto& [category, usage] : totals.categories) {
+        if (usage.allocations || usage.peak_bytes) {
+            out << "  " << category << ": " << mib(usage.bytes) << " in " << usage.allocations << " (peak "
+                << mib(usage.peak_bytes) << ")\n";
+        }
+    }
+
+    std::vector<MemoryAllocation> allocations = memory_allocations();
+    for (std::size_t i = 0; i < std::min(top, allocations.size()); ++i) {
+        const MemoryAllocation& allocation = allocations[i];
+        out << "  " << mib(allocation.bytes) << ' ' << memory_kind_name(allocation.kind) << ' ' << allocation.id;
+        if (allocation.width) {
+            out << ", " << allocation.width << 'x' << allocation.height;
+        }
+        if (allocation.mip_levels > 1) {
+            out << ", " << allocation.mip_levels << " levels";
+        }
+        out << " (" << allocation.category << (allocation.owner.empty() ? "" : " " + allocation.owner) << ")\n";
+    }
+}
+
+void write_memory_report(const std::string& path) {
+    MemoryTotals totals = memory_totals();
+    MemoryBudget budget = memory_budget();
+    std::vector<MemoryAllocation> allocations = memory_allocations();
+
+    std::ostringstream text;
+    JsonWriter json{text};
+    json.begin_object();
+    json.begin_object("budget")
+        .field("gpu_bytes", std::uint64_t(budget.gpu_bytes))
+        .field("host_bytes", std::uint64_t(budget.host_bytes))
+        .field("policy", budget.policy == MemoryBudgetPolicy::refuse ? "refuse" : "warn")
+        .end_object();
+    write_usage(json, "gpu", totals.gpu);
+    write_usage(json, "host", totals.host);
+    json.begin_object("kinds");
+    for (const auto& [kind, usage] : totals.kinds) {
+        write_usage(json, memory_kind_name(kind), usage);
+    }
+    json.end_object().begin_object("categories");
+    for (const auto& [category, usage] : totals.categories) {
+        write_usage(json, category, usage);
+    }
+    json.end_object().begin_array("allocations");
+    for (const MemoryAllocation& allocation : allocations) {
+        json.begin_object()
+            .field("kind", memory_kind_name(allocation.kind))
+            .field("id", allocation.id)
+            .field("bytes", std::uint64_t(allocation.bytes))
+            .field("format", std::uint64_t(allocation.format))
+            .field("width", allocation.width)
+            .field("height", allocation.height)
+            .field("mip_levels", allocation.mip_levels)
+            .field("category", allocation.category)
+            .field("owner", allocation.owner)
+            .end_object();
+    }
+    json.end_array().end_object();
+
+    /* Readers polling the file never see half of it */
+    std::string partial_path = path + ".partial";
+    {
+        std::ofstream out{partial_path};
+        out << text.str();
+        if (!out.flush()) {
+            throw std::runtime_error("Error writing memory report '"s + path + "'");
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(partial_path, path, error);
+    if (error) {
+        throw std::runtime_error("Error writing memory report '"s + path + "': " + error.message());
+    }
+}
+
+void set_memory_report(std::string path, std::chrono::milliseconds interval) {
+    std::lock_guard lock{accounts().mutex};
+    accounts().report_path = std::move(path);
+    accounts().report_interval = interval;
+    accounts().last_report = {};
+}
+
+void memory_frame() {
+    std::string path;
+    {
+        Accounts& accounts = ::accounts();
+        std::lock_guard lock{accounts.mutex};
+        auto now = std::chrono::steady_clock::now();
+        if (accounts.report_path.empty() || now - accounts.last_report < accounts.report_interval) {
+            return;
+        }
+        accounts.last_report = now;
+        path = accounts.report_path;
+    }
+    try {
+        write_memory_report(path);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+    }
+}
@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <glad/glad.h>
+
+#include <hash.hpp>
+#include <mipmap.hpp>
+#include <texture_import.hpp>
+#include <thread_pool.hpp>
+
+namespace {
+    /* Linear light is kept in 16 bits between levels; going back to sRGB
+     * looks up its top bits, which still tell every 8-bit sRGB code apart */
+    const int SRGB_TABLE_BITS = 13;
+
+    /* Rows are handed out in bands of about this many pixels: enough to be
+     * worth a job, few enough to spread the top levels over every thread */
+    const int BAND_PIXELS = 64 * 1024;
+
+    const char MIP_CACHE_MAGIC[4] = {'A', 'Z', 'M', 'C'};
+    const std::uint32_t MIP_CACHE_VERSION = 1;
+
+    struct GammaTables {
+        std::array<std::uint16_t, 256> to_linear;
+        /* Same scale for channels taken as they are (alpha) */
+        std::array<std::uint16_t, 256> widen;
+        std::array<unsigned char, 1 << SRGB_TABLE_BITS> to_srgb;
+
+        GammaTables() {
+            for (int i = 0; i < 256; ++i) {
+                double srgb = i / 255.0;
+                double linear = srgb <= 0.04045 ? srgb / 12.92 : std::pow((srgb + 0.055) / 1.055, 2.4);
+                this->to_linear[i] = std::uint16_t(std::lround(linear * 65535.0));
+                this->widen[i] = std::uint16_t(i * 257);
+            }
+            for (int i = 0; i < (1 << SRGB_TABLE_BITS); ++i) {
+                double linear = (i + 0.5) / (1 << SRGB_TABLE_BITS);
+                double srgb = linear <= 0.0031308 ? linear * 12.92
+                    : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+                this->to_srgb[i] = (unsigned char)std::lround(srgb * 255.0);
+            }
+        }
+    };
+
+    const GammaTables& gamma_tables() {
+        static const GammaTables tables;
+        return tables;
+    }
+
+    /* Shared by callers without a pool of their own */
+    ThreadPool& shared_pool() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    /* RGB is padded to four lanes in linear light, for the SIMD kernel */
+    int linear_lanes(int channels) {
+        return channels == 3 ? 4 : channels;
+    }
+
+    bool is_alpha(int channel, int channels) {
+        return (channels == 2 || channels == 4) && channel == channels - 1;
+    }
+
+    /* Rounded average, as _mm_avg_epu16 computes it */
+    inline std::uint16_t average(unsigned int a, unsigned int b) {
+        return std::uint16_t((a + b + 1) >> 1);
+    }
+
+#ifdef __SSE2__
+    /* Averages horizontally adjacent pixels of the 16 lanes in v0, v1 */
+    inline __m128i average_pairs_sse2(__m128i v0, __m128i v1, int lanes) {
+        __m128i even;
+        __m128i odd;
+        if (lanes == 4) {
+            even = _mm_unpacklo_epi64(v0, v1);
+            odd = _mm_unpackhi_epi64(v0, v1);
+        } else if (lanes == 2) {
+            even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(v0), _mm_castsi128_ps(v1),
+                    _MM_SHUFFLE(2, 0, 2, 0)));
+            odd = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(v0), _mm_castsi128_ps(v1),
+                    _MM_SHUFFLE(3, 1, 3, 1)));
+        } else {
+            /* Averages land in the low half of each 32-bit lane; sign
+             * extending them lets the saturating pack keep them as they are */
+            v0 = _mm_avg_epu16(v0, _mm_srli_epi32(v0, 16));
+            v1 = _mm_avg_epu16(v1, _mm_srli_epi32(v1, 16));
+            v0 = _mm_srai_epi32(_mm_slli_epi32(v0, 16), 16);
+            v1 = _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16);
+            return _mm_packs_epi32(v0, v1);
+        }
+        return _mm_avg_epu16(even, odd);
+    }
+
+    inline __m128i load_lanes(const std::uint16_t* p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+#endif
+
+    /* One row of level n + 1 from two of level n, in linear light: vertical
+     * pairs are averaged first, then horizontal ones */
+    void reduce_row(const std::uint16_t* row0, const std::uint16_t* row1, int src_width, int lanes,
+                    std::uint16_t* out, int dst_width) {
+        int n = dst_width * lanes;
+        int i = 0;
+#ifdef __SSE2__
+        /* Each output lane reads two input lanes, which exist in pairs
+         * unless the source is one pixel wide */
+        for (; src_width > 1 && i + 8 <= n; i += 8) {
+            __m128i v0 = _mm_avg_epu16(load_lanes(row0 + 2 * i), load_lanes(row1 + 2 * i));
+            __m128i v1 = _mm_avg_epu16(load_lanes(row0 + 2 * i + 8), load_lanes(row1 + 2 * i + 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), average_pairs_sse2(v0, v1, lanes));
+        }
+#endif
+        for (; i < n; ++i) {
+            int x = i / lanes;
+            int c = i % lanes;
+            int a = 2 * x * lanes + c;
+            int b = 2 * x + 1 < src_width ? a + lanes : a;
+            out[i] = average(average(row0[a], row1[a]), average(row0[b], row1[b]));
+        }
+    }
+
+    /* Level 1, rows [y0, y1), from the 8-bit level 0: the table lookups
+     * taking each channel to linear light are what this costs, so they are
+     * summed straight away rather than stored for reduce_row() */
+    template <int CHANNELS>
+    void reduce_level0_rows(const unsigned char* src, int src_width, int src_height,
+                            const std::uint16_t* const* tables, std::uint16_t* dst, int dst_width,
+                            int y0, int y1) {
+        const int lanes = CHANNELS == 3 ? 4 : CHANNELS;
+        std::size_t src_stride = std::size_t(src_width) * CHANNELS;
+
+        for (int y = y0; y < y1; ++y) {
+            const unsigned char* row0 = src + std::size_t(2 * y) * src_stride;
+            const unsigned char* row1 = 2 * y + 1 < src_height ? row0 + src_stride : row0;
+            std::uint16_t* out = dst + std::size_t(y) * dst_width * lanes;
+            for (int x = 0; x < dst_width; ++x, out += lanes) {
+                int x0 = 2 * x * CHANNELS;
+                int x1 = 2 * x + 1 < src_width ? x0 + CHANNELS : x0;
+                for (int c = 0; c < CHANNELS; ++c) {
+                    const std::uint16_t* table = tables[c];
+                    unsigned int sum = table[row0[x0 + c]] + table[row0[x1 + c]]
+                        + table[row1[x0 + c]] + table[row1[x1 + c]];
+                    out[c] = std::uint16_t((sum + 2) >> 2);
+                }
+                if (lanes > CHANNELS) {
+                    out[CHANNELS] = 0;
+                }
+            }
+        }
+    }
+
+    void reduce_level0(const unsigned char* src, int src_width, int src_height, int channels, bool srgb,
+                       std::uint16_t* dst, int dst_width, int y0, int y1) {
+        const std::uint16_t* tables[4];
+        for (int c = 0; c < channels; ++c) {
+            tables[c] = srgb && !is_alpha(c, channels) ? gamma_tables().to_linear.data()
+                : gamma_tables().widen.data();
+        }
+        switch (channels) {
+            case 1: reduce_level0_rows<1>(src, src_width, src_height, tables, dst, dst_width, y0, y1); break;
+            case 2: reduce_level0_rows<2>(src, src_width, src_height, tables, dst, dst_width, y0, y1); break;
+            case 3: reduce_level0_rows<3>(src, src_width, src_height, tables, dst, dst_width, y0, y1); break;
+            default: reduce_level0_rows<4>(src, src_width, src_height, tables, dst, dst_width, y0, y1); break;
+        }
+    }
+
+    /* Level n + 1 from level n, both in linear light, rows [y0, y1) */
+    void reduce_linear(const std::uint16_t* src, int src_width, int src_height, int lanes,
+                       std::uint16_t* dst, int dst_width, int y0, int y1) {
+        std::size_t src_stride = std::size_t(src_width) * lanes;
+        for (int y = y0; y < y1; ++y) {
+            const std::uint16_t* row0 = src + std::size_t(2 * y) * src_stride;
+            const std::uint16_t* row1 = 2 * y + 1 < src_height ? row0 + src_stride : row0;
+            reduce_row(row0, row1, src_width, lanes, dst + std::size_t(y) * dst_width * lanes, dst_width);
+        }
+    }
+
+    /* Round(value / 257): 16 bits back to 8 without gamma */
+    inline unsigned char narrow(unsigned int value) {
+        return (unsigned char)((value * 255 + 32895) >> 16);
+    }
+
+    /* Rows [y0, y1) of a linear light level back to 8 bits */
+    template <int CHANNELS>
+    void encode_rows(const std::uint16_t* src, int width, bool srgb, unsigned char* dst, int y0, int y1) {
+        const int lanes = CHANNELS == 3 ? 4 : CHANNELS;
+        const bool alpha = CHANNELS == 2 || CHANNELS == 4;
+        const int colors = alpha ? CHANNELS - 1 : CHANNELS;
+        const unsigned char* to_srgb = gamma_tables().to_srgb.data();
+        src += std::size_t(y0) * width * lanes;
+        dst += std::size_t(y0) * width * CHANNELS;
+
+        std::size_t n = std::size_t(y1 - y0) * width;
+        for (std::size_t i = 0; i < n; ++i, src += lanes, dst += CHANNELS) {
+            for (int c = 0; c < colors; ++c) {
+                dst[c] = srgb ? to_srgb[src[c] >> (16 - SRGB_TABLE_BITS)] : narrow(src[c]);
+            }
+            if (alpha) {
+                dst[colors] = narrow(src[colors]);
+            }
+        }
+    }
+
+    void encode_rows(const std::uint16_t* src, int width, int channels, bool srgb, unsigned char* dst,
+                     int y0, int y1) {
+        switch (channels) {
+            case 1: encode_rows<1>(src, width, srgb, dst, y0, y1); break;
+            case 2: encode_rows<2>(src, width, srgb, dst, y0, y1); break;
+            case 3: encode_rows<3>(src, width, srgb, dst, y0, y1); break;
+            default: encode_rows<4>(src, width, srgb, dst, y0, y1); break;
+        }
+    }
+
+    /* Runs job(y0, y1) over bands of `rows` rows */
+    void for_each_band(ThreadPool& pool, int rows, int row_pixels, const std::function<void(int, int)>& job) {
+        int band = std::clamp(BAND_PIXELS / std::max(row_pixels, 1), 1, rows);
+        std::size_t n_bands = (rows + band - 1) / band;
+        if (n_bands == 1) {
+            job(0, rows);
+            return;
+        }
+        pool.parallel_for(n_bands, [&](std::size_t i) {
+            int y0 = int(i) * band;
+            job(y0, std::min(rows, y0 + band));
+        });
+    }
+
+    struct MipCacheHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t source_size;
+        std::int64_t source_time;
+        std::int32_t width;
+        std::int32_t height;
+        std::int32_t channels;
+        std::int32_t levels;
+        std::uint32_t srgb;
+        std::uint32_t reserved;
+    };
+
+    /* Header a valid cache entry for the given source and chain has */
+    std::optional<MipCacheHeader> cache_header(std::string_view source_path, int width, int height,
+                                               int channels, int levels, bool srgb) {
+        std::error_code error;
+        std::filesystem::path source{source_path};
+        auto size = std::filesystem::file_size(source, error);
+        if (error) {
+            return std::nullopt;
+        }
+        auto time = std::filesystem::last_write_time(source, error);
+        if (error) {
+            return std::nullopt;
+        }
+
+        MipCacheHeader header{};
+        std::memcpy(header.magic, MIP_CACHE_MAGIC, sizeof header.magic);
+        header.version = MIP_CACHE_VERSION;
+        header.source_size = size;
+        header.source_time = time.time_since_epoch().count();
+        header.width = width;
+        header.height = height;
+        header.channels = channels;
+        header.levels = levels;
+        header.srgb = srgb;
+        return header;
+    }
+
+    /* GL format of the 8-bit internal formats the importer uses, 0 for others */
+    GLenum pixel_format(GLint internal_format) {
+        switch (internal_format) {
+            case GL_R8: return GL_RED;
+            case GL_RG8: return GL_RG;
+            case GL_RGB8: return GL_RGB;
+            case GL_RGBA8: return GL_RGBA;
+            default: return 0;
+        }
+    }
+}
+
+int MipChain::level_width(int level) const {
+    return std::max(this->width >> level, 1);
+}
+
+int MipChain::level_height(int level) const {
+    return std::max(this->height >> level, 1);
+}
+
+std::size_t MipChain::level_offset(int level) const {
+    std::size_t offset = 0;
+    for (int i = 1; i < level; ++i) {
+        offset += std::size_t(level_width(i)) * level_height(i) * this->channels;
+    }
+    return offset;
+}
+
+const unsigned char* MipChain::level(int level) const {
+    return this->pixels.get() + level_offset(level);
+}
+
+std::size_t MipChain::bytes() const {
+    return level_offset(this->levels);
+}
+
+MipChain build_mip_chain(const unsigned char* level0, int width, int height, int channels, int levels,
+                         bool srgb, ThreadPool* pool) {
+    MipChain chain;
+    chain.width = width;
+    chain.height = height;
+    chain.channels = channels;
+    chain.levels = levels;
+    chain.pixels = std::make_unique_for_overwrite<unsigned char[]>(chain.bytes());
+
+    ThreadPool& workers = pool ? *pool : shared_pool();
+    int lanes = linear_lanes(channels);
+    std::unique_ptr<std::uint16_t[]> above;
+    std::unique_ptr<std::uint16_t[]> below;
+
+    /* Each level needs all of the one above, so levels are built in turn;
+     * within one, bands are reduced and encoded in the same job */
+    for (int level = 1; level < levels; ++level) {
+        int src_width = chain.level_width(level - 1);
+        int src_height = chain.level_height(level - 1);
+        int dst_width = chain.level_width(level);
+        int dst_height = chain.level_height(level);
+        below = std::make_unique_for_overwrite<std::uint16_t[]>(std::size_t(dst_width) * dst_height * lanes);
+        unsigned char* dst = chain.pixels.get() + chain.level_offset(level);
+
+        for_each_band(workers, dst_height, dst_width, [&](int y0, int y1) {
+            if (level == 1) {
+                reduce_level0(level0, src_width, src_height, channels, srgb, below.get(), dst_width, y0, y1);
+            } else {
+                reduce_linear(above.get(), src_width, src_height, lanes, below.get(), dst_width, y0, y1);
+            }
+            encode_rows(below.get(), dst_width, channels, srgb, dst, y0, y1);
+        });
+        above = std::move(below);
+    }
+    return chain;
+}
+
+std::filesystem::path mip_cache_dir = "../cache/mips";
+
+std::string mip_cache_path(std::string_view source_path, int width, int height) {
+    /* The name alone would collide between directories */
+    std::filesystem::path source{source_path};
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(source, error);
+    std::uint64_t key = fnv1a_64((error ? source : absolute).lexically_normal().string());
+
+    char name[48];
+    std::snprintf(name, sizeof name, ".%016llx.%dx%d.mips", static_cast<unsigned long long>(key), width, height);
+    return (mip_cache_dir / source.filename()).string() + name;
+}
+
+std::optional<MipChain> load_cached_mip_chain(std::string_view source_path, const DecodedImage& image,
+                                              int levels, bool srgb) {
+    auto expected = cache_header(source_path, image.width, image.height, image.channels, levels, srgb);
+    if (!expected) {
+        return std::nullopt;
+    }
+    std::ifstream in{mip_cache_path(source_path, image.width, image.height), std::ios::binary};
+    MipCacheHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof header)
+            || std::memcmp(&header, &*expected, sizeof header) != 0) {
+        return std::nullopt;
+    }
+
+    MipChain chain;
+    chain.width = image.width;
+    chain.height = image.height;
+    chain.channels = image.channels;
+    chain.levels = levels;
+    chain.pixels = std::make_unique_for_overwrite<unsigned char[]>(chain.bytes());
+    if (!in.read(reinterpret_cast<char*>(chain.pixels.get()), chain.bytes())) {
+        return std::nullopt;
+    }
+    return chain;
+}
+
+void store_cached_mip_chain(std::string_view source_path, const MipChain& chain, bool srgb) {
+    auto header = cache_header(source_path, chain.width, chain.height, chain.channels, chain.levels, srgb);
+    if (!header) {
+        return;
+    }
+
+    /* Written aside and renamed into place, so concurrent loads of the same
+     * image never read a partial entry */
+    std::string path = mip_cache_path(source_path, chain.width, chain.height);
+    std::error_code error;
+    std::filesystem::create_directories(mip_cache_dir, error);
+    std::string temp_path = path + '.' + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    bool written;
+    {
+        std::ofstream out{temp_path, std::ios::binary | std::ios::trunc};
+        written = out.write(reinterpret_cast<const char*>(&*header), sizeof *header)
+            && out.write(reinterpret_cast<const char*>(chain.pixels.get()), chain.bytes());
+    }
+    if (written) {
+        std::filesystem::rename(temp_path, path, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(temp_path, error);
+    }
+}
+
+MipChain cached_mip_chain(std::string_view source_path, const DecodedImage& image, int levels,
+                          bool srgb, ThreadPool* pool) {
+    if (auto chain = load_cached_mip_chain(source_path, image, levels, srgb)) {
+        return std::move(*chain);
+    }
+    MipChain chain = build_mip_chain(image.data, image.width, image.height, image.channels, levels, srgb, pool);
+    store_cached_mip_chain(source_path, chain, srgb);
+    return chain;
+}
+
+void ensure_mipmaps(bool srgb) {
+    GLint max_level = 0;
+    GLint width = 0;
+    GLint height = 0;
+    GLint level1_width = 0;
+    GLint internal_format = 0;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &max_level);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 1, GL_TEXTURE_WIDTH, &level1_width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+
+    /* Lazy imports have storage for level 1 on, but stop sampling at 0 */
+    int levels = mip_count(width, height);
+    if (max_level != 0 || level1_width == 0 || levels == 1) {
+        return;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    GLenum format = pixel_format(internal_format);
+    if (!format) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        return;
+    }
+
+    int channels = bytes_per_pixel(internal_format);
+    auto level0 = std::make_unique_for_overwrite<unsigned char[]>(std::size_t(width) * height * channels);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, format, GL_UNSIGNED_BYTE, level0.get());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    MipChain chain = build_mip_chain(level0.get(), width, height, channels, levels, srgb);
+    for (int level = 1; level < levels; ++level) {
+        int level_width = chain.level_width(level);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment(std::size_t(level_width) * channels));
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, level_width, chain.level_height(level), format,
+                GL_UNSIGNED_BYTE, chain.level(level));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
@@ -0,0 +1,1380 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include <glad/glad.h>
+
+#include <gl_ext.hpp>
+#include <null_gl.hpp>
+
+namespace {
+    /* Same order as gl_trace.cpp's, so gl_function_name() names them */
+    enum : std::size_t {
+#define AZ_GL_FUNCTION(name) fn_##name,
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+        FUNCTION_COUNT
+    };
+
+    /* Those whose functions gl_functions.inc has */
+    const char* const EXTENSIONS[] = {
+        "GL_ARB_texture_storage", "GL_ARB_get_program_binary", "GL_ARB_separate_shader_objects", "GL_KHR_debug",
+    };
+
+    /* Capabilities glIsEnabled and glGet* know about */
+    const GLenum CAPABILITIES[] = {
+        GL_BLEND, GL_COLOR_LOGIC_OP, GL_CULL_FACE, GL_DEBUG_OUTPUT, GL_DEBUG_OUTPUT_SYNCHRONOUS,
+        GL_DEPTH_CLAMP, GL_DEPTH_TEST, GL_DITHER, GL_FRAMEBUFFER_SRGB, GL_LINE_SMOOTH, GL_MULTISAMPLE,
+        GL_POLYGON_OFFSET_FILL, GL_POLYGON_OFFSET_LINE, GL_POLYGON_OFFSET_POINT, GL_POLYGON_SMOOTH,
+        GL_PRIMITIVE_RESTART, GL_PRIMITIVE_RESTART_FIXED_INDEX, GL_PROGRAM_POINT_SIZE, GL_RASTERIZER_DISCARD,
+        GL_SAMPLE_ALPHA_TO_COVERAGE, GL_SAMPLE_ALPHA_TO_ONE, GL_SAMPLE_COVERAGE, GL_SAMPLE_MASK,
+        GL_SAMPLE_SHADING, GL_SCISSOR_TEST, GL_STENCIL_TEST, GL_TEXTURE_CUBE_MAP_SEAMLESS,
+    };
+
+    struct Buffer {
+        std::vector<std::byte> data;
+        GLenum usage = GL_STATIC_DRAW;
+        bool mapped = false;
+        GLintptr map_offset = 0;
+        GLsizeiptr map_length = 0;
+        GLbitfield map_access = 0;
+    };
+
+    struct TextureLevel {
+        GLsizei width = 0;
+        GLsizei height = 0;
+        GLsizei depth = 0;
+        GLenum internal_format = GL_RGBA;
+        /* Size of the compressed image, 0 for uncompressed formats */
+        GLsizei compressed_size = 0;
+    };
+
+    struct Texture {
+        GLenum target = 0;
+        std::map<GLint, TextureLevel> levels;
+        std::map<GLenum, GLint> parameters;
+    };
+
+    struct Shader {
+        GLenum type;
+        std::string source;
+        bool compiled = false;
+    };
+
+    struct Program {
+        std::vector<GLuint> shaders;
+        bool linked = false;
+        /* Locations are handed out in the order names are asked for */
+        std::unordered_map<std::string, GLint> uniforms;
+        std::unordered_map<std::string, GLint> attributes;
+    };
+
+    struct Query {
+        GLenum target = 0;
+        GLuint64 result = 0;
+    };
+
+    struct VertexArray {
+        GLuint element_buffer = 0;
+    };
+
+    struct Renderbuffer {
+        GLsizei width = 0;
+        GLsizei height = 0;
+        GLenum internal_format = GL_RGBA;
+    };
+
+    /* Kinds of objects whose state is not kept */
+    struct Object {
+    };
+
+    struct State {
+        GLenum error = GL_NO_ERROR;
+
+        /* One counter for all kinds of objects, so names are never reused */
+        GLuint next_name = 1;
+        std::unordered_map<GLuint, Buffer> buffers;
+        /* Name 0 stands for the default texture and vertex array */
+        std::unordered_map<GLuint, Texture> textures{{0, {}}};
+        std::unordered_map<GLuint, VertexArray> vertex_arrays{{0, {}}};
+        std::unordered_map<GLuint, Shader> shaders;
+        std::unordered_map<GLuint, Program> programs;
+        std::unordered_map<GLuint, Query> queries;
+        std::unordered_map<GLuint, Renderbuffer> renderbuffers;
+        std::unordered_map<GLuint, Object> framebuffers;
+        std::unordered_map<GLuint, Object> samplers;
+        std::unordered_map<GLuint, Object> pipelines;
+        std::unordered_set<std::uintptr_t> syncs;
+        std::uintptr_t next_sync = 1;
+
+        /* The element array buffer binding is part of the vertex array */
+        std::unordered_map<GLenum, GLuint> buffer_bindings;
+        GLuint active_texture = 0;
+        std::map<std::pair<GLuint, GLenum>, GLuint> texture_bindings;
+        GLuint vertex_array = 0;
+        GLuint program = 0;
+        GLuint pipeline = 0;
+        GLuint draw_framebuffer = 0;
+        GLuint read_framebuffer = 0;
+        GLuint renderbuffer = 0;
+
+        std::unordered_set<GLenum> enabled{GL_DITHER, GL_MULTISAMPLE};
+        std::array<GLint, 4> viewport{};
+        std::array<GLint, 4> scissor{};
+        std::array<GLfloat, 4> clear_color{};
+        /* Source and destination factors, RGB then alpha */
+        std::array<GLenum, 4> blend{GL_ONE, GL_ZERO, GL_ONE, GL_ZERO};
+        GLenum depth_func = GL_LESS;
+        GLint pack_alignment = 4;
+        GLint unpack_alignment = 4;
+    };
+
+    State state;
+    bool recording = false;
+    NullGlRecording recorded;
+
+    /* Like GL, keeps the first error until glGetError reads it */
+    void fail(GLenum error) {
+        if (state.error == GL_NO_ERROR) {
+            state.error = error;
+        }
+    }
+
+    std::uint64_t now_ns() {
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    template <typename T>
+    std::uint64_t widen(T value) {
+        if constexpr (std::is_pointer_v<T>) {
+            return std::uint64_t(reinterpret_cast<std::uintptr_t>(value));
+        } else if constexpr (std::is_same_v<T, float>) {
+            return std::bit_cast<std::uint32_t>(value);
+        } else if constexpr (std::is_same_v<T, double>) {
+            return std::bit_cast<std::uint64_t>(value);
+        } else {
+            return std::uint64_t(value);
+        }
+    }
+
+    template <typename... Args>
+    void record(std::size_t function, Args... args) {
+        recorded.commands.push_back({std::uint32_t(function), std::uint32_t(recorded.args.size()),
+                                     std::uint32_t(sizeof...(Args))});
+        (recorded.args.push_back(widen(args)), ...);
+    }
+
+    template <typename Objects>
+    void generate(Objects& objects, GLsizei n, GLuint* names) {
+        if (n < 0) {
+            fail(GL_INVALID_VALUE);
+            return;
+        }
+        for (GLsizei i = 0; i < n; ++i) {
+            names[i] = state.next_name++;
+            objects.try_emplace(names[i]);
+        }
+    }
+
+    /* Deletes the objects and resets the binding where one of them was bound */
+    template <typename Objects>
+    void remove(Objects& objects, GLsizei n, const GLuint* names, GLuint* binding = nullptr) {
+        if (n < 0) {
+            fail(GL_INVALID_VALUE);
+            return;
+        }
+        for (GLsizei i = 0; i < n; ++i) {
+            if (names[i] == 0) {
+                continue;
+            }
+            objects.erase(names[i]);
+            if (binding && *binding == names[i]) {
+                *binding = 0;
+            }
+        }
+    }
+
+    template <typename Objects>
+    GLboolean exists(const Objects& objects, GLuint name) {
+        return name != 0 && objects.contains(name) ? GL_TRUE : GL_FALSE;
+    }
+
+    /* Objects of most kinds come into existence when first bound, too */
+    template <typename Objects>
+    void bind(Objects& objects, GLuint& binding, GLuint name) {
+        if (name != 0) {
+            objects.try_emplace(name);
+        }
+        binding = name;
+    }
+
+    GLuint& buffer_binding(GLenum target) {
+        if (target == GL_ELEMENT_ARRAY_BUFFER) {
+            return state.vertex_arrays[state.vertex_array].element_buffer;
+        }
+        return state.buffer_bindings[target];
+    }
+
+    Buffer* named_buffer(GLuint name) {
+        auto buffer = state.buffers.find(name);
+        if (name == 0 || buffer == state.buffers.end()) {
+            fail(GL_INVALID_OPERATION);
+            return nullptr;
+        }
+        return &buffer->second;
+    }
+
+    Buffer* bound_buffer(GLenum target) {
+        return named_buffer(buffer_binding(target));
+    }
+
+    void buffer_data(Buffer* buffer, GLsizeiptr size, const void* data, GLenum usage) {
+        if (!buffer) {
+            return;
+        }
+        if (size < 0) {
+            fail(GL_INVALID_VALUE);
+            return;
+        }
+        buffer->data.resize(std::size_t(size));
+        if (data) {
+            std::memcpy(buffer->data.data(), data, std::size_t(size));
+        }
+        buffer->usage = usage;
+        buffer->mapped = false;
+    }
+
+    void buffer_sub_data(Buffer* buffer, GLintptr offset, GLsizeiptr size, const void* data) {
+        if (!buffer) {
+            return;
+        }
+        if (offset < 0 || size < 0 || std::size_t(offset + size) > buffer->data.size()) {
+            fail(GL_INVALID_VALUE);
+            return;
+        }
+        if (data) {
+            std::memcpy(buffer->data.data() + offset, data, std::size_t(size));
+        }
+    }
+
+    void* map_buffer(Buffer* buffer, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+        if (!buffer) {
+            return nullptr;
+        }
+        if (buffer->mapped) {
+            fail(GL_INVALID_OPERATION);
+            return nullptr;
+        }
+        if (offset < 0 || length < 0 || std::size_t(offset + length) > buffer->data.size()) {
+            fail(GL_INVALID_VALUE);
+            return nullptr;
+        }
+        buffer->mapped = true;
+        buffer->map_offset = offset;
+        buffer->map_length = length;
+        buffer->map_access = access;
+        return buffer->data.data() + offset;
+    }
+
+    GLboolean unmap_buffer(Buffer* buffer) {
+        if (!buffer) {
+            return GL_FALSE;
+        }
+        if (!buffer->mapped) {
+            fail(GL_INVALID_OPERATION);
+            return GL_FALSE;
+        }
+        buffer->mapped = false;
+        return GL_TRUE;
+    }
+
+    template <typename T>
+    void buffer_parameter(Buffer* buffer, GLenum pname, T* value) {
+        if (!buffer) {
+            return;
+        }
+        switch (pname) {
+            case GL_BUFFER_SIZE: *value = T(buffer->data.size()); break;
+            case GL_BUFFER_USAGE: *value = T(buffer->usage); break;
+            case GL_BUFFER_MAPPED: *value = T(buffer->mapped); break;
+            case GL_BUFFER_ACCESS_FLAGS: *value = T(buffer->map_access); break;
+            case GL_BUFFER_MAP_OFFSET: *value = T(buffer->map_offset); break;
+            case GL_BUFFER_MAP_LENGTH: *value = T(buffer->map_length); break;
+            default: fail(GL_INVALID_ENUM);
+        }
+    }
+
+    /* Cube map faces are bound, and sized, as the cube map */
+    GLenum binding_target(GLenum target) {
+        if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z) {
+            return GL_TEXTURE_CUBE_MAP;
+        }
+        return target;
+    }
+
+    GLuint& texture_binding(GLenum target) {
+        return state.texture_bindings[{state.active_texture, binding_target(target)}];
+    }
+
+    Texture* named_texture(GLuint name) {
+        auto texture = state.textures.find(name);
+        if (texture == state.textures.end()) {
+            fail(GL_INVALID_OPERATION);
+            return nullptr;
+        }
+        return &texture->second;
+    }
+
+    Texture* bound_texture(GLenum target) {
+        return named_texture(texture_binding(target));
+    }
+
+    void texture_image(Texture* texture, GLint level, GLenum internal_format, GLsizei width, GLsizei height,
+                       GLsizei depth, GLsizei compressed_size = 0) {
+        if (!texture) {
+            return;
+        }
+        if (level < 0 || width < 0 || height < 0 || depth < 0) {
+            fail(GL_INVALID_VALUE);
+            return;
+        }
+        texture->levels[level] = {width, height, depth, internal_format, compressed_size};
+    }
+
+    void texture_storage(Texture* texture, GLsizei levels, GLenum internal_format, GLsizei width,
+                         GLsizei height, GLsizei depth) {
+        if (!texture) {
+            return;
+        }
+        if (levels < 1 || width < 1 || height < 1 || depth < 1) {
+            fail(GL_INVALID_VALUE);
+            return;
+        }
+        bool volume = texture->target == GL_TEXTURE_3D;
+        for (GLint level = 0; level < levels; ++level) {
+            texture->levels[level] = {width, height, depth, internal_format, 0};
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+            depth = volume ? std::max(depth / 2, 1) : depth;
+        }
+        texture->parameters[GL_TEXTURE_IMMUTABLE_FORMAT] = GL_TRUE;
+        texture->parameters[GL_TEXTURE_IMMUTABLE_LEVELS] = levels;
+    }
+
+    void generate_mipmap(Texture* texture) {
+        if (!texture) {
+            return;
+        }
+        auto base = texture->levels.find(0);
+        if (base == texture->levels.end()) {
+            fail(GL_INVALID_OPERATION);
+            return;
+        }
+        TextureLevel level = base->second;
+        bool volume = texture->target == GL_TEXTURE_3D;
+        for (GLint i = 1; level.width > 1 || level.height > 1 || (volume && level.depth > 1); ++i) {
+            level.width = std::max(level.width / 2, 1);
+            level.height = std::max(level.height / 2, 1);
+            level.depth = volume ? std::max(level.depth / 2, 1) : level.depth;
+            level.compressed_size = 0;
+            texture->levels[i] = level;
+        }
+    }
+
+    GLint texture_parameter(const Texture& texture, GLenum pname) {
+        auto value = texture.parameters.find(pname);
+        if (value != texture.parameters.end()) {
+            return value->second;
+        }
+        switch (pname) {
+            case GL_TEXTURE_MIN_FILTER: return GL_NEAREST_MIPMAP_LINEAR;
+            case GL_TEXTURE_MAG_FILTER: return GL_LINEAR;
+            case GL_TEXTURE_WRAP_S:
+            case GL_TEXTURE_WRAP_T:
+            case GL_TEXTURE_WRAP_R: return GL_REPEAT;
+            case GL_TEXTURE_MAX_LEVEL: return 1000;
+            case GL_TEXTURE_SWIZZLE_R: return GL_RED;
+            case GL_TEXTURE_SWIZZLE_G: return GL_GREEN;
+            case GL_TEXTURE_SWIZZLE_B: return GL_BLUE;
+            case GL_TEXTURE_SWIZZLE_A: return GL_ALPHA;
+            default: return 0;
+        }
+    }
+
+    template <typename T>
+    void texture_level_parameter(Texture* texture, GLint level, GLenum pname, T* value) {
+        if (!texture) {
+            return;
+        }
+        TextureLevel image;
+        if (auto found = texture->levels.find(level); found != texture->levels.end()) {
+            image = found->second;
+        }
+        switch (pname) {
+            case GL_TEXTURE_WIDTH: *value = T(image.width); break;
+            case GL_TEXTURE_HEIGHT: *value = T(image.height); break;
+            case GL_TEXTURE_DEPTH: *value = T(image.depth); break;
+            case GL_TEXTURE_INTERNAL_FORMAT: *value = T(image.internal_format); break;
+            case GL_TEXTURE_COMPRESSED: *value = T(image.compressed_size > 0); break;
+            case GL_TEXTURE_COMPRESSED_IMAGE_SIZE: *value = T(image.compressed_size); break;
+            default: fail(GL_INVALID_ENUM);
+        }
+    }
+
+    Shader* named_shader(GLuint name) {
+        auto shader = state.shaders.find(name);
+        if (shader == state.shaders.end()) {
+            fail(GL_INVALID_VALUE);
+            return nullptr;
+        }
+        return &shader->second;
+    }
+
+    Program* named_program(GLuint name) {
+        auto program = state.programs.find(name);
+        if (program == state.programs.end()) {
+            fail(GL_INVALID_VALUE);
+            return nullptr;
+        }
+        return &program->second;
+    }
+
+    /* Nothing ever goes wrong, so info logs are always empty */
+    void empty_log(GLsizei max_length, GLsizei* length, GLchar* log) {
+        if (length) {
+            *length = 0;
+        }
+        if (log && max_length > 0) {
+            log[0] = '\0';
+        }
+    }
+
+    GLint location(GLuint program_name, const GLchar* name, bool attribute) {
+        Program* program = named_program(program_name);
+        if (!program) {
+            return -1;
+        }
+        if (!program->linked) {
+            fail(GL_INVALID_OPERATION);
+            return -1;
+        }
+        if (std::strncmp(name, "gl_", 3) == 0) {
+            return -1;
+        }
+        auto& locations = attribute ? program->attributes : program->uniforms;
+        return locations.try_emplace(name, GLint(locations.size())).first->second;
+    }
+
+    template <typename T>
+    void query_result(GLuint name, GLenum pname, T* value) {
+        auto query = state.queries.find(name);
+        if (query == state.queries.end()) {
+            fail(GL_INVALID_OPERATION);
+            return;
+        }
+        switch (pname) {
+            case GL_QUERY_RESULT:
+            case GL_QUERY_RESULT_NO_WAIT: *value = T(query->second.result); break;
+            case GL_QUERY_RESULT_AVAILABLE: *value = T(GL_TRUE); break;
+            case GL_QUERY_TARGET: *value = T(query->second.target); break;
+            default: fail(GL_INVALID_ENUM);
+        }
+    }
+
+    /* Up to four values of a glGet* parameter; none if it is unknown */
+    struct Values {
+        std::array<double, 4> values{};
+        int count = 0;
+    };
+
+    Values get(GLenum pname) {
+        auto one = [](double value) { return Values{{value}, 1}; };
+        auto four = [](const auto& values) {
+            return Values{{double(values[0]), double(values[1]), double(values[2]), double(values[3])}, 4};
+        };
+        switch (pname) {
+            case GL_MAJOR_VERSION: return one(3);
+            case GL_MINOR_VERSION: return one(3);
+            case GL_CONTEXT_PROFILE_MASK: return one(GL_CONTEXT_CORE_PROFILE_BIT);
+            case GL_CONTEXT_FLAGS: return one(0);
+            case GL_NUM_EXTENSIONS: return one(double(std::size(EXTENSIONS)));
+            case GL_NUM_PROGRAM_BINARY_FORMATS: return one(0);
+            case GL_NUM_SHADER_BINARY_FORMATS: return one(0);
+            case GL_MAX_TEXTURE_SIZE: return one(16384);
+            case GL_MAX_3D_TEXTURE_SIZE: return one(2048);
+            case GL_MAX_CUBE_MAP_TEXTURE_SIZE: return one(16384);
+            case GL_MAX_ARRAY_TEXTURE_LAYERS: return one(2048);
+            case GL_MAX_RENDERBUFFER_SIZE: return one(16384);
+            case GL_MAX_VIEWPORT_DIMS: return {{16384, 16384}, 2};
+            case GL_MAX_TEXTURE_IMAGE_UNITS: return one(32);
+            case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS: return one(192);
+            case GL_MAX_VERTEX_ATTRIBS: return one(16);
+            case GL_MAX_UNIFORM_BUFFER_BINDINGS: return one(84);
+            case GL_MAX_UNIFORM_BLOCK_SIZE: return one(65536);
+            case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: return one(256);
+            case GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS: return one(16);
+            case GL_MAX_DRAW_BUFFERS: return one(8);
+            case GL_MAX_COLOR_ATTACHMENTS: return one(8);
+            case GL_MAX_SAMPLES: return one(8);
+            case GL_MAX_TEXTURE_MAX_ANISOTROPY: return one(16);
+            case GL_MAX_ELEMENTS_VERTICES: return one(1 << 20);
+            case GL_MAX_ELEMENTS_INDICES: return one(1 << 20);
+            case GL_TIMESTAMP: return one(double(now_ns()));
+
+            case GL_ARRAY_BUFFER_BINDING: return one(state.buffer_bindings[GL_ARRAY_BUFFER]);
+            case GL_ELEMENT_ARRAY_BUFFER_BINDING: return one(buffer_binding(GL_ELEMENT_ARRAY_BUFFER));
+            case GL_UNIFORM_BUFFER_BINDING: return one(state.buffer_bindings[GL_UNIFORM_BUFFER]);
+            case GL_PIXEL_PACK_BUFFER_BINDING: return one(state.buffer_bindings[GL_PIXEL_PACK_BUFFER]);
+            case GL_PIXEL_UNPACK_BUFFER_BINDING: return one(state.buffer_bindings[GL_PIXEL_UNPACK_BUFFER]);
+            case GL_COPY_READ_BUFFER_BINDING: return one(state.buffer_bindings[GL_COPY_READ_BUFFER]);
+            case GL_COPY_WRITE_BUFFER_BINDING: return one(state.buffer_bindings[GL_COPY_WRITE_BUFFER]);
+            case GL_DRAW_INDIRECT_BUFFER_BINDING: return one(state.buffer_bindings[GL_DRAW_INDIRECT_BUFFER]);
+            case GL_SHADER_STORAGE_BUFFER_BINDING: return one(state.buffer_bindings[GL_SHADER_STORAGE_BUFFER]);
+            case GL_ACTIVE_TEXTURE: return one(GL_TEXTURE0 + state.active_texture);
+            case GL_TEXTURE_BINDING_1D: return one(texture_binding(GL_TEXTURE_1D));
+            case GL_TEXTURE_BINDING_2D: return one(texture_binding(GL_TEXTURE_2D));
+            case GL_TEXTURE_BINDING_3D: return one(texture_binding(GL_TEXTURE_3D));
+            case GL_TEXTURE_BINDING_2D_ARRAY: return one(texture_binding(GL_TEXTURE_2D_ARRAY));
+            case GL_TEXTURE_BINDING_CUBE_MAP: return one(texture_binding(GL_TEXTURE_CUBE_MAP));
+            case GL_VERTEX_ARRAY_BINDING: return one(state.vertex_array);
+            case GL_CURRENT_PROGRAM: return one(state.program);
+            case GL_PROGRAM_PIPELINE_BINDING: return one(state.pipeline);
+            case GL_DRAW_FRAMEBUFFER_BINDING: return one(state.draw_framebuffer);
+            case GL_READ_FRAMEBUFFER_BINDING: return one(state.read_framebuffer);
+            case GL_RENDERBUFFER_BINDING: return one(state.renderbuffer);
+
+            case GL_VIEWPORT: return four(state.viewport);
+            case GL_SCISSOR_BOX: return four(state.scissor);
+            case GL_COLOR_CLEAR_VALUE: return four(state.clear_color);
+            case GL_BLEND_SRC_RGB: return one(state.blend[0]);
+            case GL_BLEND_DST_RGB: return one(state.blend[1]);
+            case GL_BLEND_SRC_ALPHA: return one(state.blend[2]);
+            case GL_BLEND_DST_ALPHA: return one(state.blend[3]);
+            case GL_DEPTH_FUNC: return one(state.depth_func);
+            case GL_PACK_ALIGNMENT: return one(state.pack_alignment);
+            case GL_UNPACK_ALIGNMENT: return one(state.unpack_alignment);
+        }
+        if (std::find(std::begin(CAPABILITIES), std::end(CAPABILITIES), pname) != std::end(CAPABILITIES)) {
+            return one(state.enabled.contains(pname));
+        }
+        return {};
+    }
+
+    template <typename T>
+    void get_as(GLenum pname, T* data) {
+        Values values = get(pname);
+        if (values.count == 0) {
+            fail(GL_INVALID_ENUM);
+            return;
+        }
+        for (int i = 0; i < values.count; ++i) {
+            if constexpr (std::is_same_v<T, GLboolean>) {
+                data[i] = values.values[i] != 0.0 ? GL_TRUE : GL_FALSE;
+            } else {
+                data[i] = T(values.values[i]);
+            }
+        }
+    }
+
+    void set_enabled(GLenum capability, bool enabled) {
+        if (std::find(std::begin(CAPABILITIES), std::end(CAPABILITIES), capability) == std::end(CAPABILITIES)) {
+            fail(GL_INVALID_ENUM);
+        } else if (enabled) {
+            state.enabled.insert(capability);
+        } else {
+            state.enabled.erase(capability);
+        }
+    }
+
+    const GLubyte* string(const char* value) {
+        return reinterpret_cast<const GLubyte*>(value);
+    }
+
+    /* In-memory implementations, by function; calls without one are only
+     * recorded and return 0 */
+    template <std::size_t Function>
+    struct Impl {
+    };
+
+    template <> struct Impl<fn_glGetError> {
+        static GLenum call() {
+            return std::exchange(state.error, GLenum(GL_NO_ERROR));
+        }
+    };
+
+    template <> struct Impl<fn_glGetString> {
+        static const GLubyte* call(GLenum name) {
+            switch (name) {
+                case GL_VENDOR: return string("az");
+                case GL_RENDERER: return string("null");
+                case GL_VERSION: return string("3.3.0 Core Profile (null)");
+                case GL_SHADING_LANGUAGE_VERSION: return string("3.30");
+                default: fail(GL_INVALID_ENUM); return nullptr;
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetStringi> {
+        static const GLubyte* call(GLenum name, GLuint index) {
+            if (name != GL_EXTENSIONS) {
+                fail(GL_INVALID_ENUM);
+                return nullptr;
+            }
+            if (index >= std::size(EXTENSIONS)) {
+                fail(GL_INVALID_VALUE);
+                return nullptr;
+            }
+            return string(EXTENSIONS[index]);
+        }
+    };
+
+    template <> struct Impl<fn_glGetBooleanv> {
+        static void call(GLenum pname, GLboolean* data) { get_as(pname, data); }
+    };
+
+    template <> struct Impl<fn_glGetIntegerv> {
+        static void call(GLenum pname, GLint* data) { get_as(pname, data); }
+    };
+
+    template <> struct Impl<fn_glGetInteger64v> {
+        static void call(GLenum pname, GLint64* data) { get_as(pname, data); }
+    };
+
+    template <> struct Impl<fn_glGetFloatv> {
+        static void call(GLenum pname, GLfloat* data) { get_as(pname, data); }
+    };
+
+    template <> struct Impl<fn_glGetDoublev> {
+        static void call(GLenum pname, GLdouble* data) { get_as(pname, data); }
+    };
+
+    template <> struct Impl<fn_glEnable> {
+        static void call(GLenum capability) { set_enabled(capability, true); }
+    };
+
+    template <> struct Impl<fn_glDisable> {
+        static void call(GLenum capability) { set_enabled(capability, false); }
+    };
+
+    template <> struct Impl<fn_glIsEnabled> {
+        static GLboolean call(GLenum capability) { return state.enabled.contains(capability); }
+    };
+
+    template <> struct Impl<fn_glViewport> {
+        static void call(GLint x, GLint y, GLsizei width, GLsizei height) { state.viewport = {x, y, width, height}; }
+    };
+
+    template <> struct Impl<fn_glScissor> {
+        static void call(GLint x, GLint y, GLsizei width, GLsizei height) { state.scissor = {x, y, width, height}; }
+    };
+
+    template <> struct Impl<fn_glClearColor> {
+        static void call(GLfloat r, GLfloat g, GLfloat b, GLfloat a) { state.clear_color = {r, g, b, a}; }
+    };
+
+    template <> struct Impl<fn_glBlendFunc> {
+        static void call(GLenum source, GLenum destination) {
+            state.blend = {source, destination, source, destination};
+        }
+    };
+
+    template <> struct Impl<fn_glBlendFuncSeparate> {
+        static void call(GLenum source_rgb, GLenum destination_rgb, GLenum source_alpha, GLenum destination_alpha) {
+            state.blend = {source_rgb, destination_rgb, source_alpha, destination_alpha};
+        }
+    };
+
+    template <> struct Impl<fn_glDepthFunc> {
+        static void call(GLenum function) { state.depth_func = function; }
+    };
+
+    template <> struct Impl<fn_glPixelStorei> {
+        static void call(GLenum pname, GLint value) {
+            if (pname == GL_PACK_ALIGNMENT) {
+                state.pack_alignment = value;
+            } else if (pname == GL_UNPACK_ALIGNMENT) {
+                state.unpack_alignment = value;
+            }
+        }
+    };
+
+    /* Buffers */
+
+    template <> struct Impl<fn_glGenBuffers> {
+        static void call(GLsizei n, GLuint* buffers) { generate(state.buffers, n, buffers); }
+    };
+
+    template <> struct Impl<fn_glDeleteBuffers> {
+        static void call(GLsizei n, const GLuint* buffers) {
+            remove(state.buffers, n, buffers);
+            for (auto& [target, binding] : state.buffer_bindings) {
+                remove(state.buffers, n, buffers, &binding);
+            }
+            remove(state.buffers, n, buffers, &state.vertex_arrays[state.vertex_array].element_buffer);
+        }
+    };
+
+    template <> struct Impl<fn_glIsBuffer> {
+        static GLboolean call(GLuint buffer) { return exists(state.buffers, buffer); }
+    };
+
+    template <> struct Impl<fn_glBindBuffer> {
+        static void call(GLenum target, GLuint buffer) { bind(state.buffers, buffer_binding(target), buffer); }
+    };
+
+    template <> struct Impl<fn_glBindBufferBase> {
+        static void call(GLenum target, GLuint, GLuint buffer) { bind(state.buffers, buffer_binding(target), buffer); }
+    };
+
+    template <> struct Impl<fn_glBindBufferRange> {
+        static void call(GLenum target, GLuint, GLuint buffer, GLintptr, GLsizeiptr) {
+            bind(state.buffers, buffer_binding(target), buffer);
+        }
+    };
+
+    template <> struct Impl<fn_glBufferData> {
+        static void call(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+            buffer_data(bound_buffer(target), size, data, usage);
+        }
+    };
+
+    template <> struct Impl<fn_glBufferSubData> {
+        static void call(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+            buffer_sub_data(bound_buffer(target), offset, size, data);
+        }
+    };
+
+    template <> struct Impl<fn_glGetBufferSubData> {
+        static void call(GLenum target, GLintptr offset, GLsizeiptr size, void* data) {
+            Buffer* buffer = bound_buffer(target);
+            if (!buffer) {
+                return;
+            }
+            if (offset < 0 || size < 0 || std::size_t(offset + size) > buffer->data.size()) {
+                fail(GL_INVALID_VALUE);
+                return;
+            }
+            std::memcpy(data, buffer->data.data() + offset, std::size_t(size));
+        }
+    };
+
+    template <> struct Impl<fn_glMapBuffer> {
+        static void* call(GLenum target, GLenum access) {
+            Buffer* buffer = bound_buffer(target);
+            GLbitfield bits = access == GL_READ_ONLY ? GL_MAP_READ_BIT
+                : access == GL_WRITE_ONLY ? GL_MAP_WRITE_BIT : GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
+            return buffer ? map_buffer(buffer, 0, GLsizeiptr(buffer->data.size()), bits) : nullptr;
+        }
+    };
+
+    template <> struct Impl<fn_glMapBufferRange> {
+        static void* call(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+            return map_buffer(bound_buffer(target), offset, length, access);
+        }
+    };
+
+    template <> struct Impl<fn_glUnmapBuffer> {
+        static GLboolean call(GLenum target) { return unmap_buffer(bound_buffer(target)); }
+    };
+
+    template <> struct Impl<fn_glGetBufferParameteriv> {
+        static void call(GLenum target, GLenum pname, GLint* value) {
+            buffer_parameter(bound_buffer(target), pname, value);
+        }
+    };
+
+    template <> struct Impl<fn_glGetBufferParameteri64v> {
+        static void call(GLenum target, GLenum pname, GLint64* value) {
+            buffer_parameter(bound_buffer(target), pname, value);
+        }
+    };
+
+    /* Vertex arrays */
+
+    template <> struct Impl<fn_glGenVertexArrays> {
+        static void call(GLsizei n, GLuint* arrays) { generate(state.vertex_arrays, n, arrays); }
+    };
+
+    template <> struct Impl<fn_glDeleteVertexArrays> {
+        static void call(GLsizei n, const GLuint* arrays) { remove(state.vertex_arrays, n, arrays, &state.vertex_array); }
+    };
+
+    template <> struct Impl<fn_glIsVertexArray> {
+        static GLboolean call(GLuint array) { return exists(state.vertex_arrays, array); }
+    };
+
+    template <> struct Impl<fn_glBindVertexArray> {
+        static void call(GLuint array) { bind(state.vertex_arrays, state.vertex_array, array); }
+    };
+
+    /* Textures */
+
+    template <> struct Impl<fn_glGenTextures> {
+        static void call(GLsizei n, GLuint* textures) { generate(state.textures, n, textures); }
+    };
+
+    template <> struct Impl<fn_glDeleteTextures> {
+        static void call(GLsizei n, const GLuint* textures) {
+            remove(state.textures, n, textures);
+            for (auto& [unit_target, binding] : state.texture_bindings) {
+                remove(state.textures, n, textures, &binding);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glIsTexture> {
+        static GLboolean call(GLuint texture) { return exists(state.textures, texture); }
+    };
+
+    template <> struct Impl<fn_glActiveTexture> {
+        static void call(GLenum unit) { state.active_texture = unit - GL_TEXTURE0; }
+    };
+
+    template <> struct Impl<fn_glBindTexture> {
+        static void call(GLenum target, GLuint texture) {
+            bind(state.textures, texture_binding(target), texture);
+            if (texture != 0 && state.textures[texture].target == 0) {
+                state.textures[texture].target = target;
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glTexImage2D> {
+        static void call(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint,
+                         GLenum, GLenum, const void*) {
+            texture_image(bound_texture(target), level, GLenum(internal_format), width, height, 1);
+        }
+    };
+
+    template <> struct Impl<fn_glTexImage3D> {
+        static void call(GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height,
+                         GLsizei depth, GLint, GLenum, GLenum, const void*) {
+            texture_image(bound_texture(target), level, GLenum(internal_format), width, height, depth);
+        }
+    };
+
+    template <> struct Impl<fn_glCompressedTexImage2D> {
+        static void call(GLenum target, GLint level, GLenum internal_format, GLsizei width, GLsizei height, GLint,
+                         GLsizei size, const void*) {
+            texture_image(bound_texture(target), level, internal_format, width, height, 1, size);
+        }
+    };
+
+    template <> struct Impl<fn_glTexStorage2D> {
+        static void call(GLenum target, GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height) {
+            texture_storage(bound_texture(target), levels, internal_format, width, height, 1);
+        }
+    };
+
+    template <> struct Impl<fn_glTexStorage3D> {
+        static void call(GLenum target, GLsizei levels, GLenum internal_format, GLsizei width, GLsizei height,
+                         GLsizei depth) {
+            texture_storage(bound_texture(target), levels, internal_format, width, height, depth);
+        }
+    };
+
+    template <> struct Impl<fn_glCompressedTexSubImage2D> {
+        static void call(GLenum target, GLint level, GLint, GLint, GLsizei, GLsizei, GLenum, GLsizei size,
+                         const void*) {
+            /* Compressed formats are only known compressed once data arrives */
+            Texture* texture = bound_texture(target);
+            if (texture && texture->levels.contains(level)) {
+                TextureLevel& image = texture->levels[level];
+                image.compressed_size = std::max(image.compressed_size, size);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGenerateMipmap> {
+        static void call(GLenum target) { generate_mipmap(bound_texture(target)); }
+    };
+
+    template <> struct Impl<fn_glTexParameteri> {
+        static void call(GLenum target, GLenum pname, GLint value) {
+            if (Texture* texture = bound_texture(target)) {
+                texture->parameters[pname] = value;
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glTexParameteriv> {
+        static void call(GLenum target, GLenum pname, const GLint* values) {
+            if (Texture* texture = bound_texture(target)) {
+                texture->parameters[pname] = values[0];
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetTexParameteriv> {
+        static void call(GLenum target, GLenum pname, GLint* value) {
+            if (Texture* texture = bound_texture(target)) {
+                *value = texture_parameter(*texture, pname);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetTexLevelParameteriv> {
+        static void call(GLenum target, GLint level, GLenum pname, GLint* value) {
+            texture_level_parameter(bound_texture(target), level, pname, value);
+        }
+    };
+
+    template <> struct Impl<fn_glGetTexLevelParameterfv> {
+        static void call(GLenum target, GLint level, GLenum pname, GLfloat* value) {
+            texture_level_parameter(bound_texture(target), level, pname, value);
+        }
+    };
+
+    /* Shaders and programs */
+
+    template <> struct Impl<fn_glCreateShader> {
+        static GLuint call(GLenum type) {
+            GLuint name = state.next_name++;
+            state.shaders[name] = {.type = type, .source = {}};
+            return name;
+        }
+    };
+
+    template <> struct Impl<fn_glDeleteShader> {
+        static void call(GLuint shader) { state.shaders.erase(shader); }
+    };
+
+    template <> struct Impl<fn_glIsShader> {
+        static GLboolean call(GLuint shader) { return exists(state.shaders, shader); }
+    };
+
+    template <> struct Impl<fn_glShaderSource> {
+        static void call(GLuint shader_name, GLsizei count, const GLchar* const* strings, const GLint* lengths) {
+            Shader* shader = named_shader(shader_name);
+            if (!shader) {
+                return;
+            }
+            shader->source.clear();
+            for (GLsizei i = 0; i < count; ++i) {
+                if (lengths && lengths[i] >= 0) {
+                    shader->source.append(strings[i], std::size_t(lengths[i]));
+                } else {
+                    shader->source.append(strings[i]);
+                }
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glCompileShader> {
+        static void call(GLuint shader_name) {
+            if (Shader* shader = named_shader(shader_name)) {
+                shader->compiled = true;
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetShaderiv> {
+        static void call(GLuint shader_name, GLenum pname, GLint* value) {
+            Shader* shader = named_shader(shader_name);
+            if (!shader) {
+                return;
+            }
+            switch (pname) {
+                case GL_SHADER_TYPE: *value = GLint(shader->type); break;
+                case GL_COMPILE_STATUS: *value = shader->compiled; break;
+                case GL_DELETE_STATUS: *value = GL_FALSE; break;
+                case GL_INFO_LOG_LENGTH: *value = 0; break;
+                case GL_SHADER_SOURCE_LENGTH:
+                    *value = shader->source.empty() ? 0 : GLint(shader->source.size() + 1);
+                    break;
+                default: fail(GL_INVALID_ENUM);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetShaderInfoLog> {
+        static void call(GLuint shader, GLsizei max_length, GLsizei* length, GLchar* log) {
+            if (named_shader(shader)) {
+                empty_log(max_length, length, log);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetShaderSource> {
+        static void call(GLuint shader_name, GLsizei max_length, GLsizei* length, GLchar* source) {
+            Shader* shader = named_shader(shader_name);
+            if (!shader || max_length <= 0) {
+                return;
+            }
+            std::size_t size = std::min(shader->source.size(), std::size_t(max_length - 1));
+            std::memcpy(source, shader->source.data(), size);
+            source[size] = '\0';
+            if (length) {
+                *length = GLsizei(size);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glCreateProgram> {
+        static GLuint call() {
+            GLuint name = state.next_name++;
+            state.programs[name] = {};
+            return name;
+        }
+    };
+
+    template <> struct Impl<fn_glCreateShaderProgramv> {
+        static GLuint call(GLenum, GLsizei, const GLchar* const*) {
+            GLuint name = state.next_name++;
+            state.programs[name].linked = true;
+            return name;
+        }
+    };
+
+    template <> struct Impl<fn_glDeleteProgram> {
+        static void call(GLuint program) { state.programs.erase(program); }
+    };
+
+    template <> struct Impl<fn_glIsProgram> {
+        static GLboolean call(GLuint program) { return exists(state.programs, program); }
+    };
+
+    template <> struct Impl<fn_glAttachShader> {
+        static void call(GLuint program_name, GLuint shader) {
+            if (Program* program = named_program(program_name); program && named_shader(shader)) {
+                program->shaders.push_back(shader);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glDetachShader> {
+        static void call(GLuint program_name, GLuint shader) {
+            if (Program* program = named_program(program_name)) {
+                std::erase(program->shaders, shader);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glLinkProgram> {
+        static void call(GLuint program_name) {
+            if (Program* program = named_program(program_name)) {
+                program->linked = true;
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glProgramBinary> {
+        static void call(GLuint program_name, GLenum, const void*, GLsizei) {
+            /* No binary formats are supported, so no binary is valid */
+            if (Program* program = named_program(program_name)) {
+                program->linked = false;
+                fail(GL_INVALID_ENUM);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetProgramiv> {
+        static void call(GLuint program_name, GLenum pname, GLint* value) {
+            Program* program = named_program(program_name);
+            if (!program) {
+                return;
+            }
+            switch (pname) {
+                case GL_LINK_STATUS: *value = program->linked; break;
+                case GL_VALIDATE_STATUS: *value = program->linked; break;
+                case GL_DELETE_STATUS: *value = GL_FALSE; break;
+                case GL_INFO_LOG_LENGTH: *value = 0; break;
+                case GL_ATTACHED_SHADERS: *value = GLint(program->shaders.size()); break;
+                case GL_ACTIVE_UNIFORMS: *value = 0; break;
+                case GL_ACTIVE_ATTRIBUTES: *value = 0; break;
+                case GL_PROGRAM_BINARY_LENGTH: *value = 0; break;
+                default: fail(GL_INVALID_ENUM);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetProgramInfoLog> {
+        static void call(GLuint program, GLsizei max_length, GLsizei* length, GLchar* log) {
+            if (named_program(program)) {
+                empty_log(max_length, length, log);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetProgramBinary> {
+        static void call(GLuint, GLsizei, GLsizei* length, GLenum*, void*) {
+            fail(GL_INVALID_OPERATION);
+            if (length) {
+                *length = 0;
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetUniformLocation> {
+        static GLint call(GLuint program, const GLchar* name) { return location(program, name, false); }
+    };
+
+    template <> struct Impl<fn_glGetAttribLocation> {
+        static GLint call(GLuint program, const GLchar* name) { return location(program, name, true); }
+    };
+
+    template <> struct Impl<fn_glUseProgram> {
+        static void call(GLuint program) { state.program = program; }
+    };
+
+    /* Program pipelines, samplers */
+
+    template <> struct Impl<fn_glGenProgramPipelines> {
+        static void call(GLsizei n, GLuint* pipelines) { generate(state.pipelines, n, pipelines); }
+    };
+
+    template <> struct Impl<fn_glDeleteProgramPipelines> {
+        static void call(GLsizei n, const GLuint* pipelines) {
+            remove(state.pipelines, n, pipelines, &state.pipeline);
+        }
+    };
+
+    template <> struct Impl<fn_glIsProgramPipeline> {
+        static GLboolean call(GLuint pipeline) { return exists(state.pipelines, pipeline); }
+    };
+
+    template <> struct Impl<fn_glBindProgramPipeline> {
+        static void call(GLuint pipeline) { bind(state.pipelines, state.pipeline, pipeline); }
+    };
+
+    template <> struct Impl<fn_glGenSamplers> {
+        static void call(GLsizei n, GLuint* samplers) { generate(state.samplers, n, samplers); }
+    };
+
+    template <> struct Impl<fn_glDeleteSamplers> {
+        static void call(GLsizei n, const GLuint* samplers) { remove(state.samplers, n, samplers); }
+    };
+
+    template <> struct Impl<fn_glIsSampler> {
+        static GLboolean call(GLuint sampler) { return exists(state.samplers, sampler); }
+    };
+
+    /* Framebuffers and renderbuffers */
+
+    template <> struct Impl<fn_glGenFramebuffers> {
+        static void call(GLsizei n, GLuint* framebuffers) { generate(state.framebuffers, n, framebuffers); }
+    };
+
+    template <> struct Impl<fn_glDeleteFramebuffers> {
+        static void call(GLsizei n, const GLuint* framebuffers) {
+            remove(state.framebuffers, n, framebuffers, &state.draw_framebuffer);
+            remove(state.framebuffers, n, framebuffers, &state.read_framebuffer);
+        }
+    };
+
+    template <> struct Impl<fn_glIsFramebuffer> {
+        static GLboolean call(GLuint framebuffer) { return exists(state.framebuffers, framebuffer); }
+    };
+
+    template <> struct Impl<fn_glBindFramebuffer> {
+        static void call(GLenum target, GLuint framebuffer) {
+            if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER) {
+                bind(state.framebuffers, state.draw_framebuffer, framebuffer);
+            }
+            if (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER) {
+                bind(state.framebuffers, state.read_framebuffer, framebuffer);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glCheckFramebufferStatus> {
+        static GLenum call(GLenum) { return GL_FRAMEBUFFER_COMPLETE; }
+    };
+
+    template <> struct Impl<fn_glGenRenderbuffers> {
+        static void call(GLsizei n, GLuint* renderbuffers) { generate(state.renderbuffers, n, renderbuffers); }
+    };
+
+    template <> struct Impl<fn_glDeleteRenderbuffers> {
+        static void call(GLsizei n, const GLuint* renderbuffers) {
+            remove(state.renderbuffers, n, renderbuffers, &state.renderbuffer);
+        }
+    };
+
+    template <> struct Impl<fn_glIsRenderbuffer> {
+        static GLboolean call(GLuint renderbuffer) { return exists(state.renderbuffers, renderbuffer); }
+    };
+
+    template <> struct Impl<fn_glBindRenderbuffer> {
+        static void call(GLenum, GLuint renderbuffer) { bind(state.renderbuffers, state.renderbuffer, renderbuffer); }
+    };
+
+    template <> struct Impl<fn_glRenderbufferStorage> {
+        static void call(GLenum, GLenum internal_format, GLsizei width, GLsizei height) {
+            if (auto renderbuffer = state.renderbuffers.find(state.renderbuffer);
+                    renderbuffer != state.renderbuffers.end()) {
+                renderbuffer->second = {width, height, internal_format};
+            } else {
+                fail(GL_INVALID_OPERATION);
+            }
+        }
+    };
+
+    template <> struct Impl<fn_glGetRenderbufferParameteriv> {
+        static void call(GLenum, GLenum pname, GLint* value) {
+            auto renderbuffer = state.renderbuffers.find(state.renderbuffer);
+            if (renderbuffer == state.renderbuffers.end()) {
+                fail(GL_INVALID_OPERATION);
+                return;
+            }
+            switch (pname) {
+                case GL_RENDERBUFFER_WIDTH: *value = renderbuffer->second.width; break;
+                case GL_RENDERBUFFER_HEIGHT: *value = renderbuffer->second.height; break;
+                case GL_RENDERBUFFER_INTERNAL_FORMAT: *value = GLint(renderbuffer->second.internal_format); break;
+                default: fail(GL_INVALID_ENUM);
+            }
+        }
+    };
+
+    /* Queries and syncs */
+
+    template <> struct Impl<fn_glGenQueries> {
+        static void call(GLsizei n, GLuint* ids) { generate(state.queries, n, ids); }
+    };
+
+    template <> struct Impl<fn_glDeleteQueries> {
+        static void call(GLsizei n, const GLuint* ids) { remove(state.queries, n, ids); }
+    };
+
+    template <> struct Impl<fn_glIsQuery> {
+        static GLboolean call(GLuint id) { return exists(state.queries, id); }
+    };
+
+    template <> struct Impl<fn_glBeginQuery> {
+        static void call(GLenum target, GLuint id) { state.queries[id] = {target, 0}; }
+    };
+
+    template <> struct Impl<fn_glQueryCounter> {
+        static void call(GLuint id, GLenum target) { state.queries[id] = {target, now_ns()}; }
+    };
+
+    template <> struct Impl<fn_glGetQueryObjectiv> {
+        static void call(GLuint id, GLenum pname, GLint* value) { query_result(id, pname, value); }
+    };
+
+    template <> struct Impl<fn_glGetQueryObjectuiv> {
+        static void call(GLuint id, GLenum pname, GLuint* value) { query_result(id, pname, value); }
+    };
+
+    template <> struct Impl<fn_glGetQueryObjecti64v> {
+        static void call(GLuint id, GLenum pname, GLint64* value) { query_result(id, pname, value); }
+    };
+
+    template <> struct Impl<fn_glGetQueryObjectui64v> {
+        static void call(GLuint id, GLenum pname, GLuint64* value) { query_result(id, pname, value); }
+    };
+
+    template <> struct Impl<fn_glFenceSync> {
+        static GLsync call(GLenum, GLbitfield) {
+            std::uintptr_t sync = state.next_sync++;
+            state.syncs.insert(sync);
+            return reinterpret_cast<GLsync>(sync);
+        }
+    };
+
+    template <> struct Impl<fn_glIsSync> {
+        static GLboolean call(GLsync sync) { return state.syncs.contains(reinterpret_cast<std::uintptr_t>(sync)); }
+    };
+
+    template <> struct Impl<fn_glDeleteSync> {
+        static void call(GLsync sync) { state.syncs.erase(reinterpret_cast<std::uintptr_t>(sync)); }
+    };
+
+    template <> struct Impl<fn_glClientWaitSync> {
+        static GLenum call(GLsync sync, GLbitfield, GLuint64) {
+            if (!state.syncs.contains(reinterpret_cast<std::uintptr_t>(sync))) {
+                fail(GL_INVALID_VALUE);
+                return GL_WAIT_FAILED;
+            }
+            return GL_ALREADY_SIGNALED;
+        }
+    };
+
+    template <> struct Impl<fn_glGetSynciv> {
+        static void call(GLsync sync, GLenum pname, GLsizei count, GLsizei* length, GLint* values) {
+            if (!state.syncs.contains(reinterpret_cast<std::uintptr_t>(sync))) {
+                fail(GL_INVALID_VALUE);
+                return;
+            }
+            GLint value;
+            switch (pname) {
+                case GL_OBJECT_TYPE: value = GL_SYNC_FENCE; break;
+                case GL_SYNC_STATUS: value = GL_SIGNALED; break;
+                case GL_SYNC_CONDITION: value = GL_SYNC_GPU_COMMANDS_COMPLETE; break;
+                case GL_SYNC_FLAGS: value = 0; break;
+                default: fail(GL_INVALID_ENUM); return;
+            }
+            if (count > 0) {
+                values[0] = value;
+            }
+            if (length) {
+                *length = count > 0 ? 1 : 0;
+            }
+        }
+    };
+
+    /* Stands in for the function glad would have stored */
+    template <std::size_t Function, typename F>
+    struct Entry;
+
+    template <std::size_t Function, typename R, typename... Args>
+    struct Entry<Function, R (APIENTRYP)(Args...)> {
+        static R APIENTRY call(Args... args) {
+            if (recording) {
+                record(Function, args...);
+            }
+            if constexpr (requires { &Impl<Function>::call; }) {
+                return Impl<Function>::call(args...);
+            } else {
+                return R();
+            }
+        }
+    };
+}
+
+void load_null_gl(bool record) {
+    state = State{};
+    recorded.clear();
+    recording = record;
+
+#define AZ_GL_FUNCTION(name) glad_##name = &Entry<fn_##name, decltype(glad_##name)>::call;
+#include <gl_functions.inc>
+#undef AZ_GL_FUNCTION
+
+    GLVersion.major = 3;
+    GLVersion.minor = 3;
+    for (int* version : {&GLAD_GL_VERSION_1_0, &GLAD_GL_VERSION_1_1, &GLAD_GL_VERSION_1_2, &GLAD_GL_VERSION_1_3,
+                         &GLAD_GL_VERSION_1_4, &GLAD_GL_VERSION_1_5, &GLAD_GL_VERSION_2_0, &GLAD_GL_VERSION_2_1,
+                         &GLAD_GL_VERSION_3_0, &GLAD_GL_VERSION_3_1, &GLAD_GL_VERSION_3_2, &GLAD_GL_VERSION_3_3}) {
+        *version = 1;
+    }
+    /* Their functions are not all there */
+    for (int* version : {&GLAD_GL_VERSION_4_0, &GLAD_GL_VERSION_4_1, &GLAD_GL_VERSION_4_2, &GLAD_GL_VERSION_4_3,
+                         &GLAD_GL_VERSION_4_4, &GLAD_GL_VERSION_4_5, &GLAD_GL_VERSION_4_6}) {
+        *version = 0;
+    }
+    /* A context loaded before may have had extensions */
+    reset_gl_extensions();
+}
+
+void set_null_gl_recording(bool record) {
+    recording = record;
+}
+
+NullGlRecording& null_gl_recording() {
+    return recorded;
+}
+
+const std::vector<std::byte>* null_gl_buffer_data(unsigned int buffer) {
+    auto found = state.buffers.find(buffer);
+    return found == state.buffers.end() ? nullptr : &found->second.data;
+}
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include <glad/glad.h>
+
+#include <gl_debug.hpp>
+#include <memory_accounting.hpp>
+#include <overdraw.hpp>
+
+namespace {
+    /* Red and green counts per pixel */
+    const std::size_t PIXEL_BYTES = 2 * sizeof(float);
+}
+
+double OverdrawStats::average_overdraw() const {
+    return this->covered_pixels ? double(this->shaded_fragments) / this->covered_pixels : 0.0;
+}
+
+double OverdrawStats::wasted_share() const {
+    return this->shaded_fragments
+        ? double(this->shaded_fragments - this->visible_fragments) / this->shaded_fragments : 0.0;
+}
+
+void print_overdraw_stats(std::ostream& out, const OverdrawStats& stats) {
+    char line[256];
+    double pixels = std::max(1.0, double(stats.width) * stats.height);
+    std::snprintf(line, sizeof(line),
+            "Overdraw frame %llu: %.2f average, %llu max; %llu fragments shaded, %llu visible (%.1f%% wasted); "
+            "%.1f%% of pixels covered, %.1f%% visible\n",
+            static_cast<unsigned long long>(stats.frame), stats.average_overdraw(),
+            static_cast<unsigned long long>(stats.max_overdraw),
+            static_cast<unsigned long long>(stats.shaded_fragments),
+            static_cast<unsigned long long>(stats.visible_fragments), stats.wasted_share() * 100.0,
+            stats.covered_pixels * 100.0 / pixels, stats.visible_pixels * 100.0 / pixels);
+    out << line;
+}
+
+OverdrawView::OverdrawView(int width, int height)
+    : width{width},
+      height{height},
+      heat_map{"shaders/overdraw/vertex.shader", "shaders/overdraw/fragment.shader", {"counts", "max_shown"}} {
+    GlDebugGroup group{"OverdrawView"};
+
+    try {
+        glGenTextures(1, &this->counts);
+        record_allocation({MemoryKind::texture, this->counts, std::size_t(width) * height * PIXEL_BYTES,
+                           GL_RG32F, width, height, 1, "overdraw", "counts"});
+        glBindTexture(GL_TEXTURE_2D, this->counts);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, width, height, 0, GL_RG, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        gl_object_label(GL_TEXTURE, this->counts, "overdraw counts");
+
+        GLint previous_framebuffer = 0;
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+        glGenFramebuffers(1, &this->framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->counts, 0);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, GLuint(previous_framebuffer));
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("Error creating the overdraw target: framebuffer status "
+                    + std::to_string(status));
+        }
+
+        /* The heat map's triangle comes from gl_VertexID, but core profiles
+         * draw nothing without a vertex array bound */
+        glGenVertexArrays(1, &this->empty_vertex_array);
+
+        glGenBuffers(LATENCY + 1, this->pixel_buffers);
+        for (GLuint buffer : this->pixel_buffers) {
+            record_allocation({MemoryKind::buffer, buffer, std::size_t(width) * height * PIXEL_BYTES,
+                               GL_STREAM_READ, 0, 0, 1, "overdraw", "readback"});
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(std::size_t(width) * height * PIXEL_BYTES), nullptr,
+                         GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    } catch (...) {
+        /* Past the memory budget or incomplete: names not generated yet are
+         * still 0, which deletes nothing */
+        del();
+        throw;
+    }
+}
+
+void OverdrawView::begin_frame() {
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    this->previous_blend = blend == GL_TRUE;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &this->previous_framebuffer);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &this->previous_blend_src);
+    glGetIntegerv(GL_BLEND_DST_RGB, &this->previous_blend_dst);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, &this->previous_blend_equation);
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->framebuffer);
+    const GLfloat zero[4] = {};
+    glClearBufferfv(GL_COLOR, 0, zero);
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_ONE, GL_ONE);
+}
+
+std::optional<OverdrawStats> OverdrawView::end_frame() {
+    GlDebugGroup group{"OverdrawView::end_frame"};
+    std::optional<OverdrawStats> stats;
+
+    /* All pixel buffers busy: the oldest readback has to be waited for */
+    if (this->frames - this->collected > std::uint64_t(LATENCY)) {
+        stats = this->collect(this->collected++);
+    }
+
+    std::size_t slot = this->frames % (LATENCY + 1);
+    GLint previous_read_framebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read_framebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pixel_buffers[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, this->width, this->height, GL_RG, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    this->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++this->frames;
+
+    /* Heat map over whatever was bound before, replacing its pixels */
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, GLuint(previous_read_framebuffer));
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, GLuint(this->previous_framebuffer));
+    GLint previous_program = 0;
+    GLint previous_vertex_array = 0;
+    GLint previous_active_texture = 0;
+    GLint previous_texture = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vertex_array);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &previous_active_texture);
+    glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glBindTexture(GL_TEXTURE_2D, this->counts);
+    glUseProgram(this->heat_map.id);
+    glUniform1i(this->heat_map.uniforms.at("counts"), 0);
+    glUniform1f(this->heat_map.uniforms.at("max_shown"), this->max_shown);
+    glBindVertexArray(this->empty_vertex_array);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindVertexArray(GLuint(previous_vertex_array));
+    glUseProgram(GLuint(previous_program));
+    glBindTexture(GL_TEXTURE_2D, GLuint(previous_texture));
+    glActiveTexture(GLenum(previous_active_texture));
+    if (depth_test) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    if (this->previous_blend) {
+        glEnable(GL_BLEND);
+    }
+    glBlendEquation(GLenum(this->previous_blend_equation));
+    glBlendFunc(GLenum(this->previous_blend_src), GLenum(this->previous_blend_dst));
+
+    /* Otherwise, the oldest readback if it is old enough and done */
+    if (!stats && this->frames - this->collected > std::uint64_t(LATENCY)) {
+        GLsync fence = static_cast<GLsync>(this->fences[this->collected % (LATENCY + 1)]);
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            stats = this->collect(this->collected++);
+        }
+    }
+    return stats;
+}
+
+std::vector<OverdrawStats> OverdrawView::finish() {
+    std::vector<OverdrawStats> stats;
+    while (this->collected < this->frames) {
+        stats.push_back(this->collect(this->collected++));
+    }
+    return stats;
+}
+
+OverdrawStats OverdrawView::collect(std::uint64_t frame) {
+    std::size_t slot = frame % (LATENCY + 1);
+    GLsync fence = static_cast<GLsync>(this->fences[slot]);
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(10'000'000'000));
+    glDeleteSync(fence);
+    this->fences[slot] = nullptr;
+
+    OverdrawStats stats;
+    stats.frame = frame;
+    stats.width = this->width;
+    stats.height = this->height;
+
+    std::size_t pixels = std::size_t(this->width) * this->height;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, this->pixel_buffers[slot]);
+    auto counts = static_cast<const float*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+            GLsizeiptr(pixels * PIXEL_BYTES), GL_MAP_READ_BIT));
+    if (counts) {
+        for (std::size_t pixel = 0; pixel < pixels; ++pixel) {
+            auto shaded = std::uint64_t(counts[2 * pixel]);
+            auto visible = std::uint64_t(counts[2 * pixel + 1]);
+            stats.shaded_fragments += shaded;
+            stats.visible_fragments += visible;
+            stats.covered_pixels += shaded > 0;
+            stats.visible_pixels += visible > 0;
+            stats.max_overdraw = std::max(stats.max_overdraw, shaded);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return stats;
+}
+
+void OverdrawView::del() {
+    for (void*& fence : this->fences) {
+        if (fence) {
+            glDeleteSync(static_cast<GLsync>(fence));
+            fence = nullptr;
+        }
+    }
+    for (GLuint buffer : this->pixel_buffers) {
+        record_release(MemoryKind::buffer, buffer);
+    }
+    glDeleteBuffers(LATENCY + 1, this->pixel_buffers);
+    glDeleteVertexArrays(1, &this->empty_vertex_array);
+    glDeleteFramebuffers(1, &this->framebuffer);
+    record_release(MemoryKind::texture, this->counts);
+    glDeleteTextures(1, &this->counts);
+    this->heat_map.del();
+}
@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AZ_PIXEL_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+#include <pixel_kernels.hpp>
+
+namespace {
+    using RowKernel = void (*)(const PixelConversion& conversion, const unsigned char* src,
+                               unsigned char* dst, int width);
+
+    struct SrgbTable {
+        /* int rather than byte entries, for the AVX2 gathers */
+        std::array<int, 256> to_linear;
+
+        SrgbTable() {
+            for (int i = 0; i < 256; ++i) {
+                double srgb = i / 255.0;
+                double linear = srgb <= 0.04045 ? srgb / 12.92 : std::pow((srgb + 0.055) / 1.055, 2.4);
+                this->to_linear[i] = int(std::lround(linear * 255.0));
+            }
+        }
+    };
+
+    const SrgbTable& srgb_table() {
+        static const SrgbTable table;
+        return table;
+    }
+
+    /* Round(value * alpha / 255), exactly, without a division */
+    inline unsigned char multiply_alpha(unsigned int value, unsigned int alpha) {
+        unsigned int t = value * alpha + 128;
+        return (unsigned char)((t + (t >> 8)) >> 8);
+    }
+
+    bool has_alpha(const PixelConversion& conversion) {
+        return conversion.dst_channels == 2 || conversion.dst_channels == 4;
+    }
+
+    void convert_row_scalar(const PixelConversion& conversion, const unsigned char* src,
+                            unsigned char* dst, int width) {
+        int src_channels = conversion.src_channels;
+        int dst_channels = conversion.dst_channels;
+        int color_channels = has_alpha(conversion) ? dst_channels - 1 : dst_channels;
+        const int* to_linear = srgb_table().to_linear.data();
+
+        for (int x = 0; x < width; ++x, src += src_channels, dst += dst_channels) {
+            for (int i = 0; i < dst_channels; ++i) {
+                int channel = conversion.swizzle[i];
+                dst[i] = channel == PixelConversion::ONE ? 255 : src[channel];
+            }
+            if (conversion.srgb_to_linear) {
+                for (int i = 0; i < color_channels; ++i) {
+                    dst[i] = (unsigned char)to_linear[dst[i]];
+                }
+            }
+            if (conversion.premultiply_alpha && has_alpha(conversion)) {
+                unsigned int alpha = dst[dst_channels - 1];
+                for (int i = 0; i < color_channels; ++i) {
+                    dst[i] = multiply_alpha(dst[i], alpha);
+                }
+            }
+        }
+    }
+
+#ifdef AZ_PIXEL_KERNELS_X86
+    /* SSE2 has no byte shuffle, so only RGBA -> RGBA is vectorised here (the
+     * premultiplied case being the one worth it); anything else, and sRGB
+     * conversion, which needs a table lookup per byte, is left to the scalar
+     * kernel */
+    void convert_row_sse2(const PixelConversion& conversion, const unsigned char* src,
+                          unsigned char* dst, int width) {
+        bool rgba_to_rgba = conversion.src_channels == 4 && conversion.dst_channels == 4
+            && conversion.swizzle == std::array<int, 4>{0, 1, 2, 3};
+        if (!rgba_to_rgba || conversion.srgb_to_linear) {
+            convert_row_scalar(conversion, src, dst, width);
+            return;
+        }
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i bias = _mm_set1_epi16(128);
+        /* Alpha words multiply by 255, which leaves alpha unchanged */
+        const __m128i alpha_words = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+        const __m128i alpha_one = _mm_and_si128(alpha_words, _mm_set1_epi16(255));
+
+        auto premultiply = [&](__m128i pixels) {
+            __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, 0xff), 0xff);
+            alpha = _mm_or_si128(_mm_andnot_si128(alpha_words, alpha), alpha_one);
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), bias);
+            return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        };
+
+        int x = 0;
+        for (; x + 4 <= width; x += 4, src += 16, dst += 16) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            if (conversion.premultiply_alpha) {
+                __m128i low = premultiply(_mm_unpacklo_epi8(pixels, zero));
+                __m128i high = premultiply(_mm_unpackhi_epi8(pixels, zero));
+                pixels = _mm_packus_epi16(low, high);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), pixels);
+        }
+        convert_row_scalar(conversion, src, dst, width - x);
+    }
+
+    inline void store_u32(unsigned char* dst, __m128i value) {
+        int bytes = _mm_cvtsi128_si32(value);
+        std::memcpy(dst, &bytes, 4);
+    }
+
+    /* Byte shuffle control turning 4 source pixels into 4 destination
+     * pixels; ONE and unused bytes select zero (and are or-ed with `ones`) */
+    struct ShuffleMasks {
+        __m256i shuffle;
+        __m256i ones;
+        __m256i alpha_shuffle;
+        __m256i alpha_ones;
+        __m256i color_bytes;
+    };
+
+    __attribute__((target("avx2")))
+    ShuffleMasks make_masks(const PixelConversion& conversion) {
+        alignas(32) unsigned char shuffle[32];
+        alignas(32) unsigned char ones[32];
+        alignas(32) unsigned char alpha_shuffle[32];
+        alignas(32) unsigned char alpha_ones[32];
+        alignas(32) unsigned char color_bytes[32];
+        std::memset(shuffle, 0x80, sizeof shuffle);
+        std::memset(ones, 0, sizeof ones);
+        std::memset(alpha_shuffle, 0x80, sizeof alpha_shuffle);
+        std::memset(alpha_ones, 0, sizeof alpha_ones);
+        std::memset(color_bytes, 0, sizeof color_bytes);
+
+        int dst_channels = conversion.dst_channels;
+        int alpha_channel = has_alpha(conversion) ? dst_channels - 1 : -1;
+        for (int lane = 0; lane < 2; ++lane) {
+            for (int pixel = 0; pixel < 4; ++pixel) {
+                for (int i = 0; i < dst_channels; ++i) {
+                    int byte = lane * 16 + pixel * dst_channels + i;
+                    int channel = conversion.swizzle[i];
+                    if (channel == PixelConversion::ONE) {
+                        ones[byte] = 0xff;
+                    } else {
+                        shuffle[byte] = (unsigned char)(pixel * conversion.src_channels + channel);
+                    }
+                    if (i == alpha_channel) {
+                        alpha_ones[byte] = 0xff;
+                    } else {
+                        color_bytes[byte] = 0xff;
+                        if (alpha_channel != -1) {
+                            alpha_shuffle[byte] = (unsigned char)(pixel * dst_channels + alpha_channel);
+                        }
+                    }
+                }
+            }
+        }
+
+        return {
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffle)),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(ones)),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(alpha_shuffle)),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(alpha_ones)),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(color_bytes)),
+        };
+    }
+
+    /* Round(values * alphas / 255) on 16-bit lanes, as multiply_alpha() */
+    __attribute__((target("avx2")))
+    __m256i multiply_alpha_avx2(__m256i values, __m256i alphas) {
+        __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(values, alphas), _mm256_set1_epi16(128));
+        return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+
+    __attribute__((target("avx2")))
+    __m256i srgb_to_linear_avx2(__m256i bytes, const int* table) {
+        alignas(32) unsigned char in[32];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(in), bytes);
+        __m256i quarters[4];
+        for (int i = 0; i < 4; ++i) {
+            __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + 8 * i)));
+            quarters[i] = _mm256_i32gather_epi32(table, indices, 4);
+        }
+        /* Packing works per 128-bit lane; the permute restores byte order */
+        __m256i words_low = _mm256_permute4x64_epi64(_mm256_packus_epi32(quarters[0], quarters[1]), 0xd8);
+        __m256i words_high = _mm256_permute4x64_epi64(_mm256_packus_epi32(quarters[2], quarters[3]), 0xd8);
+        return _mm256_permute4x64_epi64(_mm256_packus_epi16(words_low, words_high), 0xd8);
+    }
+
+    __attribute__((target("avx2")))
+    void convert_row_avx2(const PixelConversion& conversion, const unsigned char* src,
+                          unsigned char* dst, int width) {
+        int src_channels = conversion.src_channels;
+        int dst_channels = conversion.dst_channels;
+        ShuffleMasks masks = make_masks(conversion);
+        bool premultiply = conversion.premultiply_alpha && has_alpha(conversion);
+        const int* to_linear = srgb_table().to_linear.data();
+
+        const __m256i zero = _mm256_setzero_si256();
+
+        /* 8 pixels per iteration, 4 per lane; each lane loads 16 bytes of
+         * which it uses 4 * src_channels, so stop before over-reading */
+        int x = 0;
+        for (; x + 8 <= width && (width - x - 4) * src_channels >= 16;
+             x += 8, src += 8 * src_channels, dst += 8 * dst_channels) {
+            __m256i pixels = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * src_channels)), 1);
+            pixels = _mm256_or_si256(_mm256_shuffle_epi8(pixels, masks.shuffle), masks.ones);
+
+            if (conversion.srgb_to_linear) {
+                __m256i linear = srgb_to_linear_avx2(pixels, to_linear);
+                pixels = _mm256_blendv_epi8(pixels, linear, masks.color_bytes);
+            }
+
+            if (premultiply) {
+                __m256i alpha = _mm256_or_si256(_mm256_shuffle_epi8(pixels, masks.alpha_shuffle),
+                                                masks.alpha_ones);
+                __m256i low = multiply_alpha_avx2(_mm256_unpacklo_epi8(pixels, zero),
+                                                  _mm256_unpacklo_epi8(alpha, zero));
+                __m256i high = multiply_alpha_avx2(_mm256_unpackhi_epi8(pixels, zero),
+                                                   _mm256_unpackhi_epi8(alpha, zero));
+                pixels = _mm256_packus_epi16(low, high);
+            }
+
+            /* Each lane holds 4 * dst_channels valid bytes */
+            __m128i lanes[2] = {_mm256_castsi256_si128(pixels), _mm256_extracti128_si256(pixels, 1)};
+            for (int lane = 0; lane < 2; ++lane) {
+                unsigned char* out = dst + lane * 4 * dst_channels;
+                switch (dst_channels) {
+                    case 4:
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lanes[lane]);
+                        break;
+                    case 3:
+                        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), lanes[lane]);
+                        store_u32(out + 8, _mm_srli_si128(lanes[lane], 8));
+                        break;
+                    case 2:
+                        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), lanes[lane]);
+                        break;
+                    default:
+                        store_u32(out, lanes[lane]);
+                        break;
+                }
+            }
+        }
+        convert_row_scalar(conversion, src, dst, width - x);
+    }
+#endif
+
+    PixelIsa detect() {
+#ifdef AZ_PIXEL_KERNELS_X86
+        if (__builtin_cpu_supports("avx2")) {
+            return PixelIsa::avx2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return PixelIsa::sse2;
+        }
+#endif
+        return PixelIsa::scalar;
+    }
+
+    std::atomic<PixelIsa> selected_isa{detected_pixel_isa()};
+
+    RowKernel row_kernel(PixelIsa isa) {
+#ifdef AZ_PIXEL_KERNELS_X86
+        switch (isa) {
+            case PixelIsa::avx2: return convert_row_avx2;
+            case PixelIsa::sse2: return convert_row_sse2;
+            default: break;
+        }
+#endif
+        return convert_row_scalar;
+    }
+}
+
+PixelConversion PixelConversion::expand(int src_channels, int dst_channels) {
+    bool src_gray = src_channels < 3;
+    bool src_alpha = src_channels == 2 || src_channels == 4;
+    int alpha = src_alpha ? src_channels - 1 : ONE;
+
+    PixelConversion conversion;
+    conversion.src_channels = src_channels;
+    conversion.dst_channels = dst_channels;
+    switch (dst_channels) {
+        case 1: conversion.swizzle = {0, ONE, ONE, ONE}; break;
+        case 2: conversion.swizzle = {0, alpha, ONE, ONE}; break;
+        case 3: conversion.swizzle = src_gray ? std::array<int, 4>{0, 0, 0, ONE}
+                                              : std::array<int, 4>{0, 1, 2, ONE}; break;
+        default: conversion.swizzle = src_gray ? std::array<int, 4>{0, 0, 0, alpha}
+                                               : std::array<int, 4>{0, 1, 2, alpha}; break;
+    }
+    return conversion;
+}
+
+PixelIsa detected_pixel_isa() {
+    static const PixelIsa isa = detect();
+    return isa;
+}
+
+PixelIsa pixel_isa() {
+    return selected_isa;
+}
+
+void set_pixel_isa(PixelIsa isa) {
+    selected_isa = std::min(isa, detected_pixel_isa());
+}
+
+const char* pixel_isa_name(PixelIsa isa) {
+    switch (isa) {
+        case PixelIsa::avx2: return "avx2";
+        case PixelIsa::sse2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+void convert_image(const PixelConversion& conversion, const unsigned char* src,
+                   int width, int height, unsigned char* dst) {
+    convert_image(pixel_isa(), conversion, src, width, height, dst);
+}
+
+void convert_image(PixelIsa isa, const PixelConversion& conversion, const unsigned char* src,
+                   int width, int height, unsigned char* dst) {
+    std::size_t src_stride = std::size_t(width) * conversion.src_channels;
+    std::size_t dst_stride = std::size_t(width) * conversion.dst_channels;
+
+    /* Plain copies (and flips) are memcpy's job */
+    bool identity = conversion.src_channels == conversion.dst_channels
+        && !conversion.srgb_to_linear && !conversion.premultiply_alpha;
+    for (int i = 0; identity && i < conversion.dst_channels; ++i) {
+        identity = conversion.swizzle[i] == i;
+    }
+    if (identity && !conversion.flip_y) {
+        std::memcpy(dst, src, dst_stride * height);
+        return;
+    }
+
+    RowKernel kernel = row_kernel(std::min(isa, detected_pixel_isa()));
+    for (int y = 0; y < height; ++y) {
+        int src_y = conversion.flip_y ? height - 1 - y : y;
+        const unsigned char* src_row = src + src_y * src_stride;
+        unsigned char* dst_row = dst + y * dst_stride;
+        if (identity) {
+            std::memcpy(dst_row, src_row, dst_stride);
+        } else {
+            kernel(conversion, src_row, dst_row, width);
+        }
+    }
+}
@@ -0,0 +1,282 @@
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+#include <png_writer.hpp>
+
+using namespace std::string_literals;
+
+namespace {
+    const int HASH_BITS = 15;
+    const std::size_t MIN_MATCH = 3;
+    const std::size_t MAX_MATCH = 258;
+    const std::size_t WINDOW = 32768;
+    /* Candidates tried per position; beyond this, matches hardly improve */
+    const int MAX_CHAIN = 48;
+
+    const std::uint16_t LENGTH_BASE[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+    };
+    const std::uint8_t LENGTH_EXTRA[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+    };
+    const std::uint16_t DISTANCE_BASE[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+    };
+    const std::uint8_t DISTANCE_EXTRA[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+    };
+
+    /* Deflate packs bits starting from the least significant one, Huffman
+     * codes most significant bit first */
+    struct BitWriter {
+        std::vector<unsigned char>& out;
+        std::uint64_t bits = 0;
+        int n_bits = 0;
+
+        void put(std::uint32_t value, int count) {
+            this->bits |= std::uint64_t(value) << this->n_bits;
+            this->n_bits += count;
+            while (this->n_bits >= 8) {
+                this->out.push_back((unsigned char)this->bits);
+                this->bits >>= 8;
+                this->n_bits -= 8;
+            }
+        }
+
+        void put_code(std::uint32_t code, int length) {
+            std::uint32_t reversed = 0;
+            for (int i = 0; i < length; ++i) {
+                reversed = reversed << 1 | (code >> i & 1);
+            }
+            put(reversed, length);
+        }
+
+        void flush() {
+            if (this->n_bits > 0) {
+                this->out.push_back((unsigned char)this->bits);
+            }
+            this->bits = 0;
+            this->n_bits = 0;
+        }
+    };
+
+    /* The fixed literal/length code of RFC 1951, 3.2.6 */
+    void put_symbol(BitWriter& writer, unsigned symbol) {
+        if (symbol < 144) {
+            writer.put_code(0x30 + symbol, 8);
+        } else if (symbol < 256) {
+            writer.put_code(0x190 + symbol - 144, 9);
+        } else if (symbol < 280) {
+            writer.put_code(symbol - 256, 7);
+        } else {
+            writer.put_code(0xc0 + symbol - 280, 8);
+        }
+    }
+
+    void put_match(BitWriter& writer, std::size_t length, std::size_t distance) {
+        int code = 28;
+        while (LENGTH_BASE[code] > length) {
+            --code;
+        }
+        put_symbol(writer, 257 + code);
+        writer.put(std::uint32_t(length - LENGTH_BASE[code]), LENGTH_EXTRA[code]);
+
+        code = 29;
+        while (DISTANCE_BASE[code] > distance) {
+            --code;
+        }
+        writer.put_code(code, 5);
+        writer.put(std::uint32_t(distance - DISTANCE_BASE[code]), DISTANCE_EXTRA[code]);
+    }
+
+    std::uint32_t hash3(const unsigned char* data) {
+        std::uint32_t sequence = data[0] | data[1] << 8 | data[2] << 16;
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    /* A zlib stream holding one fixed-Huffman deflate block */
+    void zlib_compress(const std::vector<unsigned char>& data, std::vector<unsigned char>& out) {
+        out.push_back(0x78);
+        out.push_back(0x01);
+
+        BitWriter writer{out};
+        writer.put(1, 1);
+        writer.put(1, 2);
+
+        /* Most recent position of each hashed 3-byte sequence, and for each
+         * position the previous one with the same hash */
+        std::vector<std::int32_t> head(std::size_t(1) << HASH_BITS, -1);
+        std::vector<std::int32_t> previous(data.size());
+        auto insert = [&](std::size_t pos) {
+            std::uint32_t hash = hash3(&data[pos]);
+            previous[pos] = head[hash];
+            head[hash] = std::int32_t(pos);
+        };
+
+        std::size_t size = data.size();
+        std::size_t pos = 0;
+        while (pos < size) {
+            std::size_t best_length = 0;
+            std::size_t best_distance = 0;
+            if (pos + MIN_MATCH <= size) {
+                std::size_t max_length = std::min(MAX_MATCH, size - pos);
+                std::int32_t candidate = head[hash3(&data[pos])];
+                for (int chain = 0; candidate >= 0 && pos - candidate <= WINDOW && chain < MAX_CHAIN; ++chain) {
+                    std::size_t length = 0;
+                    while (length < max_length && data[candidate + length] == data[pos + length]) {
+                        ++length;
+                    }
+                    if (length > best_length) {
+                        best_length = length;
+                        best_distance = pos - candidate;
+                        if (length == max_length) {
+                            break;
+                        }
+                    }
+                    candidate = previous[candidate];
+                }
+                insert(pos);
+            }
+
+            if (best_length < MIN_MATCH) {
+                put_symbol(writer, data[pos]);
+                ++pos;
+                continue;
+            }
+            put_match(writer, best_length, best_distance);
+            /* Positions inside the match are still candidates for later ones */
+            std::size_t end = pos + best_length;
+            for (++pos; pos < end; ++pos) {
+                if (pos + MIN_MATCH <= size) {
+                    insert(pos);
+                }
+            }
+        }
+        put_symbol(writer, 256);
+        writer.flush();
+
+        std::uint32_t a = 1;
+        std::uint32_t b = 0;
+        for (unsigned char byte : data) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        std::uint32_t adler = b << 16 | a;
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out.push_back((unsigned char)(adler >> shift));
+        }
+    }
+
+    std::uint32_t crc32(const unsigned char* data, std::size_t size, std::uint32_t crc = 0) {
+        static const auto table = [] {
+            std::array<std::uint32_t, 256> table{};
+            for (std::uint32_t n = 0; n < 256; ++n) {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; ++k) {
+                    c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                }
+                table[n] = c;
+            }
+            return table;
+        }();
+        crc = ~crc;
+        for (std::size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    void put32(std::vector<unsigned char>& out, std::uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out.push_back((unsigned char)(value >> shift));
+        }
+    }
+
+    void put_chunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+        put32(out, std::uint32_t(data.size()));
+        std::size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        put32(out, crc32(&out[start], out.size() - start));
+    }
+
+    unsigned char paeth(int a, int b, int c) {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        return (unsigned char)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+    }
+}
+
+std::vector<unsigned char> encode_png(const unsigned char* pixels, int width, int height, int channels,
+                                      bool flip_y) {
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+        throw std::runtime_error("Cannot encode a "s + std::to_string(width) + "x" + std::to_string(height)
+                + " image with " + std::to_string(channels) + " channels as PNG");
+    }
+    std::size_t stride = std::size_t(width) * channels;
+
+    /* Each row is prefixed by its filter type */
+    std::vector<unsigned char> filtered((stride + 1) * height);
+    std::vector<unsigned char> candidate(stride);
+    std::vector<unsigned char> zero_row(stride);
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* row = pixels + stride * (flip_y ? height - 1 - y : y);
+        const unsigned char* above = y == 0 ? zero_row.data() : pixels + stride * (flip_y ? height - y : y - 1);
+        unsigned char* out = &filtered[(stride + 1) * y];
+
+        long best_score = -1;
+        for (int filter = 0; filter < 5; ++filter) {
+            long score = 0;
+            for (std::size_t i = 0; i < stride; ++i) {
+                int a = i >= std::size_t(channels) ? row[i - channels] : 0;
+                int b = above[i];
+                int c = i >= std::size_t(channels) ? above[i - channels] : 0;
+                unsigned char predicted = filter == 0 ? 0
+                        : filter == 1 ? a
+                        : filter == 2 ? b
+                        : filter == 3 ? (a + b) / 2
+                        : paeth(a, b, c);
+                candidate[i] = (unsigned char)(row[i] - predicted);
+                score += std::abs((signed char)candidate[i]);
+            }
+            if (best_score < 0 || score < best_score) {
+                best_score = score;
+                out[0] = (unsigned char)filter;
+                std::copy(candidate.begin(), candidate.end(), out + 1);
+            }
+        }
+    }
+
+    std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    std::vector<unsigned char> header;
+    put32(header, std::uint32_t(width));
+    put32(header, std::uint32_t(height));
+    const unsigned char color_types[] = {0, 4, 2, 6};
+    header.insert(header.end(), {8, color_types[channels - 1], 0, 0, 0});
+    put_chunk(png, "IHDR", header);
+
+    std::vector<unsigned char> compressed;
+    zlib_compress(filtered, compressed);
+    put_chunk(png, "IDAT", compressed);
+    put_chunk(png, "IEND", {});
+    return png;
+}
+
+void write_png(const std::string& path, const unsigned char* pixels, int width, int height, int channels,
+               bool flip_y) {
+    std::vector<unsigned char> png = encode_png(pixels, width, height, channels, flip_y);
+    std::ofstream out{path, std::ios::binary};
+    out.write(reinterpret_cast<const char*>(png.data()), std::streamsize(png.size()));
+    if (!out.flush()) {
+        throw std::runtime_error("Error writing PNG file '"s + path + "'");
+    }
+}
@@ -0,0 +1,286 @@
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <json.hpp>
+#include <profiler.hpp>
+
+using namespace std::string_literals;
+
+namespace {
+    const std::size_t CHUNK_EVENTS = 4096;
+    /* GPU zones are not looked at before they are this many frames old, by
+     * when their queries should long be done */
+    const std::size_t GPU_LATENCY = 3;
+    /* End time of instant events */
+    const std::uint64_t INSTANT = ~std::uint64_t(0);
+    /* Counter samples keep their value in place of an end time, tagged
+     * with the top bit, which no end time gets near */
+    const std::uint64_t COUNTER = std::uint64_t(1) << 63;
+
+    const auto epoch = std::chrono::steady_clock::now();
+
+    struct Event {
+        const char* name;
+        std::uint64_t start_ns;
+        std::uint64_t end_ns;
+    };
+
+    /* Written by one thread only; `count` publishes the events before it to
+     * the trace writer, `next` the chunk after it */
+    struct Chunk {
+        Event events[CHUNK_EVENTS];
+        std::atomic<std::size_t> count{0};
+        std::atomic<Chunk*> next{nullptr};
+    };
+
+    struct Track {
+        explicit Track(std::uint64_t id) : id{id}, head{new Chunk}, tail{head} {
+        }
+        ~Track() {
+            for (Chunk* chunk = this->head; chunk;) {
+                Chunk* next = chunk->next.load(std::memory_order_relaxed);
+                delete chunk;
+                chunk = next;
+            }
+        }
+
+        void record(const char* name, std::uint64_t start_ns, std::uint64_t end_ns) {
+            Chunk* chunk = this->tail;
+            std::size_t count = chunk->count.load(std::memory_order_relaxed);
+            if (count == CHUNK_EVENTS) {
+                Chunk* fresh = new Chunk;
+                chunk->next.store(fresh, std::memory_order_release);
+                this->tail = chunk = fresh;
+                count = 0;
+            }
+            chunk->events[count] = {name, start_ns, end_ns};
+            chunk->count.store(count + 1, std::memory_order_release);
+        }
+
+        const std::uint64_t id;
+        /* Guarded by the registry's mutex */
+        std::string name;
+        Chunk* const head;
+        /* Only touched by the writing thread */
+        Chunk* tail;
+    };
+
+    /* Tracks outlive their threads, so traces written after a thread ended
+     * still have its zones */
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Track>> tracks;
+
+        std::shared_ptr<Track> add(std::string name) {
+            std::lock_guard lock{this->mutex};
+            auto track = std::make_shared<Track>(this->tracks.size() + 1);
+            track->name = name.empty() ? "thread " + std::to_string(track->id) : std::move(name);
+            this->tracks.push_back(track);
+            return track;
+        }
+    };
+
+    Registry& registry() {
+        static Registry registry;
+        return registry;
+    }
+
+    Track& thread_track() {
+        thread_local std::shared_ptr<Track> track = registry().add({});
+        return *track;
+    }
+
+    struct GpuZone {
+        const char* name;
+        GLuint begin_query;
+        GLuint end_query;
+    };
+
+    struct GpuFrame {
+        std::vector<GpuZone> zones;
+        /* Issued last; with nested zones, not the end of the zone listed
+         * last, which is the innermost one */
+        GLuint last_query = 0;
+    };
+
+    /* GPU zones, per frame, until their timestamps are read back; render
+     * thread only */
+    struct GpuProfiler {
+        std::shared_ptr<Track> track = registry().add("GPU");
+        std::deque<GpuFrame> frames{1};
+        std::vector<GLuint> free_queries;
+        /* CPU minus GPU clock, in nanoseconds; both count from unrelated
+         * points in time */
+        std::int64_t clock_offset_ns = 0;
+        bool calibrated = false;
+
+        /* A timestamp query for the current frame, issued right away */
+        GLuint query() {
+            GLuint query;
+            if (this->free_queries.empty()) {
+                glGenQueries(1, &query);
+            } else {
+                query = this->free_queries.back();
+                this->free_queries.pop_back();
+            }
+            glQueryCounter(query, GL_TIMESTAMP);
+            this->frames.back().last_query = query;
+            return query;
+        }
+
+        void calibrate() {
+            GLint64 gpu_ns = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+            this->clock_offset_ns = std::int64_t(profile_now_ns()) - gpu_ns;
+            this->calibrated = true;
+        }
+
+        /* Reads back the oldest frames whose queries are done */
+        void collect() {
+            while (this->frames.size() > GPU_LATENCY) {
+                GpuFrame& frame = this->frames.front();
+                if (frame.last_query) {
+                    /* Queries complete in order, so the last one issued tells */
+                    GLuint available = GL_FALSE;
+                    glGetQueryObjectuiv(frame.last_query, GL_QUERY_RESULT_AVAILABLE, &available);
+                    if (!available) {
+                        return;
+                    }
+                }
+                for (const GpuZone& zone : frame.zones) {
+                    GLuint64 begin_ns = 0;
+                    GLuint64 end_ns = 0;
+                    glGetQueryObjectui64v(zone.begin_query, GL_QUERY_RESULT, &begin_ns);
+                    glGetQueryObjectui64v(zone.end_query, GL_QUERY_RESULT, &end_ns);
+                    this->track->record(zone.name, std::uint64_t(std::int64_t(begin_ns) + this->clock_offset_ns),
+                                        std::uint64_t(std::int64_t(end_ns) + this->clock_offset_ns));
+                    this->free_queries.push_back(zone.begin_query);
+                    this->free_queries.push_back(zone.end_query);
+                }
+                this->frames.pop_front();
+            }
+        }
+    };
+
+    GpuProfiler& gpu_profiler() {
+        static GpuProfiler profiler;
+        return profiler;
+    }
+
+    std::uint64_t frame_start_ns = 0;
+}
+
+std::uint64_t profile_now_ns() {
+    return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count());
+}
+
+void profile_record(const char* name, std::uint64_t start_ns, std::uint64_t end_ns) {
+    thread_track().record(name, start_ns, end_ns);
+}
+
+void profile_instant(const char* name) {
+    thread_track().record(name, profile_now_ns(), INSTANT);
+}
+
+void profile_counter(const char* name, std::uint64_t value) {
+    thread_track().record(name, profile_now_ns(), COUNTER | (value & ~COUNTER));
+}
+
+void profile_thread_name(std::string name) {
+    Track& track = thread_track();
+    std::lock_guard lock{registry().mutex};
+    track.name = std::move(name);
+}
+
+GpuProfileZone::GpuProfileZone(const char* name) {
+    GpuProfiler& profiler = gpu_profiler();
+    if (!profiler.calibrated) {
+        profiler.calibrate();
+    }
+    std::vector<GpuZone>& zones = profiler.frames.back().zones;
+    this->zone = zones.size();
+    zones.push_back({name, profiler.query(), 0});
+}
+
+GpuProfileZone::~GpuProfileZone() {
+    GpuProfiler& profiler = gpu_profiler();
+    GpuZone& zone = profiler.frames.back().zones[this->zone];
+    zone.end_query = profiler.query();
+}
+
+void profile_frame() {
+    std::uint64_t now = profile_now_ns();
+    thread_track().record("frame", frame_start_ns, now);
+    frame_start_ns = now;
+
+    GpuProfiler& profiler = gpu_profiler();
+    if (profiler.calibrated) {
+        profiler.frames.emplace_back();
+        profiler.collect();
+    }
+}
+
+void write_profile_trace(const std::string& path) {
+    std::vector<std::pair<std::shared_ptr<Track>, std::string>> tracks;
+    {
+        std::lock_guard lock{registry().mutex};
+        for (const auto& track : registry().tracks) {
+            tracks.emplace_back(track, track->name);
+        }
+    }
+
+    std::ostringstream text;
+    JsonWriter json{text};
+    json.begin_object()
+        .field("displayTimeUnit", "ns")
+        .begin_array("traceEvents");
+    for (const auto& [track, name] : tracks) {
+        json.begin_object()
+            .field("name", "thread_name")
+            .field("ph", "M")
+            .field("pid", 1)
+            .field("tid", std::uint64_t(track->id))
+            .begin_object("args").field("name", name).end_object()
+            .end_object();
+
+        /* Timestamps are in microseconds */
+        for (Chunk* chunk = track->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            std::size_t count = chunk->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < count; ++i) {
+                const Event& event = chunk->events[i];
+                json.begin_object()
+                    .field("name", event.name)
+                    .field("ts", double(event.start_ns) / 1e3);
+                if (event.end_ns == INSTANT) {
+                    /* Scoped to the thread's track */
+                    json.field("ph", "i").field("s", "t");
+                } else if (event.end_ns & COUNTER) {
+                    json.field("ph", "C")
+                        .begin_object("args").field("value", event.end_ns & ~COUNTER).end_object();
+                } else {
+                    json.field("ph", "X").field("dur", double(event.end_ns - event.start_ns) / 1e3);
+                }
+                json.field("pid", 1)
+                    .field("tid", std::uint64_t(track->id))
+                    .end_object();
+            }
+        }
+    }
+    json.end_array().end_object();
+
+    std::ofstream out{path};
+    out << text.str();
+    if (!out.flush()) {
+        throw std::runtime_error("Error writing trace file '"s + path + "'");
+    }
+}
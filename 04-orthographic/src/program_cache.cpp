@@ -0,0 +1,195 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+
+#include <glad/glad.h>
+
+#include <shader_prog.hpp>
+#include <program_cache.hpp>
+#include <hash.hpp>
+
+using namespace std::string_literals;
+
+namespace {
+    const char CACHE_MAGIC[4] = {'A', 'Z', 'P', 'B'};
+    const std::uint32_t CACHE_VERSION = 1;
+
+    struct CacheHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t binary_format;
+        std::uint32_t binary_length;
+        std::uint64_t checksum;
+    };
+
+    std::string gl_string(GLenum name) {
+        auto value = reinterpret_cast<const char*>(glGetString(name));
+        return value ? value : "";
+    }
+}
+
+ProgramCache::ProgramCache(std::filesystem::path cache_dir)
+    : cache_dir{std::move(cache_dir)} {
+
+    this->driver_id = gl_string(GL_RENDERER) + '\n' + gl_string(GL_VERSION);
+
+    /* Program binaries are core since 4.1; glad leaves the pointers null when
+     * the context cannot provide them */
+    GLint n_formats = 0;
+    if (glGetProgramBinary && glProgramBinary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+    }
+    this->binary_support = n_formats > 0;
+
+    if (this->binary_support) {
+        std::error_code error;
+        std::filesystem::create_directories(this->cache_dir, error);
+        if (error) {
+            std::cerr << "Program cache disabled: cannot create '"
+                      << this->cache_dir.string() << "'\n";
+            this->binary_support = false;
+        }
+    }
+}
+
+bool ProgramCache::supported() const {
+    return this->binary_support;
+}
+
+std::uint64_t ProgramCache::key_for(const std::string& vert_shader_src,
+                                    const std::string& frag_shader_src) const {
+    /* The separators keep ("ab", "c") and ("a", "bc") from colliding */
+    std::uint64_t key = fnv1a_64(vert_shader_src);
+    key = fnv1a_64("\0", 1, key);
+    key = fnv1a_64(frag_shader_src, key);
+    key = fnv1a_64("\0", 1, key);
+    return fnv1a_64(this->driver_id, key);
+}
+
+std::filesystem::path ProgramCache::path_for(std::uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof name, "%016llx.bin", static_cast<unsigned long long>(key));
+    return this->cache_dir / name;
+}
+
+GLuint ProgramCache::get_program(const std::string& vert_shader_src,
+                                 const std::string& frag_shader_src) {
+    std::uint64_t key = 0;
+    if (this->binary_support) {
+        key = key_for(vert_shader_src, frag_shader_src);
+        GLuint program_id;
+        if (restore(key, program_id)) {
+            ++this->hits;
+            return program_id;
+        }
+    }
+    ++this->misses;
+
+    GLuint vert_shader_id = compile_shader(vert_shader_src, GL_VERTEX_SHADER);
+    GLuint frag_shader_id = 0;
+    GLuint program_id;
+    try {
+        frag_shader_id = compile_shader(frag_shader_src, GL_FRAGMENT_SHADER);
+        program_id = link_program(vert_shader_id, frag_shader_id, this->binary_support);
+    } catch (...) {
+        /* Deleting shader 0 is a no-op, so this covers either step failing */
+        glDeleteShader(frag_shader_id);
+        glDeleteShader(vert_shader_id);
+        throw;
+    }
+    glDeleteShader(frag_shader_id);
+    glDeleteShader(vert_shader_id);
+
+    if (this->binary_support) {
+        store(key, program_id);
+    }
+
+    return program_id;
+}
+
+bool ProgramCache::restore(std::uint64_t key, GLuint& program_id) {
+    auto path = path_for(key);
+    std::ifstream file{path, std::ios::binary};
+    if (!file) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::vector<char> binary;
+    bool valid = bool(file.read(reinterpret_cast<char*>(&header), sizeof header))
+        && std::memcmp(header.magic, CACHE_MAGIC, sizeof CACHE_MAGIC) == 0
+        && header.version == CACHE_VERSION
+        && header.key == key;
+    if (valid) {
+        binary.resize(header.binary_length);
+        valid = bool(file.read(binary.data(), binary.size()))
+            && file.peek() == std::ifstream::traits_type::eof()
+            && fnv1a_64(binary.data(), binary.size()) == header.checksum;
+    }
+    file.close();
+
+    if (!valid) {
+        std::cerr << "Discarding corrupt program cache entry '" << path.string() << "'\n";
+        ++this->rejected;
+        std::filesystem::remove(path);
+        return false;
+    }
+
+    program_id = glCreateProgram();
+    glProgramBinary(program_id, header.binary_format, binary.data(), binary.size());
+
+    /* Drivers are free to reject binaries (e.g. after an update that kept the
+     * version string); that is reported through the link status */
+    int success;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+    if (!success) {
+        ++this->rejected;
+        glDeleteProgram(program_id);
+        std::filesystem::remove(path);
+        return false;
+    }
+
+    return true;
+}
+
+void ProgramCache::store(std::uint64_t key, GLuint program_id) {
+    GLint binary_length = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    if (binary_length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(binary_length);
+    GLenum binary_format;
+    glGetProgramBinary(program_id, binary_length, &binary_length, &binary_format, binary.data());
+    binary.resize(binary_length);
+
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof CACHE_MAGIC);
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.binary_format = binary_format;
+    header.binary_length = binary.size();
+    header.checksum = fnv1a_64(binary.data(), binary.size());
+
+    /* Write to a temporary file first so an interrupted run never leaves a
+     * half-written entry under the final name */
+    auto path = path_for(key);
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream file{tmp_path, std::ios::binary | std::ios::trunc};
+        file.write(reinterpret_cast<const char*>(&header), sizeof header);
+        file.write(binary.data(), binary.size());
+        if (!file) {
+            std::cerr << "Could not write program cache entry '" << path.string() << "'\n";
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tmp_path, path, error);
+}
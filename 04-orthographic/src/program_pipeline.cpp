@@ -0,0 +1,248 @@
+#include <stdexcept>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <shader_prog.hpp>
+#include <program_pipeline.hpp>
+#include <gl_ext.hpp>
+#include <hash.hpp>
+
+using namespace std::string_literals;
+
+namespace {
+    std::uint64_t pair_key(GLuint a, GLuint b) {
+        return (std::uint64_t{a} << 32) | b;
+    }
+
+    /* Without glProgramUniform* (monolithic fallback on GL < 4.1), the
+     * program has to be made current for a moment */
+    template <typename F>
+    void with_program(GLuint program, F set) {
+        GLint previous_program = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+        if (GLuint(previous_program) != program) {
+            glUseProgram(program);
+        }
+        set();
+        if (GLuint(previous_program) != program) {
+            glUseProgram(GLuint(previous_program));
+        }
+    }
+
+    /* Calls `set` with the program and location of every stage declaring
+     * the uniform */
+    template <typename F>
+    void for_each_stage(const PipelineUniform& uniform, F set) {
+        if (uniform.vertex_location != -1) {
+            set(uniform.vertex_program, uniform.vertex_location);
+        }
+        if (uniform.fragment_location != -1) {
+            set(uniform.fragment_program, uniform.fragment_location);
+        }
+    }
+}
+
+void PipelineBinding::bind() const {
+    if (this->pipeline) {
+        /* A previously used monolithic program would take precedence */
+        glUseProgram(0);
+        glBindProgramPipeline(this->pipeline);
+    } else {
+        glUseProgram(this->vertex_program);
+    }
+}
+
+void PipelineBinding::store_uniform_locations(std::initializer_list<std::string> uniform_names) {
+    for (auto& uniform_name : uniform_names) {
+        if (this->uniforms.contains(uniform_name)) {
+            continue;
+        }
+        this->uniforms[uniform_name] = find_uniform(uniform_name);
+    }
+}
+
+PipelineUniform PipelineBinding::find_uniform(const std::string& name) const {
+    PipelineUniform uniform{this->vertex_program, glGetUniformLocation(this->vertex_program, name.c_str()),
+                            this->fragment_program, -1};
+    /* On the monolithic fallback the one program covers both stages */
+    if (this->fragment_program != this->vertex_program) {
+        uniform.fragment_location = glGetUniformLocation(this->fragment_program, name.c_str());
+    }
+    return uniform;
+}
+
+void PipelineBinding::replace_stages(GLuint vertex_program, GLuint fragment_program) {
+    if (this->pipeline) {
+        glUseProgramStages(this->pipeline, GL_VERTEX_SHADER_BIT, vertex_program);
+        glUseProgramStages(this->pipeline, GL_FRAGMENT_SHADER_BIT, fragment_program);
+    }
+    this->vertex_program = vertex_program;
+    this->fragment_program = fragment_program;
+    for (auto& [name, uniform] : this->uniforms) {
+        uniform = find_uniform(name);
+    }
+}
+
+PipelineUniform PipelineBinding::get_uniform_location(std::string_view name) const {
+    auto iter = this->uniforms.find(std::string{name});
+    if (iter == std::end(this->uniforms)) {
+        throw std::invalid_argument{"No such uniform found"};
+    }
+    return iter->second;
+}
+
+void PipelineBinding::set_uniform_4f(PipelineUniform uniform, float x, float y, float z, float w) const {
+    for_each_stage(uniform, [&](GLuint program, GLint location) {
+        if (glProgramUniform4f) {
+            glProgramUniform4f(program, location, x, y, z, w);
+        } else {
+            with_program(program, [&] { glUniform4f(location, x, y, z, w); });
+        }
+    });
+}
+
+void PipelineBinding::set_uniform_matrix4fv(PipelineUniform uniform, const glm::mat4& transform) const {
+    for_each_stage(uniform, [&](GLuint program, GLint location) {
+        if (glProgramUniformMatrix4fv) {
+            glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, glm::value_ptr(transform));
+        } else {
+            with_program(program, [&] {
+                glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(transform));
+            });
+        }
+    });
+}
+
+PipelineCache::PipelineCache(bool allow_separable) {
+    /* glad only loads these entry points for 4.1+ contexts */
+    this->separable = allow_separable && glCreateShaderProgramv && glGenProgramPipelines && glUseProgramStages
+        && (GLAD_GL_VERSION_4_1 || has_gl_extension("GL_ARB_separate_shader_objects"));
+}
+
+GLuint PipelineCache::get_stage(const std::string& shader_src, GLenum gl_shader_type) {
+    /* The stage type first, so the same source as another type is another
+     * stage */
+    std::uint64_t key = fnv1a_64(&gl_shader_type, sizeof gl_shader_type);
+    key = fnv1a_64("\0", 1, key);
+    key = fnv1a_64(shader_src, key);
+    auto iter = this->stages.find(key);
+    if (iter != this->stages.end()) {
+        return iter->second;
+    }
+
+    /* Compiles, marks separable and links in one go */
+    const char* const shader_code = shader_src.c_str();
+    GLuint stage = glCreateShaderProgramv(gl_shader_type, 1, &shader_code);
+    ++this->link_count;
+
+    int success;
+    glGetProgramiv(stage, GL_LINK_STATUS, &success);
+    if (!success) {
+        char info_buffer[512];
+        glGetProgramInfoLog(stage, 512, nullptr, info_buffer);
+        glDeleteProgram(stage);
+        throw std::runtime_error("Separable shader stage build failed: "s + info_buffer);
+    }
+
+    this->stages[key] = stage;
+    return stage;
+}
+
+const PipelineBinding& PipelineCache::get(const std::string& vert_shader_src,
+                                          const std::string& frag_shader_src,
+                                          std::initializer_list<std::string> uniform_names) {
+    if (!this->separable) {
+        /* As ProgramCache::key_for(): the separators keep ("ab", "c") and
+         * ("a", "bc") from colliding */
+        std::uint64_t key = fnv1a_64(vert_shader_src);
+        key = fnv1a_64("\0", 1, key);
+        key = fnv1a_64(frag_shader_src, key);
+        key = fnv1a_64("\0", 1, key);
+        auto iter = this->bindings.find(key);
+        if (iter != this->bindings.end()) {
+            iter->second.store_uniform_locations(uniform_names);
+            return iter->second;
+        }
+
+        GLuint vert_shader_id = compile_shader(vert_shader_src, GL_VERTEX_SHADER);
+        GLuint frag_shader_id = compile_shader(frag_shader_src, GL_FRAGMENT_SHADER);
+        GLuint program = link_program(vert_shader_id, frag_shader_id);
+        ++this->link_count;
+        glDeleteShader(frag_shader_id);
+        glDeleteShader(vert_shader_id);
+
+        PipelineBinding& binding = this->bindings[key] = {
+            .pipeline = 0, .vertex_program = program, .fragment_program = program};
+        binding.store_uniform_locations(uniform_names);
+        return binding;
+    }
+
+    GLuint vertex_program = get_stage(vert_shader_src, GL_VERTEX_SHADER);
+    GLuint fragment_program = get_stage(frag_shader_src, GL_FRAGMENT_SHADER);
+
+    std::uint64_t key = pair_key(vertex_program, fragment_program);
+    auto iter = this->bindings.find(key);
+    if (iter != this->bindings.end()) {
+        iter->second.store_uniform_locations(uniform_names);
+        return iter->second;
+    }
+
+    /* Mixing stages is a bind-time operation; no linking involved */
+    GLuint pipeline;
+    glGenProgramPipelines(1, &pipeline);
+    glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertex_program);
+    glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragment_program);
+
+    PipelineBinding& binding = this->bindings[key] = {
+        .pipeline = pipeline, .vertex_program = vertex_program, .fragment_program = fragment_program};
+    binding.store_uniform_locations(uniform_names);
+    return binding;
+}
+
+PipelineBinding& PipelineCache::get(GLuint vertex_program, GLuint fragment_program,
+                                    std::initializer_list<std::string> uniform_names) {
+    for (auto& binding : this->external_bindings) {
+        if (binding.vertex_program == vertex_program && binding.fragment_program == fragment_program) {
+            binding.store_uniform_locations(uniform_names);
+            return binding;
+        }
+    }
+
+    GLuint pipeline = 0;
+    if (vertex_program != fragment_program) {
+        if (!this->separable) {
+            throw std::invalid_argument{"Separate stages need separate shader objects"};
+        }
+        glGenProgramPipelines(1, &pipeline);
+        glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertex_program);
+        glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragment_program);
+    }
+
+    PipelineBinding& binding = this->external_bindings.emplace_back(PipelineBinding{
+        .pipeline = pipeline, .vertex_program = vertex_program, .fragment_program = fragment_program});
+    binding.store_uniform_locations(uniform_names);
+    return binding;
+}
+
+void PipelineCache::del() {
+    for (auto& [key, binding] : this->bindings) {
+        if (binding.pipeline) {
+            glDeleteProgramPipelines(1, &binding.pipeline);
+        } else {
+            glDeleteProgram(binding.vertex_program);
+        }
+    }
+    for (auto& binding : this->external_bindings) {
+        if (binding.pipeline) {
+            glDeleteProgramPipelines(1, &binding.pipeline);
+        }
+    }
+    this->external_bindings.clear();
+    for (auto& [key, stage] : this->stages) {
+        glDeleteProgram(stage);
+    }
+    this->bindings.clear();
+    this->stages.clear();
+}
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <hash.hpp>
+#include <lz4.hpp>
+#include <resource_pack.hpp>
+
+using namespace std::string_literals;
+
+namespace {
+    const char PACK_MAGIC[8] = {'A', 'Z', 'P', 'K', '\r', '\n', '\x1a', '\n'};
+    const std::uint32_t PACK_VERSION = 1;
+    const std::size_t PACK_ALIGNMENT = 16;
+
+    std::size_t align(std::size_t offset) {
+        return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+    }
+
+    std::unique_ptr<ResourcePack> mounted;
+}
+
+std::string resource_name(std::string_view path) {
+    return std::filesystem::path{path}.lexically_normal().generic_string();
+}
+
+std::vector<unsigned char> build_resource_pack(const std::vector<PackInput>& inputs, bool compress) {
+    struct Blob {
+        PackEntry entry{};
+        std::string name;
+        std::vector<unsigned char> stored;
+    };
+    std::vector<Blob> blobs;
+    for (auto& input : inputs) {
+        Blob blob;
+        blob.name = resource_name(input.name);
+        blob.entry.hash = fnv1a_64(blob.name);
+        blob.entry.bytes = input.bytes.size();
+        if (compress && !input.bytes.empty()) {
+            blob.stored.resize(lz4_compress_bound(input.bytes.size()));
+            blob.stored.resize(lz4_compress(input.bytes.data(), input.bytes.size(), blob.stored.data()));
+            blob.entry.flags = PACK_LZ4;
+        }
+        if (!compress || blob.stored.size() > input.bytes.size() - input.bytes.size() / 8) {
+            blob.stored = input.bytes;
+            blob.entry.flags = 0;
+        }
+        blob.entry.stored_bytes = blob.stored.size();
+        blobs.push_back(std::move(blob));
+    }
+    std::sort(blobs.begin(), blobs.end(), [](const Blob& a, const Blob& b) {
+        return a.entry.hash != b.entry.hash ? a.entry.hash < b.entry.hash : a.name < b.name;
+    });
+    for (std::size_t i = 1; i < blobs.size(); ++i) {
+        if (blobs[i].name == blobs[i - 1].name) {
+            throw std::runtime_error("Resource '"s + blobs[i].name + "' packed twice");
+        }
+    }
+
+    PackHeader header{};
+    std::memcpy(header.magic, PACK_MAGIC, sizeof header.magic);
+    header.version = PACK_VERSION;
+    header.entries = std::uint32_t(blobs.size());
+    header.names_offset = sizeof header + blobs.size() * sizeof(PackEntry);
+    for (auto& blob : blobs) {
+        blob.entry.name_offset = std::uint32_t(header.names_bytes);
+        blob.entry.name_length = std::uint32_t(blob.name.size());
+        header.names_bytes += blob.name.size();
+    }
+    std::size_t offset = align(header.names_offset + header.names_bytes);
+    for (auto& blob : blobs) {
+        blob.entry.offset = offset;
+        offset = align(offset + blob.stored.size());
+    }
+
+    std::vector<unsigned char> pack(offset);
+    std::memcpy(pack.data(), &header, sizeof header);
+    for (std::size_t i = 0; i < blobs.size(); ++i) {
+        const Blob& blob = blobs[i];
+        std::memcpy(pack.data() + sizeof header + i * sizeof(PackEntry), &blob.entry, sizeof blob.entry);
+        std::memcpy(pack.data() + header.names_offset + blob.entry.name_offset, blob.name.data(), blob.name.size());
+        std::memcpy(pack.data() + blob.entry.offset, blob.stored.data(), blob.stored.size());
+    }
+    return pack;
+}
+
+ResourcePack::ResourcePack(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Error opening resource pack '"s + path + "'");
+    }
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    if (::fstat(fd, &status) == 0 && std::size_t(status.st_size) >= sizeof(PackHeader)) {
+        this->bytes = status.st_size;
+        mapping = ::mmap(nullptr, this->bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Error mapping resource pack '"s + path + "'");
+    }
+    this->data = static_cast<const unsigned char*>(mapping);
+
+    /* The index is read on every lookup; the blobs are only checked to lie
+     * within the file */
+    ::madvise(mapping, this->bytes, MADV_RANDOM);
+    auto header = reinterpret_cast<const PackHeader*>(this->data);
+    bool valid = std::memcmp(header->magic, PACK_MAGIC, sizeof header->magic) == 0
+        && header->version == PACK_VERSION
+        && header->names_offset == sizeof *header + std::size_t(header->entries) * sizeof(PackEntry)
+        && header->names_offset <= this->bytes && header->names_bytes <= this->bytes - header->names_offset;
+    if (valid) {
+        this->entries = reinterpret_cast<const PackEntry*>(this->data + sizeof *header);
+        this->n_entries = header->entries;
+    }
+    for (std::size_t i = 0; valid && i < this->n_entries; ++i) {
+        const PackEntry& entry = this->entries[i];
+        valid = entry.offset <= this->bytes && entry.stored_bytes <= this->bytes - entry.offset
+            && std::uint64_t(entry.name_offset) + entry.name_length <= header->names_bytes
+            && (entry.flags & PACK_LZ4 || entry.stored_bytes == entry.bytes)
+            && (i == 0 || this->entries[i - 1].hash <= entry.hash);
+    }
+    if (!valid) {
+        ::munmap(mapping, this->bytes);
+        throw std::runtime_error("Invalid resource pack '"s + path + "'");
+    }
+    this->unpacked = std::make_unique<Unpacked[]>(this->n_entries);
+}
+
+ResourcePack::~ResourcePack() {
+    ::munmap(const_cast<unsigned char*>(this->data), this->bytes);
+}
+
+const PackEntry* ResourcePack::entry(std::string_view path) const {
+    std::string name = resource_name(path);
+    std::uint64_t hash = fnv1a_64(name);
+    auto names = reinterpret_cast<const char*>(this->data)
+        + reinterpret_cast<const PackHeader*>(this->data)->names_offset;
+
+    const PackEntry* end = this->entries + this->n_entries;
+    auto found = std::lower_bound(this->entries, end, hash, [](const PackEntry& entry, std::uint64_t hash) {
+        return entry.hash < hash;
+    });
+    for (; found != end && found->hash == hash; ++found) {
+        if (std::string_view{names + found->name_offset, found->name_length} == name) {
+            return found;
+        }
+    }
+    return nullptr;
+}
+
+std::span<const unsigned char> ResourcePack::contents(std::size_t index) const {
+    const PackEntry& entry = this->entries[index];
+    const unsigned char* stored = this->data + entry.offset;
+    if (!(entry.flags & PACK_LZ4)) {
+        return {stored, std::size_t(entry.bytes)};
+    }
+
+    Unpacked& unpacked = this->unpacked[index];
+    std::call_once(unpacked.once, [&] {
+        auto data = std::make_unique_for_overwrite<unsigned char[]>(entry.bytes);
+        lz4_decompress(stored, entry.stored_bytes, data.get(), entry.bytes);
+        unpacked.data = std::move(data);
+    });
+    return {unpacked.data.get(), std::size_t(entry.bytes)};
+}
+
+bool ResourcePack::contains(std::string_view path) const {
+    return entry(path) != nullptr;
+}
+
+std::optional<std::span<const unsigned char>> ResourcePack::find(std::string_view path) const {
+    const PackEntry* found = entry(path);
+    if (!found) {
+        return std::nullopt;
+    }
+    return contents(found - this->entries);
+}
+
+void ResourcePack::decompress_all(ThreadPool& pool) const {
+    std::vector<std::size_t> compressed;
+    for (std::size_t i = 0; i < this->n_entries; ++i) {
+        if (this->entries[i].flags & PACK_LZ4) {
+            compressed.push_back(i);
+        }
+    }
+    pool.parallel_for(compressed.size(), [&](std::size_t i) {
+        contents(compressed[i]);
+    });
+}
+
+std::size_t ResourcePack::size() const {
+    return this->n_entries;
+}
+
+void mount_resource_pack(std::unique_ptr<ResourcePack> pack) {
+    mounted = std::move(pack);
+}
+
+const ResourcePack* mounted_resource_pack() {
+    return mounted.get();
+}
+
+std::optional<std::span<const unsigned char>> find_resource(std::string_view path) {
+    if (!mounted) {
+        return std::nullopt;
+    }
+    return mounted->find(path);
+}
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <set>
+
+#include <glad/glad.h>
+
+#include <shader_prog.hpp>
+#include <shader_preproc.hpp>
+
+using namespace std::string_literals;
+
+namespace {
+    struct Preprocessor {
+        PreprocessedShader result;
+        std::vector<std::filesystem::path> include_stack;
+        std::set<std::filesystem::path> once_files;
+
+        std::size_t file_index(const std::filesystem::path& path) {
+            auto iter = std::find(result.files.begin(), result.files.end(), path);
+            if (iter != result.files.end()) {
+                return iter - result.files.begin();
+            }
+            result.files.push_back(path);
+            return result.files.size() - 1;
+        }
+
+        void expand(const std::filesystem::path& path, const ShaderDefines* defines);
+    };
+
+    /* Splits "  #  include  \"x\"" into ("include", "\"x\""); returns false
+     * for lines that are not preprocessor directives */
+    bool parse_directive(const std::string& line, std::string& directive, std::string& argument) {
+        auto pos = line.find_first_not_of(" \t");
+        if (pos == std::string::npos || line[pos] != '#') {
+            return false;
+        }
+        pos = line.find_first_not_of(" \t", pos + 1);
+        if (pos == std::string::npos) {
+            return false;
+        }
+        auto end = line.find_first_of(" \t", pos);
+        directive = line.substr(pos, end - pos);
+        argument.clear();
+        if (end != std::string::npos) {
+            auto arg_pos = line.find_first_not_of(" \t", end);
+            auto arg_end = line.find_last_not_of(" \t\r");
+            if (arg_pos != std::string::npos) {
+                argument = line.substr(arg_pos, arg_end - arg_pos + 1);
+            }
+        }
+        return true;
+    }
+
+    std::string define_lines(const ShaderDefines& defines) {
+        std::string lines;
+        for (auto& [name, value] : defines) {
+            lines += "#define " + name + ' ' + (value.empty() ? "1"s : value) + '\n';
+        }
+        return lines;
+    }
+
+    std::string variant_key(const std::filesystem::path& path, const ShaderDefines& defines) {
+        std::string key = path.lexically_normal().string();
+        for (auto& [name, value] : defines) {
+            key += '\n' + name + '=' + value;
+        }
+        return key;
+    }
+
+    bool uses_file(const ShaderVariantCache::Variant& variant, const std::filesystem::path& path) {
+        return std::find(variant.files.begin(), variant.files.end(), path) != variant.files.end();
+    }
+}
+
+void Preprocessor::expand(const std::filesystem::path& path, const ShaderDefines* defines) {
+    if (std::find(include_stack.begin(), include_stack.end(), path) != include_stack.end()) {
+        throw std::runtime_error("Shader include cycle at '"s + path.string() + "'");
+    }
+    if (once_files.contains(path)) {
+        return;
+    }
+
+    std::istringstream src{load_shader_src(path.string())};
+    std::size_t index = file_index(path);
+    include_stack.push_back(path);
+
+    std::string line;
+    std::string directive;
+    std::string argument;
+    std::size_t line_number = 0;
+    bool defines_pending = defines != nullptr;
+
+    while (std::getline(src, line)) {
+        ++line_number;
+
+        if (!parse_directive(line, directive, argument)) {
+            result.source += line + '\n';
+            continue;
+        }
+
+        if (directive == "version" && defines_pending) {
+            result.source += line + '\n' + define_lines(*defines);
+            result.source += "#line " + std::to_string(line_number + 1) + ' ' + std::to_string(index) + '\n';
+            defines_pending = false;
+        } else if (directive == "include") {
+            if (argument.size() < 2 || (argument.front() != '"' && argument.front() != '<')) {
+                throw std::runtime_error("Malformed #include in '"s + path.string() + "' line "
+                        + std::to_string(line_number));
+            }
+            auto include_path = (path.parent_path() / argument.substr(1, argument.size() - 2))
+                .lexically_normal();
+            result.source += "#line 1 " + std::to_string(file_index(include_path)) + '\n';
+            expand(include_path, nullptr);
+            result.source += "#line " + std::to_string(line_number + 1) + ' ' + std::to_string(index) + '\n';
+        } else if (directive == "pragma" && argument == "once") {
+            once_files.insert(path);
+            result.source += '\n';
+        } else if (directive == "pragma" && argument.starts_with("feature")) {
+            std::string name = argument.substr(sizeof "feature" - 1);
+            name.erase(0, name.find_first_not_of(" \t"));
+            if (name.empty()) {
+                throw std::runtime_error("Missing name for #pragma feature in '"s + path.string() + "'");
+            }
+            result.source += "#ifndef " + name + "\n#define " + name + " 0\n#endif\n";
+            result.source += "#line " + std::to_string(line_number + 1) + ' ' + std::to_string(index) + '\n';
+        } else {
+            result.source += line + '\n';
+        }
+    }
+
+    /* A shader without #version gets the defines at the very top */
+    if (defines_pending && !defines->empty()) {
+        result.source = define_lines(*defines) + "#line 1 0\n" + result.source;
+    }
+
+    include_stack.pop_back();
+}
+
+PreprocessedShader preprocess_shader(const std::filesystem::path& path,
+                                     const ShaderDefines& defines) {
+    Preprocessor preprocessor;
+    preprocessor.expand(path.lexically_normal(), &defines);
+    return preprocessor.result;
+}
+
+GLuint ShaderVariantCache::get_shader(const std::filesystem::path& path, GLenum gl_shader_type,
+                                      const ShaderDefines& defines) {
+    std::string key = variant_key(path, defines) + '\n' + std::to_string(gl_shader_type);
+    auto iter = this->shaders.find(key);
+    if (iter != this->shaders.end()) {
+        return iter->second.id;
+    }
+
+    PreprocessedShader shader = preprocess_shader(path, defines);
+    GLuint shader_id = compile_shader(shader.source, gl_shader_type);
+    this->shaders[key] = {shader_id, std::move(shader.files)};
+    return shader_id;
+}
+
+GLuint ShaderVariantCache::get_program(const std::filesystem::path& vert_shader_path,
+                                       const std::filesystem::path& frag_shader_path,
+                                       const ShaderDefines& defines) {
+    std::string key = variant_key(vert_shader_path, defines) + '\n'
+        + variant_key(frag_shader_path, defines);
+    auto iter = this->programs.find(key);
+    if (iter != this->programs.end()) {
+        return iter->second.id;
+    }
+
+    GLuint vert_shader_id = get_shader(vert_shader_path, GL_VERTEX_SHADER, defines);
+    GLuint frag_shader_id = get_shader(frag_shader_path, GL_FRAGMENT_SHADER, defines);
+    GLuint program_id = link_program(vert_shader_id, frag_shader_id);
+
+    /* The program depends on whatever either of its stages depends on */
+    Variant variant{program_id, {}};
+    for (auto& [shader_key, shader] : this->shaders) {
+        if (shader.id == vert_shader_id || shader.id == frag_shader_id) {
+            variant.files.insert(variant.files.end(), shader.files.begin(), shader.files.end());
+        }
+    }
+    this->programs[key] = std::move(variant);
+    return program_id;
+}
+
+void ShaderVariantCache::invalidate(const std::filesystem::path& path) {
+    auto normal_path = path.lexically_normal();
+    std::erase_if(this->programs, [&](auto& entry) {
+        if (!uses_file(entry.second, normal_path)) {
+            return false;
+        }
+        glDeleteProgram(entry.second.id);
+        return true;
+    });
+    std::erase_if(this->shaders, [&](auto& entry) {
+        if (!uses_file(entry.second, normal_path)) {
+            return false;
+        }
+        glDeleteShader(entry.second.id);
+        return true;
+    });
+}
+
+void ShaderVariantCache::del() {
+    for (auto& [key, program] : this->programs) {
+        glDeleteProgram(program.id);
+    }
+    for (auto& [key, shader] : this->shaders) {
+        glDeleteShader(shader.id);
+    }
+    this->programs.clear();
+    this->shaders.clear();
+}
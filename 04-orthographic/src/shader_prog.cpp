@@ -1,6 +1,5 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
 
@@ -8,21 +7,31 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <shader_prog.hpp>
+#include <gl_debug.hpp>
+#include <program_cache.hpp>
+#include <resource_pack.hpp>
 
 using namespace std::string_literals;
 
 std::string load_shader_src(std::string_view src_path) {
-    std::ifstream src_file{src_path.data()};
+    if (auto packed = find_resource(src_path)) {
+        return std::string(packed->begin(), packed->end());
+    }
+    /* Read straight into the string, sized up front */
+    std::ifstream src_file{src_path.data(), std::ios::binary | std::ios::ate};
     if (!src_file) {
         throw std::runtime_error("Shader path not found: '"s + src_path.data() + "'");
     }
-    std::stringstream src_text;
-    src_text << src_file.rdbuf();
-    src_file.close();
-    return src_text.str();
+    std::string src_text(std::size_t(src_file.tellg()), '\0');
+    src_file.seekg(0);
+    if (!src_file.read(src_text.data(), std::streamsize(src_text.size()))) {
+        throw std::runtime_error("Error reading shader '"s + src_path.data() + "'");
+    }
+    return src_text;
 }
 
 GLuint compile_shader(const std::string& shader_src, GLenum gl_shader_type) {
+    GlDebugGroup debug_group{"compile_shader"};
     GLuint shader_id = glCreateShader(gl_shader_type);
 
     const char* const shader_code = shader_src.c_str();
@@ -36,41 +45,87 @@ GLuint compile_shader(const std::string& shader_src, GLenum gl_shader_type) {
 
     if (!success) {
         glGetShaderInfoLog(shader_id, 512, nullptr, info_buffer);
+        glDeleteShader(shader_id);
         throw std::runtime_error("Shader "s + std::to_string(shader_id) + " compilation failed");
     }
 
     return shader_id;
 }
 
-ShaderProgram::ShaderProgram(
-        std::string_view vert_shader_path,
-        std::string_view frag_shader_path,
-        std::initializer_list<std::string> uniform_names) {
-
-    std::string vert_shader_src = load_shader_src(vert_shader_path);
-    GLuint vert_shader_id = compile_shader(vert_shader_src, GL_VERTEX_SHADER);
-
-    std::string frag_shader_src = load_shader_src(frag_shader_path);
-    GLuint frag_shader_id = compile_shader(frag_shader_src, GL_FRAGMENT_SHADER);
-
+GLuint link_program(GLuint vert_shader_id, GLuint frag_shader_id, bool retrievable_binary) {
+    GlDebugGroup debug_group{"link_program"};
     GLuint shader_program_id = glCreateProgram();
     glAttachShader(shader_program_id, vert_shader_id);
     glAttachShader(shader_program_id, frag_shader_id);
+
+    /* Must be set before linking for glGetProgramBinary to be reliable */
+    if (retrievable_binary && glProgramParameteri) {
+        glProgramParameteri(shader_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
     glLinkProgram(shader_program_id);
 
     int success;
     char info_buffer[512];
     glGetProgramiv(shader_program_id, GL_LINK_STATUS, &success);
     if (!success) {
-        glGetShaderInfoLog(shader_program_id, 512, nullptr, info_buffer);
+        glGetProgramInfoLog(shader_program_id, 512, nullptr, info_buffer);
+        glDeleteProgram(shader_program_id);
         throw std::runtime_error("Shader program linking failed: "s + info_buffer);
     }
 
+    glDetachShader(shader_program_id, frag_shader_id);
+    glDetachShader(shader_program_id, vert_shader_id);
+
+    return shader_program_id;
+}
+
+ShaderProgram::ShaderProgram(
+        std::string_view vert_shader_path,
+        std::string_view frag_shader_path,
+        std::initializer_list<std::string> uniform_names) {
+
+    std::string vert_shader_src = load_shader_src(vert_shader_path);
+    GLuint vert_shader_id = compile_shader(vert_shader_src, GL_VERTEX_SHADER);
+    gl_object_label(GL_SHADER, vert_shader_id, vert_shader_path);
+
+    std::string frag_shader_src = load_shader_src(frag_shader_path);
+    GLuint frag_shader_id = compile_shader(frag_shader_src, GL_FRAGMENT_SHADER);
+    gl_object_label(GL_SHADER, frag_shader_id, frag_shader_path);
+
+    this->id = link_program(vert_shader_id, frag_shader_id);
+    gl_object_label(GL_PROGRAM, this->id, std::string{vert_shader_path} + " + " + std::string{frag_shader_path});
+
     glDeleteShader(frag_shader_id);
     glDeleteShader(vert_shader_id);
 
-    this->id = shader_program_id;
+    store_uniform_locations(uniform_names);
+}
+
+ShaderProgram::ShaderProgram(
+        std::string_view vert_shader_path,
+        std::string_view frag_shader_path,
+        std::initializer_list<std::string> uniform_names,
+        ProgramCache& cache) {
+
+    std::string vert_shader_src = load_shader_src(vert_shader_path);
+    std::string frag_shader_src = load_shader_src(frag_shader_path);
+
+    this->id = cache.get_program(vert_shader_src, frag_shader_src);
+    gl_object_label(GL_PROGRAM, this->id, std::string{vert_shader_path} + " + " + std::string{frag_shader_path});
+
+    store_uniform_locations(uniform_names);
+}
+
+ShaderProgram::ShaderProgram(
+        GLuint program_id,
+        std::initializer_list<std::string> uniform_names)
+    : id{program_id} {
+
+    store_uniform_locations(uniform_names);
+}
 
+void ShaderProgram::store_uniform_locations(std::initializer_list<std::string> uniform_names) {
     /* Get and store location of uniforms */
     for (auto uniform_name : uniform_names) {
         this->uniforms[uniform_name] = glGetUniformLocation(this->id, uniform_name.data());
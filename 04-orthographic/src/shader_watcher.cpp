@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <glad/glad.h>
+
+#include <shader_watcher.hpp>
+
+namespace {
+    /* Editors either rewrite files in place or write a new file and rename it
+     * over the old one, so directories are watched rather than files */
+    const std::uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+    std::filesystem::path absolute_path(const std::filesystem::path& path) {
+        std::error_code error;
+        auto absolute = std::filesystem::absolute(path, error);
+        return (error ? path : absolute).lexically_normal();
+    }
+}
+
+ShaderWatcher::ShaderWatcher() {
+    this->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (this->inotify_fd == -1) {
+        std::cerr << "Shader hot-reload disabled: inotify unavailable\n";
+    }
+}
+
+ShaderWatcher::~ShaderWatcher() {
+    if (this->inotify_fd != -1) {
+        close(this->inotify_fd);
+    }
+}
+
+void ShaderWatcher::watch(ShaderProgram& program,
+                          std::filesystem::path vert_shader_path,
+                          std::filesystem::path frag_shader_path,
+                          ShaderDefines defines,
+                          ReloadCallback on_reload) {
+    add({.program = &program, .vert_shader_path = std::move(vert_shader_path),
+         .frag_shader_path = std::move(frag_shader_path), .defines = std::move(defines),
+         .on_reload = std::move(on_reload), .files = {}, .rebuild = {}, .fragment_rebuild = {}});
+}
+
+void ShaderWatcher::watch(PipelineBinding& binding,
+                          std::filesystem::path vert_shader_path,
+                          std::filesystem::path frag_shader_path,
+                          ShaderDefines defines) {
+    add({.program = nullptr, .vert_shader_path = std::move(vert_shader_path),
+         .frag_shader_path = std::move(frag_shader_path), .defines = std::move(defines),
+         .on_reload = {}, .files = {}, .rebuild = {}, .binding = &binding, .fragment_rebuild = {}});
+}
+
+void ShaderWatcher::add(Entry entry) {
+    /* Preprocessing tells us which files the program really depends on */
+    for (auto& path : {entry.vert_shader_path, entry.frag_shader_path}) {
+        for (auto& file : preprocess_shader(path, entry.defines).files) {
+            entry.files.push_back(absolute_path(file));
+        }
+    }
+    watch_files(entry.files);
+
+    this->entries.push_back(std::move(entry));
+}
+
+void ShaderWatcher::watch_files(const std::vector<std::filesystem::path>& files) {
+    if (this->inotify_fd == -1) {
+        return;
+    }
+    for (auto& file : files) {
+        auto directory = file.parent_path();
+        bool watched = std::any_of(this->directories.begin(), this->directories.end(),
+                [&](auto& entry) { return entry.second == directory; });
+        if (watched) {
+            continue;
+        }
+        int wd = inotify_add_watch(this->inotify_fd, directory.c_str(), WATCH_MASK);
+        if (wd != -1) {
+            this->directories[wd] = directory;
+        }
+    }
+}
+
+void ShaderWatcher::read_events() {
+    if (this->inotify_fd == -1) {
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t length = read(this->inotify_fd, buffer, sizeof buffer);
+        if (length <= 0) {
+            /* EAGAIN: nothing (more) to read; this must never block */
+            break;
+        }
+
+        for (char* ptr = buffer; ptr < buffer + length; ) {
+            auto event = reinterpret_cast<inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+
+            auto directory = this->directories.find(event->wd);
+            if (directory == this->directories.end() || event->len == 0) {
+                continue;
+            }
+            auto changed = directory->second / event->name;
+            for (auto& entry : this->entries) {
+                if (std::find(entry.files.begin(), entry.files.end(), changed) != entry.files.end()) {
+                    entry.dirty = true;
+                }
+            }
+        }
+    }
+}
+
+void ShaderWatcher::swap(Entry& entry, GLuint program_id) {
+    ShaderProgram& program = *entry.program;
+
+    GLint current_program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
+
+    GLuint old_id = program.id;
+    program.id = program_id;
+    for (auto& [name, location] : program.uniforms) {
+        location = glGetUniformLocation(program.id, name.c_str());
+    }
+    if (GLuint(current_program) == old_id) {
+        program.use();
+    }
+    glDeleteProgram(old_id);
+
+    if (entry.on_reload) {
+        entry.on_reload(program);
+    }
+}
+
+void ShaderWatcher::swap_stages(Entry& entry) {
+    PipelineBinding& binding = *entry.binding;
+
+    GLint current_program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
+
+    GLuint old_vertex_program = binding.vertex_program;
+    GLuint old_fragment_program = binding.fragment_program;
+    GLuint vertex_program = entry.rebuild->get();
+    GLuint fragment_program = entry.fragment_rebuild ? entry.fragment_rebuild->get() : vertex_program;
+    binding.replace_stages(vertex_program, fragment_program);
+    /* A bound pipeline picks its new stages up by itself */
+    if (!binding.pipeline && GLuint(current_program) == old_vertex_program) {
+        glUseProgram(vertex_program);
+    }
+    if (old_fragment_program != old_vertex_program) {
+        glDeleteProgram(old_fragment_program);
+    }
+    glDeleteProgram(old_vertex_program);
+}
+
+void ShaderWatcher::update(AsyncProgramBuilder& builder) {
+    read_events();
+
+    for (auto& entry : this->entries) {
+        /* Wait for an in-flight rebuild before starting another one */
+        if (!entry.dirty || entry.rebuild) {
+            continue;
+        }
+        entry.dirty = false;
+
+        try {
+            PreprocessedShader vert_shader = preprocess_shader(entry.vert_shader_path, entry.defines);
+            PreprocessedShader frag_shader = preprocess_shader(entry.frag_shader_path, entry.defines);
+
+            /* Includes may have been added by the edit */
+            entry.files.clear();
+            for (auto* shader : {&vert_shader, &frag_shader}) {
+                for (auto& file : shader->files) {
+                    entry.files.push_back(absolute_path(file));
+                }
+            }
+            watch_files(entry.files);
+
+            if (entry.binding && entry.binding->pipeline) {
+                entry.rebuild = builder.submit_stage(vert_shader.source, GL_VERTEX_SHADER);
+                entry.fragment_rebuild = builder.submit_stage(frag_shader.source, GL_FRAGMENT_SHADER);
+            } else {
+                entry.rebuild = builder.submit(vert_shader.source, frag_shader.source);
+            }
+        } catch (const std::exception& e) {
+            /* Typically a file caught halfway through being saved */
+            std::cerr << "Shader reload failed: " << e.what() << '\n';
+        }
+    }
+
+    builder.poll();
+
+    auto done = [](const std::optional<ProgramFuture>& build) {
+        return !build || build->ready() || build->failed();
+    };
+    for (auto& entry : this->entries) {
+        if (!entry.rebuild || !done(entry.rebuild) || !done(entry.fragment_rebuild)) {
+            continue;
+        }
+        bool ready = entry.rebuild->ready() && (!entry.fragment_rebuild || entry.fragment_rebuild->ready());
+        if (ready) {
+            if (entry.binding) {
+                swap_stages(entry);
+            } else {
+                swap(entry, entry.rebuild->get());
+            }
+            std::cerr << "Reloaded " << entry.vert_shader_path.string() << " + "
+                      << entry.frag_shader_path.string() << '\n';
+        } else {
+            std::cerr << "Shader reload failed, keeping previous program:\n"
+                      << entry.rebuild->error()
+                      << (entry.fragment_rebuild ? entry.fragment_rebuild->error() : "") << '\n';
+            /* A stage that did build is of no use without the other */
+            glDeleteProgram(entry.rebuild->get_or(0));
+            if (entry.fragment_rebuild) {
+                glDeleteProgram(entry.fragment_rebuild->get_or(0));
+            }
+        }
+        entry.rebuild.reset();
+        entry.fragment_rebuild.reset();
+    }
+}
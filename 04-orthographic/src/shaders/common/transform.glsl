@@ -0,0 +1,7 @@
+#pragma once
+
+uniform mat4 model;
+
+vec4 transform_position(vec3 pos) {
+    return model * vec4(pos, 1.0f);
+}
@@ -1,11 +1,29 @@
 #version 330 core
 
+/* Textured sprites vs. flat colored quads, chosen at compile time */
+#pragma feature TEXTURED
+/* Counts fragments instead of coloring them, see overdraw.hpp */
+#pragma feature OVERDRAW
+
 in vec2 tex_coord;
 out vec4 color;
 
+#if TEXTURED
 uniform sampler2D texture1;
+#else
+uniform vec4 in_color;
+#endif
 
 void main() {
-    color = texture(texture1, tex_coord);
+#if TEXTURED
+    vec4 texel = texture(texture1, tex_coord);
+#else
+    vec4 texel = in_color;
+#endif
+#if OVERDRAW
+    /* Added up by blending: every fragment, and those that show at all */
+    color = vec4(1.0, texel.a > 0.0 ? 1.0 : 0.0, 0.0, 0.0);
+#else
+    color = texel;
+#endif
 }
-
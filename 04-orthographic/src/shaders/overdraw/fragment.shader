@@ -0,0 +1,30 @@
+#version 330 core
+
+/* Fragments shaded per pixel (red) and visible ones among them (green) */
+uniform sampler2D counts;
+/* Overdraw at which the ramp saturates */
+uniform float max_shown;
+
+out vec4 color;
+
+/* Black for nothing, then blue, cyan, green, yellow, red and white */
+const vec3 RAMP[7] = vec3[](
+    vec3(0.0, 0.0, 0.0),
+    vec3(0.0, 0.0, 1.0),
+    vec3(0.0, 1.0, 1.0),
+    vec3(0.0, 1.0, 0.0),
+    vec3(1.0, 1.0, 0.0),
+    vec3(1.0, 0.0, 0.0),
+    vec3(1.0, 1.0, 1.0));
+
+void main() {
+    vec2 count = texelFetch(counts, ivec2(gl_FragCoord.xy), 0).rg;
+    float position = clamp(count.r / max_shown, 0.0, 1.0) * 6.0;
+    int below = min(int(position), 5);
+    vec3 heat = mix(RAMP[below], RAMP[below + 1], position - float(below));
+    /* Shaded, but nothing to see: the work trimming would save */
+    if (count.r > 0.0 && count.g == 0.0) {
+        heat *= 0.4;
+    }
+    color = vec4(heat, 1.0);
+}
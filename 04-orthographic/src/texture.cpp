@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <glad/glad.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <cooked_texture.hpp>
+#include <file_reader.hpp>
+#include <gl_debug.hpp>
+#include <memory_accounting.hpp>
+#include <mipmap.hpp>
+#include <profiler.hpp>
+#include <resource_pack.hpp>
+#include <texture.hpp>
+#include <texture_import.hpp>
+
+using namespace std::string_literals;
+
+void DecodedImage::free() {
+    stbi_image_free(this->data);
+    this->data = nullptr;
+}
+
+namespace {
+    std::atomic<TextureQuality> quality{TextureQuality::full};
+    std::atomic<bool> flip_on_load{false};
+
+    /* Size after skipping `levels` mip levels, as JPEG scaling rounds it */
+    int reduced_size(int size, int levels) {
+        return (size + (1 << levels) - 1) >> levels;
+    }
+}
+
+void set_flip_on_load(bool flip) {
+    flip_on_load = flip;
+}
+
+void set_texture_quality(TextureQuality new_quality) {
+    quality = new_quality;
+}
+
+TextureQuality texture_quality() {
+    return quality;
+}
+
+int skipped_levels(int width, int height, TextureSizeHint hint) {
+    int levels = 0;
+    if (hint.width > 0 && hint.height > 0) {
+        while (reduced_size(width, levels + 1) >= hint.width
+                && reduced_size(height, levels + 1) >= hint.height) {
+            ++levels;
+        }
+    }
+    levels += int(texture_quality());
+
+    /* Past this point both sides are 1 pixel already */
+    while (levels > 0 && reduced_size(width, levels - 1) == 1 && reduced_size(height, levels - 1) == 1) {
+        --levels;
+    }
+    return levels;
+}
+
+DecodedImage decode_image(std::string_view img_path, TextureSizeHint hint) {
+    /* Packed images are decoded straight from the pack's mapping; loose
+     * files are read in one go rather than through stb_image's small stdio
+     * reads */
+    if (auto packed = find_resource(img_path)) {
+        return decode_image(*packed, img_path, hint);
+    }
+    FileContents file = read_file(std::string(img_path));
+    return decode_image(file.bytes(), img_path, hint);
+}
+
+DecodedImage decode_image(std::span<const unsigned char> file, std::string_view name, TextureSizeHint hint) {
+    AZ_PROFILE_ZONE("decode_image");
+    int width;
+    int height;
+    int channels;
+    if (!stbi_info_from_memory(file.data(), int(file.size()), &width, &height, &channels)) {
+        throw std::runtime_error("Error loading image file '"s + std::string(name) + "'");
+    }
+    int levels = skipped_levels(width, height, hint);
+
+    /* Only the JPEG decoder looks at this; it reduces by up to 1/8 */
+    stbi_set_jpeg_scale_shift_thread(std::min(levels, 3));
+    /* Flipping is left to the conversion into the staging buffer */
+    stbi_set_flip_vertically_on_load_thread(0);
+    DecodedImage image;
+    image.data = stbi_load_from_memory(file.data(), int(file.size()),
+            &image.width, &image.height, &image.channels, 0);
+    image.flip_y = flip_on_load;
+    stbi_set_jpeg_scale_shift_thread(0);
+    if (!image.data) {
+        throw std::runtime_error("Error loading image file '"s + std::string(name) + "'");
+    }
+
+    /* Whatever the decoder could not skip */
+    while (image.width > reduced_size(width, levels) || image.height > reduced_size(height, levels)) {
+        downsample_half(image);
+    }
+    return image;
+}
+
+void downsample_half(DecodedImage& image) {
+    int width = (image.width + 1) / 2;
+    int height = (image.height + 1) / 2;
+    int channels = image.channels;
+
+    /* malloc, as stbi_image_free() (i.e. free()) releases it */
+    auto data = static_cast<unsigned char*>(std::malloc(std::size_t(width) * height * channels));
+    if (!data) {
+        throw std::bad_alloc{};
+    }
+
+    std::size_t src_stride = std::size_t(image.width) * channels;
+    for (int y = 0; y < height; ++y) {
+        /* Odd sizes repeat the last row and column */
+        const unsigned char* row0 = image.data + std::size_t(2 * y) * src_stride;
+        const unsigned char* row1 = 2 * y + 1 < image.height ? row0 + src_stride : row0;
+        unsigned char* dst = data + std::size_t(y) * width * channels;
+        for (int x = 0; x < width; ++x) {
+            int x0 = 2 * x * channels;
+            int x1 = 2 * x + 1 < image.width ? x0 + channels : x0;
+            for (int c = 0; c < channels; ++c) {
+                *dst++ = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+
+    image.free();
+    image.data = data;
+    image.width = width;
+    image.height = height;
+}
+
+GLuint create_texture() {
+    /* Allocate texture */
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    /* Set texture parameters */
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return texture;
+}
+
+void delete_texture(GLuint texture) {
+    /* First, as the name may be reused, on another context, right after */
+    record_release(MemoryKind::texture, texture);
+    glDeleteTextures(1, &texture);
+}
+
+GLuint set_up_texture(const DecodedImage& image) {
+    /* Use loaded image data to make up the new texture, in the smallest
+     * format that holds it */
+    return upload_imported(import_image(image), {});
+}
+
+GLuint set_up_texture(std::string_view img_path) {
+    GlDebugGroup debug_group{"set_up_texture"};
+
+    /* Cooked textures are ready for GL as they are */
+    if (is_cooked_texture(img_path)) {
+        GLuint texture = upload_cooked(CookedTexture{std::string(img_path)}, 0, std::string{img_path});
+        gl_object_label(GL_TEXTURE, texture, img_path);
+        return texture;
+    }
+
+    /* Load image to be used as texture */
+    DecodedImage image = decode_image(img_path);
+
+    /* Mipmaps come from the mip cache after the first run */
+    GLuint texture;
+    try {
+        MipChain mips = cached_mip_chain(img_path, image, mip_count(image.width, image.height));
+        texture = upload_imported(import_image(image, {}, &mips), std::string{img_path});
+    } catch (...) {
+        image.free();
+        throw;
+    }
+
+    /* Free previously allocated memory for image data */
+    image.free();
+
+    gl_object_label(GL_TEXTURE, texture, img_path);
+    return texture;
+}
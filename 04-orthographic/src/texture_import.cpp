@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include <texture_import.hpp>
+#include <block_compression.hpp>
+#include <gl_ext.hpp>
+#include <memory_accounting.hpp>
+#include <pixel_kernels.hpp>
+
+namespace {
+    const std::array<int, 4> SWIZZLE_IDENTITY{GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA};
+
+    const ImportFormat FORMAT_R8{
+        GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1, {GL_RED, GL_RED, GL_RED, GL_ONE}, "R8"};
+    const ImportFormat FORMAT_RG8{
+        GL_RG8, GL_RG, GL_UNSIGNED_BYTE, 2, {GL_RED, GL_RED, GL_RED, GL_GREEN}, "RG8"};
+    const ImportFormat FORMAT_RGB8{
+        GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 3, SWIZZLE_IDENTITY, "RGB8"};
+    const ImportFormat FORMAT_RGBA8{
+        GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, SWIZZLE_IDENTITY, "RGBA8"};
+    const ImportFormat FORMAT_RGB565{
+        GL_RGB565, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 2, SWIZZLE_IDENTITY, "RGB565"};
+    const ImportFormat FORMAT_RGBA4{
+        GL_RGBA4, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, 2, SWIZZLE_IDENTITY, "RGBA4"};
+
+    /* Rounds an 8-bit channel to `bits` bits */
+    unsigned int quantize(unsigned char value, int bits) {
+        unsigned int max = (1u << bits) - 1;
+        return (value * max + 127) / 255;
+    }
+
+    /* Block compressed levels take whole 4x4 blocks */
+    std::size_t level_bytes(const ImportFormat& format, int width, int height) {
+        for (BlockFormat blocks : {BlockFormat::bc1, BlockFormat::bc3}) {
+            if (format.internal_format == block_gl_format(blocks)) {
+                return compressed_size(blocks, width, height);
+            }
+        }
+        return std::size_t(width) * height * format.bytes_per_pixel;
+    }
+
+    bool has_texture_storage() {
+        return glTexStorage2D && (GLAD_GL_VERSION_4_2 || has_gl_extension("GL_ARB_texture_storage"));
+    }
+}
+
+int ImportedTexture::level_width(int level) const {
+    return std::max(this->width >> level, 1);
+}
+
+int ImportedTexture::level_height(int level) const {
+    return std::max(this->height >> level, 1);
+}
+
+std::size_t ImportedTexture::level_offset(int level) const {
+    std::size_t offset = 0;
+    for (int i = 0; i < level; ++i) {
+        offset += std::size_t(level_width(i)) * level_height(i) * this->format.bytes_per_pixel;
+    }
+    return offset;
+}
+
+std::size_t ImportedTexture::level0_bytes() const {
+    return level_offset(1);
+}
+
+std::size_t ImportedTexture::stored_bytes() const {
+    return level_offset(this->stored_levels);
+}
+
+ImportFormat choose_import_format(const DecodedImage& image, const ImportOptions& options) {
+    /* One- and two-channel images are gray already, and only two- and
+     * four-channel images have an alpha channel to look at */
+    bool check_gray = image.channels >= 3;
+    bool check_alpha = image.channels == 2 || image.channels == 4;
+    bool gray = true;
+    bool opaque = true;
+
+    std::size_t n_pixels = std::size_t(image.width) * image.height;
+    const unsigned char* src = image.data;
+    for (std::size_t i = 0; i < n_pixels && (check_gray || check_alpha); ++i, src += image.channels) {
+        if (check_gray && (src[0] != src[1] || src[0] != src[2])) {
+            gray = false;
+            check_gray = false;
+        }
+        if (check_alpha && src[image.channels - 1] != 255) {
+            opaque = false;
+            check_alpha = false;
+        }
+    }
+
+    if (gray) {
+        return opaque ? FORMAT_R8 : FORMAT_RG8;
+    }
+    if (options.allow_packed_16bit) {
+        return opaque ? FORMAT_RGB565 : FORMAT_RGBA4;
+    }
+    return opaque ? FORMAT_RGB8 : FORMAT_RGBA8;
+}
+
+void convert_pixels(const DecodedImage& image, const ImportFormat& format, unsigned char* dst,
+                    const ImportOptions& options) {
+    if (format.type == GL_UNSIGNED_BYTE) {
+        PixelConversion conversion = PixelConversion::expand(image.channels, format.bytes_per_pixel);
+        conversion.flip_y = image.flip_y;
+        conversion.srgb_to_linear = options.srgb_to_linear;
+        conversion.premultiply_alpha = options.premultiply_alpha;
+        convert_image(conversion, image.data, image.width, image.height, dst);
+        return;
+    }
+
+    /* Packed 16-bit formats: expand to RGBA first, through the same kernels,
+     * then quantize */
+    std::size_t row_pixels = image.width;
+    auto row = std::make_unique_for_overwrite<unsigned char[]>(row_pixels * 4);
+    PixelConversion conversion = PixelConversion::expand(image.channels, 4);
+    conversion.srgb_to_linear = options.srgb_to_linear;
+    conversion.premultiply_alpha = options.premultiply_alpha;
+
+    for (int y = 0; y < image.height; ++y) {
+        int src_y = image.flip_y ? image.height - 1 - y : y;
+        convert_image(conversion, image.data + src_y * row_pixels * image.channels, image.width, 1,
+                row.get());
+        const unsigned char* pixel = row.get();
+        for (std::size_t x = 0; x < row_pixels; ++x, pixel += 4, dst += 2) {
+            std::uint16_t packed;
+            if (format.internal_format == GL_RGB565) {
+                packed = (quantize(pixel[0], 5) << 11) | (quantize(pixel[1], 6) << 5)
+                    | quantize(pixel[2], 5);
+            } else {
+                packed = (quantize(pixel[0], 4) << 12) | (quantize(pixel[1], 4) << 8)
+                    | (quantize(pixel[2], 4) << 4) | quantize(pixel[3], 4);
+            }
+            std::memcpy(dst, &packed, 2);
+        }
+    }
+}
+
+void convert_levels(const DecodedImage& image, const MipChain* mips, const ImportedTexture& texture,
+                    unsigned char* dst, const ImportOptions& options) {
+    convert_pixels(image, texture.format, dst, options);
+    for (int level = 1; level < texture.stored_levels; ++level) {
+        /* Only read, despite the cast */
+        DecodedImage level_image{const_cast<unsigned char*>(mips->level(level)), mips->level_width(level),
+                mips->level_height(level), mips->channels, image.flip_y};
+        convert_pixels(level_image, texture.format, dst + texture.level_offset(level), options);
+    }
+}
+
+int mip_count(int width, int height) {
+    int levels = 1;
+    for (int size = std::max(width, height); size > 1; size /= 2) {
+        ++levels;
+    }
+    return levels;
+}
+
+std::size_t mip_chain_bytes(int width, int height, int bytes_per_pixel, int mip_levels) {
+    std::size_t bytes = 0;
+    for (int level = 0; level < mip_levels; ++level) {
+        bytes += std::size_t(width) * height * bytes_per_pixel;
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+    return bytes;
+}
+
+int bytes_per_pixel(unsigned int internal_format) {
+    switch (internal_format) {
+        case GL_R8: return 1;
+        case GL_RG8: return 2;
+        case GL_RGB565: return 2;
+        case GL_RGBA4: return 2;
+        /* Drivers typically pad RGB8 to four bytes, but that is their
+         * business; count what was asked for */
+        case GL_RGB8: return 3;
+        default: return 4;
+    }
+}
+
+ImportedTexture plan_import(const DecodedImage& image, const ImportOptions& options, const MipChain* mips) {
+    ImportedTexture texture;
+    texture.width = image.width;
+    texture.height = image.height;
+    texture.format = choose_import_format(image, options);
+    texture.mip_levels = options.mipmaps ? mip_count(image.width, image.height) : 1;
+    texture.mip_generation = options.mip_generation;
+    if (texture.mip_levels > 1 && options.mip_generation == MipGeneration::cpu) {
+        if (mips && mips->levels == texture.mip_levels) {
+            texture.stored_levels = texture.mip_levels;
+        } else {
+            texture.mip_generation = MipGeneration::gpu;
+        }
+    }
+    texture.bytes = mip_chain_bytes(image.width, image.height, texture.format.bytes_per_pixel,
+            texture.mip_levels);
+    texture.rgba8_bytes = mip_chain_bytes(image.width, image.height, 4, texture.mip_levels);
+    return texture;
+}
+
+ImportedTexture import_image(const DecodedImage& image, const ImportOptions& options, const MipChain* mips) {
+    MipChain built;
+    if (!mips && options.mipmaps && options.mip_generation == MipGeneration::cpu) {
+        built = build_mip_chain(image.data, image.width, image.height, image.channels,
+                mip_count(image.width, image.height));
+        mips = &built;
+    }
+    ImportedTexture texture = plan_import(image, options, mips);
+    texture.pixels = std::make_unique_for_overwrite<unsigned char[]>(texture.stored_bytes());
+    convert_levels(image, mips, texture, texture.pixels.get(), options);
+    return texture;
+}
+
+void allocate_texture_storage(const ImportFormat& format, int width, int height, int mip_levels,
+                              std::string owner) {
+    GLint texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    std::size_t bytes = 0;
+    for (int level = 0; level < mip_levels; ++level) {
+        bytes += level_bytes(format, std::max(width >> level, 1), std::max(height >> level, 1));
+    }
+    try {
+        record_allocation({.kind = MemoryKind::texture, .id = GLuint(texture), .bytes = bytes,
+                           .format = format.internal_format, .width = width, .height = height,
+                           .mip_levels = mip_levels, .category = "textures", .owner = std::move(owner)});
+    } catch (const MemoryBudgetExceeded&) {
+        GLuint id = GLuint(texture);
+        glDeleteTextures(1, &id);
+        throw;
+    }
+
+    if (has_texture_storage()) {
+        /* Immutable: the driver can settle the layout of every level up front */
+        glTexStorage2D(GL_TEXTURE_2D, mip_levels, format.internal_format, width, height);
+    } else {
+        for (int level = 0; level < mip_levels; ++level) {
+            glTexImage2D(GL_TEXTURE_2D, level, format.internal_format, width, height, 0,
+                    format.format, format.type, nullptr);
+            width = std::max(width / 2, 1);
+            height = std::max(height / 2, 1);
+        }
+    }
+    /* Levels past the allocated ones would make the texture incomplete */
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mip_levels - 1);
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, format.swizzle.data());
+}
+
+int unpack_alignment(std::size_t row_bytes) {
+    for (int alignment : {8, 4, 2}) {
+        if (row_bytes % alignment == 0) {
+            return alignment;
+        }
+    }
+    return 1;
+}
+
+GLuint upload_imported(const ImportedTexture& texture, std::string owner) {
+    GLuint id = create_texture();
+    allocate_texture_storage(texture.format, texture.width, texture.height, texture.mip_levels, std::move(owner));
+
+    for (int level = 0; level < texture.stored_levels; ++level) {
+        /* An offset into the unpack buffer when there are no pixels */
+        const unsigned char* base = texture.pixels.get();
+        const void* pixels = base ? base + texture.level_offset(level)
+            : reinterpret_cast<const void*>(texture.level_offset(level));
+
+        /* Rows are tightly packed, which e.g. odd-width R8 images are not by
+         * the default 4-byte alignment */
+        int width = texture.level_width(level);
+        glPixelStorei(GL_UNPACK_ALIGNMENT,
+                unpack_alignment(std::size_t(width) * texture.format.bytes_per_pixel));
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, texture.level_height(level),
+                texture.format.format, texture.format.type, pixels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    finish_mip_levels(texture);
+    return id;
+}
+
+void finish_mip_levels(const ImportedTexture& texture) {
+    if (texture.stored_levels == texture.mip_levels) {
+        return;
+    }
+    if (texture.mip_generation == MipGeneration::lazy) {
+        /* Complete with level 0 alone; ensure_mipmaps() lifts this */
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.stored_levels - 1);
+    } else {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+}
+
+std::string import_report(const std::string& name, const ImportedTexture& texture) {
+    char report[256];
+    std::snprintf(report, sizeof report, "%s: %s %dx%d, %d levels (%d stored), %.1f KiB (saved %.1f KiB vs RGBA8)",
+            name.c_str(), texture.format.name, texture.width, texture.height, texture.mip_levels,
+            texture.stored_levels, texture.bytes / 1024.0, (texture.rgba8_bytes - texture.bytes) / 1024.0);
+    return report;
+}
@@ -0,0 +1,258 @@
+#include <exception>
+#include <filesystem>
+#include <string>
+
+#include <glad/glad.h>
+
+#include <mipmap.hpp>
+#include <resource_pack.hpp>
+#include <texture.hpp>
+#include <texture_manager.hpp>
+#include <texture_import.hpp>
+
+struct TextureHandle::Entry {
+    std::string key;
+    std::string path;
+    TextureParams params;
+    float priority = 0.0f;
+
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+    /* Sampled with a mipmap min filter */
+    bool mipmapped = false;
+    std::size_t bytes = 0;
+    std::size_t refs = 0;
+    AssetFuture<GLuint> loading;
+    bool failed = false;
+
+    bool in_lru = false;
+    std::list<std::shared_ptr<Entry>>::iterator lru_pos;
+};
+
+namespace {
+    bool uses_mipmaps(GLenum min_filter) {
+        return min_filter != GL_NEAREST && min_filter != GL_LINEAR;
+    }
+
+    /* Size of the whole mip chain of the bound texture, as stored by us */
+    std::size_t texture_bytes(GLenum target) {
+        std::size_t bytes = 0;
+        for (int level = 0; ; ++level) {
+            GLint width = 0;
+            GLint height = 0;
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+            if (width == 0 || height == 0) {
+                break;
+            }
+            GLint compressed = GL_FALSE;
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &compressed);
+            if (compressed) {
+                GLint size = 0;
+                glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+                bytes += size;
+            } else {
+                GLint internal_format = GL_RGBA8;
+                glGetTexLevelParameteriv(target, level, GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+                bytes += std::size_t(width) * height * bytes_per_pixel(internal_format);
+            }
+            if (width == 1 && height == 1) {
+                break;
+            }
+        }
+        return bytes;
+    }
+}
+
+std::string TextureParams::key() const {
+    return std::to_string(this->wrap) + ',' + std::to_string(this->min_filter) + ','
+        + std::to_string(this->mag_filter) + ',' + std::to_string(this->size.width) + 'x'
+        + std::to_string(this->size.height);
+}
+
+TextureHandle::TextureHandle(TextureManager* manager, std::shared_ptr<Entry> entry)
+    : manager{manager}, entry{std::move(entry)} {
+    ++this->entry->refs;
+}
+
+TextureHandle::TextureHandle(const TextureHandle& other)
+    : manager{other.manager}, entry{other.entry} {
+    if (this->entry) {
+        ++this->entry->refs;
+    }
+}
+
+TextureHandle::TextureHandle(TextureHandle&& other) noexcept
+    : manager{other.manager}, entry{std::move(other.entry)} {
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle other) noexcept {
+    std::swap(this->manager, other.manager);
+    std::swap(this->entry, other.entry);
+    return *this;
+}
+
+TextureHandle::~TextureHandle() {
+    if (this->entry) {
+        this->manager->release(this->entry);
+    }
+}
+
+GLuint TextureHandle::id() const {
+    return this->entry ? this->entry->texture : 0;
+}
+
+bool TextureHandle::ready() const {
+    return id() != 0;
+}
+
+bool TextureHandle::failed() const {
+    return this->entry && this->entry->failed;
+}
+
+AssetFuture<GLuint> TextureHandle::loaded() const {
+    return this->entry->loading;
+}
+
+void TextureHandle::drawn_at(int width, int height) const {
+    if (!ready() || this->entry->mipmapped || (width >= this->entry->width && height >= this->entry->height)) {
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, this->entry->texture);
+    ensure_mipmaps();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    this->entry->mipmapped = true;
+}
+
+void TextureHandle::set_priority(float priority) const {
+    if (!this->entry || ready() || this->entry->failed || priority == this->entry->priority) {
+        return;
+    }
+    this->entry->priority = priority;
+    this->manager->pipeline.set_priority(this->entry->path, priority);
+}
+
+TextureManager::TextureManager(AssetPipeline& pipeline, std::size_t budget_bytes)
+    : budget_bytes{budget_bytes}, pipeline{pipeline} {
+}
+
+TextureManager::~TextureManager() {
+    for (auto& [key, entry] : this->entries) {
+        if (entry->texture) {
+            delete_texture(entry->texture);
+        }
+    }
+}
+
+TextureHandle TextureManager::acquire(std::string_view path, const TextureParams& params, float priority) {
+    /* Different spellings of the same file must share one texture. Packed
+     * files keep their pack name, which does not depend on the working
+     * directory */
+    const ResourcePack* pack = mounted_resource_pack();
+    std::string canonical_path = pack && pack->contains(path)
+        ? resource_name(path)
+        : std::filesystem::weakly_canonical(std::filesystem::path{path}).string();
+    std::string key = canonical_path + '\n' + params.key();
+
+    ++this->stats.requests;
+
+    auto& entry = this->entries[key];
+    if (!entry) {
+        entry = std::make_shared<TextureHandle::Entry>();
+        entry->key = key;
+        entry->path = canonical_path;
+        entry->params = params;
+        entry->priority = priority;
+        ++this->stats.loads;
+        /* Concurrent requests for the same key all await this one load */
+        entry->loading = spawn(load(entry));
+    }
+
+    if (entry->in_lru) {
+        this->lru.erase(entry->lru_pos);
+        entry->in_lru = false;
+    }
+
+    TextureHandle handle{this, entry};
+    if (priority > entry->priority) {
+        handle.set_priority(priority);
+    }
+    return handle;
+}
+
+Task<GLuint> TextureManager::load(std::shared_ptr<TextureHandle::Entry> entry) {
+    GLuint texture = 0;
+    std::exception_ptr error;
+    try {
+        texture = co_await this->pipeline.load_texture(entry->path, entry->priority, entry->params.size,
+                uses_mipmaps(entry->params.min_filter));
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    if (error) {
+        /* Errors may surface on a decode thread; the manager's state is the
+         * render thread's */
+        co_await this->pipeline.frame_queue.schedule();
+        entry->failed = true;
+        /* Let a later request try again */
+        auto iter = this->entries.find(entry->key);
+        if (iter != this->entries.end() && iter->second == entry) {
+            this->entries.erase(iter);
+        }
+        if (entry->in_lru) {
+            this->lru.erase(entry->lru_pos);
+            entry->in_lru = false;
+        }
+        std::rethrow_exception(error);
+    }
+
+    /* The pipeline resumes us on the render thread */
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, entry->params.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, entry->params.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, entry->params.min_filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, entry->params.mag_filter);
+
+    entry->texture = texture;
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &entry->width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &entry->height);
+    entry->mipmapped = uses_mipmaps(entry->params.min_filter);
+    entry->bytes = texture_bytes(GL_TEXTURE_2D);
+    this->stats.resident_bytes += entry->bytes;
+    ++this->stats.resident_textures;
+
+    collect();
+
+    co_return texture;
+}
+
+void TextureManager::release(const std::shared_ptr<TextureHandle::Entry>& entry) {
+    if (--entry->refs > 0) {
+        return;
+    }
+    entry->lru_pos = this->lru.insert(this->lru.end(), entry);
+    entry->in_lru = true;
+    collect();
+}
+
+void TextureManager::collect() {
+    auto iter = this->lru.begin();
+    while (this->stats.resident_bytes > this->budget_bytes && iter != this->lru.end()) {
+        auto entry = *iter;
+        /* Loads in flight are left alone; they are evicted once done */
+        if (!entry->texture) {
+            ++iter;
+            continue;
+        }
+
+        delete_texture(entry->texture);
+        this->stats.resident_bytes -= entry->bytes;
+        --this->stats.resident_textures;
+        ++this->stats.evictions;
+
+        iter = this->lru.erase(iter);
+        this->entries.erase(entry->key);
+    }
+}
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#include <profiler.hpp>
+#include <thread_pool.hpp>
+
+ThreadPool::ThreadPool(std::size_t n_threads) {
+    if (n_threads == 0) {
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (std::size_t i = 0; i < n_threads; ++i) {
+        this->workers.emplace_back([this] { run(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock{this->mutex};
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto& worker : this->workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::post(std::function<void()> job) {
+    {
+        std::lock_guard lock{this->mutex};
+        if (this->closed) {
+            return;
+        }
+        this->jobs.push_back(std::move(job));
+    }
+    this->wake.notify_one();
+}
+
+void ThreadPool::close() {
+    std::deque<std::function<void()>> dropped;
+    {
+        std::lock_guard lock{this->mutex};
+        this->closed = true;
+        this->stopping = true;
+        dropped.swap(this->jobs);
+    }
+    this->wake.notify_all();
+    for (auto& worker : this->workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::run() {
+    AZ_PROFILE_THREAD_NAME("ThreadPool worker");
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock{this->mutex};
+            this->wake.wait(lock, [this] { return this->stopping || !this->jobs.empty(); });
+            if (this->jobs.empty()) {
+                return;
+            }
+            job = std::move(this->jobs.front());
+            this->jobs.pop_front();
+        }
+        AZ_PROFILE_ZONE("ThreadPool job");
+        job();
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t n, const std::function<void(std::size_t)>& job) {
+    /* Shared, since helpers may only get to run after this call returned */
+    struct State {
+        std::function<void(std::size_t)> job;
+        std::size_t n;
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> done{0};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->job = job;
+    state->n = n;
+
+    auto work = [state] {
+        for (std::size_t i; (i = state->next++) < state->n; ) {
+            try {
+                state->job(i);
+            } catch (...) {
+                std::lock_guard lock{state->error_mutex};
+                state->error = std::current_exception();
+            }
+            if (++state->done == state->n) {
+                state->done.notify_all();
+            }
+        }
+    };
+
+    /* Helpers that find nothing left to do return right away */
+    std::size_t n_helpers = std::min(n, this->workers.size());
+    for (std::size_t i = 0; i < n_helpers; ++i) {
+        post(work);
+    }
+    work();
+
+    for (std::size_t count = state->done; count < n; count = state->done) {
+        state->done.wait(count);
+    }
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+std::size_t ThreadPool::size() const {
+    return this->workers.size();
+}
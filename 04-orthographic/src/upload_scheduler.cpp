@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+#include <glad/glad.h>
+
+#include <memory_accounting.hpp>
+#include <upload_scheduler.hpp>
+
+namespace {
+    GLenum binding_of(GLenum target) {
+        switch (target) {
+        case GL_ARRAY_BUFFER:
+            return GL_ARRAY_BUFFER_BINDING;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return GL_ELEMENT_ARRAY_BUFFER_BINDING;
+        case GL_UNIFORM_BUFFER:
+            return GL_UNIFORM_BUFFER_BINDING;
+        case GL_COPY_WRITE_BUFFER:
+            return GL_COPY_WRITE_BUFFER_BINDING;
+        default:
+            return 0;
+        }
+    }
+}
+
+UploadScheduler::UploadScheduler()
+    : UploadScheduler{Budget{}} {
+}
+
+UploadScheduler::UploadScheduler(Budget budget)
+    : budget{budget} {
+}
+
+UploadScheduler::~UploadScheduler() {
+    for (auto& job : this->jobs) {
+        record_release(MemoryKind::host, job.memory_id);
+    }
+}
+
+UploadScheduler::Ticket UploadScheduler::enqueue_texture(
+        GLuint texture, int level, int width, int height, GLenum format, GLenum type,
+        int bytes_per_pixel, Pixels pixels, float priority, std::function<void()> on_done) {
+
+    std::size_t row_bytes = std::size_t(width) * bytes_per_pixel;
+    Job job{this->next_ticket++, priority, true, GL_TEXTURE_2D, texture, level, width, height,
+            format, type, row_bytes, 0, row_bytes * height, 0, std::move(pixels), {}};
+    if (on_done) {
+        job.on_done.push_back(std::move(on_done));
+    }
+    hold(job);
+    this->jobs.push_back(std::move(job));
+    this->stats.queue_depth = this->jobs.size();
+    return this->jobs.back().ticket;
+}
+
+UploadScheduler::Ticket UploadScheduler::enqueue_buffer(
+        GLenum target, GLuint buffer, std::size_t offset, Pixels data, std::size_t size,
+        float priority, std::function<void()> on_done) {
+
+    if (!binding_of(target)) {
+        throw std::invalid_argument{"Unsupported buffer upload target " + std::to_string(target)};
+    }
+    Job job{this->next_ticket++, priority, false, target, buffer, 0, 0, 0,
+            0, 0, 0, offset, size, 0, std::move(data), {}};
+    if (on_done) {
+        job.on_done.push_back(std::move(on_done));
+    }
+    hold(job);
+    this->jobs.push_back(std::move(job));
+    this->stats.queue_depth = this->jobs.size();
+    return this->jobs.back().ticket;
+}
+
+void UploadScheduler::set_priority(Ticket ticket, float priority) {
+    for (auto& job : this->jobs) {
+        if (job.ticket == ticket) {
+            job.priority = priority;
+        }
+    }
+}
+
+void UploadScheduler::cancel(Ticket ticket) {
+    auto job = std::find_if(this->jobs.begin(), this->jobs.end(),
+            [ticket](auto& job) { return job.ticket == ticket; });
+    if (job != this->jobs.end()) {
+        record_release(MemoryKind::host, job->memory_id);
+        this->jobs.erase(job);
+        this->stats.queue_depth = this->jobs.size();
+    }
+}
+
+bool UploadScheduler::pending(Ticket ticket) const {
+    return std::any_of(this->jobs.begin(), this->jobs.end(),
+            [ticket](auto& job) { return job.ticket == ticket; });
+}
+
+void UploadScheduler::on_done(Ticket ticket, std::function<void()> callback) {
+    for (auto& job : this->jobs) {
+        if (job.ticket == ticket) {
+            job.on_done.push_back(std::move(callback));
+            return;
+        }
+    }
+    /* Already uploaded */
+    callback();
+}
+
+void UploadScheduler::hold(Job& job) {
+    job.memory_id = host_allocation_id();
+    record_allocation({.kind = MemoryKind::host, .id = job.memory_id, .bytes = job.size, .format = job.format,
+                       .width = job.width, .height = job.height, .category = "upload queue", .owner = {}});
+}
+
+std::size_t UploadScheduler::upload_some(Job& job, std::size_t max_bytes, bool first_band) {
+    if (!job.is_texture) {
+        std::size_t n_bytes = std::min(first_band ? std::max<std::size_t>(max_bytes, 1) : max_bytes,
+                job.size - job.done);
+        if (n_bytes == 0) {
+            return 0;
+        }
+        /* The element array binding is the bound vertex array's, so it must
+         * be put back, not cleared */
+        GLint previous_buffer = 0;
+        glGetIntegerv(binding_of(job.target), &previous_buffer);
+        glBindBuffer(job.target, job.object);
+        glBufferSubData(job.target, job.offset + job.done, n_bytes, job.data.get() + job.done);
+        glBindBuffer(job.target, GLuint(previous_buffer));
+        return n_bytes;
+    }
+
+    /* Whole rows only; the first band of a frame gets at least one, so that
+     * every upload progresses */
+    int first_row = job.done / job.row_bytes;
+    int n_rows = std::min<int>(max_bytes / job.row_bytes, job.height - first_row);
+    if (n_rows == 0 && !first_band) {
+        return 0;
+    }
+    n_rows = std::max(n_rows, 1);
+
+    glBindTexture(GL_TEXTURE_2D, job.object);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, job.row_bytes % 4 == 0 ? 4 : 1);
+    glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, first_row, job.width, n_rows,
+            job.format, job.type, job.data.get() + job.done);
+
+    return n_rows * job.row_bytes;
+}
+
+void UploadScheduler::pump() {
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    auto deadline = start + std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double, std::milli>(this->budget.max_ms));
+
+    this->stats.frame_bytes = 0;
+    this->stats.frame_uploads_completed = 0;
+
+    std::stable_sort(this->jobs.begin(), this->jobs.end(),
+            [](auto& a, auto& b) { return a.priority > b.priority; });
+
+    /* Whatever the caller had bound stays bound */
+    GLint previous_texture = 0;
+    GLint previous_alignment = 4;
+    bool had_jobs = !this->jobs.empty();
+    if (had_jobs) {
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous_texture);
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &previous_alignment);
+    }
+
+    std::vector<std::function<void()>> callbacks;
+    std::size_t i = 0;
+    while (i < this->jobs.size()) {
+        std::size_t remaining = this->budget.max_bytes > this->stats.frame_bytes
+            ? this->budget.max_bytes - this->stats.frame_bytes : 0;
+        bool out_of_budget = remaining == 0 || clock::now() >= deadline;
+        /* The first band of a frame is always sent, however large */
+        if (out_of_budget && this->stats.frame_bytes > 0) {
+            break;
+        }
+
+        Job& job = this->jobs[i];
+        std::size_t n_bytes = upload_some(job, remaining, this->stats.frame_bytes == 0);
+        job.done += n_bytes;
+        this->stats.frame_bytes += n_bytes;
+
+        if (job.done >= job.size) {
+            for (auto& callback : job.on_done) {
+                callbacks.push_back(std::move(callback));
+            }
+            record_release(MemoryKind::host, job.memory_id);
+            this->jobs.erase(this->jobs.begin() + i);
+            ++this->stats.frame_uploads_completed;
+        } else if (n_bytes == 0) {
+            ++i;
+        }
+    }
+
+    if (had_jobs) {
+        glBindTexture(GL_TEXTURE_2D, GLuint(previous_texture));
+        glPixelStorei(GL_UNPACK_ALIGNMENT, previous_alignment);
+    }
+
+    this->stats.total_bytes += this->stats.frame_bytes;
+    this->stats.queue_depth = this->jobs.size();
+
+    /* Callbacks may enqueue more work, so they run once the queue is settled */
+    for (auto& callback : callbacks) {
+        callback();
+    }
+}
@@ -0,0 +1,224 @@
+/**
+ * Replays a GL capture (see gl_capture.hpp) on a headless context: the
+ * calls before the captured frames once, to create the objects and state
+ * they use, then the captured frames as many times as asked, timing every
+ * call. Percentiles of the time spent in GL calls per frame and the
+ * functions that took longest are printed, and optionally written as JSON.
+ *
+ * What is timed is the driver's side of each call on this machine, without
+ * the application that made them; with --finish, each loop also waits for
+ * the GPU, and its wall time is reported too. Calls of several threads
+ * replay on as many contexts sharing objects, all on this thread.
+ *
+ * The context is OpenGL 3.3 core, as headless_context.hpp makes it; calls of
+ * functions it does not provide are skipped, with a warning.
+ *
+ * Usage: gl_replay capture.azgl [--loops N] [--finish] [--check-errors]
+ *                  [--top N] [--json out.json]
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <gl_capture.hpp>
+#include <bench_stats.hpp>
+#include <headless_context.hpp>
+#include <json.hpp>
+
+namespace {
+    struct Options {
+        std::string capture_path;
+        int loops = 10;
+        bool finish = false;
+        bool check_errors = false;
+        std::size_t top = 15;
+        std::string json_path;
+    };
+
+    struct FunctionTotal {
+        std::uint64_t calls = 0;
+        std::uint64_t time_ns = 0;
+    };
+
+    Options parse_options(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--finish") {
+                options.finish = true;
+                continue;
+            }
+            if (arg == "--check-errors") {
+                options.check_errors = true;
+                continue;
+            }
+            if (!arg.starts_with("--")) {
+                if (!options.capture_path.empty()) {
+                    throw std::runtime_error("More than one capture given");
+                }
+                options.capture_path = arg;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                throw std::runtime_error("Missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if (arg == "--loops") {
+                options.loops = std::max(1, std::stoi(value));
+            } else if (arg == "--top") {
+                options.top = std::size_t(std::max(0, std::stoi(value)));
+            } else if (arg == "--json") {
+                options.json_path = value;
+            } else {
+                throw std::runtime_error("Unknown option " + arg);
+            }
+        }
+        if (options.capture_path.empty()) {
+            throw std::runtime_error("No capture given");
+        }
+        return options;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\nusage: gl_replay capture.azgl [--loops N] [--finish] [--check-errors]"
+                     " [--top N] [--json out.json]\n";
+        return 2;
+    }
+
+    try {
+        GlReplay replay{options.capture_path};
+        if (replay.frames == 0) {
+            throw std::runtime_error("No frames captured in '" + options.capture_path + "'");
+        }
+        HeadlessContext context{std::max(replay.width, 1), std::max(replay.height, 1)};
+
+        /* Thread 0 renders to the offscreen framebuffer; others get contexts
+         * of their own */
+        std::vector<std::function<void()>> thread_contexts;
+        for (std::size_t thread = 1; thread < replay.threads; ++thread) {
+            thread_contexts.push_back(context.shared_context());
+        }
+        context.make_current();
+        context.bind_framebuffer();
+        GLint framebuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        replay.default_framebuffer = GLuint(framebuffer);
+        replay.check_errors = options.check_errors;
+        replay.make_current = [&](std::size_t thread) {
+            if (thread == 0) {
+                context.make_current();
+            } else {
+                thread_contexts.at(thread - 1)();
+            }
+        };
+
+        replay.set_up();
+        glFinish();
+
+        std::vector<double> frame_ms;
+        std::vector<double> loop_ms;
+        std::map<std::string, FunctionTotal> totals;
+        std::uint64_t calls = 0;
+        std::uint64_t errors = 0;
+        for (int loop = 0; loop < options.loops; ++loop) {
+            auto start = std::chrono::steady_clock::now();
+            GlReplayStats stats = replay.play_frames();
+            if (options.finish) {
+                glFinish();
+            }
+            loop_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+                              .count());
+            frame_ms.insert(frame_ms.end(), stats.frame_ms.begin(), stats.frame_ms.end());
+            for (const GlReplayFunctionStats& function : stats.functions) {
+                FunctionTotal& total = totals[function.name];
+                total.calls += function.calls;
+                total.time_ns += function.time_ns;
+            }
+            calls += stats.calls;
+            errors += stats.errors;
+        }
+        /* Back to the context holding the offscreen framebuffer */
+        replay.make_current(0);
+
+        std::vector<std::pair<std::string, FunctionTotal>> functions(totals.begin(), totals.end());
+        std::sort(functions.begin(), functions.end(), [](const auto& a, const auto& b) {
+            return a.second.time_ns > b.second.time_ns;
+        });
+        functions.resize(std::min(functions.size(), options.top));
+        double total_ms = std::accumulate(frame_ms.begin(), frame_ms.end(), 0.0);
+
+        SampleSummary frame = summarize(frame_ms);
+        SampleSummary loop = summarize(loop_ms);
+        std::printf("%s on %s, %dx%d, %zu frames x %d loops, %zu threads, %.0f calls per frame\n",
+                    options.capture_path.c_str(), context.renderer().c_str(), replay.width, replay.height,
+                    replay.frames, options.loops, replay.threads, double(calls) / frame_ms.size());
+        std::printf("frame ms: mean %.4f p50 %.4f p90 %.4f p99 %.4f max %.4f\n", frame.mean, frame.p50, frame.p90,
+                    frame.p99, frame.max);
+        std::printf("loop ms:  mean %.4f p50 %.4f p90 %.4f p99 %.4f max %.4f%s\n", loop.mean, loop.p50, loop.p90,
+                    loop.p99, loop.max, options.finish ? " (with glFinish)" : "");
+        if (options.check_errors) {
+            std::printf("GL errors: %llu\n", static_cast<unsigned long long>(errors));
+        }
+        if (!functions.empty()) {
+            std::printf("\n%-36s %12s %12s %8s\n", "function", "calls/frame", "us/call", "share");
+            for (const auto& [name, total] : functions) {
+                std::printf("%-36s %12.1f %12.3f %7.1f%%\n", name.c_str(), double(total.calls) / frame_ms.size(),
+                            total.time_ns / 1e3 / total.calls, total_ms > 0.0 ? total.time_ns / 1e4 / total_ms : 0.0);
+            }
+        }
+
+        if (!options.json_path.empty()) {
+            std::ostringstream json_text;
+            JsonWriter json{json_text};
+            json.begin_object()
+                .field("capture", options.capture_path)
+                .field("renderer", context.renderer())
+                .field("width", replay.width)
+                .field("height", replay.height)
+                .field("frames", std::uint64_t(replay.frames))
+                .field("loops", options.loops)
+                .field("threads", std::uint64_t(replay.threads))
+                .field("calls", calls)
+                .field("errors", errors);
+            write_summary(json, "frame_ms", frame);
+            write_summary(json, "loop_ms", loop);
+            json.begin_array("functions");
+            for (const auto& [name, total] : functions) {
+                json.begin_object()
+                    .field("name", name)
+                    .field("calls", total.calls)
+                    .field("time_ns", total.time_ns)
+                    .end_object();
+            }
+            json.end_array().end_object();
+
+            std::ofstream out{options.json_path};
+            out << json_text.str();
+            if (!out.flush()) {
+                throw std::runtime_error("Cannot write " + options.json_path);
+            }
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,617 @@
+/**
+ * Golden-image checks: renders the scenes of the studies (02-quads with a
+ * fixed seed, 03-texquad, also in a half-size window, and 04-orthographic)
+ * headless, reads them back and compares them with the PNGs in ../golden,
+ * pixel by pixel.
+ *
+ * A case is one way of rendering a scene. The reference case of each scene
+ * takes the plainest path there is and is what its golden image is made
+ * from; every other case renders the same scene through an optimised path
+ * (reduced decoding, the texture manager, program pipelines, ...) and has
+ * to match that same image. A new fast path gets a case here, next to its
+ * reference.
+ *
+ * Pixels match when no channel is off by more than the tolerance (or the
+ * case's own, if larger); a case passes when at most the given fraction of
+ * its pixels do not. For a failed case the rendered image and a diff image
+ * (mismatches in red over the dimmed golden image) are written to the output
+ * directory. The exit status is 1 if any case failed.
+ *
+ * --update rewrites the golden images from the reference cases; check the
+ * new images before committing them.
+ *
+ * Usage: golden_images [--update] [--tolerance 2] [--max-mismatch 0.001]
+ *                      [--out directory] [case...] (run from the src
+ *                      directory)
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <stb/stb_image.h>
+
+#include <asset_pipeline.hpp>
+#include <async_shader.hpp>
+#include <geometry.hpp>
+#include <headless_context.hpp>
+#include <png_writer.hpp>
+#include <program_pipeline.hpp>
+#include <shader_preproc.hpp>
+#include <shader_prog.hpp>
+#include <texture.hpp>
+#include <texture_manager.hpp>
+
+namespace {
+    const char* GOLDEN_DIR = "../golden";
+
+    /* Renders into the bound framebuffer of `context` */
+    using Render = std::function<void(HeadlessContext& context)>;
+
+    struct Case {
+        std::string name;
+        /* Name of the golden image; the reference case has the same name */
+        std::string golden;
+        int width;
+        int height;
+        Render render;
+        /* Smallest tolerance for paths that differ from the reference by
+         * design, e.g. in how they filter */
+        int min_tolerance = 0;
+    };
+
+    /* std::uniform_real_distribution differs between standard libraries,
+     * which would make the golden images depend on the compiler; the
+     * engine's output is fully specified */
+    float uniform(std::mt19937& engine, float min, float max) {
+        return min + (max - min) * float(engine() >> 8) * 0x1p-24f;
+    }
+
+    /* 02-quads: the study never clears, so every frame's random quad stays */
+    void render_quads(HeadlessContext&) {
+        const int frames = 64;
+        ShaderProgram shader_program{
+            "../../02-quads/src/shaders/vertex.shader",
+            "../../02-quads/src/shaders/fragment.shader",
+            {"in_color", "transform"}
+        };
+        /* Texture coordinates are unused, but the geometry has room for them */
+        Geometry quad1{
+            {
+               -0.7f, -0.2f, 0.0f,  0.0f, 0.0f,
+               -0.7f,  0.7f, 0.0f,  0.0f, 0.0f,
+                0.3f, -0.2f, 0.0f,  0.0f, 0.0f,
+                0.3f,  0.7f, 0.0f,  0.0f, 0.0f,
+            },
+            {
+                0, 1, 2,
+                3, 1, 2,
+            }
+        };
+        shader_program.use();
+
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        std::mt19937 gen{2021};
+        for (int frame = 0; frame < frames; ++frame) {
+            glm::mat4 transform = glm::mat4(1.0f);
+            float tx = uniform(gen, -1.0f, 1.0f);
+            float ty = uniform(gen, -1.0f, 1.0f);
+            float tz = uniform(gen, -1.0f, 1.0f);
+            transform = glm::translate(transform, glm::vec3(tx, ty, tz));
+            float sx = uniform(gen, 0.1f, 1.2f);
+            float sy = uniform(gen, 0.1f, 1.2f);
+            float sz = uniform(gen, 0.1f, 1.2f);
+            transform = glm::scale(transform, glm::vec3(sx, sy, sz));
+            shader_program.set_uniform_matrix4fv(shader_program.get_uniform_location("transform"), transform);
+
+            float r = uniform(gen, 0.0f, 1.0f);
+            float g = uniform(gen, 0.0f, 1.0f);
+            float b = uniform(gen, 0.0f, 1.0f);
+            shader_program.set_uniform_4f(shader_program.get_uniform_location("in_color"), r, g, b, 1.0f);
+            quad1.draw();
+        }
+
+        quad1.del();
+        shader_program.del();
+    }
+
+    /* How texquad() gets its photo */
+    enum class Decode {
+        full,
+        /* Decoded in full, then halved with a box filter */
+        halved,
+        /* Decoded at the size it is shown at, as the study does; the window
+         * has to be small enough for that to be a reduction */
+        reduced,
+    };
+
+    /* 03-texquad: a tilted photo in perspective */
+    Render texquad(Decode decode) {
+        return [decode](HeadlessContext& context) {
+            ShaderProgram shader_program{
+                "../../03-texquad/src/shaders/vertex.shader",
+                "../../03-texquad/src/shaders/fragment.shader",
+                {"model", "view", "projection"}
+            };
+            Geometry quad{
+                {
+                    0.8f,  0.45f, 0.0f,  1.0f, 1.0f,
+                    0.8f, -0.45f, 0.0f,  1.0f, 0.0f,
+                   -0.8f, -0.45f, 0.0f,  0.0f, 0.0f,
+                   -0.8f,  0.45f, 0.0f,  0.0f, 1.0f,
+                },
+                {
+                    0, 1, 3,
+                    1, 2, 3,
+                }
+            };
+            shader_program.use();
+
+            glm::vec2 window{float(context.width), float(context.height)};
+            glm::mat4 model = glm::rotate(glm::mat4{1.0f}, glm::radians(-55.0f), glm::vec3{1.0f, 0.0f, 0.0f});
+            glm::mat4 view = glm::translate(glm::mat4{1.0f}, glm::vec3{0.0f, 0.0f, -2.0f});
+            glm::mat4 projection = glm::perspective(glm::radians(45.0f), window.x / window.y, 0.1f, 100.0f);
+
+            TextureSizeHint hint;
+            if (decode == Decode::reduced) {
+                glm::vec2 screen_min = window;
+                glm::vec2 screen_max{0.0f};
+                for (glm::vec3 corner : {glm::vec3{0.8f, 0.45f, 0.0f}, glm::vec3{0.8f, -0.45f, 0.0f},
+                                         glm::vec3{-0.8f, -0.45f, 0.0f}, glm::vec3{-0.8f, 0.45f, 0.0f}}) {
+                    glm::vec4 clip = projection * view * model * glm::vec4{corner, 1.0f};
+                    glm::vec2 screen = (glm::vec2{clip} / clip.w * 0.5f + 0.5f) * window;
+                    screen_min = glm::min(screen_min, screen);
+                    screen_max = glm::max(screen_max, screen);
+                }
+                glm::vec2 screen_size = glm::ceil(screen_max - screen_min);
+                hint = {int(screen_size.x), int(screen_size.y)};
+            }
+            DecodedImage image = decode_image("../../03-texquad/tex/texquad.jpeg", hint);
+            if (decode == Decode::halved) {
+                downsample_half(image);
+            }
+            /* The photo is 1024x576; at this size the JPEG decoder itself
+             * halves it, which the halved case's image checks */
+            if (decode == Decode::reduced && image.width != 512) {
+                int width = image.width;
+                image.free();
+                throw std::runtime_error("Decoded at " + std::to_string(width) + " wide instead of 512");
+            }
+            unsigned int texture = set_up_texture(image);
+            image.free();
+
+            shader_program.set_uniform_matrix4fv(shader_program.get_uniform_location("model"), model);
+            shader_program.set_uniform_matrix4fv(shader_program.get_uniform_location("view"), view);
+            shader_program.set_uniform_matrix4fv(shader_program.get_uniform_location("projection"), projection);
+
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            quad.draw();
+
+            delete_texture(texture);
+            quad.del();
+            shader_program.del();
+        };
+    }
+
+    /* Sets the model matrix of whatever sprite program is bound */
+    using SetModel = std::function<void(const glm::mat4& model)>;
+
+    /* 04-orthographic: two textured squares */
+    void draw_squares(GLuint texture1, GLuint texture2, const SetModel& set_model) {
+        Geometry square_geo{
+            {
+                 0.2f,  0.2f, 0.0f,  1.0f, 1.0f,
+                 0.2f, -0.2f, 0.0f,  1.0f, 0.0f,
+                -0.2f, -0.2f, 0.0f,  0.0f, 0.0f,
+                -0.2f,  0.2f, 0.0f,  0.0f, 1.0f,
+            },
+            {
+                0, 1, 3,
+                1, 2, 3,
+            }
+        };
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        glm::mat4 identity = glm::mat4{1.0f};
+        glm::mat4 sq1_transform = glm::translate(identity, glm::vec3(-0.4f, 0.0f, 0.0f));
+        glBindTexture(GL_TEXTURE_2D, texture1);
+        set_model(sq1_transform);
+        square_geo.draw();
+
+        glm::mat4 sq2_transform = glm::translate(identity, glm::vec3(0.4f, -0.3f, 0.0f));
+        sq2_transform = glm::rotate(sq2_transform, glm::radians(-42.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        glBindTexture(GL_TEXTURE_2D, texture2);
+        set_model(sq2_transform);
+        square_geo.draw();
+
+        square_geo.del();
+    }
+
+    void draw_squares(GLuint texture1, GLuint texture2) {
+        ShaderVariantCache shader_variants;
+        ShaderProgram shader_program{
+            shader_variants.get_program("shaders/vertex.shader", "shaders/fragment.shader", {{"TEXTURED", ""}}),
+            {"model"}
+        };
+        shader_program.use();
+        int model_location = shader_program.get_uniform_location("model");
+        draw_squares(texture1, texture2, [&](const glm::mat4& model) {
+            shader_program.set_uniform_matrix4fv(model_location, model);
+        });
+        shader_variants.del();
+    }
+
+    void render_squares(HeadlessContext&) {
+        GLuint textures[] = {set_up_texture("../tex/1.png"), set_up_texture("../tex/2.png")};
+        draw_squares(textures[0], textures[1]);
+        delete_texture(textures[0]);
+        delete_texture(textures[1]);
+    }
+
+    /* Tracks what the scheduler reports frame by frame and throws when a
+     * frame goes over the byte budget; every row sent here is far smaller
+     * than the budget, so there is no first-band overshoot */
+    struct UploadFrames {
+        std::size_t frames = 0;
+        std::size_t bytes = 0;
+        std::size_t max_queue_depth = 0;
+
+        void after_pump(const UploadScheduler& scheduler) {
+            if (scheduler.stats.frame_bytes > scheduler.budget.max_bytes) {
+                throw std::runtime_error("upload frame of " + std::to_string(scheduler.stats.frame_bytes)
+                        + " bytes, over the budget of " + std::to_string(scheduler.budget.max_bytes));
+            }
+            this->frames += scheduler.stats.frame_bytes > 0;
+            this->bytes += scheduler.stats.frame_bytes;
+            this->max_queue_depth = std::max(this->max_queue_depth, scheduler.stats.queue_depth);
+        }
+
+        /* A burst of `burst_bytes` took several frames, and the stats add up */
+        void check(const UploadScheduler& scheduler, std::size_t burst_bytes, const char* what) const {
+            std::string error;
+            if (this->bytes < burst_bytes) {
+                error = "frame_bytes add up to " + std::to_string(this->bytes);
+            } else if (this->frames < (burst_bytes + scheduler.budget.max_bytes - 1) / scheduler.budget.max_bytes) {
+                error = "took only " + std::to_string(this->frames) + " frames";
+            } else if (this->max_queue_depth == 0 || scheduler.stats.queue_depth != 0) {
+                error = "queue_depth was never set, or not cleared";
+            }
+            if (!error.empty()) {
+                throw std::runtime_error(std::string(what) + ": " + error);
+            }
+        }
+    };
+
+    /* A buffer upload larger than the budget, through the element array
+     * binding of a bound vertex array, which must survive it */
+    void check_buffer_upload(UploadScheduler& scheduler) {
+        const std::size_t size = 200 << 10;
+        std::shared_ptr<unsigned char[]> data{new unsigned char[size]};
+        for (std::size_t i = 0; i < size; ++i) {
+            data[i] = (unsigned char)(i * 7);
+        }
+
+        GLuint vertex_array;
+        GLuint buffers[2];
+        glGenVertexArrays(1, &vertex_array);
+        glGenBuffers(2, buffers);
+        glBindVertexArray(vertex_array);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[0]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        UploadFrames frames;
+        auto ticket = scheduler.enqueue_buffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1], 0, data, size);
+        while (scheduler.pending(ticket)) {
+            scheduler.pump();
+            frames.after_pump(scheduler);
+        }
+
+        GLint element_buffer = 0;
+        glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &element_buffer);
+        std::vector<unsigned char> uploaded(size);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+        glGetBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, uploaded.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glBindVertexArray(0);
+        glDeleteBuffers(2, buffers);
+        glDeleteVertexArrays(1, &vertex_array);
+
+        frames.check(scheduler, size, "buffer upload");
+        if (GLuint(element_buffer) != buffers[0]) {
+            throw std::runtime_error("buffer upload changed the vertex array's element buffer");
+        }
+        if (!std::equal(uploaded.begin(), uploaded.end(), data.get())) {
+            throw std::runtime_error("buffer upload sent the wrong bytes");
+        }
+    }
+
+    /* The study's own loading: texture manager, size hints, and an upload
+     * thread or, without one, uploads spread over frames by the scheduler,
+     * within its budget */
+    Render managed_squares(bool upload_thread) {
+        return [upload_thread](HeadlessContext& context) {
+            AssetPipeline asset_pipeline{0, upload_thread ? context.shared_context() : std::function<void()>{}};
+            asset_pipeline.report_imports = false;
+            /* Small enough a budget for the images to take several frames */
+            UploadScheduler upload_scheduler{{64 << 10, 2.0}};
+            asset_pipeline.scheduler = &upload_scheduler;
+            if (!upload_thread) {
+                check_buffer_upload(upload_scheduler);
+            }
+            TextureManager texture_manager{asset_pipeline};
+            TextureParams square_params;
+            square_params.size = {context.width / 5, context.height / 5};
+
+            /* Priorities given up front and changed while loading only
+             * reorder the uploads */
+            TextureHandle sq1_texture = texture_manager.acquire("../tex/1.png", square_params);
+            TextureHandle sq2_texture = texture_manager.acquire("../tex/2.png", square_params, 1.0f);
+            UploadFrames frames;
+            std::size_t total_before = upload_scheduler.stats.total_bytes;
+            while (!sq1_texture.ready() || !sq2_texture.ready()) {
+                if (frames.frames == 1) {
+                    sq1_texture.set_priority(2.0f);
+                }
+                asset_pipeline.pump();
+                frames.after_pump(upload_scheduler);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (!upload_thread) {
+                /* Level 0 of either image alone is over the budget */
+                frames.check(upload_scheduler, 2 * (64 << 10), "texture uploads");
+                if (upload_scheduler.stats.total_bytes - total_before != frames.bytes) {
+                    throw std::runtime_error("total_bytes does not match the frames' bytes");
+                }
+            }
+            context.bind_framebuffer();
+            draw_squares(sq1_texture.id(), sq2_texture.id());
+        };
+    }
+
+    /* Squares small enough for the 200x200 images to be minified, sampled
+     * from the mip chains built at import */
+    void render_mipmapped_squares(HeadlessContext&) {
+        GLuint textures[] = {set_up_texture("../tex/1.png"), set_up_texture("../tex/2.png")};
+        for (GLuint texture : textures) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        }
+        draw_squares(textures[0], textures[1]);
+        delete_texture(textures[0]);
+        delete_texture(textures[1]);
+    }
+
+    /* The same, from textures loaded for magnification, which fill their
+     * mip levels once told they are drawn smaller */
+    void render_lazy_mipmapped_squares(HeadlessContext& context) {
+        AssetPipeline asset_pipeline{0};
+        asset_pipeline.report_imports = false;
+        TextureManager texture_manager{asset_pipeline};
+
+        TextureHandle sq1_texture = texture_manager.acquire("../tex/1.png");
+        TextureHandle sq2_texture = texture_manager.acquire("../tex/2.png");
+        while (!sq1_texture.ready() || !sq2_texture.ready()) {
+            asset_pipeline.pump();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        sq1_texture.drawn_at(context.width / 5, context.height / 5);
+        sq2_texture.drawn_at(context.width / 5, context.height / 5);
+        draw_squares(sq1_texture.id(), sq2_texture.id());
+    }
+
+    /* The study's shaders: stages built asynchronously and mixed by a
+     * program pipeline where the context has separable programs, one
+     * program otherwise */
+    void render_pipeline_squares(HeadlessContext&) {
+        GLuint textures[] = {set_up_texture("../tex/1.png"), set_up_texture("../tex/2.png")};
+        ShaderDefines defines{{"TEXTURED", ""}};
+        std::string vert_shader_src = preprocess_shader("shaders/vertex.shader", defines).source;
+        std::string frag_shader_src = preprocess_shader("shaders/fragment.shader", defines).source;
+
+        AsyncProgramBuilder program_builder{HeadlessContext::get_proc_address};
+        PipelineCache pipeline_cache;
+        ProgramFuture vertex_build;
+        ProgramFuture fragment_build;
+        if (pipeline_cache.separable) {
+            vertex_build = program_builder.submit_stage(vert_shader_src, GL_VERTEX_SHADER);
+            fragment_build = program_builder.submit_stage(frag_shader_src, GL_FRAGMENT_SHADER);
+        } else {
+            vertex_build = fragment_build = program_builder.submit(vert_shader_src, frag_shader_src);
+        }
+        program_builder.wait_all();
+
+        const PipelineBinding& sprite = pipeline_cache.get(vertex_build.get(), fragment_build.get(), {"model"});
+        sprite.bind();
+        PipelineUniform model_uniform = sprite.get_uniform_location("model");
+        draw_squares(textures[0], textures[1], [&](const glm::mat4& model) {
+            sprite.set_uniform_matrix4fv(model_uniform, model);
+        });
+
+        if (sprite.fragment_program != sprite.vertex_program) {
+            glDeleteProgram(sprite.fragment_program);
+        }
+        glDeleteProgram(sprite.vertex_program);
+        pipeline_cache.del();
+        delete_texture(textures[0]);
+        delete_texture(textures[1]);
+    }
+
+    std::vector<Case> cases() {
+        return {
+            {"02-quads", "02-quads", 640, 480, render_quads},
+            {"03-texquad", "03-texquad", 1024, 768, texquad(Decode::full)},
+            {"03-texquad-half", "03-texquad-half", 512, 384, texquad(Decode::halved)},
+            /* The JPEG decoder's scaled IDCT is close to, not the same as,
+             * a box filter */
+            {"03-texquad-half/reduced-decode", "03-texquad-half", 512, 384, texquad(Decode::reduced), 12},
+            {"04-orthographic", "04-orthographic", 1024, 768, render_squares},
+            {"04-orthographic/texture-manager", "04-orthographic", 1024, 768, managed_squares(true)},
+            {"04-orthographic/upload-scheduler", "04-orthographic", 1024, 768, managed_squares(false)},
+            {"04-orthographic/pipeline", "04-orthographic", 1024, 768, render_pipeline_squares},
+            {"04-orthographic-small", "04-orthographic-small", 320, 240, render_mipmapped_squares},
+            {"04-orthographic-small/lazy-mipmaps", "04-orthographic-small", 320, 240,
+                render_lazy_mipmapped_squares},
+        };
+    }
+
+    struct Options {
+        bool update = false;
+        int tolerance = 2;
+        double max_mismatch = 0.001;
+        std::string out_dir = "../golden/failed";
+        std::vector<std::string> names;
+    };
+
+    int usage() {
+        std::cerr << "usage: golden_images [--update] [--tolerance 2] [--max-mismatch 0.001]"
+                     " [--out directory] [case...]\n";
+        return 2;
+    }
+
+    std::string file_name(const std::string& case_name) {
+        std::string name = case_name;
+        std::replace(name.begin(), name.end(), '/', '.');
+        return name;
+    }
+
+    /* Compares against the golden image; returns whether the case passed */
+    bool check(const Case& test, const std::vector<unsigned char>& pixels, const Options& options) {
+        int tolerance = std::max(options.tolerance, test.min_tolerance);
+        std::string golden_path = std::string(GOLDEN_DIR) + "/" + test.golden + ".png";
+        int width;
+        int height;
+        int channels;
+        unsigned char* golden = stbi_load(golden_path.c_str(), &width, &height, &channels, 4);
+        if (!golden) {
+            std::cout << "FAIL " << test.name << ": no golden image " << golden_path << " (run with --update)\n";
+            return false;
+        }
+        if (width != test.width || height != test.height) {
+            stbi_image_free(golden);
+            std::cout << "FAIL " << test.name << ": golden image is " << width << "x" << height << '\n';
+            return false;
+        }
+
+        /* Golden images are stored top row first, read back pixels bottom
+         * row first */
+        std::vector<unsigned char> diff(std::size_t(width) * height * 3);
+        std::size_t mismatches = 0;
+        int max_difference = 0;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const unsigned char* expected = golden + (std::size_t(y) * width + x) * 4;
+                const unsigned char* actual = &pixels[(std::size_t(height - 1 - y) * width + x) * 4];
+                int difference = 0;
+                for (int c = 0; c < 4; ++c) {
+                    difference = std::max(difference, std::abs(int(expected[c]) - int(actual[c])));
+                }
+                max_difference = std::max(max_difference, difference);
+
+                unsigned char* out = &diff[(std::size_t(y) * width + x) * 3];
+                if (difference > tolerance) {
+                    ++mismatches;
+                    out[0] = (unsigned char)std::max(128, difference);
+                    out[1] = 0;
+                    out[2] = 0;
+                } else {
+                    int gray = (expected[0] * 77 + expected[1] * 150 + expected[2] * 29) >> 8;
+                    out[0] = out[1] = out[2] = (unsigned char)(gray / 3);
+                }
+            }
+        }
+        stbi_image_free(golden);
+
+        double mismatch_fraction = double(mismatches) / (double(width) * height);
+        bool passed = mismatch_fraction <= options.max_mismatch;
+        std::cout << (passed ? "ok   " : "FAIL ") << test.name << ": " << mismatches << " pixels off by more than "
+                  << tolerance << " (" << mismatch_fraction * 100.0 << "%), largest difference "
+                  << max_difference << '\n';
+        if (!passed) {
+            std::filesystem::create_directories(options.out_dir);
+            std::string base = options.out_dir + "/" + file_name(test.name);
+            write_png(base + ".actual.png", pixels.data(), width, height, 4, true);
+            write_png(base + ".diff.png", diff.data(), width, height, 3);
+            std::cout << "     wrote " << base << ".actual.png and " << base << ".diff.png\n";
+        }
+        return passed;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--update") {
+            options.update = true;
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            options.tolerance = std::stoi(argv[++i]);
+        } else if (arg == "--max-mismatch" && i + 1 < argc) {
+            options.max_mismatch = std::stod(argv[++i]);
+        } else if (arg == "--out" && i + 1 < argc) {
+            options.out_dir = argv[++i];
+        } else if (arg.starts_with("--")) {
+            return usage();
+        } else {
+            options.names.push_back(arg);
+        }
+    }
+
+    set_flip_on_load(true);
+
+    int failures = 0;
+    int ran = 0;
+    for (const Case& test : cases()) {
+        if (!options.names.empty()
+                && std::find(options.names.begin(), options.names.end(), test.name) == options.names.end()) {
+            continue;
+        }
+        /* Only reference cases make golden images */
+        if (options.update && test.name != test.golden) {
+            continue;
+        }
+        ++ran;
+        try {
+            HeadlessContext context{test.width, test.height};
+            test.render(context);
+            context.bind_framebuffer();
+            std::vector<unsigned char> pixels = context.read_pixels();
+
+            if (options.update) {
+                std::filesystem::create_directories(GOLDEN_DIR);
+                std::string golden_path = std::string(GOLDEN_DIR) + "/" + test.golden + ".png";
+                write_png(golden_path, pixels.data(), test.width, test.height, 4, true);
+                std::cout << "wrote " << golden_path << '\n';
+            } else if (!check(test, pixels, options)) {
+                ++failures;
+            }
+        } catch (const std::exception& e) {
+            std::cout << "FAIL " << test.name << ": " << e.what() << '\n';
+            ++failures;
+        }
+    }
+    if (ran == 0) {
+        std::cerr << "No such case\n";
+        return 2;
+    }
+    if (!options.update) {
+        std::cout << ran - failures << " of " << ran << " cases passed\n";
+    }
+    return failures ? 1 : 0;
+}
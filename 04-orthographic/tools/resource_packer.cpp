@@ -0,0 +1,60 @@
+/**
+ * Packs files into a resource pack (see resource_pack.hpp). Each file is
+ * packed under the path it is given by, so run this from the directory the
+ * study runs from (src) and name files the way the code does.
+ *
+ * Usage: resource_packer [--no-compress] output.azpk file...
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <resource_pack.hpp>
+
+int main(int argc, char* argv[])
+{
+    bool compress = true;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--no-compress") {
+            compress = false;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() < 2) {
+        std::cerr << "usage: resource_packer [--no-compress] output.azpk file...\n";
+        return 2;
+    }
+
+    try {
+        std::vector<PackInput> inputs;
+        std::size_t bytes = 0;
+        for (auto path = paths.begin() + 1; path != paths.end(); ++path) {
+            std::ifstream in{*path, std::ios::binary};
+            if (!in) {
+                throw std::runtime_error("Error reading '" + *path + "'");
+            }
+            inputs.push_back({*path, {std::istreambuf_iterator<char>(in), {}}});
+            bytes += inputs.back().bytes.size();
+        }
+
+        std::vector<unsigned char> pack = build_resource_pack(inputs, compress);
+        std::ofstream out{paths[0], std::ios::binary};
+        out.write(reinterpret_cast<const char*>(pack.data()), std::streamsize(pack.size()));
+        if (!out.flush()) {
+            throw std::runtime_error("Error writing '" + paths[0] + "'");
+        }
+        std::cout << paths[0] << ": " << inputs.size() << " resources, " << bytes / 1024.0 << " KiB packed into "
+                  << pack.size() / 1024.0 << " KiB\n";
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * Cooks an image into an .aztx container (see cooked_texture.hpp) that the
+ * study maps and hands to GL without decoding, converting or building
+ * mipmaps at run time.
+ *
+ * Usage: texture_cooker [--format auto|raw|bc1|bc3] [--no-mips] [--no-flip]
+ *                       [--premultiply] input output.aztx
+ */
+
+#include <iostream>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <cooked_texture.hpp>
+#include <texture.hpp>
+
+namespace {
+    int usage() {
+        std::cerr << "usage: texture_cooker [--format auto|raw|bc1|bc3] [--no-mips] [--no-flip]"
+                     " [--premultiply] input output.aztx\n";
+        return 2;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    CookOptions options;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "auto") {
+                options.format = CookOptions::Format::automatic;
+            } else if (format == "raw") {
+                options.format = CookOptions::Format::raw;
+            } else if (format == "bc1") {
+                options.format = CookOptions::Format::bc1;
+            } else if (format == "bc3") {
+                options.format = CookOptions::Format::bc3;
+            } else {
+                return usage();
+            }
+        } else if (arg == "--no-mips") {
+            options.mipmaps = false;
+        } else if (arg == "--no-flip") {
+            options.flip_y = false;
+        } else if (arg == "--premultiply") {
+            options.premultiply_alpha = true;
+        } else if (arg.starts_with("--")) {
+            return usage();
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2) {
+        return usage();
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        DecodedImage image = decode_image(paths[0]);
+        std::vector<unsigned char> file;
+        try {
+            file = cook_texture(image, options);
+        } catch (...) {
+            image.free();
+            throw;
+        }
+        image.free();
+
+        std::ofstream out{paths[1], std::ios::binary};
+        out.write(reinterpret_cast<const char*>(file.data()), std::streamsize(file.size()));
+        if (!out.flush()) {
+            throw std::runtime_error("Error writing '" + paths[1] + "'");
+        }
+        out.close();
+
+        double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+        std::cout << cooked_report(paths[1], CookedTexture{paths[1]}) << " in " << ms << " ms\n";
+    } catch (const std::runtime_error& e) {
+        std::cerr << paths[0] << ": " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}